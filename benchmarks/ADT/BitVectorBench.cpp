@@ -0,0 +1,79 @@
+//===- BitVectorBench.cpp - BitVector benchmarks --------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These benchmarks use sets shaped like the liveness and register sets of the
+// code generator: a universe of registers or values, of which a fraction is
+// set, in clusters.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/BitVector.h"
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+BENCHMARK_RANGE(BitVector, SetAndTest, 256, 65536) {
+  unsigned Universe = State.getSize();
+  std::vector<unsigned> Bits =
+      clusteredBits(Universe, Universe / 8, State.getRng());
+  std::uniform_int_distribution<unsigned> Position(0, Universe - 1);
+  std::vector<unsigned> Queries;
+  for (unsigned I = 0, E = Bits.size(); I != E; ++I)
+    Queries.push_back(Position(State.getRng()));
+
+  State.setItemsPerIteration(Bits.size() + Queries.size());
+  while (State.keepRunning()) {
+    BitVector BV(Universe);
+    for (unsigned B : Bits)
+      BV.set(B);
+    unsigned Found = 0;
+    for (unsigned Q : Queries)
+      Found += BV.test(Q);
+    doNotOptimize(Found);
+  }
+}
+
+// Merge three sets, as when computing the live-out set of a block from its
+// successors.
+BENCHMARK_RANGE(BitVector, Union, 256, 65536) {
+  unsigned Universe = State.getSize();
+  BitVector Sets[3];
+  for (BitVector &BV : Sets) {
+    BV.resize(Universe);
+    for (unsigned B : clusteredBits(Universe, Universe / 8, State.getRng()))
+      BV.set(B);
+  }
+
+  State.setItemsPerIteration(Universe);
+  while (State.keepRunning()) {
+    BitVector Out(Sets[0]);
+    Out |= Sets[1];
+    Out |= Sets[2];
+    doNotOptimize(Out);
+  }
+}
+
+BENCHMARK_RANGE(BitVector, IterateSetBits, 256, 65536) {
+  unsigned Universe = State.getSize();
+  BitVector BV(Universe);
+  std::vector<unsigned> Bits =
+      clusteredBits(Universe, Universe / 8, State.getRng());
+  for (unsigned B : Bits)
+    BV.set(B);
+
+  State.setItemsPerIteration(Bits.size());
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (int I = BV.find_first(); I >= 0; I = BV.find_next(I))
+      Sum += I;
+    doNotOptimize(Sum);
+  }
+}
@@ -0,0 +1,138 @@
+//===- DenseMapBench.cpp - DenseMap benchmarks ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Each scenario is a template over the map type and is run for DenseMap and
+// for SwissDenseMap, so that the two suites can be compared name for name.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SwissDenseMap.h"
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+// Build a map keyed by IR object pointers, in allocation order.
+template <typename MapT> static void insertPointers(State &State) {
+  std::vector<void *> Keys = pointerKeys(State.getSize(), State.getRng());
+  State.setItemsPerIteration(Keys.size());
+  while (State.keepRunning()) {
+    MapT Map;
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Map[Keys[I]] = I;
+    doNotOptimize(Map);
+  }
+}
+
+// Look up pointer keys that are present, with a skewed access pattern.
+template <typename MapT> static void lookupPointers(State &State) {
+  std::vector<void *> Keys = pointerKeys(State.getSize(), State.getRng());
+  MapT Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+  std::vector<void *> Lookups;
+  for (unsigned I : zipfIndices(Keys.size(), 4096, 1.0, State.getRng()))
+    Lookups.push_back(Keys[I]);
+
+  State.setItemsPerIteration(Lookups.size());
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (void *K : Lookups)
+      Sum += Map.find(K)->second;
+    doNotOptimize(Sum);
+  }
+}
+
+// Look up pointers that are absent but interleaved with the present ones, as
+// when querying a map that holds a subset of a function's instructions.
+template <typename MapT> static void lookupMissPointers(State &State) {
+  std::vector<void *> Keys = pointerKeys(2 * State.getSize(), State.getRng());
+  MapT Map;
+  std::vector<void *> Lookups;
+  for (unsigned I = 0, E = Keys.size(); I != E; I += 2) {
+    Map[Keys[I]] = I;
+    Lookups.push_back(Keys[I + 1]);
+  }
+
+  State.setItemsPerIteration(Lookups.size());
+  while (State.keepRunning()) {
+    unsigned Found = 0;
+    for (void *K : Lookups)
+      Found += Map.count(K);
+    doNotOptimize(Found);
+  }
+}
+
+// Insert and then erase every key, leaving tombstones behind, like a map that
+// tracks a worklist.
+template <typename MapT> static void insertErasePointers(State &State) {
+  std::vector<void *> Keys = pointerKeys(State.getSize(), State.getRng());
+  State.setItemsPerIteration(Keys.size());
+  MapT Map;
+  while (State.keepRunning()) {
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Map[Keys[I]] = I;
+    for (void *K : Keys)
+      Map.erase(K);
+    doNotOptimize(Map);
+  }
+}
+
+// Refill a map keyed by value numbers that is cleared between functions.
+template <typename MapT> static void clearAndRefillIDs(State &State) {
+  std::vector<unsigned> Keys = denseIDs(State.getSize(), State.getRng());
+  State.setItemsPerIteration(Keys.size());
+  MapT Map;
+  while (State.keepRunning()) {
+    Map.clear();
+    for (unsigned K : Keys)
+      Map[K] = K;
+    doNotOptimize(Map);
+  }
+}
+
+template <typename MapT> static void iteratePointers(State &State) {
+  std::vector<void *> Keys = pointerKeys(State.getSize(), State.getRng());
+  MapT Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+
+  State.setItemsPerIteration(Keys.size());
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (auto &KV : Map)
+      Sum += KV.second;
+    doNotOptimize(Sum);
+  }
+}
+
+#define MAP_BENCHMARKS(Suite, MapTemplate)                                     \
+  BENCHMARK_RANGE(Suite, InsertPointers, 16, 65536) {                          \
+    insertPointers<MapTemplate<void *, unsigned>>(State);                      \
+  }                                                                            \
+  BENCHMARK_RANGE(Suite, LookupPointers, 16, 65536) {                          \
+    lookupPointers<MapTemplate<void *, unsigned>>(State);                      \
+  }                                                                            \
+  BENCHMARK_RANGE(Suite, LookupMissPointers, 16, 65536) {                      \
+    lookupMissPointers<MapTemplate<void *, unsigned>>(State);                  \
+  }                                                                            \
+  BENCHMARK_RANGE(Suite, InsertErasePointers, 16, 65536) {                     \
+    insertErasePointers<MapTemplate<void *, unsigned>>(State);                 \
+  }                                                                            \
+  BENCHMARK_RANGE(Suite, ClearAndRefillIDs, 16, 65536) {                       \
+    clearAndRefillIDs<MapTemplate<unsigned, unsigned>>(State);                 \
+  }                                                                            \
+  BENCHMARK_RANGE(Suite, IteratePointers, 16, 65536) {                         \
+    iteratePointers<MapTemplate<void *, unsigned>>(State);                     \
+  }
+
+MAP_BENCHMARKS(DenseMap, DenseMap)
+MAP_BENCHMARKS(SwissDenseMap, SwissDenseMap)
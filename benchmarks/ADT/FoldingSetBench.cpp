@@ -0,0 +1,105 @@
+//===- FoldingSetBench.cpp - FoldingSet benchmarks ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These benchmarks unique expression nodes the way ScalarEvolution and the
+// SelectionDAG do: an opcode and two operand pointers, most requests asking
+// for a node that already exists.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/Support/Allocator.h"
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+namespace {
+struct ExprNode : public FoldingSetNode {
+  unsigned Opcode;
+  void *LHS, *RHS;
+
+  ExprNode(unsigned Opcode, void *LHS, void *RHS)
+      : Opcode(Opcode), LHS(LHS), RHS(RHS) {}
+
+  static void Profile(FoldingSetNodeID &ID, unsigned Opcode, void *LHS,
+                      void *RHS) {
+    ID.AddInteger(Opcode);
+    ID.AddPointer(LHS);
+    ID.AddPointer(RHS);
+  }
+  void Profile(FoldingSetNodeID &ID) const { Profile(ID, Opcode, LHS, RHS); }
+};
+
+struct Request {
+  unsigned Opcode;
+  void *LHS, *RHS;
+};
+
+/// Return Count requests for nodes drawn from N distinct ones, with a skewed
+/// distribution.
+std::vector<Request> makeRequests(unsigned N, unsigned Count,
+                                  std::mt19937 &Rng) {
+  std::vector<void *> Operands = pointerKeys(N, Rng);
+  std::uniform_int_distribution<unsigned> Opcode(0, 15), Operand(0, N - 1);
+  std::vector<Request> Distinct;
+  for (unsigned I = 0; I != N; ++I)
+    Distinct.push_back({Opcode(Rng), Operands[I], Operands[Operand(Rng)]});
+  std::vector<Request> Requests;
+  for (unsigned I : zipfIndices(N, Count, 0.8, Rng))
+    Requests.push_back(Distinct[I]);
+  return Requests;
+}
+
+ExprNode *getOrCreate(FoldingSet<ExprNode> &Set, BumpPtrAllocator &Alloc,
+                      const Request &R) {
+  FoldingSetNodeID ID;
+  ExprNode::Profile(ID, R.Opcode, R.LHS, R.RHS);
+  void *InsertPos;
+  if (ExprNode *N = Set.FindNodeOrInsertPos(ID, InsertPos))
+    return N;
+  ExprNode *N = new (Alloc) ExprNode(R.Opcode, R.LHS, R.RHS);
+  Set.InsertNode(N, InsertPos);
+  return N;
+}
+} // end anonymous namespace
+
+// Unique the nodes into an empty set, creating each on its first request.
+BENCHMARK_RANGE(FoldingSet, GetOrInsert, 64, 65536) {
+  unsigned N = State.getSize();
+  std::vector<Request> Requests = makeRequests(N, 4 * N, State.getRng());
+  State.setItemsPerIteration(Requests.size());
+  while (State.keepRunning()) {
+    BumpPtrAllocator Alloc;
+    FoldingSet<ExprNode> Set;
+    for (const Request &R : Requests)
+      doNotOptimize(*getOrCreate(Set, Alloc, R));
+  }
+}
+
+// Look up nodes that all exist already.
+BENCHMARK_RANGE(FoldingSet, Find, 64, 65536) {
+  unsigned N = State.getSize();
+  std::vector<Request> Requests = makeRequests(N, 4096, State.getRng());
+  BumpPtrAllocator Alloc;
+  FoldingSet<ExprNode> Set;
+  for (const Request &R : Requests)
+    getOrCreate(Set, Alloc, R);
+
+  State.setItemsPerIteration(Requests.size());
+  while (State.keepRunning()) {
+    for (const Request &R : Requests) {
+      FoldingSetNodeID ID;
+      ExprNode::Profile(ID, R.Opcode, R.LHS, R.RHS);
+      void *InsertPos;
+      doNotOptimize(*Set.FindNodeOrInsertPos(ID, InsertPos));
+    }
+  }
+}
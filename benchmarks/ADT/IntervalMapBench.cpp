@@ -0,0 +1,80 @@
+//===- IntervalMapBench.cpp - IntervalMap benchmarks ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These benchmarks use the map the way a live interval union does: the keys
+// are slot indexes, and each segment maps to the interval it belongs to.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/IntervalMap.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+typedef IntervalMap<unsigned, unsigned> SegmentMap;
+
+// Insert disjoint segments of different intervals in no particular order.
+BENCHMARK_RANGE(IntervalMap, InsertSegments, 8, 32768) {
+  std::vector<std::pair<unsigned, unsigned>> Segments =
+      liveSegments(State.getSize(), State.getRng());
+  std::shuffle(Segments.begin(), Segments.end(), State.getRng());
+
+  State.setItemsPerIteration(Segments.size());
+  SegmentMap::Allocator Alloc;
+  while (State.keepRunning()) {
+    SegmentMap Map(Alloc);
+    for (unsigned I = 0, E = Segments.size(); I != E; ++I)
+      Map.insert(Segments[I].first, Segments[I].second, I + 1);
+    doNotOptimize(Map);
+  }
+}
+
+// Look up random slot indexes, which may fall in a segment or in a gap.
+BENCHMARK_RANGE(IntervalMap, LookupPoints, 8, 32768) {
+  std::vector<std::pair<unsigned, unsigned>> Segments =
+      liveSegments(State.getSize(), State.getRng());
+  SegmentMap::Allocator Alloc;
+  SegmentMap Map(Alloc);
+  for (unsigned I = 0, E = Segments.size(); I != E; ++I)
+    Map.insert(Segments[I].first, Segments[I].second, I + 1);
+
+  std::uniform_int_distribution<unsigned> Point(0, Segments.back().second);
+  std::vector<unsigned> Points;
+  for (unsigned I = 0; I != 4096; ++I)
+    Points.push_back(Point(State.getRng()));
+
+  State.setItemsPerIteration(Points.size());
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (unsigned P : Points)
+      Sum += Map.lookup(P);
+    doNotOptimize(Sum);
+  }
+}
+
+// Walk all the segments in order.
+BENCHMARK_RANGE(IntervalMap, Iterate, 8, 32768) {
+  std::vector<std::pair<unsigned, unsigned>> Segments =
+      liveSegments(State.getSize(), State.getRng());
+  SegmentMap::Allocator Alloc;
+  SegmentMap Map(Alloc);
+  for (unsigned I = 0, E = Segments.size(); I != E; ++I)
+    Map.insert(Segments[I].first, Segments[I].second, I + 1);
+
+  State.setItemsPerIteration(Segments.size());
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (SegmentMap::const_iterator I = Map.begin(); I.valid(); ++I)
+      Sum += I.stop() - I.start();
+    doNotOptimize(Sum);
+  }
+}
@@ -0,0 +1,66 @@
+//===- SmallPtrSetBench.cpp - SmallPtrSet benchmarks ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+// Fill a visited set during a graph walk: every node is reached once or
+// more, and later visits find it already present.  The smallest size stays
+// in the small mode of the set.
+BENCHMARK_RANGE(SmallPtrSet, InsertVisited, 4, 16384) {
+  std::vector<void *> Nodes = pointerKeys(State.getSize(), State.getRng());
+  std::vector<void *> Visits;
+  for (unsigned I : zipfIndices(Nodes.size(), 2 * Nodes.size(), 0.5,
+                                State.getRng()))
+    Visits.push_back(Nodes[I]);
+
+  State.setItemsPerIteration(Visits.size());
+  while (State.keepRunning()) {
+    SmallPtrSet<void *, 8> Visited;
+    unsigned New = 0;
+    for (void *N : Visits)
+      New += Visited.insert(N).second;
+    doNotOptimize(New);
+  }
+}
+
+// Query membership of a set half of whose candidates are present.
+BENCHMARK_RANGE(SmallPtrSet, Count, 4, 16384) {
+  std::vector<void *> Nodes = pointerKeys(2 * State.getSize(), State.getRng());
+  SmallPtrSet<void *, 8> Set;
+  for (unsigned I = 0, E = Nodes.size(); I != E; I += 2)
+    Set.insert(Nodes[I]);
+
+  State.setItemsPerIteration(Nodes.size());
+  while (State.keepRunning()) {
+    unsigned Found = 0;
+    for (void *N : Nodes)
+      Found += Set.count(N);
+    doNotOptimize(Found);
+  }
+}
+
+// Insert and erase every element of a set that is reused, like a set of
+// instructions pending deletion.
+BENCHMARK_RANGE(SmallPtrSet, InsertErase, 4, 16384) {
+  std::vector<void *> Nodes = pointerKeys(State.getSize(), State.getRng());
+  SmallPtrSet<void *, 8> Set;
+  State.setItemsPerIteration(Nodes.size());
+  while (State.keepRunning()) {
+    for (void *N : Nodes)
+      Set.insert(N);
+    for (void *N : Nodes)
+      Set.erase(N);
+    doNotOptimize(Set);
+  }
+}
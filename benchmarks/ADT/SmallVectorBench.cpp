@@ -0,0 +1,93 @@
+//===- SmallVectorBench.cpp - SmallVector benchmarks ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+// Push elements one at a time.  The smallest size fits in the inline
+// storage; the others grow onto the heap.
+BENCHMARK_RANGE(SmallVector, PushBack, 4, 2048) {
+  unsigned N = State.getSize();
+  State.setItemsPerIteration(N);
+  while (State.keepRunning()) {
+    SmallVector<unsigned, 8> V;
+    for (unsigned I = 0; I != N; ++I)
+      V.push_back(I);
+    doNotOptimize(V);
+  }
+}
+
+// Append a range in one call, as when collecting the successors of a block.
+BENCHMARK_RANGE(SmallVector, AppendRange, 4, 2048) {
+  std::vector<void *> Source = pointerKeys(State.getSize(), State.getRng());
+  State.setItemsPerIteration(Source.size());
+  while (State.keepRunning()) {
+    SmallVector<void *, 8> V;
+    V.append(Source.begin(), Source.end());
+    doNotOptimize(V);
+  }
+}
+
+// Copy many short operand lists, most of which fit in the inline storage.
+BENCHMARK(SmallVector, CopyOperandLists) {
+  std::vector<void *> Values = pointerKeys(4096, State.getRng());
+  // Most instructions have one to three operands; a few, such as calls and
+  // PHIs, have many more.
+  std::geometric_distribution<unsigned> NumOperands(0.45);
+  std::uniform_int_distribution<unsigned> PickValue(0, Values.size() - 1);
+  std::vector<SmallVector<void *, 4>> Lists(1024);
+  for (SmallVector<void *, 4> &L : Lists)
+    for (unsigned I = 0, E = 1 + NumOperands(State.getRng()); I != E; ++I)
+      L.push_back(Values[PickValue(State.getRng())]);
+
+  State.setItemsPerIteration(Lists.size());
+  while (State.keepRunning()) {
+    std::vector<SmallVector<void *, 4>> Copies(Lists);
+    doNotOptimize(Copies);
+  }
+}
+
+// Keep a small vector sorted by inserting each element at its position, as
+// is done for small sets of registers or indices.
+BENCHMARK_RANGE(SmallVector, InsertSorted, 4, 512) {
+  std::vector<unsigned> Keys = denseIDs(State.getSize(), State.getRng());
+  std::shuffle(Keys.begin(), Keys.end(), State.getRng());
+  State.setItemsPerIteration(Keys.size());
+  while (State.keepRunning()) {
+    SmallVector<unsigned, 16> V;
+    for (unsigned K : Keys)
+      V.insert(std::lower_bound(V.begin(), V.end(), K), K);
+    doNotOptimize(V);
+  }
+}
+
+// Drain a worklist that is refilled as it is processed.
+BENCHMARK_RANGE(SmallVector, Worklist, 16, 16384) {
+  unsigned N = State.getSize();
+  State.setItemsPerIteration(N);
+  while (State.keepRunning()) {
+    SmallVector<unsigned, 16> Worklist;
+    Worklist.push_back(0);
+    unsigned Processed = 0;
+    while (!Worklist.empty()) {
+      unsigned Item = Worklist.pop_back_val();
+      ++Processed;
+      // Each item pushes its two children in an implicit binary tree.
+      for (unsigned Child = 2 * Item + 1; Child <= 2 * Item + 2; ++Child)
+        if (Child < N)
+          Worklist.push_back(Child);
+    }
+    doNotOptimize(Processed);
+  }
+}
@@ -0,0 +1,85 @@
+//===- SparseBitVectorBench.cpp - SparseBitVector benchmarks --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The universe in these benchmarks is large and only a few bits are set, in
+// clusters, which is where a sparse set is used instead of a BitVector.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+BENCHMARK_RANGE(SparseBitVector, Set, 64, 32768) {
+  unsigned N = State.getSize();
+  std::vector<unsigned> Bits = clusteredBits(64 * N, N, State.getRng());
+  std::shuffle(Bits.begin(), Bits.end(), State.getRng());
+  State.setItemsPerIteration(Bits.size());
+  while (State.keepRunning()) {
+    SparseBitVector<> SBV;
+    for (unsigned B : Bits)
+      SBV.set(B);
+    doNotOptimize(SBV);
+  }
+}
+
+BENCHMARK_RANGE(SparseBitVector, Test, 64, 32768) {
+  unsigned N = State.getSize();
+  SparseBitVector<> SBV;
+  for (unsigned B : clusteredBits(64 * N, N, State.getRng()))
+    SBV.set(B);
+  std::uniform_int_distribution<unsigned> Position(0, 64 * N - 1);
+  std::vector<unsigned> Queries;
+  for (unsigned I = 0; I != 4096; ++I)
+    Queries.push_back(Position(State.getRng()));
+
+  State.setItemsPerIteration(Queries.size());
+  while (State.keepRunning()) {
+    unsigned Found = 0;
+    for (unsigned Q : Queries)
+      Found += SBV.test(Q);
+    doNotOptimize(Found);
+  }
+}
+
+// Merge sparse sets, as in the points-to and dataflow solvers.
+BENCHMARK_RANGE(SparseBitVector, Union, 64, 32768) {
+  unsigned N = State.getSize();
+  SparseBitVector<> Sets[3];
+  for (SparseBitVector<> &SBV : Sets)
+    for (unsigned B : clusteredBits(64 * N, N, State.getRng()))
+      SBV.set(B);
+
+  State.setItemsPerIteration(3 * N);
+  while (State.keepRunning()) {
+    SparseBitVector<> Out(Sets[0]);
+    Out |= Sets[1];
+    Out |= Sets[2];
+    doNotOptimize(Out);
+  }
+}
+
+BENCHMARK_RANGE(SparseBitVector, Iterate, 64, 32768) {
+  unsigned N = State.getSize();
+  SparseBitVector<> SBV;
+  for (unsigned B : clusteredBits(64 * N, N, State.getRng()))
+    SBV.set(B);
+
+  State.setItemsPerIteration(N);
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (unsigned B : SBV)
+      Sum += B;
+    doNotOptimize(Sum);
+  }
+}
@@ -0,0 +1,95 @@
+//===- StringMapBench.cpp - StringMap benchmarks --------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These benchmarks use symbol names as keys.  Pass -symbols with the output of
+// "llvm-nm -just-symbol-name" to run them on a real symbol set.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Inputs.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+BENCHMARK_RANGE(StringMap, Insert, 64, 262144) {
+  std::vector<std::string> Names = symbolNames(State.getSize(), State.getRng());
+  State.setItemsPerIteration(Names.size());
+  while (State.keepRunning()) {
+    StringMap<unsigned> Map;
+    for (unsigned I = 0, E = Names.size(); I != E; ++I)
+      Map[Names[I]] = I;
+    doNotOptimize(Map);
+  }
+}
+
+// Look up names that are present, with a skewed access pattern.
+BENCHMARK_RANGE(StringMap, Lookup, 64, 262144) {
+  std::vector<std::string> Names = symbolNames(State.getSize(), State.getRng());
+  StringMap<unsigned> Map;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I)
+    Map[Names[I]] = I;
+  std::vector<StringRef> Lookups;
+  for (unsigned I : zipfIndices(Names.size(), 4096, 1.0, State.getRng()))
+    Lookups.push_back(Names[I]);
+
+  State.setItemsPerIteration(Lookups.size());
+  while (State.keepRunning()) {
+    unsigned Sum = 0;
+    for (StringRef K : Lookups)
+      Sum += Map.find(K)->second;
+    doNotOptimize(Sum);
+  }
+}
+
+// Look up names that are absent, each a present name with one more
+// character, so that every lookup pays for a full hash.
+BENCHMARK_RANGE(StringMap, LookupMiss, 64, 262144) {
+  std::vector<std::string> Names = symbolNames(State.getSize(), State.getRng());
+  StringMap<unsigned> Map;
+  std::vector<std::string> Lookups;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    Map[Names[I]] = I;
+    Lookups.push_back(Names[I] + "$");
+  }
+
+  State.setItemsPerIteration(Lookups.size());
+  while (State.keepRunning()) {
+    unsigned Found = 0;
+    for (const std::string &K : Lookups)
+      Found += Map.count(K);
+    doNotOptimize(Found);
+  }
+}
+
+// The string hash functions available in the tree, on the same names.
+BENCHMARK(StringHash, HashString) {
+  std::vector<std::string> Names = symbolNames(4096, State.getRng());
+  State.setItemsPerIteration(Names.size());
+  while (State.keepRunning()) {
+    unsigned H = 0;
+    for (StringRef Name : Names)
+      H += HashString(Name);
+    doNotOptimize(H);
+  }
+}
+
+BENCHMARK(StringHash, HashValue) {
+  std::vector<std::string> Names = symbolNames(4096, State.getRng());
+  State.setItemsPerIteration(Names.size());
+  while (State.keepRunning()) {
+    size_t H = 0;
+    for (StringRef Name : Names)
+      H += hash_value(Name);
+    doNotOptimize(H);
+  }
+}
@@ -0,0 +1,325 @@
+//===- Benchmark.cpp - Microbenchmark harness -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the registry and the driver of the microbenchmark
+// harness: calibration, sampling, statistics, and saving and comparing
+// results.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+static cl::opt<std::string>
+Filter("filter", cl::desc("Only run the benchmarks whose name matches this "
+                          "regular expression"),
+       cl::value_desc("regex"));
+
+static cl::opt<bool>
+ListOnly("list", cl::desc("List the benchmarks and exit"));
+
+static cl::opt<unsigned>
+NumSamples("samples", cl::desc("Number of timed samples of each benchmark"),
+           cl::init(10));
+
+static cl::opt<unsigned>
+MinSampleTime("min-sample-time",
+              cl::desc("Minimum duration of a sample, in milliseconds"),
+              cl::init(20));
+
+static cl::opt<unsigned>
+Seed("seed", cl::desc("Seed mixed into the inputs of every benchmark"),
+     cl::init(0));
+
+static cl::opt<std::string>
+SaveFile("save", cl::desc("Save the results to this file, as CSV"),
+         cl::value_desc("filename"));
+
+static cl::opt<std::string>
+BaselineFile("compare",
+             cl::desc("Compare the results to a file written by -save"),
+             cl::value_desc("filename"));
+
+static cl::opt<double>
+Threshold("threshold",
+          cl::desc("Smallest change of the median, in percent, that is "
+                   "reported as a regression or improvement"),
+          cl::init(5.0));
+
+static cl::opt<bool>
+FailOnRegression("fail-on-regression",
+                 cl::desc("Exit with an error if a benchmark regressed"));
+
+//===----------------------------------------------------------------------===//
+// State
+//===----------------------------------------------------------------------===//
+
+void State::startTimer() {
+  Started = true;
+  Start = Clock::now();
+}
+
+void State::stopTimer() {
+  // Keep returning false if the benchmark calls keepRunning() again.
+  if (Finished)
+    return;
+  Elapsed += Clock::now() - Start;
+  Finished = true;
+}
+
+//===----------------------------------------------------------------------===//
+// Registry
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct BenchmarkInfo {
+  std::string Suite;
+  std::string Name;
+  BenchmarkFn Fn;
+  std::vector<uint64_t> Sizes;
+};
+
+/// Statistics over the samples of one benchmark, in nanoseconds per item.
+struct Result {
+  std::string Name;
+  uint64_t Iterations;
+  double Min, Median, Mean, StdDev;
+};
+} // end anonymous namespace
+
+static std::vector<BenchmarkInfo> &getRegistry() {
+  static std::vector<BenchmarkInfo> Registry;
+  return Registry;
+}
+
+Registration::Registration(const char *Suite, const char *Name,
+                           BenchmarkFn Fn) {
+  getRegistry().push_back({Suite, Name, Fn, {0}});
+}
+
+Registration::Registration(const char *Suite, const char *Name,
+                           BenchmarkFn Fn, uint64_t Lo, uint64_t Hi) {
+  assert(Lo > 0 && Lo <= Hi && "Invalid size range");
+  std::vector<uint64_t> Sizes;
+  for (uint64_t Size = Lo; Size < Hi; Size *= 8)
+    Sizes.push_back(Size);
+  Sizes.push_back(Hi);
+  getRegistry().push_back({Suite, Name, Fn, std::move(Sizes)});
+}
+
+static std::string getFullName(const BenchmarkInfo &B, uint64_t Size) {
+  std::string FullName = B.Suite + "." + B.Name;
+  if (Size)
+    FullName += "/" + utostr(Size);
+  return FullName;
+}
+
+//===----------------------------------------------------------------------===//
+// Driver
+//===----------------------------------------------------------------------===//
+
+/// Run one sample of a benchmark, and return its time in seconds.
+static double runSample(const BenchmarkInfo &B, uint64_t Size,
+                        uint64_t Iterations, unsigned SampleSeed,
+                        uint64_t &ItemsPerIteration) {
+  State S(Size, Iterations, SampleSeed);
+  B.Fn(S);
+  if (!S.isFinished())
+    report_fatal_error("benchmark " + getFullName(B, Size) +
+                       " did not finish its timed loop");
+  ItemsPerIteration = S.getItemsPerIteration();
+  return S.getElapsedSeconds();
+}
+
+static Result runBenchmark(const BenchmarkInfo &B, uint64_t Size) {
+  std::string FullName = getFullName(B, Size);
+  // The inputs depend only on the name and the seed option, so they are the
+  // same from run to run and for every sample.
+  unsigned SampleSeed = (unsigned)hash_combine(hash_value(FullName),
+                                               unsigned(Seed));
+
+  // Find an iteration count that makes a sample last at least
+  // MinSampleTime.  This also warms up the caches and the allocator.
+  double MinTime = MinSampleTime / 1000.0;
+  uint64_t Iterations = 1;
+  uint64_t Items;
+  for (;;) {
+    double Time = runSample(B, Size, Iterations, SampleSeed, Items);
+    if (Time >= MinTime || Iterations >= (uint64_t(1) << 40))
+      break;
+    // Aim a little past the target so that noise does not make the next
+    // attempt fall short, but do not grow too fast from a tiny measurement.
+    double Scale = Time > 0 ? MinTime * 1.4 / Time : 100;
+    Scale = std::min(100.0, std::max(2.0, Scale));
+    Iterations = uint64_t(Iterations * Scale);
+  }
+
+  std::vector<double> Times;
+  for (unsigned I = 0, E = std::max(1u, unsigned(NumSamples)); I != E; ++I) {
+    double Time = runSample(B, Size, Iterations, SampleSeed, Items);
+    double ItemsPerSample = double(Iterations) * std::max<uint64_t>(Items, 1);
+    Times.push_back(Time * 1e9 / ItemsPerSample);
+  }
+  std::sort(Times.begin(), Times.end());
+
+  Result R;
+  R.Name = FullName;
+  R.Iterations = Iterations;
+  R.Min = Times.front();
+  size_t Mid = Times.size() / 2;
+  R.Median =
+      Times.size() % 2 ? Times[Mid] : (Times[Mid - 1] + Times[Mid]) / 2;
+  double Sum = 0;
+  for (double T : Times)
+    Sum += T;
+  R.Mean = Sum / Times.size();
+  double SquaredDeviations = 0;
+  for (double T : Times)
+    SquaredDeviations += (T - R.Mean) * (T - R.Mean);
+  R.StdDev = Times.size() > 1
+                 ? std::sqrt(SquaredDeviations / (Times.size() - 1))
+                 : 0;
+  return R;
+}
+
+static bool parseDouble(StringRef Str, double &Value) {
+  std::string Buffer = Str.str();
+  char *End;
+  Value = strtod(Buffer.c_str(), &End);
+  return !Buffer.empty() && *End == '\0';
+}
+
+/// Read the medians and standard deviations from a file written by -save.
+static bool readBaseline(StringRef Filename,
+                         StringMap<std::pair<double, double>> &Baseline) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+      MemoryBuffer::getFile(Filename);
+  if (std::error_code EC = BufOrErr.getError()) {
+    errs() << Filename << ": " << EC.message() << "\n";
+    return false;
+  }
+  SmallVector<StringRef, 0> Lines;
+  (*BufOrErr)->getBuffer().split(Lines, "\n", -1, false);
+  for (StringRef Line : Lines) {
+    SmallVector<StringRef, 6> Fields;
+    Line.split(Fields, ",");
+    double Median, StdDev;
+    // Skip the header and anything malformed.
+    if (Fields.size() != 6 || !parseDouble(Fields[3], Median) ||
+        !parseDouble(Fields[5], StdDev))
+      continue;
+    Baseline[Fields[0]] = std::make_pair(Median, StdDev);
+  }
+  return true;
+}
+
+int llvm::benchmark::runBenchmarks() {
+  std::vector<BenchmarkInfo> Benchmarks = getRegistry();
+  std::stable_sort(Benchmarks.begin(), Benchmarks.end(),
+                   [](const BenchmarkInfo &A, const BenchmarkInfo &B) {
+                     return A.Suite < B.Suite;
+                   });
+
+  Regex FilterRE(Filter);
+  std::string Error;
+  if (!Filter.empty() && !FilterRE.isValid(Error)) {
+    errs() << "invalid -filter: " << Error << "\n";
+    return 1;
+  }
+
+  std::vector<std::pair<const BenchmarkInfo *, uint64_t>> Selected;
+  for (const BenchmarkInfo &B : Benchmarks)
+    for (uint64_t Size : B.Sizes)
+      if (Filter.empty() || FilterRE.match(getFullName(B, Size)))
+        Selected.push_back(std::make_pair(&B, Size));
+
+  if (ListOnly) {
+    for (auto &BS : Selected)
+      outs() << getFullName(*BS.first, BS.second) << "\n";
+    return 0;
+  }
+
+  StringMap<std::pair<double, double>> Baseline;
+  if (!BaselineFile.empty() && !readBaseline(BaselineFile, Baseline))
+    return 1;
+
+  std::unique_ptr<raw_fd_ostream> Save;
+  if (!SaveFile.empty()) {
+    std::error_code EC;
+    Save.reset(new raw_fd_ostream(SaveFile, EC, sys::fs::F_Text));
+    if (EC) {
+      errs() << SaveFile << ": " << EC.message() << "\n";
+      return 1;
+    }
+    *Save << "name,iterations,min_ns,median_ns,mean_ns,stddev_ns\n";
+  }
+
+  outs() << "All times are nanoseconds per item over " << NumSamples
+         << " samples.\n";
+  outs() << left_justify("benchmark", 40) << right_justify("iterations", 12)
+         << right_justify("min", 11) << right_justify("median", 11)
+         << right_justify("mean", 11) << right_justify("stddev", 9);
+  if (!Baseline.empty())
+    outs() << right_justify("baseline", 11) << right_justify("change", 10);
+  outs() << "\n";
+
+  unsigned NumRegressions = 0;
+  for (auto &BS : Selected) {
+    Result R = runBenchmark(*BS.first, BS.second);
+    outs() << left_justify(R.Name, 40) << format("%12llu", R.Iterations)
+           << format("%11.2f%11.2f%11.2f%8.1f%%", R.Min, R.Median, R.Mean,
+                     R.Mean ? 100 * R.StdDev / R.Mean : 0.0);
+    auto Base = Baseline.find(R.Name);
+    if (Base != Baseline.end() && Base->second.first > 0) {
+      double Old = Base->second.first;
+      double Change = 100 * (R.Median - Old) / Old;
+      // A change within the noise of either run is not significant.
+      double Noise = 200 * std::max(R.StdDev, Base->second.second) / Old;
+      bool Significant = std::fabs(Change) >= std::max(double(Threshold),
+                                                       Noise);
+      outs() << format("%11.2f%+9.1f%%", Old, Change);
+      if (Significant)
+        outs() << (Change > 0 ? "  regression" : "  improvement");
+      if (Significant && Change > 0)
+        ++NumRegressions;
+    }
+    outs() << "\n";
+    outs().flush();
+
+    if (Save)
+      *Save << R.Name << "," << R.Iterations << ","
+            << format("%.4f,%.4f,%.4f,%.4f", R.Min, R.Median, R.Mean,
+                      R.StdDev)
+            << "\n";
+  }
+
+  if (NumRegressions) {
+    outs() << NumRegressions << " benchmark(s) regressed.\n";
+    if (FailOnRegression)
+      return 1;
+  }
+  return 0;
+}
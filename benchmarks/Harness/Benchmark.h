@@ -0,0 +1,158 @@
+//===- Benchmark.h - Microbenchmark harness ---------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a small harness for microbenchmarks of the LLVM support
+// libraries.  A benchmark is a function that prepares its inputs and then runs
+// a timed loop:
+//
+//   BENCHMARK_RANGE(DenseMap, InsertPointers, 16, 65536) {
+//     std::vector<void *> Keys = pointerKeys(State.getSize(), State.getRng());
+//     State.setItemsPerIteration(Keys.size());
+//     while (State.keepRunning()) {
+//       DenseMap<void *, unsigned> Map;
+//       for (void *K : Keys)
+//         Map[K] = 0;
+//       doNotOptimize(Map);
+//     }
+//   }
+//
+// The harness first calibrates the number of iterations of the loop so that a
+// sample takes a measurable time, and then takes several samples and reports
+// statistics over them.  The inputs are generated from a seed derived from the
+// name of the benchmark, so a benchmark sees the same inputs on every run and
+// regardless of which other benchmarks are selected.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_BENCHMARKS_HARNESS_BENCHMARK_H
+#define LLVM_BENCHMARKS_HARNESS_BENCHMARK_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace llvm {
+namespace benchmark {
+
+/// The state of one run of a benchmark.  The benchmark calls keepRunning() to
+/// drive its timed loop; the time between the first call and the call that
+/// returns false is measured, minus the time spent paused.
+class State {
+  typedef std::chrono::steady_clock Clock;
+
+  uint64_t Size;
+  uint64_t Iterations;
+  uint64_t Remaining;
+  uint64_t ItemsPerIteration = 1;
+  bool Started = false;
+  bool Finished = false;
+  Clock::time_point Start;
+  Clock::duration Elapsed = Clock::duration::zero();
+  std::mt19937 Rng;
+
+  void startTimer();
+  void stopTimer();
+
+public:
+  State(uint64_t Size, uint64_t Iterations, unsigned Seed)
+      : Size(Size), Iterations(Iterations), Remaining(Iterations), Rng(Seed) {}
+
+  /// Return true if the timed loop should run another iteration.
+  LLVM_ATTRIBUTE_ALWAYS_INLINE bool keepRunning() {
+    if (LLVM_UNLIKELY(!Started))
+      startTimer();
+    if (LLVM_LIKELY(Remaining != 0)) {
+      --Remaining;
+      return true;
+    }
+    stopTimer();
+    return false;
+  }
+
+  /// Stop the clock, so that per-iteration setup is not measured.
+  void pauseTiming() { Elapsed += Clock::now() - Start; }
+  /// Restart the clock after pauseTiming().
+  void resumeTiming() { Start = Clock::now(); }
+
+  /// The problem size this run was registered with, or 0 if the benchmark
+  /// is not parameterized.
+  uint64_t getSize() const { return Size; }
+
+  /// A random number generator seeded deterministically for this benchmark
+  /// and size.
+  std::mt19937 &getRng() { return Rng; }
+
+  /// Set the number of items one iteration of the timed loop processes.  The
+  /// results are reported per item.
+  void setItemsPerIteration(uint64_t Items) { ItemsPerIteration = Items; }
+
+  uint64_t getIterations() const { return Iterations; }
+  uint64_t getItemsPerIteration() const { return ItemsPerIteration; }
+
+  /// Return true once the timed loop has run to completion.
+  bool isFinished() const { return Finished; }
+
+  /// The time measured by the timed loop, in seconds.
+  double getElapsedSeconds() const {
+    return std::chrono::duration<double>(Elapsed).count();
+  }
+};
+
+typedef void (*BenchmarkFn)(State &);
+
+/// Registers a benchmark function with the harness.  Instances are created
+/// at namespace scope by the BENCHMARK macros.
+class Registration {
+public:
+  /// Register a benchmark that runs once with size 0.
+  Registration(const char *Suite, const char *Name, BenchmarkFn Fn);
+  /// Register a benchmark that runs for sizes Lo, Lo*8, Lo*64, ... up to and
+  /// including Hi.
+  Registration(const char *Suite, const char *Name, BenchmarkFn Fn,
+               uint64_t Lo, uint64_t Hi);
+};
+
+/// Force the compiler to assume that Value is read, so that the computation
+/// producing it is not optimized away.
+template <typename T> LLVM_ATTRIBUTE_ALWAYS_INLINE void doNotOptimize(T &Value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r"(&Value) : "memory");
+#else
+  static volatile const void *Sink;
+  Sink = &Value;
+#endif
+}
+
+/// Run the benchmarks selected on the command line and print the results.
+/// Returns the exit status of the benchmark program.
+int runBenchmarks();
+
+} // end namespace benchmark
+} // end namespace llvm
+
+#define BENCHMARK_FN_NAME(Suite, Name) Suite##_##Name##_Benchmark
+
+/// Define a benchmark that is run once, with a size of 0.
+#define BENCHMARK(Suite, Name)                                                 \
+  static void BENCHMARK_FN_NAME(Suite, Name)(::llvm::benchmark::State &);      \
+  static ::llvm::benchmark::Registration Suite##_##Name##_Registration(        \
+      #Suite, #Name, BENCHMARK_FN_NAME(Suite, Name));                          \
+  static void BENCHMARK_FN_NAME(Suite, Name)(::llvm::benchmark::State & State)
+
+/// Define a benchmark that is run for the sizes Lo, Lo*8, ... up to Hi.
+#define BENCHMARK_RANGE(Suite, Name, Lo, Hi)                                   \
+  static void BENCHMARK_FN_NAME(Suite, Name)(::llvm::benchmark::State &);      \
+  static ::llvm::benchmark::Registration Suite##_##Name##_Registration(        \
+      #Suite, #Name, BENCHMARK_FN_NAME(Suite, Name), Lo, Hi);                  \
+  static void BENCHMARK_FN_NAME(Suite, Name)(::llvm::benchmark::State & State)
+
+#endif
@@ -0,0 +1,197 @@
+//===- Inputs.cpp - Key distributions for microbenchmarks -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Inputs.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+static cl::opt<std::string>
+SymbolsFile("symbols",
+            cl::desc("Use the symbol names in this file, one per line, as "
+                     "string keys (see llvm-nm -just-symbol-name)"),
+            cl::value_desc("filename"));
+
+std::vector<void *> llvm::benchmark::pointerKeys(unsigned N,
+                                                 std::mt19937 &Rng) {
+  // Object sizes of common IR objects, in bytes.
+  static const unsigned Sizes[] = {24, 32, 48, 56, 64, 72, 88, 96, 128};
+  std::uniform_int_distribution<unsigned> PickSize(
+      0, array_lengthof(Sizes) - 1);
+  std::uniform_int_distribution<uintptr_t> SlabGap(1, 64);
+  const uintptr_t SlabSize = 4096;
+
+  std::vector<void *> Keys;
+  Keys.reserve(N);
+  uintptr_t SlabStart = 0x10000000;
+  uintptr_t Ptr = SlabStart;
+  for (unsigned I = 0; I != N; ++I) {
+    unsigned Size = Sizes[PickSize(Rng)];
+    if (Ptr + Size > SlabStart + SlabSize) {
+      SlabStart += SlabSize * SlabGap(Rng);
+      Ptr = SlabStart;
+    }
+    Keys.push_back(reinterpret_cast<void *>(Ptr));
+    Ptr += Size;
+  }
+  return Keys;
+}
+
+std::vector<unsigned> llvm::benchmark::denseIDs(unsigned N,
+                                                std::mt19937 &Rng) {
+  std::bernoulli_distribution Hole(0.05);
+  std::vector<unsigned> IDs;
+  IDs.reserve(N);
+  for (unsigned ID = 0; IDs.size() != N; ++ID)
+    if (!Hole(Rng))
+      IDs.push_back(ID);
+  return IDs;
+}
+
+static std::vector<std::string> readSymbolNames(unsigned N) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+      MemoryBuffer::getFileOrSTDIN(SymbolsFile);
+  if (std::error_code EC = BufOrErr.getError())
+    report_fatal_error(SymbolsFile + ": " + EC.message());
+
+  SmallVector<StringRef, 0> Lines;
+  (*BufOrErr)->getBuffer().split(Lines, "\n", -1, false);
+  StringSet<> Seen;
+  std::vector<std::string> Names;
+  for (StringRef Line : Lines) {
+    if (Names.size() == N)
+      break;
+    Line = Line.trim();
+    if (!Line.empty() && Seen.insert(Line).second)
+      Names.push_back(Line);
+  }
+  return Names;
+}
+
+std::vector<std::string> llvm::benchmark::symbolNames(unsigned N,
+                                                      std::mt19937 &Rng) {
+  if (!SymbolsFile.empty())
+    return readSymbolNames(N);
+
+  static const char *const Words[] = {
+      "llvm",     "clang",       "detail",     "DenseMap",    "SmallVector",
+      "Value",    "Function",    "Builder",    "Analysis",    "iterator",
+      "StringRef", "Twine",      "Instruction", "BasicBlock", "impl",
+      "PassManager", "Type",     "allocator"};
+  static const char *const Params[] = {"i", "j", "PKc", "RKS_", "S0_",
+                                       "Pv", "b", "m", "NS_9StringRefE",
+                                       "S1_"};
+  std::uniform_int_distribution<unsigned> Depth(1, 5),
+      Word(0, array_lengthof(Words) - 1),
+      Param(0, array_lengthof(Params) - 1), Arity(0, 4), Coin(0, 3);
+
+  std::vector<std::string> Names;
+  Names.reserve(N);
+  for (unsigned I = 0; I != N; ++I) {
+    std::string Name = "_ZN";
+    for (unsigned D = 0, E = Depth(Rng); D != E; ++D) {
+      StringRef W = Words[Word(Rng)];
+      Name += utostr(W.size()) + W.str();
+      if (Coin(Rng) == 0) {
+        StringRef Arg = Words[Word(Rng)];
+        Name += "I" + utostr(Arg.size()) + Arg.str() + "E";
+      }
+    }
+    // Make every name unique.
+    std::string Unique = "f" + utostr(I);
+    Name += utostr(Unique.size()) + Unique + "E";
+    unsigned A = Arity(Rng);
+    if (A == 0)
+      Name += "v";
+    for (; A; --A)
+      Name += Params[Param(Rng)];
+    Names.push_back(std::move(Name));
+  }
+  return Names;
+}
+
+std::vector<unsigned> llvm::benchmark::zipfIndices(unsigned N, unsigned Count,
+                                                   double S,
+                                                   std::mt19937 &Rng) {
+  // Sample ranks by inverting the cumulative distribution.
+  std::vector<double> CDF(N);
+  double Sum = 0;
+  for (unsigned I = 0; I != N; ++I)
+    CDF[I] = Sum += 1.0 / std::pow(double(I + 1), S);
+
+  // Map ranks to indices through a permutation, so that the hot keys are not
+  // the ones inserted first.
+  std::vector<unsigned> Permutation(N);
+  for (unsigned I = 0; I != N; ++I)
+    Permutation[I] = I;
+  std::shuffle(Permutation.begin(), Permutation.end(), Rng);
+
+  std::uniform_real_distribution<double> Uniform(0, Sum);
+  std::vector<unsigned> Indices;
+  Indices.reserve(Count);
+  for (unsigned I = 0; I != Count; ++I) {
+    unsigned Rank = std::lower_bound(CDF.begin(), CDF.end(), Uniform(Rng)) -
+                    CDF.begin();
+    Indices.push_back(Permutation[std::min(Rank, N - 1)]);
+  }
+  return Indices;
+}
+
+std::vector<unsigned> llvm::benchmark::clusteredBits(unsigned Universe,
+                                                     unsigned N,
+                                                     std::mt19937 &Rng) {
+  assert(N <= Universe && "More bits than positions");
+  std::vector<bool> Set(Universe);
+  std::uniform_int_distribution<unsigned> Start(0, Universe - 1);
+  std::geometric_distribution<unsigned> RunLength(0.1);
+  unsigned Count = 0;
+  while (Count != N) {
+    unsigned Bit = Start(Rng);
+    unsigned End = std::min(Universe, Bit + 1 + RunLength(Rng));
+    for (; Bit != End && Count != N; ++Bit) {
+      if (!Set[Bit]) {
+        Set[Bit] = true;
+        ++Count;
+      }
+    }
+  }
+
+  std::vector<unsigned> Bits;
+  Bits.reserve(N);
+  for (unsigned Bit = 0; Bit != Universe; ++Bit)
+    if (Set[Bit])
+      Bits.push_back(Bit);
+  return Bits;
+}
+
+std::vector<std::pair<unsigned, unsigned>>
+llvm::benchmark::liveSegments(unsigned N, std::mt19937 &Rng) {
+  // Slot indexes are spaced 16 apart, and most segments are short.
+  std::geometric_distribution<unsigned> Length(0.2), Gap(0.3);
+  std::vector<std::pair<unsigned, unsigned>> Segments;
+  Segments.reserve(N);
+  unsigned Pos = 16;
+  for (unsigned I = 0; I != N; ++I) {
+    unsigned Start = Pos;
+    unsigned End = Start + 16 * (1 + Length(Rng));
+    Segments.push_back(std::make_pair(Start, End));
+    Pos = End + 16 * (1 + Gap(Rng));
+  }
+  return Segments;
+}
@@ -0,0 +1,65 @@
+//===- Inputs.h - Key distributions for microbenchmarks ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares generators for the kinds of keys the compiler stores in
+// its containers.  Uniformly random keys flatter most hash tables and search
+// trees; these try to reproduce the structure of the real ones instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_BENCHMARKS_HARNESS_INPUTS_H
+#define LLVM_BENCHMARKS_HARNESS_INPUTS_H
+
+#include "llvm/Support/DataTypes.h"
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+namespace benchmark {
+
+/// Return N distinct pointers laid out like IR objects carved out of a bump
+/// allocator: mostly increasing addresses with the alignment and size mix of
+/// Values and Instructions, in slabs that are not adjacent.  These are the
+/// keys of most DenseMaps and SmallPtrSets.  The pointers are never
+/// dereferenced.
+std::vector<void *> pointerKeys(unsigned N, std::mt19937 &Rng);
+
+/// Return N distinct small integers, such as value numbers or virtual
+/// register numbers: a dense range with a few holes, in allocation order.
+std::vector<unsigned> denseIDs(unsigned N, std::mt19937 &Rng);
+
+/// Return N distinct symbol names.  If the harness was given a symbol list
+/// with -symbols, the names are taken from it, and there may be fewer than N.
+/// Otherwise they are generated to look like Itanium-mangled C++ names:
+/// nested namespaces, template arguments and parameter lists, with long
+/// common prefixes.
+std::vector<std::string> symbolNames(unsigned N, std::mt19937 &Rng);
+
+/// Return Count indices in [0, N) that follow a Zipf distribution with
+/// exponent S, shuffled so that the hot indices are spread over the range.
+/// Lookups in compiler tables are heavily skewed towards a few hot keys.
+std::vector<unsigned> zipfIndices(unsigned N, unsigned Count, double S,
+                                  std::mt19937 &Rng);
+
+/// Return N distinct bit positions below Universe, sorted, in clusters of
+/// consecutive bits like those of liveness and dataflow sets.
+std::vector<unsigned> clusteredBits(unsigned Universe, unsigned N,
+                                    std::mt19937 &Rng);
+
+/// Return N disjoint closed intervals in increasing order, with gaps
+/// between them, shaped like the segments of live ranges over slot indexes.
+std::vector<std::pair<unsigned, unsigned>> liveSegments(unsigned N,
+                                                        std::mt19937 &Rng);
+
+} // end namespace benchmark
+} // end namespace llvm
+
+#endif
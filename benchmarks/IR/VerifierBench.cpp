@@ -0,0 +1,105 @@
+//===- VerifierBench.cpp - Verifier benchmarks ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These benchmarks check a module of the given number of functions, each a
+// loop of a few dozen instructions with TBAA tags and a call to the previous
+// function, serially and with the function bodies checked in parallel.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <thread>
+
+using namespace llvm;
+using namespace llvm::benchmark;
+
+/// Return the text of a module of NumFunctions functions, with arithmetic
+/// whose constants are drawn from Rng.
+static std::string makeModuleText(unsigned NumFunctions, std::mt19937 &Rng) {
+  std::uniform_int_distribution<unsigned> Constant(1, 1000);
+  std::string Text;
+  raw_string_ostream OS(Text);
+  for (unsigned F = 0; F != NumFunctions; ++F) {
+    OS << "define i32 @f" << F << "(i32* %p, i32 %n) {\n"
+       << "entry:\n"
+       << "  br label %loop\n"
+       << "loop:\n"
+       << "  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]\n"
+       << "  %acc = phi i32 [ 0, %entry ], [ %acc.next, %body ]\n"
+       << "  %c = icmp slt i32 %i, %n\n"
+       << "  br i1 %c, label %body, label %exit\n"
+       << "body:\n"
+       << "  %q = getelementptr inbounds i32, i32* %p, i32 %i\n"
+       << "  %v0 = load i32, i32* %q, !tbaa !0\n";
+    for (unsigned I = 1; I != 24; ++I)
+      OS << "  %v" << I << " = " << (I % 3 ? "add" : "mul") << " i32 %v"
+         << I - 1 << ", " << Constant(Rng) << "\n";
+    if (F)
+      OS << "  %r = call i32 @f" << F - 1 << "(i32* %q, i32 %v23)\n";
+    else
+      OS << "  %r = add i32 %v23, 1\n";
+    OS << "  store i32 %r, i32* %q, !tbaa !0\n"
+       << "  %acc.next = add i32 %acc, %r\n"
+       << "  %i.next = add nsw i32 %i, 1\n"
+       << "  br label %loop\n"
+       << "exit:\n"
+       << "  ret i32 %acc\n"
+       << "}\n";
+  }
+  OS << "!0 = !{!1, !1, i64 0}\n"
+     << "!1 = !{!\"int\", !2}\n"
+     << "!2 = !{!\"tbaa root\"}\n";
+  return OS.str();
+}
+
+static std::unique_ptr<Module> makeModule(LLVMContext &Context,
+                                          unsigned NumFunctions,
+                                          std::mt19937 &Rng) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M =
+      parseAssemblyString(makeModuleText(NumFunctions, Rng), Err, Context);
+  if (!M)
+    report_fatal_error("cannot parse the benchmark module");
+  return M;
+}
+
+static void verifyModuleBenchmark(State &State, unsigned NumThreads) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = makeModule(Context, State.getSize(),
+                                         State.getRng());
+  uint64_t NumInstructions = 0;
+  for (const Function &F : *M)
+    for (const BasicBlock &BB : F)
+      NumInstructions += BB.size();
+
+  State.setItemsPerIteration(NumInstructions);
+  while (State.keepRunning()) {
+    bool Broken = verifyModule(*M, nullptr, NumThreads);
+    doNotOptimize(Broken);
+  }
+}
+
+BENCHMARK_RANGE(Verifier, ModuleSerial, 64, 4096) {
+  verifyModuleBenchmark(State, 1);
+}
+
+// With as many threads as the machine has, so compare it against the serial
+// benchmark on a machine with several.
+BENCHMARK_RANGE(Verifier, ModuleParallel, 64, 4096) {
+  verifyModuleBenchmark(State,
+                        std::max(2u, std::thread::hardware_concurrency()));
+}
@@ -674,6 +674,28 @@ function(add_unittest test_suite test_name)
   endif ()
 endfunction()
 
+function(add_benchmark bench_suite bench_name)
+  if( NOT LLVM_BUILD_BENCHMARKS )
+    set(EXCLUDE_FROM_ALL ON)
+  endif()
+
+  include_directories(${LLVM_MAIN_SRC_DIR}/benchmarks/Harness)
+
+  add_llvm_executable(${bench_name} ${ARGN})
+  set(outdir ${CMAKE_CURRENT_BINARY_DIR}/${CMAKE_CFG_INTDIR})
+  set_output_directory(${bench_name} ${outdir} ${outdir})
+  target_link_libraries(${bench_name}
+    BenchmarkHarness
+    LLVMSupport
+    )
+
+  add_dependencies(${bench_suite} ${bench_name})
+  get_target_property(bench_suite_folder ${bench_suite} FOLDER)
+  if (NOT ${bench_suite_folder} STREQUAL "NOTFOUND")
+    set_property(TARGET ${bench_name} PROPERTY FOLDER "${bench_suite_folder}")
+  endif ()
+endfunction()
+
 function(llvm_add_go_executable binary pkgpath)
   cmake_parse_arguments(ARG "ALL" "" "DEPENDS;GOFLAGS" ${ARGN})
 
@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 15
+#define LTO_API_VERSION 16
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -523,6 +523,39 @@ lto_codegen_optimize(lto_code_gen_t cg);
 extern const void*
 lto_codegen_compile_optimized(lto_code_gen_t cg, size_t* length);
 
+/**
+ * Sets the number of partitions the optimized merged module is split into by
+ * lto_codegen_compile_optimized_to_files(), and the number of threads used
+ * to generate code for the partitions. A thread count of 0 uses one thread
+ * per hardware thread.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int partitions,
+                            unsigned int threads);
+
+/**
+ * Generates code for the optimized merged module into one native object file
+ * per partition (see lto_codegen_set_parallelism()), generating code for the
+ * partitions in parallel. It will not run any IR optimizations on the merged
+ * module.
+ *
+ * Local symbols referenced from several partitions are given hidden
+ * visibility, so the object files taken together expose the same symbols to
+ * the linked output as a single object file would.
+ *
+ * The names of the files are written to names and their number to count.
+ * The array is owned by the lto_code_gen_t and stays valid until the next
+ * compilation or lto_codegen_dispose(). It is up to the linker to remove the
+ * files. Returns true on error.
+ *
+ * \since LTO_API_VERSION=16
+ */
+extern lto_bool_t
+lto_codegen_compile_optimized_to_files(lto_code_gen_t cg, const char ***names,
+                                       unsigned int *count);
+
 /**
  * Returns the runtime API version.
  *
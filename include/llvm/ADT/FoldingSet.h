@@ -345,7 +345,12 @@ public:
   /// Intern - Copy this node's data to a memory region allocated from the
   /// given allocator and return a FoldingSetNodeIDRef describing the
   /// interned data.
-  FoldingSetNodeIDRef Intern(BumpPtrAllocator &Allocator) const;
+  template <typename AllocatorT>
+  FoldingSetNodeIDRef Intern(AllocatorBase<AllocatorT> &Allocator) const {
+    unsigned *New = Allocator.template Allocate<unsigned>(Bits.size());
+    std::uninitialized_copy(Bits.begin(), Bits.end(), New);
+    return FoldingSetNodeIDRef(New, Bits.size());
+  }
 };
 
 // Convenience type to hide the implementation of the folding set.
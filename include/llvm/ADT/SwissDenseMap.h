@@ -0,0 +1,670 @@
+//===- llvm/ADT/SwissDenseMap.h - Group-probed hash table -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissDenseMap class, an open-addressing hash table
+// with the interface of DenseMap and the layout of a "Swiss table".
+//
+// Next to the array of buckets, the map keeps one control byte per bucket,
+// which says whether the bucket is empty, deleted, or full; a full bucket's
+// byte also holds 7 bits of the key's hash.  A lookup loads the control bytes
+// of a group of 16 buckets at once and compares them all against the hash
+// bits with a couple of SSE2 instructions, so it only touches the buckets
+// whose hash bits match: usually just the one holding the key, and none on a
+// miss.  DenseMap, in contrast, compares keys bucket by bucket along its
+// probe sequence, and every step can miss in the cache.
+//
+// Because emptiness is recorded in the control bytes, keys need no reserved
+// empty and tombstone values: KeyInfoT only has to provide getHashValue and
+// isEqual.  Erasing a key only leaves a deleted marker when its group is
+// full; otherwise the bucket becomes empty again, so maps with heavy churn do
+// not fill up with tombstones.
+//
+// Unlike DenseMap, the map mixes the result of getHashValue before using it,
+// so the weak hashes of DenseMapInfo for pointers and integers are fine.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSDENSEMAP_H
+#define LLVM_ADT_SWISSDENSEMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LLVM_SWISSDENSEMAP_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+namespace detail {
+/// Control byte values.  A full bucket stores the top 7 bits of its hash,
+/// which is never negative.
+enum : signed char { SwissEmpty = -128, SwissDeleted = -2 };
+
+/// The control bytes of a group of consecutive buckets, with operations that
+/// return a bitmask of the buckets matching a condition, bit I standing for
+/// bucket I of the group.
+class SwissGroup {
+public:
+  enum { Width = 16 };
+
+#ifdef LLVM_SWISSDENSEMAP_USE_SSE2
+  explicit SwissGroup(const signed char *Pos)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Pos))) {}
+
+  unsigned match(signed char H2) const {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(H2), Ctrl));
+  }
+  unsigned matchEmpty() const { return match(SwissEmpty); }
+  /// Empty and deleted are the only negative control bytes.
+  unsigned matchEmptyOrDeleted() const { return _mm_movemask_epi8(Ctrl); }
+
+private:
+  __m128i Ctrl;
+#else
+  explicit SwissGroup(const signed char *Pos) { memcpy(Ctrl, Pos, Width); }
+
+  unsigned match(signed char H2) const {
+    unsigned Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Mask |= unsigned(Ctrl[I] == H2) << I;
+    return Mask;
+  }
+  unsigned matchEmpty() const { return match(SwissEmpty); }
+  unsigned matchEmptyOrDeleted() const {
+    unsigned Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Mask |= unsigned(Ctrl[I] < 0) << I;
+    return Mask;
+  }
+
+private:
+  signed char Ctrl[Width];
+#endif
+};
+} // end namespace detail
+
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>, bool IsConst = false>
+class SwissDenseMapIterator;
+
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+class SwissDenseMap : public DebugEpochBase {
+public:
+  typedef unsigned size_type;
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef detail::DenseMapPair<KeyT, ValueT> value_type;
+
+  typedef SwissDenseMapIterator<KeyT, ValueT, KeyInfoT> iterator;
+  typedef SwissDenseMapIterator<KeyT, ValueT, KeyInfoT, true> const_iterator;
+
+private:
+  typedef value_type BucketT;
+  typedef detail::SwissGroup Group;
+
+  /// The control bytes, one per bucket.  The buckets follow them in the same
+  /// allocation.
+  signed char *Ctrl;
+  BucketT *Buckets;
+  unsigned NumEntries;
+  /// Zero, or a power of two that is at least the group width.
+  unsigned NumBuckets;
+  /// The number of empty buckets that can still be filled before the table
+  /// must be rehashed.  This keeps the load, counting deleted buckets, at
+  /// most 7/8, which guarantees that every probe sequence finds an empty
+  /// bucket.
+  unsigned GrowthLeft;
+
+public:
+  explicit SwissDenseMap(unsigned NumInitBuckets = 0) { init(NumInitBuckets); }
+
+  SwissDenseMap(const SwissDenseMap &Other) : DebugEpochBase() {
+    init(0);
+    copyFrom(Other);
+  }
+
+  SwissDenseMap(SwissDenseMap &&Other) : DebugEpochBase() {
+    init(0);
+    swap(Other);
+  }
+
+  template <typename InputIt>
+  SwissDenseMap(const InputIt &I, const InputIt &E) {
+    init(0);
+    reserve(std::distance(I, E));
+    insert(I, E);
+  }
+
+  ~SwissDenseMap() {
+    destroyAll();
+    operator delete(Ctrl);
+  }
+
+  SwissDenseMap &operator=(const SwissDenseMap &Other) {
+    if (&Other != this)
+      copyFrom(Other);
+    return *this;
+  }
+
+  SwissDenseMap &operator=(SwissDenseMap &&Other) {
+    destroyAll();
+    operator delete(Ctrl);
+    init(0);
+    swap(Other);
+    return *this;
+  }
+
+  void swap(SwissDenseMap &RHS) {
+    incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+  }
+
+  inline iterator begin() {
+    return empty() ? end() : iterator(Ctrl, Buckets, getBucketsEnd(), *this);
+  }
+  inline iterator end() {
+    return iterator(nullptr, getBucketsEnd(), getBucketsEnd(), *this, true);
+  }
+  inline const_iterator begin() const {
+    return empty() ? end()
+                   : const_iterator(Ctrl, Buckets, getBucketsEnd(), *this);
+  }
+  inline const_iterator end() const {
+    return const_iterator(nullptr, getBucketsEnd(), getBucketsEnd(), *this,
+                          true);
+  }
+
+  bool LLVM_ATTRIBUTE_UNUSED_RESULT empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it has at least Size buckets.  Does not shrink.
+  void resize(size_type Size) {
+    incrementEpoch();
+    if (Size > NumBuckets)
+      rehash(Size);
+  }
+
+  /// Grow the map so that NumEntries entries fit without rehashing.
+  void reserve(size_type NumEntries) {
+    resize(getMinBucketsFor(NumEntries));
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && GrowthLeft == getMaxLoad(NumBuckets))
+      return;
+
+    // If the table is huge and mostly unused, shrink it.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      shrink_and_clear();
+      return;
+    }
+
+    destroyAll();
+    memset(Ctrl, detail::SwissEmpty, NumBuckets);
+    NumEntries = 0;
+    GrowthLeft = getMaxLoad(NumBuckets);
+  }
+
+  void shrink_and_clear() {
+    unsigned OldNumEntries = NumEntries;
+    destroyAll();
+    unsigned NewNumBuckets = 0;
+    if (OldNumEntries)
+      NewNumBuckets = std::max(64u, getMinBucketsFor(OldNumEntries));
+    if (NewNumBuckets == NumBuckets) {
+      memset(Ctrl, detail::SwissEmpty, NumBuckets);
+      NumEntries = 0;
+      GrowthLeft = getMaxLoad(NumBuckets);
+      return;
+    }
+    operator delete(Ctrl);
+    init(NewNumBuckets);
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const KeyT &Val) const {
+    return findBucket(Val) != nullptr ? 1 : 0;
+  }
+
+  iterator find(const KeyT &Val) { return find_as(Val); }
+  const_iterator find(const KeyT &Val) const { return find_as(Val); }
+
+  /// Alternate version of find() which allows a different, and possibly less
+  /// expensive, key type.  KeyInfoT must provide getHashValue(LookupKeyT)
+  /// and isEqual(LookupKeyT, KeyT).
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    if (BucketT *B = findBucket(Val))
+      return makeIterator(B);
+    return end();
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    if (const BucketT *B = findBucket(Val))
+      return makeIterator(B);
+    return end();
+  }
+
+  /// Return the entry for the specified key, or a default constructed value
+  /// if no such entry exists.
+  ValueT lookup(const KeyT &Val) const {
+    if (const BucketT *B = findBucket(Val))
+      return B->getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    std::pair<unsigned, bool> Pos = findOrPrepareInsert(KV.first);
+    if (!Pos.second)
+      constructAt(Pos.first, KV.first, KV.second);
+    return std::make_pair(makeIterator(Buckets + Pos.first), !Pos.second);
+  }
+
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    std::pair<unsigned, bool> Pos = findOrPrepareInsert(KV.first);
+    if (!Pos.second)
+      constructAt(Pos.first, std::move(KV.first), std::move(KV.second));
+    return std::make_pair(makeIterator(Buckets + Pos.first), !Pos.second);
+  }
+
+  /// Range insertion of pairs.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    BucketT *B = findBucket(Val);
+    if (!B)
+      return false;
+    eraseBucket(B - Buckets);
+    return true;
+  }
+  void erase(iterator I) { eraseBucket(&*I - Buckets); }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    std::pair<unsigned, bool> Pos = findOrPrepareInsert(Key);
+    if (!Pos.second)
+      constructAt(Pos.first, Key, ValueT());
+    return Buckets[Pos.first];
+  }
+
+  ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    std::pair<unsigned, bool> Pos = findOrPrepareInsert(Key);
+    if (!Pos.second)
+      constructAt(Pos.first, std::move(Key), ValueT());
+    return Buckets[Pos.first];
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// Return true if the specified pointer points somewhere into the map's
+  /// array of buckets (i.e. either to a key or value in the map).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < getBucketsEnd();
+  }
+
+  /// Return an opaque pointer into the buckets array.  In conjunction with
+  /// the previous method, this can be used to determine whether an insertion
+  /// caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// Return the approximate size (in bytes) of the actual map.  This is just
+  /// the raw memory used by the map.  If entries are pointers to objects, the
+  /// size of the referenced objects are not included.
+  size_t getMemorySize() const {
+    return NumBuckets ? getBucketsOffset(NumBuckets) +
+                            NumBuckets * sizeof(BucketT)
+                      : 0;
+  }
+
+private:
+  BucketT *getBucketsEnd() const { return Buckets + NumBuckets; }
+
+  iterator makeIterator(BucketT *B) {
+    return iterator(Ctrl + (B - Buckets), B, getBucketsEnd(), *this, true);
+  }
+  const_iterator makeIterator(const BucketT *B) const {
+    return const_iterator(Ctrl + (B - Buckets), B, getBucketsEnd(), *this,
+                          true);
+  }
+
+  static unsigned getMaxLoad(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  /// Return the smallest number of buckets that holds NumEntries entries.
+  static unsigned getMinBucketsFor(unsigned NumEntries) {
+    if (NumEntries == 0)
+      return 0;
+    unsigned Buckets = Group::Width;
+    while (getMaxLoad(Buckets) < NumEntries)
+      Buckets *= 2;
+    return Buckets;
+  }
+
+  static size_t getBucketsOffset(unsigned NumBuckets) {
+    return RoundUpToAlignment(NumBuckets, AlignOf<BucketT>::Alignment);
+  }
+
+  /// Mix the hash of a key.  DenseMapInfo hashes are weak in the low bits
+  /// for pointers; a multiplication spreads every bit of the input over the
+  /// high bits of the product, which are the ones used.
+  template <typename LookupKeyT> static uint64_t hashOf(const LookupKeyT &Val) {
+    return uint64_t(KeyInfoT::getHashValue(Val)) * 0x9E3779B97F4A7C15ULL;
+  }
+  /// The hash bits stored in the control byte.
+  static signed char getH2(uint64_t Hash) {
+    return static_cast<signed char>(Hash >> 57);
+  }
+  /// The hash bits that select the first group to probe.
+  static unsigned getH1(uint64_t Hash) { return unsigned(Hash >> 32); }
+
+  /// Return the bucket holding Val, or null.  The groups are probed
+  /// quadratically, which visits every group because their number is a
+  /// power of two.
+  template <typename LookupKeyT>
+  BucketT *findBucket(const LookupKeyT &Val) const {
+    if (NumBuckets == 0)
+      return nullptr;
+    uint64_t Hash = hashOf(Val);
+    signed char H2 = getH2(Hash);
+    unsigned GroupMask = NumBuckets / Group::Width - 1;
+    unsigned G = getH1(Hash) & GroupMask;
+    for (unsigned Step = 1;; ++Step) {
+      unsigned Base = G * Group::Width;
+      Group Grp(Ctrl + Base);
+      for (unsigned M = Grp.match(H2); M; M &= M - 1) {
+        BucketT *B = Buckets + Base + countTrailingZeros(M);
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, B->getFirst())))
+          return B;
+      }
+      // A key is never placed beyond a group with an empty bucket.
+      if (LLVM_LIKELY(Grp.matchEmpty()))
+        return nullptr;
+      G = (G + Step) & GroupMask;
+    }
+  }
+
+  /// Return the first empty or deleted bucket on the probe sequence of Hash.
+  unsigned findFirstNonFull(uint64_t Hash) const {
+    unsigned GroupMask = NumBuckets / Group::Width - 1;
+    unsigned G = getH1(Hash) & GroupMask;
+    for (unsigned Step = 1;; ++Step) {
+      if (unsigned M = Group(Ctrl + G * Group::Width).matchEmptyOrDeleted())
+        return G * Group::Width + countTrailingZeros(M);
+      G = (G + Step) & GroupMask;
+    }
+  }
+
+  /// Look up Val.  Return the index of its bucket and true if it is present.
+  /// Otherwise, claim a bucket for it and return its index and false; the
+  /// caller must then construct the key and value with constructAt.
+  template <typename LookupKeyT>
+  std::pair<unsigned, bool> findOrPrepareInsert(const LookupKeyT &Val) {
+    if (NumBuckets == 0)
+      rehash(Group::Width);
+    uint64_t Hash = hashOf(Val);
+    signed char H2 = getH2(Hash);
+    unsigned GroupMask = NumBuckets / Group::Width - 1;
+    unsigned G = getH1(Hash) & GroupMask;
+    for (unsigned Step = 1;; ++Step) {
+      unsigned Base = G * Group::Width;
+      Group Grp(Ctrl + Base);
+      for (unsigned M = Grp.match(H2); M; M &= M - 1) {
+        unsigned Idx = Base + countTrailingZeros(M);
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, Buckets[Idx].getFirst())))
+          return std::make_pair(Idx, true);
+      }
+      if (LLVM_LIKELY(Grp.matchEmpty()))
+        break;
+      G = (G + Step) & GroupMask;
+    }
+
+    // Reuse the first deleted bucket of the probe sequence, or take an empty
+    // one if the load allows it.
+    unsigned Idx = findFirstNonFull(Hash);
+    if (LLVM_UNLIKELY(GrowthLeft == 0 && Ctrl[Idx] == detail::SwissEmpty)) {
+      // If deleted buckets make up a good part of the load, rehashing at the
+      // same size is enough to reclaim them.
+      if (uint64_t(NumEntries) * 32 <= uint64_t(NumBuckets) * 25)
+        rehash(NumBuckets);
+      else
+        rehash(NumBuckets * 2);
+      Idx = findFirstNonFull(Hash);
+    }
+    incrementEpoch();
+    if (Ctrl[Idx] == detail::SwissEmpty)
+      --GrowthLeft;
+    Ctrl[Idx] = H2;
+    ++NumEntries;
+    return std::make_pair(Idx, false);
+  }
+
+  template <typename KeyArg, typename ValueArg>
+  void constructAt(unsigned Idx, KeyArg &&Key, ValueArg &&Value) {
+    BucketT *B = Buckets + Idx;
+    new (&B->getFirst()) KeyT(std::forward<KeyArg>(Key));
+    new (&B->getSecond()) ValueT(std::forward<ValueArg>(Value));
+  }
+
+  void eraseBucket(unsigned Idx) {
+    BucketT *B = Buckets + Idx;
+    B->getSecond().~ValueT();
+    B->getFirst().~KeyT();
+    --NumEntries;
+    // If the group has an empty bucket, no probe sequence has ever continued
+    // past it, so the bucket can become empty too.  Otherwise a deleted
+    // marker keeps the probe sequences through this group going.
+    unsigned Base = Idx & ~unsigned(Group::Width - 1);
+    if (Group(Ctrl + Base).matchEmpty()) {
+      Ctrl[Idx] = detail::SwissEmpty;
+      ++GrowthLeft;
+    } else {
+      Ctrl[Idx] = detail::SwissDeleted;
+    }
+  }
+
+  bool allocateBuckets(unsigned Num) {
+    NumBuckets = Num;
+    if (NumBuckets == 0) {
+      Ctrl = nullptr;
+      Buckets = nullptr;
+      return false;
+    }
+    assert(isPowerOf2_32(NumBuckets) && NumBuckets >= Group::Width &&
+           "Invalid number of buckets");
+    Ctrl = static_cast<signed char *>(operator new(
+        getBucketsOffset(NumBuckets) + NumBuckets * sizeof(BucketT)));
+    Buckets = reinterpret_cast<BucketT *>(Ctrl + getBucketsOffset(NumBuckets));
+    return true;
+  }
+
+  void init(unsigned InitBuckets) {
+    NumEntries = 0;
+    if (InitBuckets)
+      InitBuckets =
+          std::max<unsigned>(Group::Width, NextPowerOf2(InitBuckets - 1));
+    if (allocateBuckets(InitBuckets))
+      memset(Ctrl, detail::SwissEmpty, NumBuckets);
+    GrowthLeft = getMaxLoad(NumBuckets);
+  }
+
+  /// Move the entries to a new table of at least AtLeast buckets.
+  void rehash(unsigned AtLeast) {
+    incrementEpoch();
+    signed char *OldCtrl = Ctrl;
+    BucketT *OldBuckets = Buckets;
+    unsigned OldNumBuckets = NumBuckets;
+    unsigned OldNumEntries = NumEntries;
+
+    init(std::max(AtLeast, getMinBucketsFor(OldNumEntries)));
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      BucketT *B = OldBuckets + I;
+      uint64_t Hash = hashOf(B->getFirst());
+      unsigned Idx = findFirstNonFull(Hash);
+      Ctrl[Idx] = getH2(Hash);
+      new (&Buckets[Idx].getFirst()) KeyT(std::move(B->getFirst()));
+      new (&Buckets[Idx].getSecond()) ValueT(std::move(B->getSecond()));
+      B->getSecond().~ValueT();
+      B->getFirst().~KeyT();
+    }
+    NumEntries = OldNumEntries;
+    GrowthLeft -= OldNumEntries;
+    operator delete(OldCtrl);
+  }
+
+  void destroyAll() {
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      Buckets[I].getSecond().~ValueT();
+      Buckets[I].getFirst().~KeyT();
+    }
+  }
+
+  void copyFrom(const SwissDenseMap &Other) {
+    destroyAll();
+    operator delete(Ctrl);
+    if (!allocateBuckets(Other.NumBuckets)) {
+      NumEntries = 0;
+      GrowthLeft = 0;
+      return;
+    }
+    memcpy(Ctrl, Other.Ctrl, NumBuckets);
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      new (&Buckets[I].getFirst()) KeyT(Other.Buckets[I].getFirst());
+      new (&Buckets[I].getSecond()) ValueT(Other.Buckets[I].getSecond());
+    }
+    NumEntries = Other.NumEntries;
+    GrowthLeft = Other.GrowthLeft;
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, bool IsConst>
+class SwissDenseMapIterator : DebugEpochBase::HandleBase {
+  typedef SwissDenseMapIterator<KeyT, ValueT, KeyInfoT, true> ConstIterator;
+  friend class SwissDenseMapIterator<KeyT, ValueT, KeyInfoT, true>;
+  friend class SwissDenseMapIterator<KeyT, ValueT, KeyInfoT, false>;
+
+  typedef detail::DenseMapPair<KeyT, ValueT> Bucket;
+
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename std::conditional<IsConst, const Bucket, Bucket>::type
+      value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+
+private:
+  const signed char *Ctrl;
+  pointer Ptr, End;
+
+public:
+  SwissDenseMapIterator() : Ctrl(nullptr), Ptr(nullptr), End(nullptr) {}
+
+  SwissDenseMapIterator(const signed char *Ctrl, pointer Pos, pointer E,
+                        const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ctrl(Ctrl), Ptr(Pos), End(E) {
+    assert(isHandleInSync() && "invalid construction!");
+    if (!NoAdvance)
+      AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined
+  // copy constructor.
+  template <bool IsConstSrc,
+            typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+  SwissDenseMapIterator(
+      const SwissDenseMapIterator<KeyT, ValueT, KeyInfoT, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ctrl(I.Ctrl), Ptr(I.Ptr), End(I.End) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ptr == RHS.Ptr;
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return !(*this == RHS);
+  }
+
+  inline SwissDenseMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  SwissDenseMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    SwissDenseMapIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+static inline size_t
+capacity_in_bytes(const SwissDenseMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif
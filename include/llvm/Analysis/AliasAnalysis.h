@@ -375,7 +375,7 @@ public:
   ModRefResult getModRefInfo(const Instruction *I) {
     if (auto CS = ImmutableCallSite(I)) {
       auto MRB = getModRefBehavior(CS);
-      if (MRB & ModRef)
+      if ((MRB & ModRef) == ModRef)
         return ModRef;
       else if (MRB & Ref)
         return Ref;
@@ -23,6 +23,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Mutex.h"
 #include <memory>
 
 namespace llvm {
@@ -157,6 +158,9 @@ class AssumptionCacheTracker : public ImmutablePass {
                    FunctionCallbackVH::DMI> FunctionCallsMap;
   FunctionCallsMap AssumptionCaches;
 
+  /// Guards AssumptionCaches when function passes run concurrently.
+  sys::Mutex CachesLock;
+
 public:
   /// \brief Get the cached assumptions for a function.
   ///
@@ -170,6 +174,11 @@ public:
   void releaseMemory() override { AssumptionCaches.shrink_and_clear(); }
 
   void verifyAnalysis() const override;
+
+  /// The threads of a multithreaded function pass manager share the tracker,
+  /// each working on the caches of different functions.
+  bool isThreadSafe() const override { return true; }
+
   bool doFinalization(Module &) override {
     verifyAnalysis();
     return false;
@@ -41,6 +41,7 @@ public:
   bool runOnFunction(Function &F) override;
   void releaseMemory() override;
   void print(raw_ostream &O, const Module *M) const override;
+  Pass *clone() const override { return new BlockFrequencyInfo(); }
   const Function *getFunction() const;
   void view() const;
 
@@ -48,6 +48,7 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   bool runOnFunction(Function &F) override;
   void print(raw_ostream &OS, const Module *M = nullptr) const override;
+  Pass *clone() const override { return new BranchProbabilityInfo(); }
 
   /// \brief Get an edge's probability, relative to other out-edges of the Src.
   ///
@@ -0,0 +1,102 @@
+//===- llvm/Analysis/KnownBitsCache.h - Cache known bits --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a cache of the known bits and of the number of sign bits
+// that ValueTracking computes for the instructions of a function, so that a
+// pass querying the same values again and again computes them once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_KNOWNBITSCACHE_H
+#define LLVM_ANALYSIS_KNOWNBITSCACHE_H
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/ValueHandle.h"
+#include <utility>
+
+namespace llvm {
+
+/// \brief A cache of the results of computeKnownBits and ComputeNumSignBits
+/// for the scalar instructions of one function.
+///
+/// The results are kept for each search depth they were computed at, so that
+/// a query gives what it would give without the cache.  The queries only use
+/// the cache when their results do not depend on their context instruction,
+/// that is when the function has no @llvm.assume calls and the dominating
+/// conditions are not looked at.
+///
+/// The cache forgets the results of a value, and of the values computed from
+/// it, when it is deleted or replaced.  A pass that changes an instruction in
+/// place must call invalidate() on it before querying again.  All the queries
+/// that share a cache must pass the same assumption cache and dominator tree.
+class KnownBitsCache {
+  /// \brief Forgets the results of a value when it is deleted or replaced.
+  class ValueCallbackVH final : public CallbackVH {
+    KnownBitsCache *KBC;
+    void deleted() override;
+    void allUsesReplacedWith(Value *) override;
+
+  public:
+    typedef DenseMapInfo<Value *> DMI;
+
+    ValueCallbackVH(Value *V, KnownBitsCache *KBC = nullptr)
+        : CallbackVH(V), KBC(KBC) {}
+  };
+
+  friend ValueCallbackVH;
+
+  typedef std::pair<const Value *, unsigned> Key;
+
+  struct KnownBits {
+    APInt KnownZero, KnownOne;
+  };
+
+  DenseMap<Key, KnownBits> KnownBitsResults;
+  DenseMap<Key, unsigned> SignBitsResults;
+
+  /// \brief The tracked values, each with the mask of the depths it has
+  /// results for.
+  DenseMap<ValueCallbackVH, unsigned, ValueCallbackVH::DMI> Tracked;
+
+  void track(Value *V, unsigned Depth);
+  bool forget(const Value *V);
+
+public:
+  KnownBitsCache() {}
+  KnownBitsCache(const KnownBitsCache &) = delete;
+  KnownBitsCache &operator=(const KnownBitsCache &) = delete;
+
+  /// \brief Look up the known bits of \p V computed at \p Depth.  Return false
+  /// if they are not in the cache.
+  bool lookupKnownBits(const Value *V, unsigned Depth, APInt &KnownZero,
+                       APInt &KnownOne) const;
+  void cacheKnownBits(Value *V, unsigned Depth, const APInt &KnownZero,
+                      const APInt &KnownOne);
+
+  /// \brief Look up the number of sign bits of \p V computed at \p Depth.
+  /// Return 0 if it is not in the cache.
+  unsigned lookupNumSignBits(const Value *V, unsigned Depth) const;
+  void cacheNumSignBits(Value *V, unsigned Depth, unsigned NumSignBits);
+
+  /// \brief Forget the results of \p V and of the values whose results may
+  /// have been computed from them.
+  void invalidate(Value *V);
+
+  /// \brief Forget all the results.
+  void clear();
+
+  unsigned size() const {
+    return KnownBitsResults.size() + SignBitsResults.size();
+  }
+};
+
+} // end namespace llvm
+
+#endif
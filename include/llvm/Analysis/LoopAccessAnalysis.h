@@ -516,6 +516,8 @@ public:
 
   bool runOnFunction(Function &F) override;
 
+  Pass *clone() const override { return new LoopAccessAnalysis(); }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override;
 
   /// \brief Query the result of the loop access information for the loop \p L.
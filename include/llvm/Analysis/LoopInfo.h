@@ -766,6 +766,8 @@ public:
   /// \brief Calculate the natural loop information for a given function.
   bool runOnFunction(Function &F) override;
 
+  Pass *clone() const override { return new LoopInfoWrapperPass(); }
+
   void verifyAnalysis() const override;
 
   void releaseMemory() override { LI.releaseMemory(); }
@@ -113,6 +113,9 @@ public:
   PMDataManager *getAsPMDataManager() override { return this; }
   Pass *getAsPass() override { return this; }
 
+  /// Return an empty manager, the contained passes are copied by the caller.
+  Pass *clone() const override { return new LPPassManager(); }
+
   /// Print passes managed by this manager
   void dumpPassStructure(unsigned Offset) override;
 
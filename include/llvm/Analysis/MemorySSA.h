@@ -0,0 +1,457 @@
+//===- MemorySSA.h - Build Memory SSA ---------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file exposes an interface to building and using memory SSA to walk the
+// memory dependences of a function.
+//
+// Memory SSA is a sparse form of SSA for the state of memory as a whole.  Each
+// instruction that may write memory is a MemoryDef, which produces a new
+// version of memory from the one it is given.  Each instruction that may only
+// read memory is a MemoryUse of the version it is given.  Where the versions
+// of memory of several predecessors meet, a MemoryPhi merges them.  The
+// version that the function starts with is the live on entry def, which is
+// not attached to any instruction.  For example:
+//
+//   define void @foo() {
+//   entry:
+//     %p1 = alloca i8
+//     %p2 = alloca i8
+//     ; 1 = MemoryDef(liveOnEntry)
+//     store i8 0, i8* %p1
+//     ; 2 = MemoryDef(1)
+//     store i8 0, i8* %p2
+//     br label %loop
+//   loop:
+//     ; 4 = MemoryPhi({entry,2},{loop,3})
+//     ; MemoryUse(4)
+//     %v = load i8, i8* %p1
+//     ; 3 = MemoryDef(4)
+//     store i8 %v, i8* %p2
+//     br label %loop
+//   }
+//
+// The defining access of an access is only the nearest access that may write
+// memory; it does not take into account what memory the instructions touch.
+// A MemorySSAWalker does, using alias analysis to skip over the defs that do
+// not write the location that an access reads or writes.  The load above is
+// not clobbered by 4, but by 1.
+//
+// Memory SSA is built once for a function, in time linear in its number of
+// instructions, and the passes that change memory instructions keep it up to
+// date with the update methods of MemorySSA.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/ilist.h"
+#include "llvm/ADT/ilist_node.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/Pass.h"
+#include <memory>
+
+namespace llvm {
+
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class MemoryAccess;
+class raw_ostream;
+
+template <class T> class DomTreeNodeBase;
+typedef DomTreeNodeBase<BasicBlock> DomTreeNode;
+
+/// \brief The base class of the nodes of memory SSA: a def, a use or a phi of
+/// the state of memory.
+class MemoryAccess : public ilist_node<MemoryAccess> {
+public:
+  enum AccessKind { AccessUse, AccessDef, AccessPhi };
+
+  typedef SmallPtrSet<MemoryAccess *, 4> UserSet;
+  typedef UserSet::const_iterator user_iterator;
+
+  virtual ~MemoryAccess();
+
+  AccessKind getKind() const { return Kind; }
+
+  /// \brief Return the block that the access belongs to.
+  BasicBlock *getBlock() const { return Block; }
+
+  /// \brief The accesses that are given this access as their version of
+  /// memory: the uses and defs it defines, and the phis it flows into.
+  iterator_range<user_iterator> users() const {
+    return iterator_range<user_iterator>(Users.begin(), Users.end());
+  }
+  bool user_empty() const { return Users.empty(); }
+
+  virtual void print(raw_ostream &OS) const = 0;
+  void dump() const;
+
+  /// \brief Print the name that the users of this access refer to it by.
+  void printAsOperand(raw_ostream &OS) const;
+
+protected:
+  MemoryAccess(AccessKind Kind, BasicBlock *BB) : Kind(Kind), Block(BB) {}
+
+  /// \brief Record that \p User is given this access, or no longer is.
+  void addUser(MemoryAccess *User) { Users.insert(User); }
+  void removeUser(MemoryAccess *User) { Users.erase(User); }
+
+private:
+  MemoryAccess(const MemoryAccess &) = delete;
+  void operator=(const MemoryAccess &) = delete;
+
+  const AccessKind Kind;
+  BasicBlock *Block;
+  UserSet Users;
+
+  friend class MemorySSA;
+  friend class MemoryUseOrDef;
+  friend class MemoryPhi;
+};
+
+/// \brief The sentinel of the lists of accesses of the blocks is a half node
+/// that lives in the list itself, as for the instruction lists.
+template <>
+struct ilist_traits<MemoryAccess> : public ilist_default_traits<MemoryAccess> {
+  mutable ilist_half_node<MemoryAccess> Sentinel;
+
+  MemoryAccess *createSentinel() const {
+    return static_cast<MemoryAccess *>(&Sentinel);
+  }
+  void destroySentinel(MemoryAccess *) {}
+
+  MemoryAccess *provideInitialHead() const { return createSentinel(); }
+  MemoryAccess *ensureHead(MemoryAccess *) const { return createSentinel(); }
+  static void noteHead(MemoryAccess *, MemoryAccess *) {}
+
+private:
+  void createNode(const MemoryAccess &);
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// \brief The common part of MemoryUse and MemoryDef: an access attached to
+/// an instruction, which is given the version of memory it reads or writes.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  /// \brief Return the instruction that the access is attached to.  This is
+  /// null for the live on entry def.
+  Instruction *getMemoryInst() const { return MemoryInst; }
+
+  /// \brief Return the nearest access above this one that may write memory.
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessUse || MA->getKind() == AccessDef;
+  }
+
+protected:
+  MemoryUseOrDef(AccessKind Kind, MemoryAccess *DMA, Instruction *MI,
+                 BasicBlock *BB)
+      : MemoryAccess(Kind, BB), MemoryInst(MI), DefiningAccess(nullptr) {
+    setDefiningAccess(DMA);
+  }
+
+  void setDefiningAccess(MemoryAccess *DMA);
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+
+  friend class MemorySSA;
+};
+
+/// \brief An instruction that may read memory, but not write it.
+class MemoryUse final : public MemoryUseOrDef {
+public:
+  MemoryUse(MemoryAccess *DMA, Instruction *MI, BasicBlock *BB)
+      : MemoryUseOrDef(AccessUse, DMA, MI, BB) {}
+
+  void print(raw_ostream &OS) const override;
+
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessUse;
+  }
+};
+
+/// \brief An instruction that may write memory, which makes a new version of
+/// memory from the one it is given.
+///
+/// The number of a def is what the accesses below it print to refer to it.
+class MemoryDef final : public MemoryUseOrDef {
+public:
+  MemoryDef(MemoryAccess *DMA, Instruction *MI, BasicBlock *BB, unsigned Ver)
+      : MemoryUseOrDef(AccessDef, DMA, MI, BB), ID(Ver) {}
+
+  unsigned getID() const { return ID; }
+
+  void print(raw_ostream &OS) const override;
+
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessDef;
+  }
+
+private:
+  const unsigned ID;
+};
+
+/// \brief The merge of the versions of memory that reach a block from its
+/// predecessors.  It has one incoming value for each edge into the block, as
+/// a PHINode has, and is the first access of the block.
+class MemoryPhi final : public MemoryAccess {
+public:
+  MemoryPhi(BasicBlock *BB, unsigned Ver)
+      : MemoryAccess(AccessPhi, BB), ID(Ver) {}
+
+  unsigned getID() const { return ID; }
+
+  unsigned getNumIncomingValues() const { return Operands.size(); }
+  MemoryAccess *getIncomingValue(unsigned I) const {
+    return Operands[I].second;
+  }
+  BasicBlock *getIncomingBlock(unsigned I) const { return Operands[I].first; }
+
+  /// \brief Return the first incoming value from \p BB, or null when \p BB
+  /// is not a predecessor.
+  MemoryAccess *getIncomingValueForBlock(const BasicBlock *BB) const;
+
+  void setIncomingValue(unsigned I, MemoryAccess *V);
+  void addIncoming(MemoryAccess *V, BasicBlock *BB);
+
+  void print(raw_ostream &OS) const override;
+
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessPhi;
+  }
+
+private:
+  /// \brief Return true if \p V is still one of the incoming values.
+  bool hasIncomingValue(const MemoryAccess *V) const;
+
+  const unsigned ID;
+  SmallVector<std::pair<BasicBlock *, MemoryAccess *>, 4> Operands;
+
+  friend class MemorySSA;
+};
+
+class MemorySSAWalker;
+
+/// \brief Memory SSA for a function: the accesses of its instructions, the
+/// phis that merge them, and a walker over them.
+class MemorySSA {
+public:
+  typedef iplist<MemoryAccess> AccessListType;
+
+  /// \brief Where to put an access that is created in a block.
+  enum InsertionPlace { Beginning, End };
+
+  MemorySSA(Function &F, AliasAnalysis *AA, DominatorTree *DT);
+  ~MemorySSA();
+
+  /// \brief Return the caching walker over this memory SSA.
+  MemorySSAWalker *getWalker() { return Walker.get(); }
+
+  /// \brief Return the access attached to the instruction \p I, or null if
+  /// it touches no memory.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const;
+
+  /// \brief Return the phi of the block \p BB, if it has one.
+  MemoryPhi *getMemoryAccess(const BasicBlock *BB) const;
+
+  /// \brief Return the accesses of the block \p BB in program order, with its
+  /// phi first, or null if it has none.
+  const AccessListType *getBlockAccesses(const BasicBlock *BB) const {
+    auto It = PerBlockAccesses.find(BB);
+    return It == PerBlockAccesses.end() ? nullptr : It->second.get();
+  }
+
+  /// \brief The version of memory the function starts with.  Every use of
+  /// it can read memory from before the function.
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef.get();
+  }
+
+  /// \brief Return true if \p Dominator dominates \p Dominatee.  An access
+  /// dominates itself, and the live on entry def dominates everything.
+  bool dominates(const MemoryAccess *Dominator,
+                 const MemoryAccess *Dominatee) const;
+
+  /// \name Updates
+  /// Passes that add or remove memory instructions call these to keep memory
+  /// SSA and the walker up to date.
+  /// @{
+
+  /// \brief Create the access of \p I, which must already be in \p BB, at the
+  /// beginning or the end of the accesses of the block.  Return null if \p I
+  /// touches no memory.
+  ///
+  /// The new access is given the version of memory at its place.  A new def
+  /// is given to the accesses below it, and phis are added where its version
+  /// meets others, which takes time linear in the size of the function.
+  MemoryUseOrDef *createMemoryAccessInBB(Instruction *I, BasicBlock *BB,
+                                         InsertionPlace Point);
+
+  /// \brief Create the access of \p I right before or right after the access
+  /// \p InsertPt, as createMemoryAccessInBB() does.
+  MemoryUseOrDef *createMemoryAccessBefore(Instruction *I,
+                                           MemoryUseOrDef *InsertPt);
+  MemoryUseOrDef *createMemoryAccessAfter(Instruction *I,
+                                          MemoryAccess *InsertPt);
+
+  /// \brief Remove and delete \p MA, giving its users the version of memory
+  /// it was given.  A phi may only be removed when all its incoming values
+  /// are the same, or when it has no users.  Call this before erasing the
+  /// instruction of an access.
+  void removeMemoryAccess(MemoryAccess *MA);
+  /// @}
+
+  /// \brief Check the structure of memory SSA, and abort if it is broken:
+  /// each access must be in the list of its block, know its users, and be
+  /// dominated by its defining accesses.
+  void verifyMemorySSA() const;
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+private:
+  void buildMemorySSA();
+  MemoryUseOrDef *createNewAccess(Instruction *I, BasicBlock *BB);
+  AccessListType *getOrCreateAccessList(const BasicBlock *BB);
+  MemoryAccess *renameBlock(BasicBlock *BB, MemoryAccess *IncomingVal);
+  void renamePass(DomTreeNode *Root, MemoryAccess *IncomingVal,
+                  SmallPtrSetImpl<BasicBlock *> &Visited);
+  void markUnreachableAsLiveOnEntry(BasicBlock *BB);
+  bool locallyDominates(const MemoryAccess *Dominator,
+                        const MemoryAccess *Dominatee) const;
+  void invalidateOrdering(const BasicBlock *BB) const;
+  MemoryAccess *getVersionAtEntry(BasicBlock *BB) const;
+  MemoryAccess *getVersionAtEnd(BasicBlock *BB) const;
+  void insertIntoListsAndUpdate(MemoryUseOrDef *NewAccess,
+                                AccessListType::iterator InsertPt);
+  void placeMissingPhis(SmallVectorImpl<BasicBlock *> &NewPhiBlocks);
+
+  Function &F;
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+
+  DenseMap<const Value *, MemoryAccess *> ValueToMemoryAccess;
+  DenseMap<const BasicBlock *, std::unique_ptr<AccessListType>>
+      PerBlockAccesses;
+  std::unique_ptr<MemoryDef> LiveOnEntryDef;
+  std::unique_ptr<MemorySSAWalker> Walker;
+  unsigned NextID;
+
+  /// The position of the accesses in their block, computed on demand for the
+  /// blocks whose accesses locallyDominates() compares.
+  mutable DenseMap<const MemoryAccess *, unsigned> BlockOrder;
+  mutable SmallPtrSet<const BasicBlock *, 16> BlocksWithOrder;
+};
+
+/// \brief Walks memory SSA to find the access that clobbers a memory
+/// location: the nearest access above it that may write it.
+class MemorySSAWalker {
+public:
+  MemorySSAWalker(MemorySSA *MSSA) : MSSA(MSSA) {}
+  virtual ~MemorySSAWalker();
+
+  /// \brief Return the access that clobbers the memory that the instruction
+  /// \p I reads or writes: a def, a phi, or the live on entry def.  For a
+  /// def, this is the access that \p I overwrites the memory of.
+  virtual MemoryAccess *getClobberingMemoryAccess(const Instruction *I) = 0;
+
+  /// \brief Return the access that clobbers \p Loc, looking from
+  /// \p StartingAccess included upward.  For a use, the walk starts at its
+  /// defining access.
+  virtual MemoryAccess *
+  getClobberingMemoryAccess(MemoryAccess *StartingAccess,
+                            const AliasAnalysis::Location &Loc) = 0;
+
+  /// \brief Forget what is cached about \p MA, before it is changed or
+  /// removed.
+  virtual void invalidateInfo(MemoryAccess *MA) {}
+
+protected:
+  MemorySSA *MSSA;
+};
+
+/// \brief A walker that caches the clobbers it finds, both for the accesses
+/// it is asked about and for the defs and phis it walks past.
+///
+/// At a phi, the walk goes up every incoming value; when they reach different
+/// clobbers, the phi is the clobber.  A walk that comes back to a phi it is
+/// walking, around a loop, found nothing in the loop that clobbers the
+/// location, and agrees with the other incoming values of that phi.
+class CachingMemorySSAWalker final : public MemorySSAWalker {
+public:
+  CachingMemorySSAWalker(MemorySSA *MSSA, AliasAnalysis *AA)
+      : MemorySSAWalker(MSSA), AA(AA) {}
+
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *I) override;
+  MemoryAccess *
+  getClobberingMemoryAccess(MemoryAccess *StartingAccess,
+                            const AliasAnalysis::Location &Loc) override;
+  void invalidateInfo(MemoryAccess *MA) override;
+
+private:
+  struct Query;
+
+  MemoryAccess *walkToClobber(MemoryAccess *MA, Query &Q, unsigned &Assumes);
+  MemoryAccess *walkPhi(MemoryPhi *Phi, Query &Q, unsigned &Assumes);
+  bool clobbers(MemoryDef *MD, const Query &Q) const;
+  MemoryAccess *lookupClobber(const MemoryAccess *MA, const Query &Q) const;
+  void cacheClobber(const MemoryAccess *MA, const Query &Q,
+                    MemoryAccess *Clobber);
+
+  AliasAnalysis *AA;
+
+  /// The clobber of the instruction of each access, as
+  /// getClobberingMemoryAccess(const Instruction *) found it.
+  DenseMap<const MemoryAccess *, MemoryAccess *> InstClobbers;
+  /// The clobber of a location at or above a def or phi.
+  DenseMap<std::pair<const MemoryAccess *, AliasAnalysis::Location>,
+           MemoryAccess *> LocClobbers;
+  /// The clobber of the memory a call touches at or above a def or phi.
+  DenseMap<std::pair<const MemoryAccess *, const Instruction *>,
+           MemoryAccess *> CallClobbers;
+};
+
+/// \brief The legacy pass that builds memory SSA for a function.
+class MemorySSAWrapperPass : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  MemorySSAWrapperPass();
+
+  MemorySSA &getMSSA() { return *MSSA; }
+  const MemorySSA &getMSSA() const { return *MSSA; }
+
+  bool runOnFunction(Function &F) override;
+  void releaseMemory() override;
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+  void verifyAnalysis() const override;
+  void print(raw_ostream &OS, const Module *M = nullptr) const override;
+
+private:
+  std::unique_ptr<MemorySSA> MSSA;
+};
+
+} // End llvm namespace
+
+#endif
@@ -149,6 +149,13 @@ namespace llvm {
   // analyze.
   FunctionPass *createInstCountPass();
 
+  //===--------------------------------------------------------------------===//
+  //
+  // createIRMemoryUsagePass - This pass accounts the memory that the IR of a
+  // module holds, for each class of IR object.
+  //
+  ModulePass *createIRMemoryUsagePass();
+
   //===--------------------------------------------------------------------===//
   //
   // createRegionInfoPass - This pass finds all single entry single exit regions
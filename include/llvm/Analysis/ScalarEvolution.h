@@ -23,6 +23,7 @@
 
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/DataTypes.h"
 #include <map>
+#include <vector>
 
 namespace llvm {
   class APInt;
@@ -57,9 +59,10 @@ namespace llvm {
   ///
   class SCEV : public FoldingSetNode {
     friend struct FoldingSetTrait<SCEV>;
+    friend class ScalarEvolution;
 
     /// FastID - A reference to an Interned FoldingSetNodeID for this node.
-    /// The ScalarEvolution's BumpPtrAllocator holds the data.
+    /// The ScalarEvolution's SCEVNodeAllocator holds the data.
     FoldingSetNodeIDRef FastID;
 
     // The SCEV baseclass this node corresponds to
@@ -169,6 +172,61 @@ namespace llvm {
     static bool classof(const SCEV *S);
   };
 
+  /// SCEVNodeAllocator - Allocates the SCEV nodes, their operand lists and
+  /// their interned IDs from a BumpPtrAllocator.  The memory of the nodes that
+  /// ScalarEvolution reclaims is kept in free lists by size and used again.
+  class SCEVNodeAllocator : public AllocatorBase<SCEVNodeAllocator> {
+    BumpPtrAllocator Allocator;
+
+    /// MaxRecycledWords - Larger blocks are not recycled.  Nodes with more
+    /// operands than this are rare.
+    static const unsigned MaxRecycledWords = 32;
+
+    /// FreeLists - The free blocks of each size in words.  The first word of
+    /// a free block points to the next one.
+    void *FreeLists[MaxRecycledWords + 1];
+
+    static size_t getNumWords(size_t Size) {
+      return (Size + sizeof(void *) - 1) / sizeof(void *);
+    }
+
+  public:
+    SCEVNodeAllocator() {
+      std::fill_n(FreeLists, MaxRecycledWords + 1, nullptr);
+    }
+
+    void *Allocate(size_t Size, size_t Alignment) {
+      assert(Alignment <= alignOf<void *>() && "Alignment not supported!");
+      size_t Words = getNumWords(Size);
+      if (Words <= MaxRecycledWords && FreeLists[Words]) {
+        void *Block = FreeLists[Words];
+        FreeLists[Words] = *static_cast<void **>(Block);
+        return Block;
+      }
+      return Allocator.Allocate(Words * sizeof(void *), alignOf<void *>());
+    }
+
+    void Deallocate(const void *Ptr, size_t Size) {
+      size_t Words = getNumWords(Size);
+      if (Words == 0 || Words > MaxRecycledWords)
+        return;
+      void **Block = static_cast<void **>(const_cast<void *>(Ptr));
+      *Block = FreeLists[Words];
+      FreeLists[Words] = Block;
+    }
+
+    // Pull in base class overloads.
+    using AllocatorBase<SCEVNodeAllocator>::Allocate;
+    using AllocatorBase<SCEVNodeAllocator>::Deallocate;
+
+    void Reset() {
+      Allocator.Reset();
+      std::fill_n(FreeLists, MaxRecycledWords + 1, nullptr);
+    }
+
+    size_t getTotalMemory() const { return Allocator.getTotalMemory(); }
+  };
+
   /// ScalarEvolution - This class is the main scalar evolution driver.  Because
   /// client code (intentionally) can't do much with the SCEV objects directly,
   /// they must ask this class for services.
@@ -346,9 +404,10 @@ namespace llvm {
       /// getMax - Get the max backedge taken count for the loop.
       const SCEV *getMax(ScalarEvolution *SE) const;
 
-      /// Return true if any backedge taken count expressions refer to the given
-      /// subexpression.
-      bool hasOperand(const SCEV *S, ScalarEvolution *SE) const;
+      /// getSubexprs - Add the backedge-taken count expressions and all their
+      /// subexpressions to Exprs.
+      void getSubexprs(SmallVectorImpl<const SCEV *> &Exprs,
+                       ScalarEvolution *SE) const;
 
       /// clear - Invalidate this result and free associated memory.
       void clear();
@@ -358,6 +417,21 @@ namespace llvm {
     /// this function as they are computed.
     DenseMap<const Loop*, BackedgeTakenInfo> BackedgeTakenCounts;
 
+    /// BECountUsers - The loops whose cached backedge-taken counts refer to
+    /// each expression, directly or as a subexpression.  This lets
+    /// forgetMemoizedResults find the counts to drop without searching them
+    /// all.
+    DenseMap<const SCEV *, SmallPtrSet<const Loop *, 2>> BECountUsers;
+
+    /// addBECountUsers - Record L as a user of the expressions in its
+    /// backedge-taken counts BTI.
+    void addBECountUsers(const Loop *L, const BackedgeTakenInfo &BTI);
+
+    /// eraseBackedgeTakenInfo - Drop the cached backedge-taken counts at I,
+    /// and their entries in BECountUsers.
+    void eraseBackedgeTakenInfo(
+        DenseMap<const Loop *, BackedgeTakenInfo>::iterator I);
+
     /// ConstantEvolutionLoopExitValue - This map contains entries for all of
     /// the PHI instructions that we attempt to compute constant evolutions for.
     /// This allows us to avoid potentially expensive recomputation of these
@@ -582,6 +656,8 @@ namespace llvm {
     static char ID; // Pass identification, replacement for typeid
     ScalarEvolution();
 
+    Pass *clone() const override { return new ScalarEvolution(); }
+
     LLVMContext &getContext() const { return F->getContext(); }
 
     /// isSCEVable - Test if values of the given type are analyzable within
@@ -963,15 +1039,61 @@ namespace llvm {
     bool doesIVOverflowOnGT(const SCEV *RHS, const SCEV *Stride,
                             bool IsSigned, bool NoWrap);
 
+  public:
+    /// ReclaimScope - While a ReclaimScope is alive, ScalarEvolution records
+    /// the expressions it creates.  When the scope ends, those that no cache
+    /// of the analysis refers to are freed, and their memory is used for new
+    /// expressions.  A pass that creates many temporary expressions, such as
+    /// one that tries out several rewrites of a loop, can open a scope for
+    /// each loop it works on.  It must not use any expression it got in the
+    /// scope after the scope ends, nor pass one to an analysis that keeps
+    /// it.  Scopes may nest; an inner scope leaves the expressions it kept to
+    /// the outer one.
+    class ReclaimScope {
+      ScalarEvolution &SE;
+      size_t Begin;
+
+      ReclaimScope(const ReclaimScope &) = delete;
+      void operator=(const ReclaimScope &) = delete;
+
+    public:
+      explicit ReclaimScope(ScalarEvolution &SE);
+      ~ReclaimScope();
+    };
+
   private:
     FoldingSet<SCEV> UniqueSCEVs;
-    BumpPtrAllocator SCEVAllocator;
+    SCEVNodeAllocator SCEVAllocator;
 
     /// FirstUnknown - The head of a linked list of all SCEVUnknown
     /// values that have been allocated. This is used by releaseMemory
     /// to locate them all and call their destructors.
     SCEVUnknown *FirstUnknown;
+
+    /// NewSCEVs - The expressions created while a ReclaimScope is alive, in
+    /// the order they were created.
+    std::vector<SCEV *> NewSCEVs;
+
+    /// NumReclaimScopes - The number of ReclaimScopes alive.
+    unsigned NumReclaimScopes;
+
+    /// insertSCEV - Add the new expression S to UniqueSCEVs at the insert
+    /// position IP.
+    void insertSCEV(SCEV *S, void *IP);
+
+    /// reclaimSCEVs - Free the expressions in NewSCEVs from Begin on that
+    /// the caches do not refer to, and drop the results cached for them.
+    void reclaimSCEVs(size_t Begin);
+
+    /// freeSCEV - Free the memory of the unused expression S.
+    void freeSCEV(SCEV *S);
   };
 }
 
+inline void *operator new(size_t Size, llvm::SCEVNodeAllocator &Allocator) {
+  return Allocator.Allocate(Size, llvm::alignOf<void *>());
+}
+
+inline void operator delete(void *, llvm::SCEVNodeAllocator &) {}
+
 #endif
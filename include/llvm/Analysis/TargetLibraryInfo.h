@@ -321,6 +321,9 @@ public:
 
   TargetLibraryInfo &getTLI() { return TLI; }
   const TargetLibraryInfo &getTLI() const { return TLI; }
+
+  /// Queries only read the tables, which are set up before the passes run.
+  bool isThreadSafe() const override { return true; }
 };
 
 } // end namespace llvm
@@ -865,6 +865,10 @@ public:
   explicit TargetTransformInfoWrapperPass(TargetIRAnalysis TIRA);
 
   TargetTransformInfo &getTTI(Function &F);
+
+  /// \brief Every thread running function passes concurrently gets a copy of
+  /// the pass, which holds the TTI of the function the thread works on.
+  Pass *clone() const override;
 };
 
 /// \brief Create an analysis pass wrapper around a TTI object.
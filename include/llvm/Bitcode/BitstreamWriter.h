@@ -18,6 +18,8 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <vector>
 
 namespace llvm {
@@ -25,6 +27,28 @@ namespace llvm {
 class BitstreamWriter {
   SmallVectorImpl<char> &Out;
 
+  /// FS - If not null, Out is written out to FS whenever a block is exited
+  /// with at least FlushThreshold bytes in it, so that the buffer does not
+  /// grow with the output.  Words backpatched after they have been written out
+  /// are overwritten in FS, which must therefore support pwrite.
+  raw_pwrite_stream *FS;
+  uint64_t FlushThreshold;
+
+  /// FlushedBytes - The number of bytes of the output written out to FS, and
+  /// FSBase - The offset in FS of the first of them.
+  uint64_t FlushedBytes;
+  uint64_t FSBase;
+
+  /// Placeholder - A word to be filled in with BackpatchWordAt.  Once written
+  /// out, the bytes the word spans are kept here, since they can't be read
+  /// back from FS to merge in the bits around the word.
+  struct Placeholder {
+    uint64_t BitNo;
+    bool Flushed;
+    unsigned char Bytes[5];
+  };
+  SmallVector<Placeholder, 1> Placeholders;
+
   /// CurBit - Always between 0 and 31 inclusive, specifies the next bit to use.
   unsigned CurBit;
 
@@ -62,13 +86,58 @@ class BitstreamWriter {
 
   // BackpatchWord - Backpatch a 32-bit word in the output with the specified
   // value.
-  void BackpatchWord(unsigned ByteNo, unsigned NewWord) {
+  void BackpatchWord(uint64_t ByteNo, unsigned NewWord) {
+    if (ByteNo < FlushedBytes) {
+      assert(ByteNo + 4 <= FlushedBytes && "Word was partly written out");
+      char Bytes[4] = {
+        (char)(NewWord >>  0),
+        (char)(NewWord >>  8),
+        (char)(NewWord >> 16),
+        (char)(NewWord >> 24) };
+      FS->pwrite(Bytes, 4, FSBase + ByteNo);
+      return;
+    }
+
+    ByteNo -= FlushedBytes;
     Out[ByteNo++] = (unsigned char)(NewWord >>  0);
     Out[ByteNo++] = (unsigned char)(NewWord >>  8);
     Out[ByteNo++] = (unsigned char)(NewWord >> 16);
     Out[ByteNo  ] = (unsigned char)(NewWord >> 24);
   }
 
+  /// FlushToFile - Write the buffer out to FS if it has grown past the
+  /// threshold.  The bytes of a placeholder that the buffer does not hold
+  /// entirely yet are kept back, to be written out with the rest of it.
+  void FlushToFile() {
+    if (!FS || Out.size() < FlushThreshold)
+      return;
+
+    uint64_t End = FlushedBytes + Out.size();
+    for (bool Changed = true; Changed;) {
+      Changed = false;
+      for (const Placeholder &P : Placeholders) {
+        uint64_t ByteNo = P.BitNo / 8;
+        if (!P.Flushed && ByteNo < End && ByteNo + 5 > End) {
+          End = ByteNo;
+          Changed = true;
+        }
+      }
+    }
+    for (Placeholder &P : Placeholders) {
+      uint64_t ByteNo = P.BitNo / 8;
+      if (P.Flushed || ByteNo + 5 > End)
+        continue;
+      std::copy(Out.begin() + (ByteNo - FlushedBytes),
+                Out.begin() + (ByteNo - FlushedBytes + 5), P.Bytes);
+      P.Flushed = true;
+    }
+
+    size_t Size = End - FlushedBytes;
+    FS->write(Out.data(), Size);
+    Out.erase(Out.begin(), Out.begin() + Size);
+    FlushedBytes = End;
+  }
+
   void WriteByte(unsigned char Value) {
     Out.push_back(Value);
   }
@@ -82,19 +151,27 @@ class BitstreamWriter {
     Out.append(&Bytes[0], &Bytes[4]);
   }
 
-  unsigned GetBufferOffset() const {
-    return Out.size();
+  uint64_t GetBufferOffset() const {
+    return FlushedBytes + Out.size();
   }
 
   unsigned GetWordIndex() const {
-    unsigned Offset = GetBufferOffset();
+    uint64_t Offset = GetBufferOffset();
     assert((Offset & 3) == 0 && "Not 32-bit aligned");
     return Offset / 4;
   }
 
 public:
-  explicit BitstreamWriter(SmallVectorImpl<char> &O)
-    : Out(O), CurBit(0), CurValue(0), CurCodeSize(2) {}
+  /// Create a writer that appends to \p O.  If \p FS is given, the contents
+  /// of \p O are written out to it as soon as a block is exited with at least
+  /// \p FlushThreshold bytes in \p O, starting at the current position of
+  /// \p FS.  Whatever is left in \p O at the end is for the caller to write
+  /// out.
+  explicit BitstreamWriter(SmallVectorImpl<char> &O,
+                           raw_pwrite_stream *FS = nullptr,
+                           uint64_t FlushThreshold = 0)
+      : Out(O), FS(FS), FlushThreshold(FlushThreshold), FlushedBytes(0),
+        FSBase(FS ? FS->tell() : 0), CurBit(0), CurValue(0), CurCodeSize(2) {}
 
   ~BitstreamWriter() {
     assert(CurBit == 0 && "Unflushed data remaining");
@@ -104,6 +181,46 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Retrieve the number of bytes written out to the stream given at
+  /// construction.
+  uint64_t GetNumOfFlushedBytes() const { return FlushedBytes; }
+
+  /// \brief Note that the 32 bits at bit position \p BitNo, which must have
+  /// been emitted as zeros, are to be filled in by BackpatchWordAt.
+  void AddPlaceholderWord(uint64_t BitNo) {
+    assert(BitNo / 8 >= FlushedBytes && "Placeholder already written out");
+    Placeholder P;
+    P.BitNo = BitNo;
+    P.Flushed = false;
+    Placeholders.push_back(P);
+  }
+
+  /// \brief Overwrite the placeholder at bit position \p BitNo, added with
+  /// AddPlaceholderWord and since flushed, with \p NewWord.  This fills in a
+  /// fixed-width field whose value was not known when it was emitted.
+  void BackpatchWordAt(uint64_t BitNo, unsigned NewWord) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Backpatching unflushed bits");
+    auto P = std::find_if(
+        Placeholders.begin(), Placeholders.end(),
+        [&](const Placeholder &P) { return P.BitNo == BitNo; });
+    assert(P != Placeholders.end() && "Not a placeholder");
+
+    // Patch the kept bytes if the word has been written out, else the buffer.
+    unsigned char *Bytes = P->Flushed
+                               ? P->Bytes
+                               : (unsigned char *)Out.data() +
+                                     (BitNo / 8 - FlushedBytes);
+    for (unsigned I = 0; I != 32; ++I) {
+      unsigned Bit = BitNo % 8 + I;
+      assert(!(Bytes[Bit / 8] & (1 << (Bit % 8))) && "Placeholder is not zero");
+      if (NewWord & (1u << I))
+        Bytes[Bit / 8] |= 1 << (Bit % 8);
+    }
+    if (P->Flushed)
+      FS->pwrite((const char *)P->Bytes, 5, FSBase + BitNo / 8);
+    Placeholders.erase(P);
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -237,7 +354,7 @@ public:
 
     // Compute the size of the block, in words, not counting the size field.
     unsigned SizeInWords = GetWordIndex() - B.StartSizeWord - 1;
-    unsigned ByteNo = B.StartSizeWord*4;
+    uint64_t ByteNo = uint64_t(B.StartSizeWord) * 4;
 
     // Update the block size field in the header of this sub-block.
     BackpatchWord(ByteNo, SizeInWords);
@@ -246,6 +363,8 @@ public:
     CurCodeSize = B.PrevCodeSize;
     CurAbbrevs = std::move(B.PrevAbbrevs);
     BlockScope.pop_back();
+
+    FlushToFile();
   }
 
   //===--------------------------------------------------------------------===//
@@ -42,7 +42,11 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_SUMMARY_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -73,6 +77,10 @@ namespace bitc {
 
     MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
     MODULE_CODE_COMDAT      = 12,  // COMDAT: [selection_kind, name]
+
+    // FUNCTION_INDEX: [offset], the 32-bit word offset of the function index
+    // block from the start of the bitcode, as a fixed 32-bit field.
+    MODULE_CODE_FUNCTION_INDEX = 13,
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -354,6 +362,24 @@ namespace bitc {
                                      //           vol,ordering,synchscope]
   };
 
+  // The function summary block (FUNCTION_SUMMARY_BLOCK_ID) holds a name table
+  // followed by one entry per named function definition. Names are numbered
+  // in the order of their NAME records, starting at zero.
+  enum FunctionSummaryCodes {
+    FS_CODE_NAME  = 1, // NAME:  [strchr x N]
+    FS_CODE_ENTRY = 2  // ENTRY: [nameid, linkage, flags, instcount,
+                       //         n x callee nameid]
+  };
+
+  // The function index block (FUNCTION_INDEX_BLOCK_ID) follows the function
+  // bodies and gives the bit offset of every body from the start of the
+  // bitcode, so that a reader can find them without walking the module.
+  // Entries are in the order of the bodies, and each offset is relative to
+  // the offset of the previous entry.
+  enum FunctionIndexCodes {
+    FUNCTION_INDEX_ENTRY = 1 // ENTRY: [valueid, offset delta]
+  };
+
   enum UseListCodes {
     USELIST_CODE_DEFAULT = 1, // DEFAULT: [index..., value-id]
     USELIST_CODE_BB      = 2  // BB: [index..., bb-id]
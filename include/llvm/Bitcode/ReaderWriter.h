@@ -23,9 +23,11 @@
 namespace llvm {
   class BitstreamWriter;
   class DataStreamer;
+  class FunctionInfoIndex;
   class LLVMContext;
   class Module;
   class ModulePass;
+  class raw_fd_ostream;
   class raw_ostream;
 
   /// Read the header of the specified bitcode buffer and prepare for lazy
@@ -51,6 +53,18 @@ namespace llvm {
   getBitcodeTargetTriple(MemoryBufferRef Buffer, LLVMContext &Context,
                          DiagnosticHandlerFunction DiagnosticHandler = nullptr);
 
+  /// Return true if the specified bitcode buffer contains function summaries.
+  bool hasFunctionSummary(MemoryBufferRef Buffer, LLVMContext &Context,
+                          DiagnosticHandlerFunction DiagnosticHandler = nullptr);
+
+  /// Read the function summaries of the specified bitcode buffer, skipping
+  /// the rest of the module, and return them as an index registering the
+  /// module under its buffer identifier. A buffer without summaries yields an
+  /// index without functions.
+  ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+  getFunctionInfoIndex(MemoryBufferRef Buffer, LLVMContext &Context,
+                       DiagnosticHandlerFunction DiagnosticHandler = nullptr);
+
   /// Read the specified bitcode file, returning the module.
   ErrorOr<Module *>
   parseBitcodeFile(MemoryBufferRef Buffer, LLVMContext &Context,
@@ -64,8 +78,28 @@ namespace llvm {
   /// If \c ShouldPreserveUseListOrder, encode the use-list order for each \a
   /// Value in \c M.  These will be reconstructed exactly when \a M is
   /// deserialized.
+  ///
+  /// If \c EmitFunctionSummary, emit a summary of every function definition
+  /// that getFunctionInfoIndex() can read back without parsing the module.
+  ///
+  /// If \c EmitFunctionIndex, emit the offsets of the function bodies, so
+  /// that lazy readers can find them without walking the module.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                          bool ShouldPreserveUseListOrder = false);
+                          bool ShouldPreserveUseListOrder = false,
+                          bool EmitFunctionSummary = false,
+                          bool EmitFunctionIndex = false);
+
+  /// \brief Write the specified module to the specified file stream, as
+  /// above.
+  ///
+  /// If \c Out can seek, the bitstream is written out as it is produced, and
+  /// the sizes of the blocks are patched in place, rather than buffering all
+  /// of it first.  Only up to -bitcode-flush-threshold megabytes are buffered
+  /// at a time.
+  void WriteBitcodeToFile(const Module *M, raw_fd_ostream &Out,
+                          bool ShouldPreserveUseListOrder = false,
+                          bool EmitFunctionSummary = false,
+                          bool EmitFunctionIndex = false);
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
@@ -0,0 +1,50 @@
+//===-- llvm/CodeGen/ParallelCG.h - Parallel code generation ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header declares functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_PARALLELCG_H
+#define LLVM_CODEGEN_PARALLELCG_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Module;
+class raw_pwrite_stream;
+
+/// Split M into OSs.size() partitions, and generate code for each partition
+/// using a TargetMachine created by TMFactory, writing the result for the
+/// partition to the corresponding stream in OSs.
+///
+/// Each partition is serialized to bitcode and compiled in a private
+/// LLVMContext on a pool of ThreadCount threads (zero means one per hardware
+/// thread), so TMFactory must be safe to call concurrently. The partitioning
+/// depends only on M and OSs.size(), which keeps the output deterministic
+/// regardless of the number of threads. See SplitModule for the meaning of
+/// PreserveLocals.
+///
+/// If OSs.size() is 1, code is generated for M directly on the calling thread.
+/// Otherwise M may be modified by SplitModule and should not be used for code
+/// generation again.
+void splitCodeGen(
+    Module &M, ArrayRef<raw_pwrite_stream *> OSs,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
+    TargetMachine::CodeGenFileType FT = TargetMachine::CGFT_ObjectFile,
+    unsigned ThreadCount = 0, bool PreserveLocals = false);
+
+} // namespace llvm
+
+#endif
@@ -219,6 +219,8 @@ public:
 
   bool runOnFunction(Function &F) override;
 
+  Pass *clone() const override { return new DominatorTreeWrapperPass(); }
+
   void verifyAnalysis() const override;
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
@@ -0,0 +1,129 @@
+//===-- llvm/IR/FunctionInfo.h - Function summary index ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines FunctionSummary, a compact description of a function
+// definition (linkage, size and direct call edges), and FunctionInfoIndex,
+// which maps function names to their summaries across a set of modules.
+//
+// Summaries are emitted into bitcode files on request and read back without
+// parsing the rest of the module. Thin link-time optimization uses the
+// combined index of all the input files to decide which functions each module
+// should import for inlining, and then optimizes the modules independently.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_FUNCTIONINFO_H
+#define LLVM_IR_FUNCTIONINFO_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/GlobalValue.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class Module;
+
+/// Summary of a single function definition.
+class FunctionSummary {
+  GlobalValue::LinkageTypes Linkage;
+
+  /// Number of instructions in the function body.
+  unsigned InstCount;
+
+  /// True if the body may be copied into another module as an
+  /// available_externally definition. This is the case when it refers to no
+  /// symbol that is local to its module or that its module may discard.
+  bool IsEligibleForImport;
+
+  /// Names of the functions called directly from the body, without
+  /// duplicates, in order of first occurrence.
+  std::vector<std::string> Callees;
+
+public:
+  FunctionSummary(GlobalValue::LinkageTypes Linkage, unsigned InstCount,
+                  bool IsEligibleForImport)
+      : Linkage(Linkage), InstCount(InstCount),
+        IsEligibleForImport(IsEligibleForImport) {}
+
+  GlobalValue::LinkageTypes getLinkage() const { return Linkage; }
+  unsigned getInstCount() const { return InstCount; }
+  bool isEligibleForImport() const { return IsEligibleForImport; }
+
+  ArrayRef<std::string> callees() const { return Callees; }
+  void addCallee(StringRef Name) { Callees.push_back(Name); }
+
+  /// Compute the summary of the function definition \p F.
+  static FunctionSummary compute(const Function &F);
+};
+
+/// A function summary together with the module defining the function.
+struct FunctionInfo {
+  unsigned ModuleID;
+  FunctionSummary Summary;
+
+  FunctionInfo(unsigned ModuleID, FunctionSummary Summary)
+      : ModuleID(ModuleID), Summary(std::move(Summary)) {}
+};
+
+/// Index of the function summaries of one or more modules.
+///
+/// Modules are identified by their position in the index, in the order they
+/// were added. A function name may have several definitions, for example
+/// linkonce_odr functions defined in many modules.
+class FunctionInfoIndex {
+  std::vector<std::string> ModulePaths;
+
+  /// Function name to its definitions, in the order they were added.
+  StringMap<std::vector<FunctionInfo>> FunctionMap;
+
+  /// For every module, the names of the functions it defines, in the order
+  /// their summaries were added.
+  std::vector<std::vector<StringRef>> ModuleFunctions;
+
+public:
+  /// Register the module at \p Path and return its module ID.
+  unsigned addModule(StringRef Path);
+
+  /// Record \p Summary as the summary of the definition of \p Name in module
+  /// \p ModuleID.
+  void addFunctionSummary(StringRef Name, unsigned ModuleID,
+                          FunctionSummary Summary);
+
+  /// Add every module and summary of \p Other to this index. The module IDs
+  /// of \p Other are renumbered to follow the modules already present.
+  void mergeFrom(const FunctionInfoIndex &Other);
+
+  unsigned getNumModules() const { return ModulePaths.size(); }
+  StringRef getModulePath(unsigned ModuleID) const {
+    return ModulePaths[ModuleID];
+  }
+
+  /// Return the definitions of \p Name, or an empty list if no indexed module
+  /// defines it.
+  ArrayRef<FunctionInfo> findFunctionInfoList(StringRef Name) const;
+
+  /// Return the names of the functions defined in \p ModuleID.
+  ArrayRef<StringRef> getModuleFunctions(unsigned ModuleID) const {
+    return ModuleFunctions[ModuleID];
+  }
+
+  /// Build the index of the named function definitions of \p M, registered
+  /// under the module path \p Path.
+  static std::unique_ptr<FunctionInfoIndex> build(const Module &M,
+                                                  StringRef Path);
+};
+
+} // End llvm namespace
+
+#endif
@@ -36,8 +36,9 @@ class DebugLoc;
 /// This is an important class for using LLVM in a threaded context.  It
 /// (opaquely) owns and manages the core "global" data of LLVM's core
 /// infrastructure, including the type and constant uniquing tables.
-/// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// By default, LLVMContext itself provides no locking guarantees, so you should
+/// be careful to have one context per thread, unless the context is put in
+/// multithreaded mode (see enableMultithreading()).
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
@@ -151,6 +152,30 @@ public:
   /// control to LLVM. Other LLVM contexts are unaffected by this restriction.
   void setYieldCallback(YieldCallbackTy Callback, void *OpaqueHandle);
 
+  /// \brief Allow several threads to use this context concurrently.
+  ///
+  /// In multithreaded mode, any thread may get types, constants, attributes
+  /// and uniqued metadata (IntegerType::get, StructType::get, ConstantInt::get,
+  /// ConstantExpr::get, AttributeSet::get, MDTuple::get, ...), and create or
+  /// delete IR that uses them, while other threads do the same. The uniquing
+  /// tables are guarded by locks, the table of integer constants being split
+  /// into independently locked shards, and so are the use lists of the values
+  /// that are not local to a function.
+  ///
+  /// Every other object keeps the usual rules: a module, a function and
+  /// their contents must only be used by one thread at a time, and the use
+  /// lists of shared values (constants and global values) must not be walked
+  /// while other threads may create or delete uses of them. Mutating a shared
+  /// object, such as setting the body or name of a struct type, or replacing
+  /// uses of a constant, is not thread-safe either.
+  ///
+  /// This must be called while the context is only used by one thread. It
+  /// cannot be undone.
+  void enableMultithreading();
+
+  /// \brief Return true if enableMultithreading() was called.
+  bool isMultithreaded() const;
+
   /// \brief Calls the yield callback (if applicable).
   ///
   /// This transfers control of the current thread back to the client, which may
@@ -71,7 +71,10 @@
 //
 // [o] class FPPassManager : public ModulePass, public PMDataManager;
 //
-// FPPassManager manages FunctionPasses and BBPassManagers
+// FPPassManager manages FunctionPasses and BBPassManagers. With
+// -function-pass-threads, it runs copies of its passes (see Pass::clone) on
+// several functions of the module at once, each copy owned by a top level
+// manager of its own.
 //
 // [o] class MPPassManager : public Pass, public PMDataManager;
 //
@@ -174,6 +177,11 @@ protected:
 
   void initializeAllAnalysisInfo();
 
+  /// Record that P is the last user of the passes in LastUses, without going
+  /// through the LastUser map.  Used by managers that copy the schedule of
+  /// another top level manager instead of building their own.
+  void addLastUses(Pass *P, ArrayRef<Pass *> LastUses);
+
 private:
   virtual PMDataManager *getAsPMDataManager() = 0;
   virtual PassManagerType getTopLevelPassManagerType() = 0;
@@ -356,6 +364,9 @@ public:
     return (unsigned)PassVector.size();
   }
 
+  /// Return the passes managed by this manager, in execution order.
+  ArrayRef<Pass *> getContainedPasses() const { return PassVector; }
+
   virtual PassManagerType getPassManagerType() const {
     assert ( 0 && "Invalid use of getPassManagerType");
     return PMT_Unknown;
@@ -470,6 +481,12 @@ public:
   PassManagerType getPassManagerType() const override {
     return PMT_FunctionPassManager;
   }
+
+private:
+  /// Run the passes on the functions of M on NumThreads threads (see
+  /// -function-pass-threads) and set Changed.  Return false, without running
+  /// anything, if the passes or the analyses they use do not support it.
+  bool runOnModuleInParallel(Module &M, unsigned NumThreads, bool &Changed);
 };
 
 Timer *getPassTimer(Pass *);
@@ -80,10 +80,7 @@ private:
   Use(const Use &U) = delete;
 
   /// Destructor - Only for zap()
-  ~Use() {
-    if (Val)
-      removeFromList();
-  }
+  inline ~Use();
 
   enum PrevPtrTag { zeroDigitTag, oneDigitTag, stopTag, fullStopTag };
 
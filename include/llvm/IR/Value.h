@@ -69,9 +69,16 @@ class Value {
   Type *VTy;
   Use *UseList;
 
-  friend class ValueAsMetadata; // Allow access to NameAndIsUsedByMD.
+  friend class ValueAsMetadata; // Allow access to IsUsedByMD.
   friend class ValueHandleBase;
-  PointerIntPair<ValueName *, 1> NameAndIsUsedByMD;
+  friend class LLVMContext; // Allow access to HasMultithreadedContexts.
+
+  /// \brief Set once any LLVMContext is in multithreaded mode.
+  ///
+  /// The use lists of the values of such a context that are not local to a
+  /// function are shared between threads, and updated under a lock (see
+  /// addSharedUse()).
+  static bool HasMultithreadedContexts;
 
   const unsigned char SubclassID;   // Subclass identifier (for isa/dyn_cast)
   unsigned char HasValueHandle : 1; // Has a ValueHandle pointing to this?
@@ -101,7 +108,16 @@ protected:
   /// This is stored here to save space in User on 64-bit hosts.  Since most
   /// instances of Value have operands, 32-bit hosts aren't significantly
   /// affected.
-  unsigned NumOperands;
+  unsigned NumOperands : 30;
+
+private:
+  unsigned IsUsedByMD : 1;
+
+  /// \brief Set when the value has a name.
+  ///
+  /// Most values have none, so the names are kept in a table of the context
+  /// (see getValueName()) rather than in every value.
+  unsigned HasName : 1;
 
 private:
   template <typename UseT> // UseT == 'Use' or 'const Use'
@@ -210,9 +226,9 @@ public:
   LLVMContext &getContext() const;
 
   // \brief All values can potentially be named.
-  bool hasName() const { return getValueName() != nullptr; }
-  ValueName *getValueName() const { return NameAndIsUsedByMD.getPointer(); }
-  void setValueName(ValueName *VN) { NameAndIsUsedByMD.setPointer(VN); }
+  bool hasName() const { return HasName; }
+  ValueName *getValueName() const;
+  void setValueName(ValueName *VN);
 
 private:
   void destroyValueName();
@@ -315,8 +331,38 @@ public:
   /// hasNUsesOrMore to check for specific values.
   unsigned getNumUses() const;
 
+  /// \brief Return true if any LLVMContext is in multithreaded mode.
+  static bool hasMultithreadedContexts() { return HasMultithreadedContexts; }
+
+  /// \brief Observer of the uses of shared values that one thread adds and
+  /// removes while some LLVMContext is in multithreaded mode.
+  ///
+  /// The order of such a use list depends on how the threads interleave.  An
+  /// observer lets a client that needs a deterministic order record where the
+  /// uses it makes belong, and sort the lists afterwards.
+  class SharedUseObserver {
+  public:
+    virtual ~SharedUseObserver();
+    virtual void addedUse(Use &U) = 0;
+    virtual void removedUse(Use &U) = 0;
+  };
+
+  /// \brief Set the observer of the calling thread, or clear it with null.
+  static void setSharedUseObserver(SharedUseObserver *Observer);
+
   /// \brief This method should only be used by the Use class.
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    if (LLVM_UNLIKELY(HasMultithreadedContexts) && isSharedBetweenFunctions())
+      return addSharedUse(U);
+    U.addToList(&UseList);
+  }
+
+  /// \brief This method should only be used by the Use class.
+  void removeUse(Use &U) {
+    if (LLVM_UNLIKELY(HasMultithreadedContexts) && isSharedBetweenFunctions())
+      return removeSharedUse(U);
+    U.removeFromList();
+  }
 
   /// \brief Concrete subclass of this.
   ///
@@ -393,7 +439,7 @@ public:
   bool hasValueHandle() const { return HasValueHandle; }
 
   /// \brief Return true if there is metadata referencing this value.
-  bool isUsedByMetadata() const { return NameAndIsUsedByMD.getInt(); }
+  bool isUsedByMetadata() const { return IsUsedByMD; }
 
   /// \brief Strip off pointer casts, all-zero GEPs, and aliases.
   ///
@@ -507,6 +553,17 @@ private:
   template <class Compare>
   static void mergeUseListsImpl(Use *L, Use *R, Use **Next, Compare Cmp);
 
+  /// \brief Return true for the values that are not local to a function:
+  /// constants, including global values, inline asm and metadata wrappers.
+  bool isSharedBetweenFunctions() const {
+    return SubclassID >= ConstantFirstVal && SubclassID < InstructionVal;
+  }
+
+  /// \brief Add or remove \p U from the use list of this value, which other
+  /// threads may update as well if its context is multithreaded.
+  void addSharedUse(Use &U);
+  void removeSharedUse(Use &U);
+
 protected:
   unsigned short getSubclassDataFromValue() const { return SubclassData; }
   void setValueSubclassData(unsigned short D) { SubclassData = D; }
@@ -518,11 +575,16 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
 }
 
 void Use::set(Value *V) {
-  if (Val) removeFromList();
+  if (Val) Val->removeUse(*this);
   Val = V;
   if (V) V->addUse(*this);
 }
 
+Use::~Use() {
+  if (Val)
+    Val->removeUse(*this);
+}
+
 template <class Compare> void Value::sortUseList(Compare Cmp) {
   if (!UseList || !UseList->Next)
     // No need to sort 0 or 1 uses.
@@ -70,7 +70,7 @@ public:
   ValueHandleBase(HandleBaseKind Kind, const ValueHandleBase &RHS)
     : PrevPair(nullptr, Kind), Next(nullptr), V(RHS.V) {
     if (isValid(V))
-      AddToExistingUseList(RHS.getPrevPtr());
+      AddToUseListOf(RHS);
   }
   ~ValueHandleBase() {
     if (isValid(V))
@@ -89,7 +89,7 @@ public:
     if (V == RHS.V) return RHS.V;
     if (isValid(V)) RemoveFromUseList();
     V = RHS.V;
-    if (isValid(V)) AddToExistingUseList(RHS.getPrevPtr());
+    if (isValid(V)) AddToUseListOf(RHS);
     return V;
   }
 
@@ -125,6 +125,10 @@ private:
   /// \brief Add this ValueHandle to the use list after Node.
   void AddToExistingUseListAfter(ValueHandleBase *Node);
 
+  /// \brief Add this ValueHandle to the use list for V, right before \p RHS,
+  /// which is watching V as well.
+  void AddToUseListOf(const ValueHandleBase &RHS);
+
   /// \brief Add this ValueHandle to the use list for V.
   void AddToUseList();
   /// \brief Remove this ValueHandle from its current use list.
@@ -48,6 +48,15 @@ bool verifyFunction(const Function &F, raw_ostream *OS = nullptr);
 /// returned.
 bool verifyModule(const Module &M, raw_ostream *OS = nullptr);
 
+/// \brief Check a module for errors, checking the function bodies on up to
+/// \p NumThreads threads.
+///
+/// This returns the same result and writes the same messages as the above,
+/// which uses the number of threads given by -verify-threads. With more than
+/// one thread, the context of \p M is made multithreaded, see
+/// LLVMContext::enableMultithreading().
+bool verifyModule(const Module &M, raw_ostream *OS, unsigned NumThreads);
+
 /// \brief Create a verifier pass.
 ///
 /// Check a module or function for validity. This is essentially a pass wrapped
@@ -0,0 +1,105 @@
+//===-LTOCache.h - LLVM Link Time Optimizer object cache ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the LTOCache class, an on-disk cache of the native
+// objects produced by link-time optimization.
+//
+// Entries are identified by a key, normally the MD5 of everything the object
+// depends on: the input bitcode, the functions imported into it, the
+// optimization and code generation options and the compiler version. An
+// incremental link looks every object up before optimizing the module, and
+// only recomputes the objects whose inputs changed.
+//
+// The cache is safe to share between concurrent links. An entry is computed
+// by a single process at a time, using a LockFileManager, and published with
+// an atomic rename. Failing to use the cache is never an error: the object is
+// computed as if there was no cache.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LTO_LTOCACHE_H
+#define LLVM_LTO_LTOCACHE_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+class MemoryBuffer;
+
+/// Limits enforced on a cache directory by LTOCache::prune().
+struct LTOCachePruningPolicy {
+  /// Minimum number of seconds between two prunings of the directory. Zero
+  /// prunes on every call.
+  unsigned Interval;
+
+  /// Number of seconds after which an entry that was not used is removed.
+  /// Zero keeps entries regardless of their age.
+  unsigned Expiration;
+
+  /// Maximum total size of the entries, in bytes. The least recently used
+  /// entries are removed first. Zero does not limit the size.
+  uint64_t MaxSize;
+
+  LTOCachePruningPolicy() : Interval(1200), Expiration(7 * 24 * 3600),
+                            MaxSize(0) {}
+};
+
+/// Compute the keys of LTOCache entries.
+class LTOCacheKey {
+  MD5 Hasher;
+
+public:
+  LTOCacheKey();
+
+  /// Mix \p Data into the key. Every string is length-prefixed, so the
+  /// boundaries between them are part of the key.
+  void add(StringRef Data);
+  void add(uint64_t Value);
+
+  /// Return the key as a hexadecimal string.
+  std::string final();
+};
+
+class LTOCache {
+  SmallString<128> Dir;
+
+  void getEntryPath(StringRef Key, SmallVectorImpl<char> &Path) const;
+
+public:
+  /// Use \p Dir, which is created if needed, as the cache directory.
+  explicit LTOCache(StringRef Dir);
+
+  StringRef getDirectory() const { return Dir; }
+
+  /// Return the cached object for \p Key, or null if there is none.
+  std::unique_ptr<MemoryBuffer> lookup(StringRef Key);
+
+  /// Store \p Data as the object for \p Key, replacing any previous entry.
+  void insert(StringRef Key, StringRef Data);
+
+  /// Return the cached object for \p Key. On a miss, compute it with
+  /// \p Compute, which returns null on failure, and store the result. If
+  /// another process is computing the same entry, wait for it instead.
+  std::unique_ptr<MemoryBuffer>
+  getOrCompute(StringRef Key,
+               function_ref<std::unique_ptr<MemoryBuffer>()> Compute);
+
+  /// Remove the entries that exceed the limits of \p Policy, unless the
+  /// directory was already pruned less than Policy.Interval seconds ago.
+  /// Returns true if the directory was pruned.
+  bool prune(const LTOCachePruningPolicy &Policy);
+};
+
+} // End llvm namespace
+
+#endif
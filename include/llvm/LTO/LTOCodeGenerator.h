@@ -40,6 +40,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/CodeGen.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
 #include <vector>
@@ -50,6 +51,7 @@ namespace llvm {
   class GlobalValue;
   class Mangler;
   class MemoryBuffer;
+  class Target;
   class TargetLibraryInfo;
   class TargetMachine;
   class raw_ostream;
@@ -79,6 +81,14 @@ struct LTOCodeGenerator {
   void setAttr(const char *mAttr) { MAttr = mAttr; }
   void setOptLevel(unsigned optLevel) { OptLevel = optLevel; }
 
+  // Set the number of partitions the merged module is split into by
+  // compileOptimizedToFiles(), and the number of threads that generate code
+  // for them. A thread count of zero uses one thread per hardware thread.
+  void setParallelism(unsigned Partitions, unsigned Threads) {
+    CodeGenPartitions = Partitions ? Partitions : 1;
+    CodeGenThreads = Threads;
+  }
+
   void setShouldInternalize(bool Value) { ShouldInternalize = Value; }
   void setShouldEmbedUselists(bool Value) { ShouldEmbedUselists = Value; }
 
@@ -134,6 +144,23 @@ struct LTOCodeGenerator {
   // if the compilation was not successful.
   const void *compileOptimized(size_t *length, std::string &errMsg);
 
+  // Compiles the merged optimized module into one object file per partition
+  // set by setParallelism(), generating code for the partitions in parallel.
+  // The paths to the object files are returned via "names" and their number
+  // via "count"; both stay valid until the next compilation. Locals that are
+  // referenced across partitions become hidden symbols, so the linked output
+  // exports the same symbols as with a single object file. Return true on
+  // success.
+  //
+  // NOTE that it is up to the linker to remove the intermediate object files.
+  bool compileOptimizedToFiles(const char ***names, unsigned *count,
+                               std::string &errMsg);
+
+  // Compiles the merged optimized module into Out.size() object files, one
+  // per partition, written to the streams in Out. Return true on success.
+  bool compileOptimized(ArrayRef<raw_pwrite_stream *> Out,
+                        std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   LLVMContext &getContext() { return Context; }
@@ -149,6 +176,7 @@ private:
                         SmallPtrSetImpl<GlobalValue *> &AsmUsed,
                         Mangler &Mangler);
   bool determineTarget(std::string &errMsg);
+  std::unique_ptr<TargetMachine> createTargetMachine();
 
   static void DiagnosticHandler(const DiagnosticInfo &DI, void *Context);
 
@@ -161,6 +189,11 @@ private:
   LLVMContext &Context;
   Linker IRLinker;
   TargetMachine *TargetMach = nullptr;
+  const Target *MArch = nullptr;
+  std::string TripleStr;
+  std::string FeatureStr;
+  Reloc::Model RelocModel = Reloc::Default;
+  CodeGenOpt::Level CGOptLevel = CodeGenOpt::Default;
   bool EmitDwarfDebugInfo = false;
   bool ScopeRestrictionsDone = false;
   lto_codegen_model CodeModel = LTO_CODEGEN_PIC_MODEL_DEFAULT;
@@ -171,8 +204,12 @@ private:
   std::string MCpu;
   std::string MAttr;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::vector<const char *> NativeObjectPathRefs;
   TargetOptions Options;
   unsigned OptLevel = 2;
+  unsigned CodeGenPartitions = 1;
+  unsigned CodeGenThreads = 0;
   lto_diagnostic_handler_t DiagHandler = nullptr;
   void *DiagContext = nullptr;
   LTOModule *OwnedModule = nullptr;
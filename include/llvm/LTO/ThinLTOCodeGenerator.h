@@ -0,0 +1,142 @@
+//===-ThinLTOCodeGenerator.h - LLVM Thin Link Time Optimizer --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ThinLTOCodeGenerator class.
+//
+// Unlike LTOCodeGenerator, which links every module into a single one before
+// optimizing it, ThinLTOCodeGenerator never materializes the whole program.
+// It proceeds in three steps:
+//
+//   1. The thin link reads the function summaries of every input (see
+//      llvm/IR/FunctionInfo.h) into a combined index, without parsing the
+//      modules themselves.
+//   2. For every module, the index is used to choose the functions defined in
+//      other modules that are worth importing for inlining.
+//   3. Every module is then loaded in its own LLVMContext, together with the
+//      functions it imports, optimized and compiled to an object file. These
+//      backends are independent of each other and run in parallel.
+//
+// With a cache directory, the object file of a module is reused by the next
+// link as long as the module, the functions it imports and the options are
+// unchanged (see llvm/LTO/LTOCache.h).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LTO_THINLTOCODEGENERATOR_H
+#define LLVM_LTO_THINLTOCODEGENERATOR_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/LTO/LTOCache.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Target/TargetOptions.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class FunctionInfoIndex;
+class MemoryBuffer;
+class Module;
+
+class ThinLTOCodeGenerator {
+public:
+  /// The functions a module imports, as a map from the ID of the defining
+  /// module in the combined index to the names of the functions.
+  typedef std::map<unsigned, std::vector<std::string>> ImportListTy;
+
+  ThinLTOCodeGenerator();
+  ~ThinLTOCodeGenerator();
+
+  /// Add the bitcode file \p Data, identified by \p Identifier. The data must
+  /// outlive the code generator.
+  void addModule(StringRef Identifier, StringRef Data);
+
+  void setTargetOptions(TargetOptions Opts) { Options = Opts; }
+  void setCpu(StringRef CPU) { MCpu = CPU; }
+  void setAttr(StringRef Attrs) { MAttr = Attrs; }
+  void setCodePICModel(Reloc::Model Model) { RelocModel = Model; }
+  void setOptLevel(unsigned Level) { OptLevel = Level; }
+
+  /// Set the number of backends to run concurrently. Zero, the default, uses
+  /// one thread per hardware thread.
+  void setThreadCount(unsigned Count) { ThreadCount = Count; }
+
+  /// Only import functions with at most \p Limit instructions.
+  void setImportInstrLimit(unsigned Limit) { ImportInstrLimit = Limit; }
+
+  /// Cache the object files in the directory \p Path. An empty path, the
+  /// default, disables the cache.
+  void setCacheDir(StringRef Path) { CacheDir = Path; }
+
+  /// Set the limits the cache directory is pruned to after every run.
+  void setCachePruningPolicy(const LTOCachePruningPolicy &Policy) {
+    CachePruningPolicy = Policy;
+  }
+
+  /// Perform the thin link: read the function summaries of every module into
+  /// a combined index whose module IDs follow the order of addModule(). A
+  /// module without summaries is loaded to compute them. Returns null on
+  /// error.
+  std::unique_ptr<FunctionInfoIndex> linkSummaries(std::string &ErrMsg);
+
+  /// Compute the functions module \p ModuleID of \p Index should import.
+  /// Every callee that is defined in another module, can be imported and has
+  /// at most \p InstrLimit instructions is imported, along with the callees
+  /// of the imported functions that meet the same criteria.
+  static ImportListTy computeImportList(const FunctionInfoIndex &Index,
+                                        unsigned ModuleID,
+                                        unsigned InstrLimit);
+
+  /// Run the thin link and the backends. On success, getProducedBinaries()
+  /// returns one object file per module.
+  bool run(std::string &ErrMsg);
+
+  /// Return the object files produced by run(), in the order of addModule().
+  ArrayRef<std::unique_ptr<MemoryBuffer>> getProducedBinaries() const {
+    return ProducedBinaries;
+  }
+
+private:
+  struct ModuleInput {
+    std::string Identifier;
+    StringRef Data;
+  };
+
+  /// Optimize and compile module \p ModuleID after importing \p Imports.
+  bool runBackend(unsigned ModuleID, const ImportListTy &Imports,
+                  std::unique_ptr<MemoryBuffer> &Binary, std::string &ErrMsg);
+
+  /// Link the functions listed in \p Imports into \p M as
+  /// available_externally definitions.
+  bool importFunctions(Module &M, const ImportListTy &Imports,
+                       std::string &ErrMsg);
+
+  /// Compute the cache key of the object file of module \p ModuleID, given
+  /// the hashes of the contents of every module.
+  std::string computeCacheKey(unsigned ModuleID, const ImportListTy &Imports,
+                              ArrayRef<std::string> ModuleHashes) const;
+
+  std::vector<ModuleInput> Modules;
+  std::vector<std::unique_ptr<MemoryBuffer>> ProducedBinaries;
+  TargetOptions Options;
+  std::string MCpu;
+  std::string MAttr;
+  Reloc::Model RelocModel;
+  unsigned OptLevel;
+  unsigned ThreadCount;
+  unsigned ImportInstrLimit;
+  std::string CacheDir;
+  LTOCachePruningPolicy CachePruningPolicy;
+};
+
+} // End llvm namespace
+
+#endif
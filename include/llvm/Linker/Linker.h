@@ -70,8 +70,13 @@ public:
   /// \brief Link \p Src into the composite. The source is destroyed.
   /// Passing OverrideSymbols as true will have symbols from Src
   /// shadow those in the Dest.
+  /// Passing LinkOnlyNeeded as true links only the definitions of Src that
+  /// the composite declares, and the ones they reference in turn.  The other
+  /// function bodies of Src are not even materialized, and named metadata
+  /// refers to the globals that were not linked through null operands.
   /// Returns true on error.
-  bool linkInModule(Module *Src, bool OverrideSymbols = false);
+  bool linkInModule(Module *Src, bool OverrideSymbols = false,
+                    bool LinkOnlyNeeded = false);
 
   /// \brief Set the composite to the passed-in module.
   void setModule(Module *Dst);
@@ -176,6 +176,29 @@ public:
   /// check state of analysis information.
   virtual void verifyAnalysis() const;
 
+  /// clone - Return a new instance of this pass, configured like this one, or
+  /// null if the pass cannot be copied (the default).
+  ///
+  /// A function pass (or basic block or loop pass) that implements clone()
+  /// declares that it may be run by a multithreaded function pass manager (see
+  /// -function-pass-threads), which runs one copy of the pass per thread, each
+  /// on a different function of the same module.  The copies must only modify
+  /// the function they run on and values uniqued in the LLVMContext, must not
+  /// touch the other functions, iterate the global lists of the module or use
+  /// mutable global state, and may only add declarations or globals to the
+  /// module through Module::getOrInsertFunction, Module::getOrInsertGlobal,
+  /// Intrinsic::getDeclaration or the GlobalVariable constructor.
+  ///
+  /// An immutable pass that is not thread-safe can implement clone() to get
+  /// one copy per thread as well.
+  virtual Pass *clone() const;
+
+  /// isThreadSafe - Return true if this module-level analysis (typically an
+  /// immutable pass) can be queried by several threads at once, in which case
+  /// a multithreaded function pass manager shares it between its threads
+  /// instead of running the pipeline serially.  Defaults to false.
+  virtual bool isThreadSafe() const;
+
   // dumpPassStructure - Implement the -debug-passes=PassStructure option
   virtual void dumpPassStructure(unsigned Offset = 0);
 
@@ -0,0 +1,175 @@
+//===- llvm/Support/Parallel.h - Parallel algorithms ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a task group API and parallel versions of for_each and
+// sort built on top of ThreadPool. All of them degrade to plain serial
+// execution when LLVM is built without thread support or when the pool they
+// run on has a single thread.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+
+/// Return the process-wide thread pool used by the parallel algorithms when
+/// no pool is given explicitly. It is sized to the hardware concurrency and
+/// created on first use.
+ThreadPool &getDefaultThreadPool();
+
+/// Return true if work handed to \p Pool would actually run concurrently.
+inline bool isParallelismAvailable(const ThreadPool &Pool) {
+  return Pool.getThreadCount() > 1;
+}
+
+/// A group of tasks running on a ThreadPool that can be waited upon as a
+/// whole. Tasks may spawn further tasks into the same group. The destructor
+/// waits for every task of the group.
+class TaskGroup {
+  ThreadPool &Pool;
+  std::mutex Lock;
+  std::vector<std::shared_future<void>> Futures;
+
+  TaskGroup(const TaskGroup &) = delete;
+  void operator=(const TaskGroup &) = delete;
+
+public:
+  explicit TaskGroup(ThreadPool &Pool = getDefaultThreadPool())
+      : Pool(Pool) {}
+  ~TaskGroup() { sync(); }
+
+  /// Run \p F asynchronously as part of this group.
+  void spawn(std::function<void()> F);
+
+  /// Wait for every task spawned so far, including the tasks they spawned.
+  void sync();
+
+  ThreadPool &getPool() const { return Pool; }
+};
+
+namespace detail {
+/// Minimum number of elements handed to a single task by parallel_for_each.
+const ptrdiff_t MinParallelGrainSize = 32;
+
+/// Below this size parallel_sort falls back to std::sort.
+const ptrdiff_t MinParallelSortSize = 1024;
+
+template <class RandomAccessIterator, class Comparator>
+RandomAccessIterator medianOf3(RandomAccessIterator Start,
+                               RandomAccessIterator End, Comparator Comp) {
+  RandomAccessIterator Mid = Start + (std::distance(Start, End) / 2);
+  return Comp(*Start, *(End - 1))
+             ? (Comp(*Mid, *(End - 1)) ? (Comp(*Start, *Mid) ? Mid : Start)
+                                       : End - 1)
+             : (Comp(*Mid, *Start) ? (Comp(*(End - 1), *Mid) ? Mid : End - 1)
+                                   : Start);
+}
+
+template <class RandomAccessIterator, class Comparator>
+void parallelQuickSort(RandomAccessIterator Start, RandomAccessIterator End,
+                       const Comparator &Comp, TaskGroup &TG, size_t Depth) {
+  // Do a sequential sort for small inputs, or once the recursion is deep
+  // enough that there is no more parallelism to gain.
+  if (std::distance(Start, End) < MinParallelSortSize || Depth == 0) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  // Partition around a median-of-3 pivot parked at the end of the range.
+  auto Pivot = medianOf3(Start, End, Comp);
+  std::swap(*(End - 1), *Pivot);
+  Pivot = std::partition(Start, End - 1, [&Comp, End](decltype(*Start) V) {
+    return Comp(V, *(End - 1));
+  });
+  std::swap(*Pivot, *(End - 1));
+
+  // Recurse on the lower half in a new task and on the upper half here.
+  TG.spawn([=, &Comp, &TG] {
+    parallelQuickSort(Start, Pivot, Comp, TG, Depth - 1);
+  });
+  parallelQuickSort(Pivot + 1, End, Comp, TG, Depth - 1);
+}
+} // namespace detail
+
+/// Apply \p Fn to every index in [\p Begin, \p End) on \p Pool. The order in
+/// which the indices are visited is unspecified.
+template <class IndexTy, class FuncTy>
+void parallel_for(IndexTy Begin, IndexTy End, FuncTy Fn,
+                  ThreadPool &Pool = getDefaultThreadPool()) {
+  if (!isParallelismAvailable(Pool) ||
+      End - Begin <= detail::MinParallelGrainSize) {
+    for (IndexTy I = Begin; I != End; ++I)
+      Fn(I);
+    return;
+  }
+  // Hand out a few chunks per thread so that stealing can balance uneven
+  // elements, but keep each chunk large enough to amortize the task overhead.
+  IndexTy TaskSize = std::max<IndexTy>(
+      (End - Begin) / IndexTy(Pool.getThreadCount() * 4),
+      detail::MinParallelGrainSize);
+  TaskGroup TG(Pool);
+  IndexTy I = Begin;
+  for (; I + TaskSize < End; I += TaskSize)
+    TG.spawn([=, &Fn] {
+      for (IndexTy J = I, E = I + TaskSize; J != E; ++J)
+        Fn(J);
+    });
+  for (; I != End; ++I)
+    Fn(I);
+}
+
+/// Apply \p Fn to every element of the random access range [\p Begin,
+/// \p End) on \p Pool. The order in which the elements are visited is
+/// unspecified.
+template <class RandomAccessIterator, class FuncTy>
+void parallel_for_each(RandomAccessIterator Begin, RandomAccessIterator End,
+                       FuncTy Fn, ThreadPool &Pool = getDefaultThreadPool()) {
+  parallel_for(ptrdiff_t(0), std::distance(Begin, End),
+               [&](ptrdiff_t I) { Fn(Begin[I]); }, Pool);
+}
+
+/// Sort the random access range [\p Start, \p End) with \p Comp on \p Pool.
+/// Like std::sort, the sort is not stable.
+template <class RandomAccessIterator, class Comparator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                   const Comparator &Comp, ThreadPool &Pool) {
+  if (!isParallelismAvailable(Pool)) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+  TaskGroup TG(Pool);
+  detail::parallelQuickSort(Start, End, Comp, TG,
+                            Log2_64(std::distance(Start, End)) + 1);
+}
+
+template <class RandomAccessIterator, class Comparator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                   const Comparator &Comp) {
+  parallel_sort(Start, End, Comp, getDefaultThreadPool());
+}
+
+template <class RandomAccessIterator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End) {
+  parallel_sort(Start, End, std::less<typename std::iterator_traits<
+                                RandomAccessIterator>::value_type>());
+}
+
+} // namespace llvm
+
+#endif // LLVM_SUPPORT_PARALLEL_H
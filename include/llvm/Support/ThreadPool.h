@@ -0,0 +1,148 @@
+//===-- llvm/Support/ThreadPool.h - A work-stealing ThreadPool --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a work-stealing pool of threads that asynchronously
+// executes tasks and hands out futures for them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+/// A ThreadPool for asynchronous parallel execution on a defined number of
+/// threads.
+///
+/// Every worker thread owns a double-ended queue of tasks. Tasks submitted
+/// from a worker are pushed onto that worker's own queue and popped in LIFO
+/// order, which keeps recursively spawned work hot in cache. Tasks submitted
+/// from any other thread are distributed round-robin. A worker whose queue is
+/// empty steals the oldest task from the queue of another worker.
+///
+/// When LLVM is built without thread support (LLVM_ENABLE_THREADS=0), no
+/// threads are created and every task runs synchronously inside async().
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+  typedef std::packaged_task<void()> PackagedTaskTy;
+
+  /// Construct a pool with the number of threads found by
+  /// std::thread::hardware_concurrency().
+  ThreadPool();
+
+  /// Construct a pool of \p ThreadCount threads. A count of zero is treated
+  /// like the default constructor.
+  explicit ThreadPool(unsigned ThreadCount);
+
+  /// Blocking destructor: the pool waits for all the threads to complete.
+  ~ThreadPool();
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  template <typename Function, typename... Args>
+  std::shared_future<void> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return asyncImpl(std::move(Task));
+  }
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  template <typename Function>
+  std::shared_future<void> async(Function &&F) {
+    return asyncImpl(std::forward<Function>(F));
+  }
+
+  /// Blocking wait for all the tasks to finish. Must not be called from one of
+  /// the pool's own worker threads.
+  void wait();
+
+  /// Block until \p Future is ready. A worker thread of this pool that calls
+  /// this helps execute pending tasks instead of sleeping, so tasks
+  /// may wait on tasks they spawned without deadlocking the pool.
+  void waitFor(const std::shared_future<void> &Future);
+
+  /// Return the number of worker threads in the pool. This is zero when LLVM
+  /// is built without thread support.
+  unsigned getThreadCount() const { return Threads.size(); }
+
+  /// Return true if the calling thread is one of this pool's workers.
+  bool isWorkerThread() const;
+
+private:
+  /// Queue of tasks owned by a single worker.
+  struct WorkQueue {
+    mutable std::mutex Lock;
+    std::deque<PackagedTaskTy> Tasks;
+  };
+
+  /// Package \p Task, enqueue it and return a future for its completion.
+  std::shared_future<void> asyncImpl(TaskTy Task);
+
+  /// Pop a task from the queue of worker \p Self, or steal one from another
+  /// worker. Returns false if every queue is empty.
+  bool tryPopTask(unsigned Self, PackagedTaskTy &Task);
+
+  /// Return true if any worker queue holds a task that has not been started.
+  bool hasQueuedTasks() const;
+
+  /// Run one pending task on behalf of worker \p Self, if there is one.
+  bool runPendingTask(unsigned Self);
+
+  /// Main loop of worker thread \p Index.
+  void workerLoop(unsigned Index);
+
+  /// Account for the completion of one task and wake up any waiters.
+  void finishTask();
+
+  /// Threads in flight.
+  std::vector<std::thread> Threads;
+
+  /// One task queue per worker thread.
+  std::vector<std::unique_ptr<WorkQueue>> Queues;
+
+#if LLVM_ENABLE_THREADS
+  /// Number of tasks that are queued or currently running.
+  std::atomic<unsigned> PendingTasks;
+
+  /// Round-robin cursor used to distribute tasks submitted by non-workers.
+  std::atomic<unsigned> NextQueue;
+
+  /// Lock protecting the sleep / wake-up protocol below.
+  std::mutex StateLock;
+
+  /// Condition for idle workers to wait for new tasks.
+  std::condition_variable WorkAvailableCondition;
+
+  /// Condition signaled whenever a task completes.
+  std::condition_variable CompletionCondition;
+
+  /// Signal for the destruction of the pool, asking threads to exit.
+  bool EnableFlag;
+#endif
+};
+
+} // namespace llvm
+
+#endif // LLVM_SUPPORT_THREADPOOL_H
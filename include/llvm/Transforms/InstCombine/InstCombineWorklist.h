@@ -10,8 +10,9 @@
 #ifndef LLVM_TRANSFORMS_INSTCOMBINE_INSTCOMBINEWORKLIST_H
 #define LLVM_TRANSFORMS_INSTCOMBINE_INSTCOMBINEWORKLIST_H
 
-#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SwissDenseMap.h"
+#include "llvm/Analysis/KnownBitsCache.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
@@ -25,27 +26,36 @@ namespace llvm {
 /// InstCombine.
 class InstCombineWorklist {
   SmallVector<Instruction*, 256> Worklist;
-  DenseMap<Instruction*, unsigned> WorklistMap;
+  SwissDenseMap<Instruction*, unsigned> WorklistMap;
+  KnownBitsCache *KBC;
 
   void operator=(const InstCombineWorklist&RHS) = delete;
   InstCombineWorklist(const InstCombineWorklist&) = delete;
 public:
-  InstCombineWorklist() {}
+  InstCombineWorklist() : KBC(nullptr) {}
 
   InstCombineWorklist(InstCombineWorklist &&Arg)
       : Worklist(std::move(Arg.Worklist)),
-        WorklistMap(std::move(Arg.WorklistMap)) {}
+        WorklistMap(std::move(Arg.WorklistMap)), KBC(Arg.KBC) {}
   InstCombineWorklist &operator=(InstCombineWorklist &&RHS) {
     Worklist = std::move(RHS.Worklist);
     WorklistMap = std::move(RHS.WorklistMap);
+    KBC = RHS.KBC;
     return *this;
   }
 
   bool isEmpty() const { return Worklist.empty(); }
 
+  /// setKnownBitsCache - Invalidate the instructions added to the worklist in
+  /// the given cache, since they are added when they change.  Pass null to
+  /// stop.
+  void setKnownBitsCache(KnownBitsCache *C) { KBC = C; }
+
   /// Add - Add the specified instruction to the worklist if it isn't already
   /// in it.
   void Add(Instruction *I) {
+    if (KBC)
+      KBC->invalidate(I);
     if (WorklistMap.insert(std::make_pair(I, Worklist.size())).second) {
       DEBUG(dbgs() << "IC: ADD: " << *I << '\n');
       Worklist.push_back(I);
@@ -63,7 +73,7 @@ public:
   void AddInitialGroup(Instruction *const *List, unsigned NumEntries) {
     assert(Worklist.empty() && "Worklist must be empty to add initial group");
     Worklist.reserve(NumEntries+16);
-    WorklistMap.resize(NumEntries);
+    WorklistMap.reserve(NumEntries);
     DEBUG(dbgs() << "IC: ADDING: " << NumEntries << " instrs to worklist\n");
     for (unsigned Idx = 0; NumEntries; --NumEntries) {
       Instruction *I = List[NumEntries-1];
@@ -74,7 +84,7 @@ public:
 
   // Remove - remove I from the worklist if it exists.
   void Remove(Instruction *I) {
-    DenseMap<Instruction*, unsigned>::iterator It = WorklistMap.find(I);
+    SwissDenseMap<Instruction*, unsigned>::iterator It = WorklistMap.find(I);
     if (It == WorklistMap.end()) return; // Not in worklist.
 
     // Don't bother moving everything down, just null out the slot.
@@ -0,0 +1,57 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Module;
+class StringRef;
+
+/// Splits the module M into N linkable partitions. The function ModuleCallback
+/// is called N times passing each individual partition as the MPart argument.
+/// M itself is left in place, but its local symbols may have been
+/// externalized.
+///
+/// Globals that must end up in the same partition are kept together: members
+/// of a comdat, and aliases with the object they alias. The resulting groups
+/// are distributed over the partitions so that every partition receives a
+/// similar amount of code. The partitioning depends only on the contents of
+/// M and on N, so it is deterministic.
+///
+/// If PreserveLocals is false, symbols with local linkage that end up being
+/// referenced from another partition are externalized with hidden visibility,
+/// and renamed with a ".llvm.split" suffix so that they cannot clash with
+/// symbols defined outside of M. Hidden symbols are demoted back to local
+/// symbols when the partitions are linked into an executable or shared
+/// library, so the linked output exports the same symbols as it would have
+/// without splitting. If PreserveLocals is true, every local symbol is instead
+/// kept in the same partition as all of its users, which leaves the external
+/// interface of every partition unchanged at the cost of coarser partitions.
+///
+/// FIXME: Internal symbols defined in module-level inline asm are not visible
+/// to the other partitions.
+void SplitModule(
+    Module &M, unsigned N,
+    std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback,
+    bool PreserveLocals = false);
+
+} // End llvm namespace
+
+#endif
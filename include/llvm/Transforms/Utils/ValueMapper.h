@@ -59,7 +59,13 @@ namespace llvm {
     /// RF_IgnoreMissingEntries - If this flag is set, the remapper ignores
     /// entries that are not in the value map.  If it is unset, it aborts if an
     /// operand is asked to be remapped which doesn't exist in the mapping.
-    RF_IgnoreMissingEntries = 2
+    RF_IgnoreMissingEntries = 2,
+
+    /// RF_NullMapMissingGlobalValues - If this flag is set, global values that
+    /// are not in the value map and that the materializer does not provide
+    /// are mapped to null, rather than to themselves.  Constants and metadata
+    /// referring to them are mapped to null as well.
+    RF_NullMapMissingGlobalValues = 4
   };
 
   static inline RemapFlags operator|(RemapFlags LHS, RemapFlags RHS) {
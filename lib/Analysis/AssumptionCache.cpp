@@ -18,9 +18,11 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/Support/Debug.h"
+#include <mutex>
 using namespace llvm;
 using namespace llvm::PatternMatch;
 
@@ -96,6 +98,10 @@ void AssumptionCacheTracker::FunctionCallbackVH::deleted() {
 }
 
 AssumptionCache &AssumptionCacheTracker::getAssumptionCache(Function &F) {
+  std::unique_lock<sys::Mutex> Lock(CachesLock, std::defer_lock);
+  if (F.getContext().isMultithreaded())
+    Lock.lock();
+
   // We probe the function map twice to try and avoid creating a value handle
   // around the function in common cases. This makes insertion a bit slower,
   // but if we have to insert we're going to scan the whole function so that
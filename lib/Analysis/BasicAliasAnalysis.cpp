@@ -453,6 +453,10 @@ namespace {
 
     bool doInitialization(Module &M) override;
 
+    /// Queries use caches held by the pass, so every thread running function
+    /// passes concurrently gets its own copy.
+    Pass *clone() const override { return new BasicAliasAnalysis(); }
+
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<AliasAnalysis>();
       AU.addRequired<AssumptionCacheTracker>();
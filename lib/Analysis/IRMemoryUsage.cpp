@@ -0,0 +1,298 @@
+//===-- IRMemoryUsage.cpp - Accounts the memory held by the IR of a module ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass accounts the bytes that the IR of a module holds, for each class
+// of IR object: values, the operand lists of the users, the names, and the
+// constants and metadata that the module refers to.  Run it from opt with the
+// -analyze option to print the report.
+//
+// The figures are what the objects themselves take, and their operands and
+// trailing data.  They leave out the allocator overhead, the slack of the
+// growable operand lists, and the uniquing tables of the context.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/Passes.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+namespace {
+/// The number of objects of one class and the bytes they take.
+struct ClassUsage {
+  uint64_t Count;
+  uint64_t Bytes;
+  ClassUsage() : Count(0), Bytes(0) {}
+};
+
+class IRMemoryUsage : public ModulePass {
+  StringMap<ClassUsage> Usage;
+  SmallPtrSet<const Constant *, 64> VisitedConstants;
+  SmallPtrSet<const Metadata *, 64> VisitedMetadata;
+  SmallVector<const Metadata *, 64> MetadataWorklist;
+
+  void account(StringRef Class, uint64_t Bytes) {
+    ClassUsage &U = Usage[Class];
+    ++U.Count;
+    U.Bytes += Bytes;
+  }
+
+  void accountName(const Value &V);
+  void accountOperands(const User &U);
+  void accountConstant(const Constant *C);
+  void accountMetadata(const Metadata *MD);
+  void accountInstruction(const Instruction &I);
+  void drainMetadataWorklist();
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  IRMemoryUsage() : ModulePass(ID) {
+    initializeIRMemoryUsagePass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+  void print(raw_ostream &O, const Module *M) const override;
+  void releaseMemory() override {
+    Usage.clear();
+    VisitedConstants.clear();
+    VisitedMetadata.clear();
+  }
+};
+}
+
+char IRMemoryUsage::ID = 0;
+INITIALIZE_PASS(IRMemoryUsage, "ir-memory",
+                "Account the memory held by the IR of a module", false, true)
+
+ModulePass *llvm::createIRMemoryUsagePass() { return new IRMemoryUsage(); }
+
+void IRMemoryUsage::accountName(const Value &V) {
+  if (!V.hasName())
+    return;
+  // The name, and its entry in the table of the context that maps the named
+  // values to their names.
+  account("Value name", sizeof(StringMapEntry<Value *>) + V.getName().size() +
+                            1 + sizeof(std::pair<const Value *, ValueName *>));
+}
+
+void IRMemoryUsage::accountOperands(const User &U) {
+  if (!U.getNumOperands())
+    return;
+  ClassUsage &Uses = Usage["Use"];
+  Uses.Count += U.getNumOperands();
+  Uses.Bytes += U.getNumOperands() * sizeof(Use);
+  for (const Value *Op : U.operands()) {
+    if (auto *C = dyn_cast<Constant>(Op))
+      accountConstant(C);
+    else if (auto *MDV = dyn_cast<MetadataAsValue>(Op))
+      accountMetadata(MDV->getMetadata());
+  }
+}
+
+void IRMemoryUsage::accountConstant(const Constant *C) {
+  // Global values are accounted with the module that owns them.
+  if (isa<GlobalValue>(C) || !VisitedConstants.insert(C).second)
+    return;
+
+  switch (C->getValueID()) {
+  case Value::ConstantIntVal: {
+    const APInt &Val = cast<ConstantInt>(C)->getValue();
+    unsigned NumWords = Val.getNumWords();
+    account("ConstantInt", sizeof(ConstantInt) +
+                               (NumWords > 1 ? NumWords * sizeof(uint64_t) : 0));
+    break;
+  }
+  case Value::ConstantFPVal:
+    account("ConstantFP", sizeof(ConstantFP));
+    break;
+  case Value::ConstantDataArrayVal:
+  case Value::ConstantDataVectorVal: {
+    auto *CDS = cast<ConstantDataSequential>(C);
+    account(isa<ConstantDataArray>(CDS) ? "ConstantDataArray"
+                                        : "ConstantDataVector",
+            sizeof(ConstantDataSequential) +
+                CDS->getRawDataValues().size());
+    break;
+  }
+  case Value::ConstantAggregateZeroVal:
+    account("ConstantAggregateZero", sizeof(ConstantAggregateZero));
+    break;
+  case Value::ConstantPointerNullVal:
+    account("ConstantPointerNull", sizeof(ConstantPointerNull));
+    break;
+  case Value::UndefValueVal:
+    account("UndefValue", sizeof(UndefValue));
+    break;
+  case Value::BlockAddressVal:
+    account("BlockAddress", sizeof(BlockAddress));
+    break;
+  case Value::ConstantArrayVal:
+    account("ConstantArray", sizeof(ConstantArray));
+    break;
+  case Value::ConstantStructVal:
+    account("ConstantStruct", sizeof(ConstantStruct));
+    break;
+  case Value::ConstantVectorVal:
+    account("ConstantVector", sizeof(ConstantVector));
+    break;
+  default:
+    // The subclasses of ConstantExpr are private to the IR library; they add
+    // at most a few words to ConstantExpr.
+    account("ConstantExpr", sizeof(ConstantExpr));
+    break;
+  }
+  accountOperands(*C);
+}
+
+void IRMemoryUsage::accountMetadata(const Metadata *MD) {
+  if (!MD || !VisitedMetadata.insert(MD).second)
+    return;
+  MetadataWorklist.push_back(MD);
+}
+
+void IRMemoryUsage::drainMetadataWorklist() {
+  while (!MetadataWorklist.empty()) {
+    const Metadata *MD = MetadataWorklist.pop_back_val();
+    switch (MD->getMetadataID()) {
+    case Metadata::MDStringKind:
+      account("MDString", sizeof(StringMapEntry<MDString>) +
+                              cast<MDString>(MD)->getLength() + 1);
+      continue;
+    case Metadata::ConstantAsMetadataKind:
+      account("ConstantAsMetadata", sizeof(ConstantAsMetadata));
+      accountConstant(cast<ConstantAsMetadata>(MD)->getValue());
+      continue;
+    case Metadata::LocalAsMetadataKind:
+      account("LocalAsMetadata", sizeof(LocalAsMetadata));
+      continue;
+#define HANDLE_MDNODE_LEAF(CLASS)                                              \
+    case Metadata::CLASS##Kind:                                                \
+      account(#CLASS, sizeof(CLASS) +                                          \
+                          cast<MDNode>(MD)->getNumOperands() *                 \
+                              sizeof(MDOperand));                              \
+      break;
+#include "llvm/IR/Metadata.def"
+    default:
+      llvm_unreachable("Unexpected metadata kind");
+    }
+    for (const MDOperand &Op : cast<MDNode>(MD)->operands())
+      accountMetadata(Op);
+  }
+}
+
+void IRMemoryUsage::accountInstruction(const Instruction &I) {
+  switch (I.getOpcode()) {
+#define HANDLE_INST(N, OPCODE, CLASS)                                          \
+  case Instruction::OPCODE:                                                    \
+    account(#CLASS, sizeof(CLASS));                                            \
+    break;
+#include "llvm/IR/Instruction.def"
+  }
+  // The incoming blocks of a phi follow its operands.
+  if (auto *PN = dyn_cast<PHINode>(&I))
+    Usage["PHINode"].Bytes += PN->getNumIncomingValues() * sizeof(BasicBlock *);
+  accountName(I);
+  accountOperands(I);
+
+  if (DILocation *DL = I.getDebugLoc())
+    accountMetadata(DL);
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  I.getAllMetadataOtherThanDebugLoc(MDs);
+  for (auto &MD : MDs) {
+    account("Metadata attachment",
+            sizeof(std::pair<unsigned, TrackingMDNodeRef>));
+    accountMetadata(MD.second);
+  }
+}
+
+bool IRMemoryUsage::runOnModule(Module &M) {
+  account("Module", sizeof(Module));
+
+  for (const GlobalVariable &GV : M.globals()) {
+    account("GlobalVariable", sizeof(GlobalVariable));
+    accountName(GV);
+    accountOperands(GV);
+  }
+  for (const GlobalAlias &GA : M.aliases()) {
+    account("GlobalAlias", sizeof(GlobalAlias));
+    accountName(GA);
+    accountOperands(GA);
+  }
+  for (const Function &F : M) {
+    account("Function", sizeof(Function));
+    accountName(F);
+    accountOperands(F);
+    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+    F.getAllMetadata(MDs);
+    for (auto &MD : MDs) {
+      account("Metadata attachment",
+              sizeof(std::pair<unsigned, TrackingMDNodeRef>));
+      accountMetadata(MD.second);
+    }
+    for (const Argument &A : F.args()) {
+      account("Argument", sizeof(Argument));
+      accountName(A);
+    }
+    for (const BasicBlock &BB : F) {
+      account("BasicBlock", sizeof(BasicBlock));
+      accountName(BB);
+      for (const Instruction &I : BB)
+        accountInstruction(I);
+    }
+  }
+  for (const NamedMDNode &NMD : M.named_metadata()) {
+    account("NamedMDNode", sizeof(NamedMDNode) + NMD.getName().size() +
+                               NMD.getNumOperands() * sizeof(TrackingMDRef));
+    for (const MDNode *Op : NMD.operands())
+      accountMetadata(Op);
+  }
+  drainMetadataWorklist();
+  return false;
+}
+
+void IRMemoryUsage::print(raw_ostream &O, const Module *M) const {
+  std::vector<std::pair<StringRef, ClassUsage>> Rows;
+  uint64_t TotalCount = 0, TotalBytes = 0;
+  for (const auto &Entry : Usage) {
+    Rows.push_back(std::make_pair(Entry.getKey(), Entry.getValue()));
+    TotalCount += Entry.getValue().Count;
+    TotalBytes += Entry.getValue().Bytes;
+  }
+  std::sort(Rows.begin(), Rows.end(),
+            [](const std::pair<StringRef, ClassUsage> &LHS,
+               const std::pair<StringRef, ClassUsage> &RHS) {
+    if (LHS.second.Bytes != RHS.second.Bytes)
+      return LHS.second.Bytes > RHS.second.Bytes;
+    return LHS.first < RHS.first;
+  });
+
+  O << "IR memory usage:\n";
+  O << "       Count          Bytes      %  Class\n";
+  for (const auto &Row : Rows)
+    O << format("%12llu %14llu %6.2f  ", (unsigned long long)Row.second.Count,
+                (unsigned long long)Row.second.Bytes,
+                100.0 * Row.second.Bytes / TotalBytes)
+      << Row.first << '\n';
+  O << format("%12llu %14llu %6.2f  ", (unsigned long long)TotalCount,
+              (unsigned long long)TotalBytes, 100.0)
+    << "Total\n";
+}
@@ -0,0 +1,123 @@
+//===- KnownBitsCache.cpp - Cache known bits queries ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the cache of the known bits and of the number of sign
+// bits of the instructions of a function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/KnownBitsCache.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Instruction.h"
+using namespace llvm;
+
+/// The search depth limit of ValueTracking.  The result of a value is computed
+/// from the values it uses through at most this many uses whose results are
+/// not themselves in the cache.
+static const unsigned MaxUncachedUses = 6;
+
+void KnownBitsCache::ValueCallbackVH::deleted() {
+  KBC->forget(getValPtr());
+  // 'this' now dangles!
+}
+
+void KnownBitsCache::ValueCallbackVH::allUsesReplacedWith(Value *) {
+  // The users still use the old value at this point.
+  KBC->invalidate(getValPtr());
+  // 'this' now dangles!
+}
+
+void KnownBitsCache::track(Value *V, unsigned Depth) {
+  assert(Depth < 32 && "Depth does not fit the mask");
+  auto I = Tracked.find_as(V);
+  if (I == Tracked.end())
+    I = Tracked.insert(std::make_pair(ValueCallbackVH(V, this), 0u)).first;
+  I->second |= 1u << Depth;
+}
+
+bool KnownBitsCache::forget(const Value *V) {
+  auto I = Tracked.find_as(const_cast<Value *>(V));
+  if (I == Tracked.end())
+    return false;
+  for (unsigned Depths = I->second; Depths; Depths &= Depths - 1) {
+    Key K(V, countTrailingZeros(Depths));
+    KnownBitsResults.erase(K);
+    SignBitsResults.erase(K);
+  }
+  Tracked.erase(I);
+  return true;
+}
+
+bool KnownBitsCache::lookupKnownBits(const Value *V, unsigned Depth,
+                                     APInt &KnownZero, APInt &KnownOne) const {
+  auto I = KnownBitsResults.find(Key(V, Depth));
+  if (I == KnownBitsResults.end())
+    return false;
+  KnownZero = I->second.KnownZero;
+  KnownOne = I->second.KnownOne;
+  return true;
+}
+
+void KnownBitsCache::cacheKnownBits(Value *V, unsigned Depth,
+                                    const APInt &KnownZero,
+                                    const APInt &KnownOne) {
+  KnownBits &Entry = KnownBitsResults[Key(V, Depth)];
+  Entry.KnownZero = KnownZero;
+  Entry.KnownOne = KnownOne;
+  track(V, Depth);
+}
+
+unsigned KnownBitsCache::lookupNumSignBits(const Value *V,
+                                           unsigned Depth) const {
+  auto I = SignBitsResults.find(Key(V, Depth));
+  return I == SignBitsResults.end() ? 0 : I->second;
+}
+
+void KnownBitsCache::cacheNumSignBits(Value *V, unsigned Depth,
+                                      unsigned NumSignBits) {
+  assert(NumSignBits && "A value has at least one sign bit");
+  SignBitsResults[Key(V, Depth)] = NumSignBits;
+  track(V, Depth);
+}
+
+void KnownBitsCache::invalidate(Value *V) {
+  forget(V);
+
+  // Walk the users of V as long as their results may have been computed from
+  // V.  A user whose results are in the cache starts a new chain of uses, as
+  // its own users may have read them.  Each value is walked with the shortest
+  // chain of uncached uses that reaches it.
+  DenseMap<Value *, unsigned> Distance;
+  SmallVector<Value *, 16> Worklist;
+  Distance[V] = 0;
+  Worklist.push_back(V);
+  while (!Worklist.empty()) {
+    Value *Cur = Worklist.pop_back_val();
+    unsigned UserDistance = Distance[Cur] + 1;
+    for (User *U : Cur->users()) {
+      if (!isa<Instruction>(U))
+        continue;
+      unsigned NewDistance = forget(U) ? 0 : UserDistance;
+      auto Inserted = Distance.insert(std::make_pair(U, NewDistance));
+      if (!Inserted.second) {
+        if (Inserted.first->second <= NewDistance)
+          continue;
+        Inserted.first->second = NewDistance;
+      }
+      if (NewDistance < MaxUncachedUses)
+        Worklist.push_back(U);
+    }
+  }
+}
+
+void KnownBitsCache::clear() {
+  KnownBitsResults.clear();
+  SignBitsResults.clear();
+  Tracked.clear();
+}
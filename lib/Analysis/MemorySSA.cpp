@@ -0,0 +1,1000 @@
+//===-- MemorySSA.cpp - Memory SSA Builder --------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemorySSA class, which builds memory SSA for a
+// function, and the caching walker that looks up clobbers over it.
+//
+// The accesses are placed the way mem2reg places the phis of an alloca: a phi
+// goes in each block of the iterated dominance frontier of the blocks with a
+// def, and a walk of the dominator tree gives each access the nearest def or
+// phi above it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/IteratedDominanceFrontier.h"
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "memoryssa"
+
+STATISTIC(NumClobberCacheHits, "Number of clobbers found in the walker cache");
+STATISTIC(NumClobberChecks, "Number of defs checked for clobbering by walker");
+
+static cl::opt<unsigned> MaxCheckLimit(
+    "memssa-check-limit", cl::Hidden, cl::init(100),
+    cl::desc("The maximum number of defs and phis the memory SSA walker looks "
+             "at for one query before it gives a conservative answer"));
+
+static cl::opt<bool>
+VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Verify memory SSA after building it"));
+
+static cl::opt<bool> PrintClobbers(
+    "memoryssa-print-clobbers", cl::init(false), cl::Hidden,
+    cl::desc("Print the clobber that the walker finds for each use and def"));
+
+INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                      true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                    true)
+
+//===----------------------------------------------------------------------===//
+// Accesses
+//===----------------------------------------------------------------------===//
+
+MemoryAccess::~MemoryAccess() {}
+
+void MemoryAccess::printAsOperand(raw_ostream &OS) const {
+  if (auto *MD = dyn_cast<MemoryDef>(this)) {
+    if (!MD->getMemoryInst() && !MD->getBlock())
+      OS << "liveOnEntry";
+    else
+      OS << MD->getID();
+  } else {
+    OS << cast<MemoryPhi>(this)->getID();
+  }
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << "\n";
+}
+
+void MemoryUseOrDef::setDefiningAccess(MemoryAccess *DMA) {
+  if (DefiningAccess == DMA)
+    return;
+  if (DefiningAccess)
+    DefiningAccess->removeUser(this);
+  DefiningAccess = DMA;
+  if (DMA)
+    DMA->addUser(this);
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  getDefiningAccess()->printAsOperand(OS);
+  OS << ')';
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  printAsOperand(OS);
+  OS << " = MemoryDef(";
+  getDefiningAccess()->printAsOperand(OS);
+  OS << ')';
+}
+
+MemoryAccess *MemoryPhi::getIncomingValueForBlock(const BasicBlock *BB) const {
+  for (const auto &Op : Operands)
+    if (Op.first == BB)
+      return Op.second;
+  return nullptr;
+}
+
+bool MemoryPhi::hasIncomingValue(const MemoryAccess *V) const {
+  for (const auto &Op : Operands)
+    if (Op.second == V)
+      return true;
+  return false;
+}
+
+void MemoryPhi::setIncomingValue(unsigned I, MemoryAccess *V) {
+  MemoryAccess *Old = Operands[I].second;
+  if (Old == V)
+    return;
+  Operands[I].second = V;
+  // The same value may come in from several blocks.
+  if (!hasIncomingValue(Old))
+    Old->removeUser(this);
+  V->addUser(this);
+}
+
+void MemoryPhi::addIncoming(MemoryAccess *V, BasicBlock *BB) {
+  Operands.push_back(std::make_pair(BB, V));
+  V->addUser(this);
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  printAsOperand(OS);
+  OS << " = MemoryPhi(";
+  for (unsigned I = 0, E = Operands.size(); I != E; ++I) {
+    if (I)
+      OS << ',';
+    OS << '{';
+    BasicBlock *BB = Operands[I].first;
+    if (BB->hasName())
+      OS << BB->getName();
+    else
+      BB->printAsOperand(OS, false);
+    OS << ',';
+    Operands[I].second->printAsOperand(OS);
+    OS << '}';
+  }
+  OS << ')';
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA(Function &F, AliasAnalysis *AA, DominatorTree *DT)
+    : F(F), AA(AA), DT(DT), NextID(0) {
+  buildMemorySSA();
+}
+
+MemorySSA::~MemorySSA() {}
+
+MemorySSA::AccessListType *
+MemorySSA::getOrCreateAccessList(const BasicBlock *BB) {
+  std::unique_ptr<AccessListType> &Accesses = PerBlockAccesses[BB];
+  if (!Accesses)
+    Accesses.reset(new AccessListType());
+  return Accesses.get();
+}
+
+/// Create the access of \p I, with no defining access yet, if it touches
+/// memory.
+MemoryUseOrDef *MemorySSA::createNewAccess(Instruction *I, BasicBlock *BB) {
+  AliasAnalysis::ModRefResult ModRef = AA->getModRefInfo(I);
+  if (ModRef == AliasAnalysis::NoModRef)
+    return nullptr;
+
+  assert(!ValueToMemoryAccess.count(I) && "Instruction already has an access");
+  MemoryUseOrDef *MUD;
+  if (ModRef & AliasAnalysis::Mod)
+    MUD = new MemoryDef(nullptr, I, BB, NextID++);
+  else
+    MUD = new MemoryUse(nullptr, I, BB);
+  ValueToMemoryAccess[I] = MUD;
+  return MUD;
+}
+
+void MemorySSA::buildMemorySSA() {
+  // The live on entry def belongs to no block, so that it is not mistaken for
+  // an access of the entry block.
+  LiveOnEntryDef.reset(new MemoryDef(nullptr, nullptr, nullptr, NextID++));
+
+  // Create the accesses of the instructions, and note the blocks that define
+  // memory.
+  DenseMap<const BasicBlock *, unsigned> BBNumbers;
+  SmallPtrSet<BasicBlock *, 32> DefiningBlocks;
+  unsigned NextBBNumber = 0;
+  for (BasicBlock &BB : F) {
+    BBNumbers[&BB] = NextBBNumber++;
+    AccessListType *Accesses = nullptr;
+    for (Instruction &I : BB) {
+      MemoryUseOrDef *MUD = createNewAccess(&I, &BB);
+      if (!MUD)
+        continue;
+      if (!Accesses)
+        Accesses = getOrCreateAccessList(&BB);
+      Accesses->push_back(MUD);
+      if (isa<MemoryDef>(MUD) && DT->isReachableFromEntry(&BB))
+        DefiningBlocks.insert(&BB);
+    }
+  }
+
+  // Place the phis, numbering them in the order of their blocks.
+  IDFCalculator IDFs(*DT);
+  IDFs.setDefiningBlocks(DefiningBlocks);
+  SmallVector<BasicBlock *, 32> IDFBlocks;
+  IDFs.calculate(IDFBlocks);
+  std::sort(IDFBlocks.begin(), IDFBlocks.end(),
+            [&BBNumbers](const BasicBlock *A, const BasicBlock *B) {
+    return BBNumbers.lookup(A) < BBNumbers.lookup(B);
+  });
+  for (BasicBlock *BB : IDFBlocks) {
+    MemoryPhi *Phi = new MemoryPhi(BB, NextID++);
+    ValueToMemoryAccess[BB] = Phi;
+    getOrCreateAccessList(BB)->push_front(Phi);
+  }
+
+  // Give each access the def or phi above it.
+  SmallPtrSet<BasicBlock *, 32> Visited;
+  renamePass(DT->getRootNode(), LiveOnEntryDef.get(), Visited);
+
+  // The blocks that the walk of the dominator tree did not reach are
+  // unreachable.  Nothing flows into them, so their accesses are given the
+  // live on entry def.
+  for (BasicBlock &BB : F)
+    if (!Visited.count(&BB))
+      markUnreachableAsLiveOnEntry(&BB);
+
+  Walker.reset(new CachingMemorySSAWalker(this, AA));
+}
+
+/// Give the accesses of \p BB their defining accesses, starting from
+/// \p IncomingVal, and the incoming values of the phis of its successors.
+/// Return the version of memory at the end of the block.
+MemoryAccess *MemorySSA::renameBlock(BasicBlock *BB,
+                                     MemoryAccess *IncomingVal) {
+  auto It = PerBlockAccesses.find(BB);
+  if (It != PerBlockAccesses.end()) {
+    for (MemoryAccess &MA : *It->second) {
+      if (auto *MUD = dyn_cast<MemoryUseOrDef>(&MA)) {
+        MUD->setDefiningAccess(IncomingVal);
+        if (isa<MemoryDef>(MUD))
+          IncomingVal = MUD;
+      } else {
+        IncomingVal = &MA;
+      }
+    }
+  }
+
+  for (BasicBlock *Succ : successors(BB))
+    if (MemoryPhi *Phi = getMemoryAccess(Succ))
+      Phi->addIncoming(IncomingVal, BB);
+  return IncomingVal;
+}
+
+void MemorySSA::renamePass(DomTreeNode *Root, MemoryAccess *IncomingVal,
+                           SmallPtrSetImpl<BasicBlock *> &Visited) {
+  // Walk the dominator tree with an explicit stack: the generated functions
+  // this runs on can have dominator trees far deeper than the call stack.
+  struct RenamePassData {
+    DomTreeNode *Node;
+    DomTreeNode::iterator ChildIt;
+    MemoryAccess *IncomingVal;
+  };
+  SmallVector<RenamePassData, 32> WorkStack;
+
+  Visited.insert(Root->getBlock());
+  IncomingVal = renameBlock(Root->getBlock(), IncomingVal);
+  WorkStack.push_back({Root, Root->begin(), IncomingVal});
+  while (!WorkStack.empty()) {
+    RenamePassData &Top = WorkStack.back();
+    if (Top.ChildIt == Top.Node->end()) {
+      WorkStack.pop_back();
+      continue;
+    }
+    DomTreeNode *Child = *Top.ChildIt++;
+    BasicBlock *BB = Child->getBlock();
+    Visited.insert(BB);
+    IncomingVal = renameBlock(BB, Top.IncomingVal);
+    WorkStack.push_back({Child, Child->begin(), IncomingVal});
+  }
+}
+
+void MemorySSA::markUnreachableAsLiveOnEntry(BasicBlock *BB) {
+  assert(!DT->isReachableFromEntry(BB) &&
+         "Reachable block found while handling unreachable blocks");
+
+  // An unreachable block has no phi, since the phis are placed from the
+  // dominator tree, but it may branch to a reachable block that has one.
+  for (BasicBlock *Succ : successors(BB))
+    if (MemoryPhi *Phi = getMemoryAccess(Succ))
+      Phi->addIncoming(LiveOnEntryDef.get(), BB);
+
+  auto It = PerBlockAccesses.find(BB);
+  if (It == PerBlockAccesses.end())
+    return;
+  for (MemoryAccess &MA : *It->second)
+    cast<MemoryUseOrDef>(MA).setDefiningAccess(LiveOnEntryDef.get());
+}
+
+MemoryUseOrDef *MemorySSA::getMemoryAccess(const Instruction *I) const {
+  return cast_or_null<MemoryUseOrDef>(ValueToMemoryAccess.lookup(I));
+}
+
+MemoryPhi *MemorySSA::getMemoryAccess(const BasicBlock *BB) const {
+  return cast_or_null<MemoryPhi>(ValueToMemoryAccess.lookup(BB));
+}
+
+void MemorySSA::invalidateOrdering(const BasicBlock *BB) const {
+  BlocksWithOrder.erase(BB);
+}
+
+bool MemorySSA::locallyDominates(const MemoryAccess *Dominator,
+                                 const MemoryAccess *Dominatee) const {
+  const BasicBlock *BB = Dominator->getBlock();
+  assert(BB == Dominatee->getBlock() &&
+         "Asking for local domination of accesses of different blocks");
+  if (BlocksWithOrder.insert(BB).second) {
+    unsigned Position = 0;
+    for (const MemoryAccess &MA : *getBlockAccesses(BB))
+      BlockOrder[&MA] = Position++;
+  }
+  return BlockOrder.lookup(Dominator) < BlockOrder.lookup(Dominatee);
+}
+
+bool MemorySSA::dominates(const MemoryAccess *Dominator,
+                          const MemoryAccess *Dominatee) const {
+  if (Dominator == Dominatee || isLiveOnEntryDef(Dominator))
+    return true;
+  if (isLiveOnEntryDef(Dominatee))
+    return false;
+  if (Dominator->getBlock() != Dominatee->getBlock())
+    return DT->dominates(Dominator->getBlock(), Dominatee->getBlock());
+  return locallyDominates(Dominator, Dominatee);
+}
+
+/// Return the version of memory that reaches the beginning of \p BB.
+MemoryAccess *MemorySSA::getVersionAtEntry(BasicBlock *BB) const {
+  // A block without a phi sees the version at the end of its immediate
+  // dominator.
+  while (DT->isReachableFromEntry(BB)) {
+    if (MemoryPhi *Phi = getMemoryAccess(BB))
+      return Phi;
+    DomTreeNode *IDom = DT->getNode(BB)->getIDom();
+    if (!IDom)
+      break;
+    BB = IDom->getBlock();
+    if (const AccessListType *Accesses = getBlockAccesses(BB))
+      for (auto It = Accesses->rbegin(), E = Accesses->rend(); It != E; ++It)
+        if (!isa<MemoryUse>(*It))
+          return const_cast<MemoryAccess *>(&*It);
+  }
+  return LiveOnEntryDef.get();
+}
+
+/// Return the version of memory that leaves \p BB.  As when memory SSA is
+/// built, an unreachable block gives the live on entry def to the phis of its
+/// successors.
+MemoryAccess *MemorySSA::getVersionAtEnd(BasicBlock *BB) const {
+  if (!DT->isReachableFromEntry(BB))
+    return LiveOnEntryDef.get();
+  if (const AccessListType *Accesses = getBlockAccesses(BB))
+    for (auto It = Accesses->rbegin(), E = Accesses->rend(); It != E; ++It)
+      if (!isa<MemoryUse>(*It))
+        return const_cast<MemoryAccess *>(&*It);
+  return getVersionAtEntry(BB);
+}
+
+/// Add the phis that the blocks with defs now need, with placeholder
+/// incoming values, and return their blocks in \p NewPhiBlocks.
+void MemorySSA::placeMissingPhis(SmallVectorImpl<BasicBlock *> &NewPhiBlocks) {
+  SmallPtrSet<BasicBlock *, 32> DefiningBlocks;
+  for (const auto &Entry : PerBlockAccesses) {
+    BasicBlock *BB = const_cast<BasicBlock *>(Entry.first);
+    if (!DT->isReachableFromEntry(BB))
+      continue;
+    for (const MemoryAccess &MA : *Entry.second)
+      if (isa<MemoryDef>(MA)) {
+        DefiningBlocks.insert(BB);
+        break;
+      }
+  }
+
+  IDFCalculator IDFs(*DT);
+  IDFs.setDefiningBlocks(DefiningBlocks);
+  SmallVector<BasicBlock *, 32> IDFBlocks;
+  IDFs.calculate(IDFBlocks);
+  for (BasicBlock *BB : IDFBlocks)
+    if (!getMemoryAccess(BB))
+      NewPhiBlocks.push_back(BB);
+  if (NewPhiBlocks.empty())
+    return;
+
+  // Number the new phis in the order of their blocks.
+  if (NewPhiBlocks.size() > 1) {
+    DenseMap<const BasicBlock *, unsigned> BBNumbers;
+    unsigned NextBBNumber = 0;
+    for (BasicBlock &BB : F)
+      BBNumbers[&BB] = NextBBNumber++;
+    std::sort(NewPhiBlocks.begin(), NewPhiBlocks.end(),
+              [&BBNumbers](const BasicBlock *A, const BasicBlock *B) {
+      return BBNumbers.lookup(A) < BBNumbers.lookup(B);
+    });
+  }
+  for (BasicBlock *BB : NewPhiBlocks) {
+    MemoryPhi *Phi = new MemoryPhi(BB, NextID++);
+    ValueToMemoryAccess[BB] = Phi;
+    getOrCreateAccessList(BB)->push_front(Phi);
+    invalidateOrdering(BB);
+    for (BasicBlock *Pred : predecessors(BB))
+      Phi->addIncoming(LiveOnEntryDef.get(), Pred);
+  }
+}
+
+/// Insert \p NewAccess before \p InsertPt in the list of its block, and give
+/// it, and the accesses that a new def now defines, their versions of memory.
+void MemorySSA::insertIntoListsAndUpdate(MemoryUseOrDef *NewAccess,
+                                         AccessListType::iterator InsertPt) {
+  BasicBlock *BB = NewAccess->getBlock();
+  getOrCreateAccessList(BB)->insert(InsertPt, NewAccess);
+  invalidateOrdering(BB);
+  Walker->invalidateInfo(NewAccess);
+
+  if (!DT->isReachableFromEntry(BB)) {
+    NewAccess->setDefiningAccess(LiveOnEntryDef.get());
+    return;
+  }
+  if (isa<MemoryUse>(NewAccess)) {
+    MemoryAccess *Current = getVersionAtEntry(BB);
+    for (MemoryAccess &MA : *getOrCreateAccessList(BB)) {
+      if (&MA == NewAccess)
+        break;
+      if (!isa<MemoryUse>(MA))
+        Current = &MA;
+    }
+    NewAccess->setDefiningAccess(Current);
+    return;
+  }
+
+  // A def changes the version of memory in the blocks it dominates, and in
+  // those that the new phis dominate.  Give their accesses their versions
+  // again, then the phis that these blocks flow into their incoming values.
+  SmallVector<BasicBlock *, 8> NewPhiBlocks;
+  placeMissingPhis(NewPhiBlocks);
+  SmallPtrSet<BasicBlock *, 8> Roots(NewPhiBlocks.begin(), NewPhiBlocks.end());
+  Roots.insert(BB);
+  SmallPtrSet<BasicBlock *, 32> Region;
+  SmallPtrSet<MemoryPhi *, 16> PhisToUpdate;
+  for (BasicBlock *PhiBB : NewPhiBlocks)
+    PhisToUpdate.insert(getMemoryAccess(PhiBB));
+  for (DomTreeNode *Node : depth_first(DT->getRootNode())) {
+    BasicBlock *RegionBB = Node->getBlock();
+    DomTreeNode *IDom = Node->getIDom();
+    if (!Roots.count(RegionBB) &&
+        !(IDom && Region.count(IDom->getBlock())))
+      continue;
+    Region.insert(RegionBB);
+
+    if (const AccessListType *Accesses = getBlockAccesses(RegionBB)) {
+      MemoryAccess *Current = getVersionAtEntry(RegionBB);
+      for (const MemoryAccess &CMA : *Accesses) {
+        MemoryAccess *MA = const_cast<MemoryAccess *>(&CMA);
+        if (auto *MUD = dyn_cast<MemoryUseOrDef>(MA)) {
+          MUD->setDefiningAccess(Current);
+          if (isa<MemoryDef>(MUD))
+            Current = MUD;
+        } else {
+          Current = MA;
+        }
+      }
+    }
+    for (BasicBlock *Succ : successors(RegionBB))
+      if (MemoryPhi *Phi = getMemoryAccess(Succ))
+        PhisToUpdate.insert(Phi);
+  }
+  for (MemoryPhi *Phi : PhisToUpdate)
+    for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+      Phi->setIncomingValue(I, getVersionAtEnd(Phi->getIncomingBlock(I)));
+}
+
+MemoryUseOrDef *MemorySSA::createMemoryAccessInBB(Instruction *I,
+                                                  BasicBlock *BB,
+                                                  InsertionPlace Point) {
+  MemoryUseOrDef *NewAccess = createNewAccess(I, BB);
+  if (!NewAccess)
+    return nullptr;
+
+  AccessListType *Accesses = getOrCreateAccessList(BB);
+  AccessListType::iterator InsertPt = Accesses->end();
+  if (Point == Beginning) {
+    // The phi stays the first access of the block.
+    InsertPt = Accesses->begin();
+    while (InsertPt != Accesses->end() && isa<MemoryPhi>(*InsertPt))
+      ++InsertPt;
+  }
+  insertIntoListsAndUpdate(NewAccess, InsertPt);
+  return NewAccess;
+}
+
+MemoryUseOrDef *MemorySSA::createMemoryAccessBefore(Instruction *I,
+                                                    MemoryUseOrDef *InsertPt) {
+  MemoryUseOrDef *NewAccess = createNewAccess(I, InsertPt->getBlock());
+  if (!NewAccess)
+    return nullptr;
+  insertIntoListsAndUpdate(NewAccess, AccessListType::iterator(InsertPt));
+  return NewAccess;
+}
+
+MemoryUseOrDef *MemorySSA::createMemoryAccessAfter(Instruction *I,
+                                                   MemoryAccess *InsertPt) {
+  MemoryUseOrDef *NewAccess = createNewAccess(I, InsertPt->getBlock());
+  if (!NewAccess)
+    return nullptr;
+  insertIntoListsAndUpdate(NewAccess,
+                           std::next(AccessListType::iterator(InsertPt)));
+  return NewAccess;
+}
+
+void MemorySSA::removeMemoryAccess(MemoryAccess *MA) {
+  assert(!isLiveOnEntryDef(MA) && "Trying to remove the live on entry def");
+
+  // The version of memory that the users of MA get instead.  For a phi, this
+  // is its incoming value, if it has only one besides itself.
+  MemoryAccess *NewDefTarget = nullptr;
+  auto *Phi = dyn_cast<MemoryPhi>(MA);
+  if (Phi) {
+    for (const auto &Op : Phi->Operands) {
+      if (Op.second == Phi || Op.second == NewDefTarget)
+        continue;
+      if (NewDefTarget) {
+        NewDefTarget = nullptr;
+        break;
+      }
+      NewDefTarget = Op.second;
+    }
+  } else {
+    NewDefTarget = cast<MemoryUseOrDef>(MA)->getDefiningAccess();
+  }
+
+  Walker->invalidateInfo(MA);
+
+  SmallVector<MemoryAccess *, 8> Users(MA->Users.begin(), MA->Users.end());
+  for (MemoryAccess *User : Users) {
+    if (User == MA)
+      continue;
+    assert(NewDefTarget &&
+           "Removing a phi with users and different incoming values");
+    if (auto *MUD = dyn_cast<MemoryUseOrDef>(User)) {
+      MUD->setDefiningAccess(NewDefTarget);
+      continue;
+    }
+    auto *UserPhi = cast<MemoryPhi>(User);
+    for (unsigned I = 0, E = UserPhi->getNumIncomingValues(); I != E; ++I)
+      if (UserPhi->getIncomingValue(I) == MA)
+        UserPhi->setIncomingValue(I, NewDefTarget);
+  }
+
+  // Drop the operands of MA, then MA itself.
+  if (Phi) {
+    for (const auto &Op : Phi->Operands)
+      Op.second->removeUser(Phi);
+    ValueToMemoryAccess.erase(Phi->getBlock());
+  } else {
+    auto *MUD = cast<MemoryUseOrDef>(MA);
+    MUD->setDefiningAccess(nullptr);
+    ValueToMemoryAccess.erase(MUD->getMemoryInst());
+  }
+
+  BasicBlock *BB = MA->getBlock();
+  invalidateOrdering(BB);
+  BlockOrder.erase(MA);
+  auto It = PerBlockAccesses.find(BB);
+  It->second->erase(MA);
+  if (It->second->empty())
+    PerBlockAccesses.erase(It);
+}
+
+/// Abort with \p Msg about the access \p MA.
+static void reportBrokenMemorySSA(const MemoryAccess *MA, const char *Msg) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  OS << "Broken memory SSA: " << Msg;
+  if (MA)
+    OS << ": " << *MA;
+  report_fatal_error(OS.str());
+}
+
+void MemorySSA::verifyMemorySSA() const {
+  for (BasicBlock &BB : F) {
+    const AccessListType *Accesses = getBlockAccesses(&BB);
+    if (Accesses && Accesses->empty())
+      reportBrokenMemorySSA(nullptr, "empty list of accesses");
+
+    // The accesses of the block are its phi, then the accesses of its
+    // instructions in order.
+    AccessListType::const_iterator It, End;
+    if (Accesses) {
+      It = Accesses->begin();
+      End = Accesses->end();
+    }
+    if (MemoryPhi *Phi = getMemoryAccess(&BB)) {
+      if (!Accesses || &*It != Phi)
+        reportBrokenMemorySSA(Phi, "phi is not the first access of its block");
+      ++It;
+    }
+    for (Instruction &I : BB) {
+      MemoryUseOrDef *MUD = getMemoryAccess(&I);
+      if (!MUD)
+        continue;
+      if (!Accesses || It == End || &*It != MUD)
+        reportBrokenMemorySSA(MUD, "access out of the order of instructions");
+      if (MUD->getBlock() != &BB)
+        reportBrokenMemorySSA(MUD, "access in the wrong block");
+      ++It;
+    }
+    if (Accesses && It != End)
+      reportBrokenMemorySSA(&*It, "access of no instruction of its block");
+    if (!Accesses)
+      continue;
+
+    bool Reachable = DT->isReachableFromEntry(&BB);
+    for (const MemoryAccess &MA : *Accesses) {
+      // Each access knows its users, and is a user of its operands.
+      for (MemoryAccess *User : MA.users()) {
+        bool Uses;
+        if (auto *MUD = dyn_cast<MemoryUseOrDef>(User))
+          Uses = MUD->getDefiningAccess() == &MA;
+        else
+          Uses = cast<MemoryPhi>(User)->hasIncomingValue(&MA);
+        if (!Uses)
+          reportBrokenMemorySSA(&MA, "user that does not use its access");
+      }
+
+      if (auto *MUD = dyn_cast<MemoryUseOrDef>(&MA)) {
+        MemoryAccess *Def = MUD->getDefiningAccess();
+        if (!Def || !Def->Users.count(const_cast<MemoryAccess *>(&MA)))
+          reportBrokenMemorySSA(&MA, "defining access does not know its user");
+        if (isa<MemoryUse>(Def))
+          reportBrokenMemorySSA(&MA, "defined by a use");
+        if (Reachable && (Def == &MA || !dominates(Def, &MA)))
+          reportBrokenMemorySSA(&MA, "not dominated by its defining access");
+        continue;
+      }
+
+      // A phi has one incoming value for each edge into its block, and each
+      // value dominates the end of its block.
+      auto *Phi = cast<MemoryPhi>(const_cast<MemoryAccess *>(&MA));
+      SmallVector<BasicBlock *, 8> Preds(pred_begin(&BB), pred_end(&BB));
+      if (Phi->getNumIncomingValues() != Preds.size())
+        reportBrokenMemorySSA(Phi, "wrong number of incoming values");
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+        BasicBlock *Pred = Phi->getIncomingBlock(I);
+        MemoryAccess *V = Phi->getIncomingValue(I);
+        auto PredIt = std::find(Preds.begin(), Preds.end(), Pred);
+        if (PredIt == Preds.end())
+          reportBrokenMemorySSA(Phi, "incoming block is not a predecessor");
+        Preds.erase(PredIt);
+        if (!V->Users.count(Phi))
+          reportBrokenMemorySSA(Phi, "incoming value does not know its user");
+        if (isa<MemoryUse>(V))
+          reportBrokenMemorySSA(Phi, "incoming value is a use");
+        if (!isLiveOnEntryDef(V) && V->getBlock() != Pred &&
+            DT->isReachableFromEntry(Pred) &&
+            !DT->dominates(V->getBlock(), Pred))
+          reportBrokenMemorySSA(Phi, "incoming value does not dominate its "
+                                     "block");
+      }
+    }
+  }
+
+  for (const auto &Entry : ValueToMemoryAccess) {
+    const MemoryAccess *MA = Entry.second;
+    const AccessListType *Accesses = getBlockAccesses(MA->getBlock());
+    if (!Accesses || std::find_if(Accesses->begin(), Accesses->end(),
+                                  [MA](const MemoryAccess &Other) {
+                      return &Other == MA;
+                    }) == Accesses->end())
+      reportBrokenMemorySSA(MA, "access missing from its block");
+  }
+}
+
+namespace {
+/// Print the accesses of a function, and their clobbers if asked to, as
+/// comments above its instructions.
+class MemorySSAAnnotatedWriter : public AssemblyAnnotationWriter {
+  MemorySSA *MSSA;
+
+  void printClobber(const Instruction *I, formatted_raw_ostream &OS) {
+    if (!PrintClobbers)
+      return;
+    OS << "; Clobber: ";
+    MSSA->getWalker()->getClobberingMemoryAccess(I)->printAsOperand(OS);
+    OS << "\n";
+  }
+
+public:
+  MemorySSAAnnotatedWriter(MemorySSA *MSSA) : MSSA(MSSA) {}
+
+  void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                formatted_raw_ostream &OS) override {
+    if (MemoryPhi *Phi = MSSA->getMemoryAccess(BB))
+      OS << "; " << *Phi << "\n";
+  }
+
+  void emitInstructionAnnot(const Instruction *I,
+                            formatted_raw_ostream &OS) override {
+    if (MemoryUseOrDef *MUD = MSSA->getMemoryAccess(I)) {
+      OS << "; " << *MUD << "\n";
+      printClobber(I, OS);
+    }
+  }
+};
+}
+
+void MemorySSA::print(raw_ostream &OS) const {
+  MemorySSAAnnotatedWriter Writer(const_cast<MemorySSA *>(this));
+  F.print(OS, &Writer);
+}
+
+void MemorySSA::dump() const { print(dbgs()); }
+
+//===----------------------------------------------------------------------===//
+// Walkers
+//===----------------------------------------------------------------------===//
+
+MemorySSAWalker::~MemorySSAWalker() {}
+
+/// A lookup of the clobber of a location, or of the memory a call touches.
+struct CachingMemorySSAWalker::Query {
+  /// The location, when the query is not for a call.
+  AliasAnalysis::Location Loc;
+  /// The call, or null.
+  const Instruction *Call;
+  /// The phis that the walk is going up the incoming values of, with their
+  /// depth in the walk.
+  DenseMap<const MemoryPhi *, unsigned> WalkingPhis;
+  /// The number of defs and phis looked at so far.
+  unsigned Checks;
+
+  Query() : Call(nullptr), Checks(0) {}
+};
+
+/// The depth of the phis that an answer of the walk assumes nothing about.
+static const unsigned NoAssumption = ~0U;
+
+/// Return true if \p I is ordered with respect to other memory accesses, and
+/// so must not be moved across the access right above it.
+static bool isOrderedAccess(const Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return !LI->isUnordered();
+  if (auto *SI = dyn_cast<StoreInst>(I))
+    return !SI->isUnordered();
+  return isa<FenceInst>(I) || isa<AtomicCmpXchgInst>(I) ||
+         isa<AtomicRMWInst>(I);
+}
+
+bool CachingMemorySSAWalker::clobbers(MemoryDef *MD, const Query &Q) const {
+  ++NumClobberChecks;
+  Instruction *DefInst = MD->getMemoryInst();
+  if (Q.Call) {
+    // There is no location to ask about for a fence.
+    if (isa<FenceInst>(DefInst))
+      return true;
+    return AA->getModRefInfo(DefInst, ImmutableCallSite(Q.Call)) !=
+           AliasAnalysis::NoModRef;
+  }
+  return AA->getModRefInfo(DefInst, Q.Loc) & AliasAnalysis::Mod;
+}
+
+MemoryAccess *CachingMemorySSAWalker::lookupClobber(const MemoryAccess *MA,
+                                                    const Query &Q) const {
+  MemoryAccess *Clobber;
+  if (Q.Call)
+    Clobber = CallClobbers.lookup(std::make_pair(MA, Q.Call));
+  else
+    Clobber = LocClobbers.lookup(std::make_pair(MA, Q.Loc));
+  if (Clobber)
+    ++NumClobberCacheHits;
+  return Clobber;
+}
+
+void CachingMemorySSAWalker::cacheClobber(const MemoryAccess *MA,
+                                          const Query &Q,
+                                          MemoryAccess *Clobber) {
+  if (Q.Call)
+    CallClobbers[std::make_pair(MA, Q.Call)] = Clobber;
+  else
+    LocClobbers[std::make_pair(MA, Q.Loc)] = Clobber;
+}
+
+/// Return the clobber of the query at or above the def or phi \p MA.  The
+/// defs walked past on the way up are given the same clobber in the cache.
+///
+/// The answer may assume that a phi being walked ends up with the same
+/// clobber as its other incoming values.  \p Assumes is set to the depth of
+/// the outermost such phi, or to NoAssumption.  Only answers that assume
+/// nothing are cached.
+MemoryAccess *CachingMemorySSAWalker::walkToClobber(MemoryAccess *MA,
+                                                    Query &Q,
+                                                    unsigned &Assumes) {
+  SmallVector<MemoryAccess *, 16> WalkedPast;
+  MemoryAccess *Clobber;
+  Assumes = NoAssumption;
+  while (true) {
+    if (MSSA->isLiveOnEntryDef(MA)) {
+      Clobber = MA;
+      break;
+    }
+    if ((Clobber = lookupClobber(MA, Q)))
+      break;
+    // Past the limit, MA stands in for the clobber.  That is conservative,
+    // since MA may write memory.
+    if (++Q.Checks > MaxCheckLimit) {
+      Clobber = MA;
+      break;
+    }
+    if (auto *Phi = dyn_cast<MemoryPhi>(MA)) {
+      Clobber = walkPhi(Phi, Q, Assumes);
+      break;
+    }
+    auto *MD = cast<MemoryDef>(MA);
+    if (clobbers(MD, Q)) {
+      Clobber = MD;
+      break;
+    }
+    WalkedPast.push_back(MD);
+    MA = MD->getDefiningAccess();
+  }
+
+  if (Assumes == NoAssumption)
+    for (MemoryAccess *Def : WalkedPast)
+      cacheClobber(Def, Q, Clobber);
+  return Clobber;
+}
+
+/// Return the clobber of the query at or above \p Phi.
+MemoryAccess *CachingMemorySSAWalker::walkPhi(MemoryPhi *Phi, Query &Q,
+                                              unsigned &Assumes) {
+  // Coming back to a phi that is being walked means that the walk went around
+  // a loop without meeting a clobber.  Its answer is left to that phi.
+  unsigned Depth = Q.WalkingPhis.size();
+  auto Inserted = Q.WalkingPhis.insert(std::make_pair(Phi, Depth));
+  if (!Inserted.second) {
+    Assumes = Inserted.first->second;
+    return Phi;
+  }
+
+  // The incoming values that come back to a phi being walked are assumed to
+  // agree with the others.  If they all agree, memory along every path from
+  // the function entry has the same clobber.  The assumptions about this phi
+  // then hold, but those about the phis around it are only checked when the
+  // walk gets back to them.
+  MemoryAccess *Clobber = nullptr;
+  MemoryPhi *OutermostPhi = Phi;
+  unsigned OutermostDepth = Depth;
+  unsigned MinAssumes = NoAssumption;
+  bool Disagree = false;
+  for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+    unsigned IncomingAssumes;
+    MemoryAccess *IncomingClobber =
+        walkToClobber(Phi->getIncomingValue(I), Q, IncomingAssumes);
+    MinAssumes = std::min(MinAssumes, IncomingAssumes);
+    if (auto *ClobberPhi = dyn_cast<MemoryPhi>(IncomingClobber)) {
+      auto It = Q.WalkingPhis.find(ClobberPhi);
+      if (It != Q.WalkingPhis.end()) {
+        MinAssumes = std::min(MinAssumes, It->second);
+        if (It->second < OutermostDepth) {
+          OutermostPhi = ClobberPhi;
+          OutermostDepth = It->second;
+        }
+        continue;
+      }
+    }
+    if (!Clobber) {
+      Clobber = IncomingClobber;
+    } else if (IncomingClobber != Clobber) {
+      Disagree = true;
+      break;
+    }
+  }
+  Q.WalkingPhis.erase(Phi);
+
+  if (Disagree) {
+    // The phi is the clobber, whatever the phis around it turn out to be.
+    Clobber = Phi;
+    Assumes = NoAssumption;
+  } else if (!Clobber) {
+    // All the incoming values came back to phis being walked, so this phi
+    // agrees with the outermost of them.
+    Clobber = OutermostPhi;
+    Assumes = OutermostPhi == Phi ? NoAssumption : MinAssumes;
+  } else {
+    Assumes = MinAssumes >= Depth ? NoAssumption : MinAssumes;
+  }
+  if (Assumes == NoAssumption)
+    cacheClobber(Phi, Q, Clobber);
+  return Clobber;
+}
+
+MemoryAccess *
+CachingMemorySSAWalker::getClobberingMemoryAccess(const Instruction *I) {
+  MemoryUseOrDef *StartingAccess = MSSA->getMemoryAccess(I);
+  assert(StartingAccess && "Instruction does not touch memory");
+
+  auto It = InstClobbers.find(StartingAccess);
+  if (It != InstClobbers.end()) {
+    ++NumClobberCacheHits;
+    return It->second;
+  }
+
+  MemoryAccess *Clobber;
+  Query Q;
+  if (isOrderedAccess(I)) {
+    Clobber = StartingAccess->getDefiningAccess();
+  } else {
+    if (ImmutableCallSite(I))
+      Q.Call = I;
+    else
+      Q.Loc = AA->getLocation(I);
+    unsigned Assumes;
+    Clobber = walkToClobber(StartingAccess->getDefiningAccess(), Q, Assumes);
+    assert(Assumes == NoAssumption && "Walk left phis unresolved");
+  }
+  InstClobbers[StartingAccess] = Clobber;
+  return Clobber;
+}
+
+MemoryAccess *CachingMemorySSAWalker::getClobberingMemoryAccess(
+    MemoryAccess *StartingAccess, const AliasAnalysis::Location &Loc) {
+  if (auto *MU = dyn_cast<MemoryUse>(StartingAccess))
+    StartingAccess = MU->getDefiningAccess();
+  Query Q;
+  Q.Loc = Loc;
+  unsigned Assumes;
+  return walkToClobber(StartingAccess, Q, Assumes);
+}
+
+void CachingMemorySSAWalker::invalidateInfo(MemoryAccess *MA) {
+  // Nothing walks past a use, so only its own clobber is cached.  A def or
+  // phi may be the clobber, or on the way to the clobber, of any access
+  // below it.
+  if (isa<MemoryUse>(MA)) {
+    InstClobbers.erase(MA);
+    return;
+  }
+  InstClobbers.clear();
+  LocClobbers.clear();
+  CallClobbers.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWrapperPass
+//===----------------------------------------------------------------------===//
+
+char MemorySSAWrapperPass::ID = 0;
+
+MemorySSAWrapperPass::MemorySSAWrapperPass() : FunctionPass(ID) {
+  initializeMemorySSAWrapperPassPass(*PassRegistry::getPassRegistry());
+}
+
+void MemorySSAWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<DominatorTreeWrapperPass>();
+  AU.addRequiredTransitive<AliasAnalysis>();
+}
+
+bool MemorySSAWrapperPass::runOnFunction(Function &F) {
+  auto &AA = getAnalysis<AliasAnalysis>();
+  auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  MSSA.reset(new MemorySSA(F, &AA, &DT));
+  if (VerifyMemorySSA)
+    MSSA->verifyMemorySSA();
+  return false;
+}
+
+void MemorySSAWrapperPass::releaseMemory() { MSSA.reset(); }
+
+void MemorySSAWrapperPass::verifyAnalysis() const {
+  if (VerifyMemorySSA)
+    MSSA->verifyMemorySSA();
+}
+
+void MemorySSAWrapperPass::print(raw_ostream &OS, const Module *M) const {
+  MSSA->print(OS);
+}
@@ -34,6 +34,8 @@ namespace {
 
     void getAnalysisUsage(AnalysisUsage &AU) const override {}
 
+    bool isThreadSafe() const override { return true; }
+
     bool doInitialization(Module &M) override {
       // Note: NoAA does not call InitializeAliasAnalysis because it's
       // special and does not support chaining.
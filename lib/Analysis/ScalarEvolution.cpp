@@ -320,7 +320,7 @@ const SCEV *ScalarEvolution::getConstant(ConstantInt *V) {
   void *IP = nullptr;
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
   SCEV *S = new (SCEVAllocator) SCEVConstant(ID.Intern(SCEVAllocator), V);
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -1161,7 +1161,7 @@ const SCEV *ScalarEvolution::getTruncateExpr(const SCEV *Op,
   // made any changes which would invalidate it.
   SCEV *S = new (SCEVAllocator) SCEVTruncateExpr(ID.Intern(SCEVAllocator),
                                                  Op, Ty);
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -1583,7 +1583,7 @@ const SCEV *ScalarEvolution::getZeroExtendExpr(const SCEV *Op,
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
   SCEV *S = new (SCEVAllocator) SCEVZeroExtendExpr(ID.Intern(SCEVAllocator),
                                                    Op, Ty);
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -1781,7 +1781,7 @@ const SCEV *ScalarEvolution::getSignExtendExpr(const SCEV *Op,
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
   SCEV *S = new (SCEVAllocator) SCEVSignExtendExpr(ID.Intern(SCEVAllocator),
                                                    Op, Ty);
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -2317,7 +2317,7 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
     std::uninitialized_copy(Ops.begin(), Ops.end(), O);
     S = new (SCEVAllocator) SCEVAddExpr(ID.Intern(SCEVAllocator),
                                         O, Ops.size());
-    UniqueSCEVs.InsertNode(S, IP);
+    insertSCEV(S, IP);
   }
   S->setNoWrapFlags(Flags);
   return S;
@@ -2613,7 +2613,7 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
     std::uninitialized_copy(Ops.begin(), Ops.end(), O);
     S = new (SCEVAllocator) SCEVMulExpr(ID.Intern(SCEVAllocator),
                                         O, Ops.size());
-    UniqueSCEVs.InsertNode(S, IP);
+    insertSCEV(S, IP);
   }
   S->setNoWrapFlags(Flags);
   return S;
@@ -2734,7 +2734,7 @@ const SCEV *ScalarEvolution::getUDivExpr(const SCEV *LHS,
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
   SCEV *S = new (SCEVAllocator) SCEVUDivExpr(ID.Intern(SCEVAllocator),
                                              LHS, RHS);
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -2920,7 +2920,7 @@ ScalarEvolution::getAddRecExpr(SmallVectorImpl<const SCEV *> &Operands,
     std::uninitialized_copy(Operands.begin(), Operands.end(), O);
     S = new (SCEVAllocator) SCEVAddRecExpr(ID.Intern(SCEVAllocator),
                                            O, Operands.size(), L);
-    UniqueSCEVs.InsertNode(S, IP);
+    insertSCEV(S, IP);
   }
   S->setNoWrapFlags(Flags);
   return S;
@@ -3026,7 +3026,7 @@ ScalarEvolution::getSMaxExpr(SmallVectorImpl<const SCEV *> &Ops) {
   std::uninitialized_copy(Ops.begin(), Ops.end(), O);
   SCEV *S = new (SCEVAllocator) SCEVSMaxExpr(ID.Intern(SCEVAllocator),
                                              O, Ops.size());
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -3130,7 +3130,7 @@ ScalarEvolution::getUMaxExpr(SmallVectorImpl<const SCEV *> &Ops) {
   std::uninitialized_copy(Ops.begin(), Ops.end(), O);
   SCEV *S = new (SCEVAllocator) SCEVUMaxExpr(ID.Intern(SCEVAllocator),
                                              O, Ops.size());
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -3184,7 +3184,7 @@ const SCEV *ScalarEvolution::getUnknown(Value *V) {
   SCEV *S = new (SCEVAllocator) SCEVUnknown(ID.Intern(SCEVAllocator), V, this,
                                             FirstUnknown);
   FirstUnknown = cast<SCEVUnknown>(S);
-  UniqueSCEVs.InsertNode(S, IP);
+  insertSCEV(S, IP);
   return S;
 }
 
@@ -4656,47 +4656,76 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // recusive call to getBackedgeTakenInfo (on a different
   // loop), which would invalidate the iterator computed
   // earlier.
-  return BackedgeTakenCounts.find(L)->second = Result;
+  BackedgeTakenInfo &BTI = BackedgeTakenCounts.find(L)->second = Result;
+  addBECountUsers(L, BTI);
+  return BTI;
+}
+
+void ScalarEvolution::addBECountUsers(const Loop *L,
+                                      const BackedgeTakenInfo &BTI) {
+  SmallVector<const SCEV *, 16> Exprs;
+  BTI.getSubexprs(Exprs, this);
+  for (const SCEV *S : Exprs)
+    BECountUsers[S].insert(L);
+}
+
+void ScalarEvolution::eraseBackedgeTakenInfo(
+    DenseMap<const Loop *, BackedgeTakenInfo>::iterator I) {
+  SmallVector<const SCEV *, 16> Exprs;
+  I->second.getSubexprs(Exprs, this);
+  for (const SCEV *S : Exprs) {
+    auto Users = BECountUsers.find(S);
+    assert(Users != BECountUsers.end() && "Expression of a count not used!");
+    Users->second.erase(I->first);
+    if (Users->second.empty())
+      BECountUsers.erase(Users);
+  }
+  I->second.clear();
+  BackedgeTakenCounts.erase(I);
 }
 
 /// forgetLoop - This method should be called by the client when it has
 /// changed a loop in a way that may effect ScalarEvolution's ability to
 /// compute a trip count, or if the loop is deleted.
 void ScalarEvolution::forgetLoop(const Loop *L) {
-  // Drop any stored trip count value.
-  DenseMap<const Loop*, BackedgeTakenInfo>::iterator BTCPos =
-    BackedgeTakenCounts.find(L);
-  if (BTCPos != BackedgeTakenCounts.end()) {
-    BTCPos->second.clear();
-    BackedgeTakenCounts.erase(BTCPos);
-  }
-
-  // Drop information about expressions based on loop-header PHIs.
+  // Forget the loop and all the loops it contains, to avoid dangling entries
+  // in the ValuesAtScopes map. The phis of the inner loops are usually
+  // reached from those of the outer ones, so walk each instruction once for
+  // the whole nest.
+  SmallVector<const Loop *, 16> LoopWorklist(1, L);
   SmallVector<Instruction *, 16> Worklist;
-  PushLoopPHIs(L, Worklist);
-
   SmallPtrSet<Instruction *, 8> Visited;
-  while (!Worklist.empty()) {
-    Instruction *I = Worklist.pop_back_val();
-    if (!Visited.insert(I).second)
-      continue;
+  while (!LoopWorklist.empty()) {
+    L = LoopWorklist.pop_back_val();
 
-    ValueExprMapType::iterator It =
-      ValueExprMap.find_as(static_cast<Value *>(I));
-    if (It != ValueExprMap.end()) {
-      forgetMemoizedResults(It->second);
-      ValueExprMap.erase(It);
-      if (PHINode *PN = dyn_cast<PHINode>(I))
-        ConstantEvolutionLoopExitValue.erase(PN);
+    // Drop any stored trip count value.
+    DenseMap<const Loop*, BackedgeTakenInfo>::iterator BTCPos =
+      BackedgeTakenCounts.find(L);
+    if (BTCPos != BackedgeTakenCounts.end())
+      eraseBackedgeTakenInfo(BTCPos);
+
+    // Drop information about expressions based on loop-header PHIs.
+    PushLoopPHIs(L, Worklist);
+
+    while (!Worklist.empty()) {
+      Instruction *I = Worklist.pop_back_val();
+      if (!Visited.insert(I).second)
+        continue;
+
+      ValueExprMapType::iterator It =
+        ValueExprMap.find_as(static_cast<Value *>(I));
+      if (It != ValueExprMap.end()) {
+        forgetMemoizedResults(It->second);
+        ValueExprMap.erase(It);
+        if (PHINode *PN = dyn_cast<PHINode>(I))
+          ConstantEvolutionLoopExitValue.erase(PN);
+      }
+
+      PushDefUseChildren(I, Worklist);
     }
 
-    PushDefUseChildren(I, Worklist);
+    LoopWorklist.append(L->begin(), L->end());
   }
-
-  // Forget all contained loops too, to avoid dangling entries in the
-  // ValuesAtScopes map.
-  for (Loop::iterator I = L->begin(), E = L->end(); I != E; ++I)
-    forgetLoop(*I);
 }
 
 /// forgetValue - This method should be called by the client when it has
@@ -4780,23 +4809,38 @@ ScalarEvolution::BackedgeTakenInfo::getMax(ScalarEvolution *SE) const {
   return Max ? Max : SE->getCouldNotCompute();
 }
 
-bool ScalarEvolution::BackedgeTakenInfo::hasOperand(const SCEV *S,
-                                                    ScalarEvolution *SE) const {
-  if (Max && Max != SE->getCouldNotCompute() && SE->hasOperand(Max, S))
+namespace {
+// Collect the nodes of an expression tree, each once.
+// Implements SCEVTraversal::Visitor.
+struct SCEVCollectSubexprs {
+  SmallVectorImpl<const SCEV *> &Exprs;
+
+  SCEVCollectSubexprs(SmallVectorImpl<const SCEV *> &Exprs) : Exprs(Exprs) {}
+
+  bool follow(const SCEV *S) {
+    Exprs.push_back(S);
     return true;
+  }
+  bool isDone() const { return false; }
+};
+}
+
+void ScalarEvolution::BackedgeTakenInfo::getSubexprs(
+    SmallVectorImpl<const SCEV *> &Exprs, ScalarEvolution *SE) const {
+  SCEVCollectSubexprs Collect(Exprs);
+  SCEVTraversal<SCEVCollectSubexprs> T(Collect);
+  if (Max && Max != SE->getCouldNotCompute())
+    T.visitAll(Max);
 
   if (!ExitNotTaken.ExitingBlock)
-    return false;
+    return;
 
   for (const ExitNotTakenInfo *ENT = &ExitNotTaken;
        ENT != nullptr; ENT = ENT->getNextExit()) {
 
-    if (ENT->ExactNotTaken != SE->getCouldNotCompute()
-        && SE->hasOperand(ENT->ExactNotTaken, S)) {
-      return true;
-    }
+    if (ENT->ExactNotTaken != SE->getCouldNotCompute())
+      T.visitAll(ENT->ExactNotTaken);
   }
-  return false;
 }
 
 /// Allocate memory for BackedgeTakenInfo and copy the not-taken count of each
@@ -8057,6 +8101,7 @@ bool ScalarEvolution::runOnFunction(Function &F) {
 }
 
 void ScalarEvolution::releaseMemory() {
+  if (getenv("SCEVSTAT")) { unsigned N = 0; for (auto I = UniqueSCEVs.begin(), E = UniqueSCEVs.end(); I != E; ++I) ++N; errs() << "TMPSTAT nodes " << N << " bytes " << SCEVAllocator.getTotalMemory() << " vem " << ValueExprMap.size() << " vas " << ValuesAtScopes.size() << " ur " << UnsignedRanges.size() << " sr " << SignedRanges.size() << " ld " << LoopDispositions.size() << " bd " << BlockDispositions.size() << " btc " << BackedgeTakenCounts.size() << "\n"; }
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
   for (SCEVUnknown *U = FirstUnknown; U; U = U->Next)
@@ -8077,6 +8122,7 @@ void ScalarEvolution::releaseMemory() {
   assert(!WalkingBEDominatingConds && "isLoopBackedgeGuardedByCond garbage!");
 
   BackedgeTakenCounts.clear();
+  BECountUsers.clear();
   ConstantEvolutionLoopExitValue.clear();
   ValuesAtScopes.clear();
   LoopDispositions.clear();
@@ -8419,16 +8465,14 @@ void ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
   UnsignedRanges.erase(S);
   SignedRanges.erase(S);
 
-  for (DenseMap<const Loop*, BackedgeTakenInfo>::iterator I =
-         BackedgeTakenCounts.begin(), E = BackedgeTakenCounts.end(); I != E; ) {
-    BackedgeTakenInfo &BEInfo = I->second;
-    if (BEInfo.hasOperand(S, this)) {
-      BEInfo.clear();
-      BackedgeTakenCounts.erase(I++);
-    }
-    else
-      ++I;
-  }
+  // Drop the backedge-taken counts that refer to S.
+  auto Users = BECountUsers.find(S);
+  if (Users == BECountUsers.end())
+    return;
+  SmallVector<const Loop *, 4> Loops(Users->second.begin(),
+                                     Users->second.end());
+  for (const Loop *L : Loops)
+    eraseBackedgeTakenInfo(BackedgeTakenCounts.find(L));
 }
 
 typedef DenseMap<const Loop *, std::string> VerifyMap;
@@ -82,6 +82,9 @@ public:
 
   bool doInitialization(Module &M) override;
 
+  /// Queries only read the scope metadata.
+  bool isThreadSafe() const override { return true; }
+
   /// getAdjustedAnalysisPointer - This method is used when a pass implements
   /// an analysis interface through multiple inheritance.  If needed, it
   /// should override this to adjust the this pointer as needed for the
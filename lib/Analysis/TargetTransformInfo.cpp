@@ -14,9 +14,12 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 
 using namespace llvm;
 
@@ -313,11 +316,25 @@ TargetTransformInfoWrapperPass::TargetTransformInfoWrapperPass(
       *PassRegistry::getPassRegistry());
 }
 
+/// Targets cache their subtargets without synchronization, the copies of the
+/// wrapper pass used by concurrent function passes create their TTI one at a
+/// time.
+static ManagedStatic<sys::Mutex> TTICreationLock;
+
 TargetTransformInfo &TargetTransformInfoWrapperPass::getTTI(Function &F) {
+  if (!F.getContext().isMultithreaded()) {
+    TTI = TIRA.run(F);
+    return *TTI;
+  }
+  sys::ScopedLock Lock(*TTICreationLock);
   TTI = TIRA.run(F);
   return *TTI;
 }
 
+Pass *TargetTransformInfoWrapperPass::clone() const {
+  return new TargetTransformInfoWrapperPass(TIRA);
+}
+
 ImmutablePass *
 llvm::createTargetTransformInfoWrapperPass(TargetIRAnalysis TIRA) {
   return new TargetTransformInfoWrapperPass(std::move(TIRA));
@@ -285,6 +285,9 @@ namespace {
 
     bool doInitialization(Module &M) override;
 
+    /// Queries only read the TBAA metadata.
+    bool isThreadSafe() const override { return true; }
+
     /// getAdjustedAnalysisPointer - This method is used when a pass implements
     /// an analysis interface through multiple inheritance.  If needed, it
     /// should override this to adjust the this pointer as needed for the
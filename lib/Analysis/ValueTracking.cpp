@@ -16,6 +16,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/KnownBitsCache.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/CallSite.h"
@@ -98,15 +99,25 @@ struct Query {
   AssumptionCache *AC;
   const Instruction *CxtI;
   const DominatorTree *DT;
+  // The cache of the results, if any.  Only set when the results do not
+  // depend on the context instruction.
+  KnownBitsCache *KBC;
 
   Query(AssumptionCache *AC = nullptr, const Instruction *CxtI = nullptr,
-        const DominatorTree *DT = nullptr)
-      : AC(AC), CxtI(CxtI), DT(DT) {}
+        const DominatorTree *DT = nullptr, KnownBitsCache *KBC = nullptr)
+      : AC(AC), CxtI(CxtI), DT(DT),
+        KBC(KBC && !isContextSensitive(AC) ? KBC : nullptr) {}
 
   Query(const Query &Q, const Value *NewExcl)
-      : ExclInvs(Q.ExclInvs), AC(Q.AC), CxtI(Q.CxtI), DT(Q.DT) {
+      : ExclInvs(Q.ExclInvs), AC(Q.AC), CxtI(Q.CxtI), DT(Q.DT), KBC(Q.KBC) {
     ExclInvs.insert(NewExcl);
   }
+
+  // The results depend on the context instruction when there are assumptions
+  // or dominating conditions to look at.
+  static bool isContextSensitive(AssumptionCache *AC) {
+    return EnableDomConditions || (AC && !AC->assumptions().empty());
+  }
 };
 } // end anonymous namespace
 
@@ -133,9 +144,9 @@ static void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
 void llvm::computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
                             const DataLayout &DL, unsigned Depth,
                             AssumptionCache *AC, const Instruction *CxtI,
-                            const DominatorTree *DT) {
+                            const DominatorTree *DT, KnownBitsCache *KBC) {
   ::computeKnownBits(V, KnownZero, KnownOne, DL, Depth,
-                     Query(AC, safeCxtI(V, CxtI), DT));
+                     Query(AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static void ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
@@ -145,9 +156,9 @@ static void ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
 void llvm::ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
                           const DataLayout &DL, unsigned Depth,
                           AssumptionCache *AC, const Instruction *CxtI,
-                          const DominatorTree *DT) {
+                          const DominatorTree *DT, KnownBitsCache *KBC) {
   ::ComputeSignBit(V, KnownZero, KnownOne, DL, Depth,
-                   Query(AC, safeCxtI(V, CxtI), DT));
+                   Query(AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static bool isKnownToBeAPowerOfTwo(Value *V, bool OrZero, unsigned Depth,
@@ -156,9 +167,10 @@ static bool isKnownToBeAPowerOfTwo(Value *V, bool OrZero, unsigned Depth,
 bool llvm::isKnownToBeAPowerOfTwo(Value *V, const DataLayout &DL, bool OrZero,
                                   unsigned Depth, AssumptionCache *AC,
                                   const Instruction *CxtI,
-                                  const DominatorTree *DT) {
+                                  const DominatorTree *DT,
+                                  KnownBitsCache *KBC) {
   return ::isKnownToBeAPowerOfTwo(V, OrZero, Depth,
-                                  Query(AC, safeCxtI(V, CxtI), DT), DL);
+                                  Query(AC, safeCxtI(V, CxtI), DT, KBC), DL);
 }
 
 static bool isKnownNonZero(Value *V, const DataLayout &DL, unsigned Depth,
@@ -166,8 +178,8 @@ static bool isKnownNonZero(Value *V, const DataLayout &DL, unsigned Depth,
 
 bool llvm::isKnownNonZero(Value *V, const DataLayout &DL, unsigned Depth,
                           AssumptionCache *AC, const Instruction *CxtI,
-                          const DominatorTree *DT) {
-  return ::isKnownNonZero(V, DL, Depth, Query(AC, safeCxtI(V, CxtI), DT));
+                          const DominatorTree *DT, KnownBitsCache *KBC) {
+  return ::isKnownNonZero(V, DL, Depth, Query(AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static bool MaskedValueIsZero(Value *V, const APInt &Mask, const DataLayout &DL,
@@ -175,9 +187,10 @@ static bool MaskedValueIsZero(Value *V, const APInt &Mask, const DataLayout &DL,
 
 bool llvm::MaskedValueIsZero(Value *V, const APInt &Mask, const DataLayout &DL,
                              unsigned Depth, AssumptionCache *AC,
-                             const Instruction *CxtI, const DominatorTree *DT) {
+                             const Instruction *CxtI, const DominatorTree *DT,
+                             KnownBitsCache *KBC) {
   return ::MaskedValueIsZero(V, Mask, DL, Depth,
-                             Query(AC, safeCxtI(V, CxtI), DT));
+                             Query(AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static unsigned ComputeNumSignBits(Value *V, const DataLayout &DL,
@@ -186,8 +199,10 @@ static unsigned ComputeNumSignBits(Value *V, const DataLayout &DL,
 unsigned llvm::ComputeNumSignBits(Value *V, const DataLayout &DL,
                                   unsigned Depth, AssumptionCache *AC,
                                   const Instruction *CxtI,
-                                  const DominatorTree *DT) {
-  return ::ComputeNumSignBits(V, DL, Depth, Query(AC, safeCxtI(V, CxtI), DT));
+                                  const DominatorTree *DT,
+                                  KnownBitsCache *KBC) {
+  return ::ComputeNumSignBits(V, DL, Depth,
+                              Query(AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static void computeKnownBitsAddSub(bool Add, Value *Op0, Value *Op1, bool NSW,
@@ -936,8 +951,9 @@ static void computeKnownBitsFromAssume(Value *V, APInt &KnownZero,
 /// where V is a vector, known zero, and known one values are the
 /// same width as the vector element, and the bit is set only if it is true
 /// for all of the elements in the vector.
-void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
-                      const DataLayout &DL, unsigned Depth, const Query &Q) {
+static void computeKnownBitsImpl(Value *V, APInt &KnownZero, APInt &KnownOne,
+                                 const DataLayout &DL, unsigned Depth,
+                                 const Query &Q) {
   assert(V && "No Value?");
   assert(Depth <= MaxDepth && "Limit Search Depth");
   unsigned BitWidth = KnownZero.getBitWidth();
@@ -1512,6 +1528,18 @@ void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
   assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?");
 }
 
+/// Look the known bits of a scalar instruction up in the cache of the query, if
+/// any, before computing them.
+void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
+                      const DataLayout &DL, unsigned Depth, const Query &Q) {
+  if (!Q.KBC || !isa<Instruction>(V) || V->getType()->isVectorTy())
+    return computeKnownBitsImpl(V, KnownZero, KnownOne, DL, Depth, Q);
+  if (Q.KBC->lookupKnownBits(V, Depth, KnownZero, KnownOne))
+    return;
+  computeKnownBitsImpl(V, KnownZero, KnownOne, DL, Depth, Q);
+  Q.KBC->cacheKnownBits(V, Depth, KnownZero, KnownOne);
+}
+
 /// Determine whether the sign bit is known to be zero or one.
 /// Convenience wrapper around computeKnownBits.
 void ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
@@ -1876,8 +1904,8 @@ bool MaskedValueIsZero(Value *V, const APInt &Mask, const DataLayout &DL,
 ///
 /// 'Op' must have a scalar integer type.
 ///
-unsigned ComputeNumSignBits(Value *V, const DataLayout &DL, unsigned Depth,
-                            const Query &Q) {
+static unsigned ComputeNumSignBitsImpl(Value *V, const DataLayout &DL,
+                                       unsigned Depth, const Query &Q) {
   unsigned TyBits = DL.getTypeSizeInBits(V->getType()->getScalarType());
   unsigned Tmp, Tmp2;
   unsigned FirstAnswer = 1;
@@ -2096,6 +2124,19 @@ unsigned ComputeNumSignBits(Value *V, const DataLayout &DL, unsigned Depth,
   return std::max(FirstAnswer, std::min(TyBits, Mask.countLeadingZeros()));
 }
 
+/// Look the number of sign bits of a scalar instruction up in the cache of the
+/// query, if any, before computing it.
+unsigned ComputeNumSignBits(Value *V, const DataLayout &DL, unsigned Depth,
+                            const Query &Q) {
+  if (!Q.KBC || !isa<Instruction>(V) || V->getType()->isVectorTy())
+    return ComputeNumSignBitsImpl(V, DL, Depth, Q);
+  if (unsigned NumSignBits = Q.KBC->lookupNumSignBits(V, Depth))
+    return NumSignBits;
+  unsigned NumSignBits = ComputeNumSignBitsImpl(V, DL, Depth, Q);
+  Q.KBC->cacheNumSignBits(V, Depth, NumSignBits);
+  return NumSignBits;
+}
+
 /// This function computes the integer multiple of Base that equals V.
 /// If successful, it returns true and returns the multiple in
 /// Multiple. If unsuccessful, it returns false. It looks
@@ -27,8 +27,13 @@
 #include "llvm/IR/ValueSymbolTable.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <tuple>
 using namespace llvm;
 
 static std::string getTypeString(Type *T) {
@@ -47,6 +52,64 @@ bool LLParser::Run() {
          ValidateEndOfModule();
 }
 
+/// UseOrderRecorder - Records where the serial parser makes the uses of shared
+/// values that one thread makes: the offset in the input of the top-level
+/// entity or function body being parsed, then the order within it.
+struct LLParser::UseOrderRecorder : public Value::SharedUseObserver {
+  const char *Base;
+  uint64_t Next;
+  DenseMap<const Use *, uint64_t> Keys;
+
+  explicit UseOrderRecorder(const char *Base) : Base(Base), Next(0) {}
+
+  void startEntity(const char *Ptr) { Next = uint64_t(Ptr - Base) << 32; }
+  void addedUse(Use &U) override { Keys[&U] = Next++; }
+  void removedUse(Use &U) override { Keys.erase(&U); }
+};
+
+/// RunInParallel - The top-level entities are parsed in order, as by Run,
+/// except that the function bodies are only skipped.  Once the types, global
+/// values and metadata of the module are all known, the bodies are parsed on
+/// a thread pool, each by a parser of its own that reads the module level
+/// state of this one.  Bodies need no forward references to global values,
+/// so nothing is left to resolve between them afterwards.
+bool LLParser::RunInParallel(unsigned NumThreads) {
+  // The use lists of shared values are not built in the order uselistorder
+  // directives are relative to, and block addresses refer to the blocks of
+  // other bodies.
+  if (Source.find("uselistorder") != StringRef::npos ||
+      Source.find("blockaddress") != StringRef::npos)
+    return true;
+
+  // The bodies are parsed concurrently, and some module level entities are
+  // parsed before bodies that come first in the input.  Record where each use
+  // of a shared value is made, to order the use lists as the serial parser
+  // does.
+  Context.enableMultithreading();
+  UseOrderRecorder Recorder(Source.begin());
+  UseOrder = &Recorder;
+  Value::setSharedUseObserver(&Recorder);
+
+  // Prime the lexer.
+  Lex.Lex();
+
+  DeferBodies = true;
+  bool Failed = ParseTopLevelEntities();
+  Value::setSharedUseObserver(nullptr);
+  UseOrder = nullptr;
+  if (!Failed && !ParseDeferredBodies(NumThreads, Recorder.Keys) &&
+      !ValidateEndOfModule())
+    return false;
+
+  // The input will be parsed again.  Give up the names of the struct types
+  // created here, so that the types created then get the same names.
+  for (auto &Entry : NamedTypes)
+    if (StructType *STy = dyn_cast_or_null<StructType>(Entry.second.first))
+      if (!STy->isLiteral())
+        STy->setName("");
+  return true;
+}
+
 /// ValidateEndOfModule - Do final validity and sanity checks at the end of the
 /// module.
 bool LLParser::ValidateEndOfModule() {
@@ -170,6 +233,8 @@ bool LLParser::ValidateEndOfModule() {
 
 bool LLParser::ParseTopLevelEntities() {
   while (1) {
+    if (UseOrder)
+      UseOrder->startEntity(Lex.getLoc().getPointer());
     switch (Lex.getKind()) {
     default:         return TokError("expected top-level entity");
     case lltok::Eof: return false;
@@ -366,9 +431,333 @@ bool LLParser::ParseDefine() {
   Lex.Lex();
 
   Function *F;
-  return ParseFunctionHeader(F, true) ||
-         ParseOptionalFunctionMetadata(*F) ||
-         ParseFunctionBody(*F);
+  if (ParseFunctionHeader(F, true) ||
+      ParseOptionalFunctionMetadata(*F))
+    return true;
+
+  int FunctionNumber = -1;
+  if (!F->hasName()) FunctionNumber = NumberedVals.size()-1;
+
+  if (DeferBodies)
+    return SkipFunctionBody(*F, FunctionNumber);
+  return ParseFunctionBody(*F, FunctionNumber);
+}
+
+/// SkipFunctionBody - Record the body of the function being defined for
+/// ParseDeferredBodies and skip to its end.  On the way, the names of the
+/// metadata attached to its instructions are registered and the names of the
+/// global values it refers to before they are defined are reserved, when the
+/// serial parser would add them.
+bool LLParser::SkipFunctionBody(Function &Fn, int FunctionNumber) {
+  if (Lex.getKind() != lltok::lbrace)
+    return TokError("expected '{' in function body");
+
+  DeferredBodies.emplace_back(&Fn, FunctionNumber, Lex.getLoc().getPointer());
+
+  auto ReserveName = [&](const std::string &Name) {
+    if (!M->getNamedValue(Name))
+      ReservedNames[Name] = new GlobalVariable(
+          *M, Type::getInt8Ty(Context), false, GlobalValue::ExternalLinkage,
+          nullptr, Name);
+  };
+
+  // A call looks its callee up after its arguments.
+  std::string Callee;
+  unsigned Parens = 0;
+
+  unsigned Depth = 0;
+  do {
+    switch (Lex.getKind()) {
+    case lltok::Eof:
+    case lltok::Error:
+      return TokError("expected '}' at end of function body");
+    case lltok::lbrace:
+      ++Depth;
+      break;
+    case lltok::rbrace:
+      --Depth;
+      break;
+    case lltok::lparen:
+      if (!Callee.empty())
+        ++Parens;
+      break;
+    case lltok::rparen:
+      if (!Callee.empty() && --Parens == 0) {
+        ReserveName(Callee);
+        Callee.clear();
+      }
+      break;
+    case lltok::GlobalVar: {
+      std::string Name = Lex.getStrVal();
+      if (Lex.Lex() == lltok::lparen && Callee.empty())
+        Callee = Name;
+      else
+        ReserveName(Name);
+      continue;
+    }
+    case lltok::MetadataVar: {
+      // Specialized nodes are the only other use of the syntax in a body.
+      std::string Name = Lex.getStrVal();
+      if (Lex.Lex() != lltok::lparen)
+        M->getMDKindID(Name);
+      continue;
+    }
+    default:
+      break;
+    }
+    Lex.Lex();
+  } while (Depth);
+
+  DeferredBodies.back().End = Lex.getLoc().getPointer();
+  return false;
+}
+
+/// releaseReservedName - Remove the placeholder that SkipFunctionBody made for
+/// Name, if any, right before the global value named so is created.  The
+/// value takes the place the placeholder had in the symbol table.
+void LLParser::releaseReservedName(const std::string &Name) {
+  if (ReservedNames.empty())
+    return;
+  auto I = ReservedNames.find(Name);
+  if (I == ReservedNames.end())
+    return;
+  I->second->setName("");
+  I->second->eraseFromParent();
+  ReservedNames.erase(I);
+}
+
+/// ParseDeferredBodies - Parse the function bodies skipped by
+/// SkipFunctionBody on NumThreads threads, and finish what their parsers left
+/// over in body order.  UseKeys has the positions of the uses made so far.
+bool LLParser::ParseDeferredBodies(unsigned NumThreads,
+                                   DenseMap<const Use *, uint64_t> &UseKeys) {
+  DeferBodies = false;
+
+  // The parsers of the bodies cannot resolve forward references to module
+  // level entities.  Whatever is still undefined here is never defined.
+  if (!ForwardRefVals.empty() || !ForwardRefValIDs.empty() ||
+      !ForwardRefMDNodes.empty() || !ForwardRefComdats.empty() ||
+      !ReservedNames.empty())
+    return true;
+  for (const auto &NT : NumberedTypes)
+    if (NT.second.second.isValid())
+      return true;
+  for (const auto &NT : NamedTypes)
+    if (NT.second.second.isValid())
+      return true;
+
+  // Resolve metadata cycles now rather than at the end of the module: bodies
+  // may only refer to resolved nodes, which they can track without changing
+  // them.
+  for (auto &N : NumberedMetadata) {
+    if (N.second && !N.second->isResolved())
+      N.second->resolveCycles();
+  }
+
+  NumThreads = std::max<size_t>(
+      1, std::min<size_t>(NumThreads, DeferredBodies.size()));
+
+  // Hand the bodies out one at a time, to balance the load.  Diagnostics of
+  // the parsers of the bodies are dropped: invalid input is parsed again.
+  std::atomic<unsigned> NextBody(0);
+  std::atomic<bool> AnyFailed(false);
+  std::vector<UseOrderRecorder> Recorders(NumThreads,
+                                          UseOrderRecorder(Source.begin()));
+  auto ParseBodies = [&](UseOrderRecorder &Recorder) {
+    SourceMgr SM;
+    SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Source, "", false),
+                          SMLoc());
+    SMDiagnostic Err;
+    Value::setSharedUseObserver(&Recorder);
+    for (unsigned B = NextBody++; B < DeferredBodies.size() && !AnyFailed;
+         B = NextBody++) {
+      DeferredBody &Body = DeferredBodies[B];
+      Recorder.startEntity(Body.Start);
+      LLParser P(*this, StringRef(Body.Start, Source.end() - Body.Start), SM,
+                 Err);
+      if (P.ParseDeferredBody(Body))
+        AnyFailed = true;
+    }
+    Value::setSharedUseObserver(nullptr);
+  };
+  if (NumThreads > 1) {
+    ThreadPool Pool(NumThreads);
+    for (UseOrderRecorder &Recorder : Recorders) {
+      UseOrderRecorder *R = &Recorder;
+      Pool.async([&ParseBodies, R] { ParseBodies(*R); });
+    }
+    Pool.wait();
+  } else {
+    ParseBodies(Recorders.front());
+  }
+  if (AnyFailed)
+    return true;
+
+  for (DeferredBody &Body : DeferredBodies) {
+    InstsWithTBAATag.append(Body.InstsWithTBAATag.begin(),
+                            Body.InstsWithTBAATag.end());
+    ForwardRefAttrGroups.insert(Body.ForwardRefAttrGroups.begin(),
+                                Body.ForwardRefAttrGroups.end());
+  }
+
+  for (UseOrderRecorder &Recorder : Recorders)
+    for (const auto &Key : Recorder.Keys)
+      UseKeys[Key.first] = Key.second;
+  RestoreUseListOrders(UseKeys);
+  return false;
+}
+
+/// ParseDeferredBody - Parse Body in this parser of its own.
+bool LLParser::ParseDeferredBody(DeferredBody &Body) {
+  assert(Main && "Not the parser of a deferred body");
+  // Prime the lexer.
+  Lex.Lex();
+
+  Body.Failed = ParseFunctionBody(*Body.F, Body.FunctionNumber) ||
+                Lex.getLoc().getPointer() != Body.End;
+  Body.InstsWithTBAATag.append(InstsWithTBAATag.begin(),
+                               InstsWithTBAATag.end());
+  Body.ForwardRefAttrGroups = std::move(ForwardRefAttrGroups);
+  return Body.Failed;
+}
+
+namespace {
+/// The position of a use in the order the serial parser makes the uses of a
+/// value: the key of the use or of the user a constant is created for, then
+/// the number of the constant within that user, then the operand number.
+typedef std::tuple<uint64_t, unsigned, unsigned> UsePosition;
+}
+
+/// numberConstants - Number the constants in the operand trees of U in the
+/// order the parser creates them: the operands of a constant before it, and
+/// the callee of a call before its arguments.
+static void numberConstants(const User *U,
+                            DenseMap<const Constant *, unsigned> &Numbers) {
+  SmallVector<const Use *, 8> Ops;
+  if (isa<CallInst>(U))
+    Ops.push_back(&U->getOperandUse(U->getNumOperands() - 1));
+  else if (isa<InvokeInst>(U))
+    Ops.push_back(&U->getOperandUse(U->getNumOperands() - 3));
+  for (const Use &Op : U->operands())
+    Ops.push_back(&Op);
+
+  for (const Use *Op : Ops) {
+    const Constant *C = dyn_cast_or_null<Constant>(Op->get());
+    if (!C || isa<GlobalValue>(C) || Numbers.count(C))
+      continue;
+    numberConstants(C, Numbers);
+    unsigned Number = Numbers.size();
+    Numbers[C] = Number;
+  }
+}
+
+/// RestoreUseListOrders - Sort the use lists of the shared values that the
+/// module uses as the serial parser leaves them, given the positions in
+/// UseKeys of the uses made while parsing it.  Uses made before are older
+/// than all of these and keep their order.
+///
+/// A constant makes its uses when it is created, by the first parser asking
+/// for it.  When another parser asked for it first, which the serial parser
+/// would have run earlier, its creation is moved to just before the user it
+/// was asked for, among the constants created for that user.
+void LLParser::RestoreUseListOrders(DenseMap<const Use *, uint64_t> &UseKeys) {
+  DenseMap<const Constant *, uint64_t> Created;
+  SmallPtrSet<Value *, 64> Used;
+  for (const auto &Key : UseKeys) {
+    Used.insert(Key.first->get());
+    const auto *C = dyn_cast<Constant>(Key.first->getUser());
+    if (!C || isa<GlobalValue>(C))
+      continue;
+    auto Entry = Created.insert(std::make_pair(C, Key.second));
+    if (!Entry.second)
+      Entry.first->second = std::min(Entry.first->second, Key.second);
+  }
+
+  // The first use a user makes is when the parser creates it.
+  auto getUserKey = [&](const User *U) {
+    uint64_t Key = UINT64_MAX;
+    for (const Use &Op : U->operands()) {
+      auto I = UseKeys.find(&Op);
+      if (I != UseKeys.end())
+        Key = std::min(Key, I->second);
+    }
+    return Key;
+  };
+
+  DenseMap<const User *, DenseMap<const Constant *, unsigned>> Numbers;
+  auto getNumber = [&](const User *U, const Constant *C) {
+    DenseMap<const Constant *, unsigned> &UserNumbers = Numbers[U];
+    if (UserNumbers.empty())
+      numberConstants(U, UserNumbers);
+    return UserNumbers.lookup(C);
+  };
+
+  // Visit the users of a constant before it: they are created after it.
+  std::vector<std::pair<uint64_t, const Constant *>> ByCreation;
+  for (const auto &Entry : Created)
+    ByCreation.push_back(std::make_pair(Entry.second, Entry.first));
+  std::sort(ByCreation.begin(), ByCreation.end(),
+            [](const std::pair<uint64_t, const Constant *> &L,
+               const std::pair<uint64_t, const Constant *> &R) {
+              return L.first > R.first;
+            });
+
+  DenseMap<const Constant *, std::pair<uint64_t, const User *>> CreatedFor;
+  DenseMap<const Use *, UsePosition> MovedUses;
+  for (const auto &Entry : ByCreation) {
+    const Constant *C = Entry.second;
+    uint64_t Key = Entry.first;
+    const User *For = nullptr;
+    unsigned Number = 0;
+    for (const Use &U : C->uses()) {
+      const User *UU = U.getUser();
+      uint64_t UserKey;
+      const User *UserFor;
+      if (isa<Constant>(UU) && !isa<GlobalValue>(UU)) {
+        auto I = CreatedFor.find(cast<Constant>(UU));
+        if (I == CreatedFor.end())
+          continue;
+        UserKey = I->second.first;
+        UserFor = I->second.second;
+      } else {
+        if (!UseKeys.count(&U))
+          continue;
+        UserKey = getUserKey(UU);
+        UserFor = UU;
+      }
+      if (UserKey > Key || (UserKey == Key && !For))
+        continue;
+      unsigned UserNumber = getNumber(UserFor, C);
+      if (UserKey < Key || UserNumber < Number) {
+        Key = UserKey;
+        For = UserFor;
+        Number = UserNumber;
+      }
+    }
+    if (!For)
+      continue;
+    CreatedFor[C] = std::make_pair(Key, For);
+    for (const Use &Op : C->operands())
+      if (UseKeys.count(&Op))
+        MovedUses[&Op] = UsePosition(Key, Number, Op.getOperandNo());
+  }
+
+  auto getPosition = [&](const Use &U) {
+    auto I = UseKeys.find(&U);
+    if (I == UseKeys.end())
+      return UsePosition(0, 0, 0);
+    auto J = MovedUses.find(&U);
+    if (J != MovedUses.end())
+      return J->second;
+    return UsePosition(I->second, UINT_MAX, 0);
+  };
+  // Use lists start with the most recent use.
+  auto Cmp = [&](const Use &L, const Use &R) {
+    return getPosition(R) < getPosition(L);
+  };
+  for (Value *V : Used)
+    if (!std::is_sorted(V->use_begin(), V->use_end(), Cmp))
+      V->sortUseList(Cmp);
 }
 
 /// ParseGlobalType
@@ -523,9 +912,19 @@ bool LLParser::ParseMDString(MDString *&Result) {
 bool LLParser::ParseMDNodeID(MDNode *&Result) {
   // !{ ..., !42, ... }
   unsigned MID = 0;
+  LocTy Loc = Lex.getLoc();
   if (ParseUInt32(MID))
     return true;
 
+  // The parser of a deferred body only sees the metadata the module defines.
+  if (Main) {
+    auto I = Main->NumberedMetadata.find(MID);
+    if (I == Main->NumberedMetadata.end())
+      return Error(Loc, "use of undefined metadata '!" + Twine(MID) + "'");
+    Result = I->second;
+    return false;
+  }
+
   // If not a forward reference, just return it now.
   if (NumberedMetadata.count(MID)) {
     Result = NumberedMetadata[MID];
@@ -632,6 +1031,11 @@ bool LLParser::ParseAlias(const std::string &Name, LocTy NameLoc, unsigned L,
   assert(Lex.getKind() == lltok::kw_alias);
   Lex.Lex();
 
+  // An alias replaces the references to it made above, so the parsers of the
+  // bodies above would not leave their use lists in the serial order.
+  if (DeferBodies && !DeferredBodies.empty())
+    return Error(NameLoc, "alias defined after a deferred function body");
+
   GlobalValue::LinkageTypes Linkage = (GlobalValue::LinkageTypes) L;
 
   if(!GlobalAlias::isValidLinkage(Linkage))
@@ -756,6 +1160,7 @@ bool LLParser::ParseGlobal(const std::string &Name, LocTy NameLoc,
 
   // See if the global was forward referenced, if so, use the global.
   if (!Name.empty()) {
+    releaseReservedName(Name);
     GVal = M->getNamedValue(Name);
     if (GVal) {
       if (!ForwardRefVals.erase(Name) || !isa<GlobalValue>(GVal))
@@ -1009,6 +1414,7 @@ GlobalValue *LLParser::GetGlobalVal(const std::string &Name, Type *Ty,
   }
 
   // Look this name up in the normal function symbol table.
+  releaseReservedName(Name);
   GlobalValue *Val =
     cast_or_null<GlobalValue>(M->getValueSymbolTable().lookup(Name));
 
@@ -1029,6 +1435,13 @@ GlobalValue *LLParser::GetGlobalVal(const std::string &Name, Type *Ty,
     return nullptr;
   }
 
+  // The parser of a deferred body runs once all the global values of the
+  // module are known, and cannot add to the module anyway.
+  if (Main) {
+    Error(Loc, "use of undefined value '@" + Name + "'");
+    return nullptr;
+  }
+
   // Otherwise, create a new forward reference for this value and remember it.
   GlobalValue *FwdVal;
   if (FunctionType *FT = dyn_cast<FunctionType>(PTy->getElementType()))
@@ -1050,7 +1463,8 @@ GlobalValue *LLParser::GetGlobalVal(unsigned ID, Type *Ty, LocTy Loc) {
     return nullptr;
   }
 
-  GlobalValue *Val = ID < NumberedVals.size() ? NumberedVals[ID] : nullptr;
+  const std::vector<GlobalValue*> &Numbered = getNumberedVals();
+  GlobalValue *Val = ID < Numbered.size() ? Numbered[ID] : nullptr;
 
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
@@ -1069,6 +1483,11 @@ GlobalValue *LLParser::GetGlobalVal(unsigned ID, Type *Ty, LocTy Loc) {
     return nullptr;
   }
 
+  if (Main) {
+    Error(Loc, "use of undefined value '@" + Twine(ID) + "'");
+    return nullptr;
+  }
+
   // Otherwise, create a new forward reference for this value and remember it.
   GlobalValue *FwdVal;
   if (FunctionType *FT = dyn_cast<FunctionType>(PTy->getElementType()))
@@ -1727,6 +2146,16 @@ bool LLParser::ParseType(Type *&Result, const Twine &Msg, bool AllowVoid) {
     break;
   case lltok::LocalVar: {
     // Type ::= %foo
+    // The parser of a deferred body only sees the types the module defines.
+    if (Main) {
+      auto I = Main->NamedTypes.find(Lex.getStrVal());
+      if (I == Main->NamedTypes.end())
+        return TokError("use of undefined type named '" + Lex.getStrVal() +
+                        "'");
+      Result = I->second.first;
+      Lex.Lex();
+      break;
+    }
     std::pair<Type*, LocTy> &Entry = NamedTypes[Lex.getStrVal()];
 
     // If the type hasn't been defined yet, create a forward definition and
@@ -1742,6 +2171,15 @@ bool LLParser::ParseType(Type *&Result, const Twine &Msg, bool AllowVoid) {
 
   case lltok::LocalVarID: {
     // Type ::= %4
+    if (Main) {
+      auto I = Main->NumberedTypes.find(Lex.getUIntVal());
+      if (I == Main->NumberedTypes.end())
+        return TokError("use of undefined type '%" + Twine(Lex.getUIntVal()) +
+                        "'");
+      Result = I->second.first;
+      Lex.Lex();
+      break;
+    }
     std::pair<Type*, LocTy> &Entry = NumberedTypes[Lex.getUIntVal()];
 
     // If the type hasn't been defined yet, create a forward definition and
@@ -4196,6 +4634,7 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
 
   Fn = nullptr;
   if (!FunctionName.empty()) {
+    releaseReservedName(FunctionName);
     // If this was a definition of a forward reference, remove the definition
     // from the forward reference table and fill in the forward ref.
     std::map<std::string, std::pair<GlobalValue*, LocTy> >::iterator FRVI =
@@ -4325,14 +4764,11 @@ bool LLParser::PerFunctionState::resolveForwardRefBlockAddresses() {
 
 /// ParseFunctionBody
 ///   ::= '{' BasicBlock+ UseListOrderDirective* '}'
-bool LLParser::ParseFunctionBody(Function &Fn) {
+bool LLParser::ParseFunctionBody(Function &Fn, int FunctionNumber) {
   if (Lex.getKind() != lltok::lbrace)
     return TokError("expected '{' in function body");
   Lex.Lex();  // eat the {.
 
-  int FunctionNumber = -1;
-  if (!Fn.hasName()) FunctionNumber = NumberedVals.size()-1;
-
   PerFunctionState PFS(*this, Fn, FunctionNumber);
 
   // Resolve block addresses and allow basic blocks to be forward-declared
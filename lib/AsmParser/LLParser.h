@@ -134,12 +134,69 @@ namespace llvm {
     std::map<Value*, std::vector<unsigned> > ForwardRefAttrGroups;
     std::map<unsigned, AttrBuilder> NumberedAttrBuilders;
 
+    /// The whole input, which the parsers of deferred function bodies lex
+    /// again from the start of their body.
+    StringRef Source;
+
+    /// DeferredBody - A function body that RunInParallel skipped while parsing
+    /// the rest of the module.  Start is the opening brace and End the token
+    /// after the closing one.  The parser of the body leaves what can only be
+    /// finished once all the bodies are known in the remaining fields.
+    struct DeferredBody {
+      Function *F;
+      int FunctionNumber;
+      const char *Start, *End;
+      bool Failed;
+      SmallVector<Instruction*, 4> InstsWithTBAATag;
+      std::map<Value*, std::vector<unsigned> > ForwardRefAttrGroups;
+
+      DeferredBody(Function *F, int FunctionNumber, const char *Start)
+          : F(F), FunctionNumber(FunctionNumber), Start(Start), End(nullptr),
+            Failed(false) {}
+    };
+    std::vector<DeferredBody> DeferredBodies;
+
+    /// ReservedNames - Placeholders for the global values that skipped bodies
+    /// refer to before they are defined.  The serial parser creates these
+    /// values at the first reference, and the layout of the symbol table of
+    /// the module depends on the order names are added in.
+    std::map<std::string, GlobalVariable*> ReservedNames;
+
+    /// DeferBodies - Set while RunInParallel parses the top-level entities,
+    /// to skip the function bodies instead.
+    bool DeferBodies;
+
+    /// Main - In the parser of a deferred function body, the parser of the
+    /// module.  Its module level state does not change while the bodies are
+    /// parsed, and is only read.
+    const LLParser *Main;
+
+    /// UseOrder - While RunInParallel parses the top-level entities, where
+    /// the serial parser makes the uses of shared values made meanwhile.
+    struct UseOrderRecorder;
+    UseOrderRecorder *UseOrder;
+
+    LLParser(const LLParser &Main, StringRef F, SourceMgr &SM,
+             SMDiagnostic &Err)
+        : Context(Main.Context), Lex(F, SM, Err, Main.Context), M(Main.M),
+          BlockAddressPFS(nullptr), DeferBodies(false), Main(&Main),
+          UseOrder(nullptr) {}
+
   public:
     LLParser(StringRef F, SourceMgr &SM, SMDiagnostic &Err, Module *m)
         : Context(m->getContext()), Lex(F, SM, Err, m->getContext()), M(m),
-          BlockAddressPFS(nullptr) {}
+          BlockAddressPFS(nullptr), Source(F), DeferBodies(false),
+          Main(nullptr), UseOrder(nullptr) {}
     bool Run();
 
+    /// RunInParallel - Parse the module like Run, but parse the function
+    /// bodies on NumThreads threads once all the other top-level entities are
+    /// known.  Return true if the module could not be parsed that way, either
+    /// because the input is invalid or because it uses something left to the
+    /// serial parser.  The module must then be discarded and the input parsed
+    /// again with Run, which gives the diagnostic.
+    bool RunInParallel(unsigned NumThreads);
+
     LLVMContext &getContext() { return Context; }
 
   private:
@@ -157,6 +214,11 @@ namespace llvm {
     GlobalValue *GetGlobalVal(const std::string &N, Type *Ty, LocTy Loc);
     GlobalValue *GetGlobalVal(unsigned ID, Type *Ty, LocTy Loc);
 
+    /// getNumberedVals - The unnamed global values of the module, in order.
+    const std::vector<GlobalValue*> &getNumberedVals() const {
+      return Main ? Main->NumberedVals : NumberedVals;
+    }
+
     /// Get a Comdat with the specified name, creating a forward reference
     /// record if needed.
     Comdat *getComdat(const std::string &N, LocTy Loc);
@@ -249,6 +311,12 @@ namespace llvm {
     bool ParseNamedType();
     bool ParseDeclare();
     bool ParseDefine();
+    bool SkipFunctionBody(Function &Fn, int FunctionNumber);
+    void releaseReservedName(const std::string &Name);
+    bool ParseDeferredBodies(unsigned NumThreads,
+                             DenseMap<const Use *, uint64_t> &UseKeys);
+    bool ParseDeferredBody(DeferredBody &Body);
+    void RestoreUseListOrders(DenseMap<const Use *, uint64_t> &UseKeys);
 
     bool ParseGlobalType(bool &IsConstant);
     bool ParseUnnamedGlobal();
@@ -420,7 +488,7 @@ namespace llvm {
     };
     bool ParseArgumentList(SmallVectorImpl<ArgInfo> &ArgList, bool &isVarArg);
     bool ParseFunctionHeader(Function *&Fn, bool isDefine);
-    bool ParseFunctionBody(Function &Fn);
+    bool ParseFunctionBody(Function &Fn, int FunctionNumber);
     bool ParseBasicBlock(PerFunctionState &PFS);
 
     enum TailCallType { TCT_None, TCT_Tail, TCT_MustTail };
@@ -14,14 +14,36 @@
 #include "llvm/AsmParser/Parser.h"
 #include "LLParser.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstring>
 #include <system_error>
+#include <thread>
 using namespace llvm;
 
+// Parsing function bodies on several threads is opt-in.  It switches the
+// context to multithreaded mode.
+static cl::opt<unsigned>
+ParseThreads("asm-parse-threads",
+             cl::desc("Number of threads parsing the function bodies of an "
+                      "assembly file (0 uses all the hardware threads)"),
+             cl::init(1));
+
+/// Return the number of threads parsing function bodies.
+static unsigned getParseThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (ParseThreads == 0)
+    return std::max(1u, std::thread::hardware_concurrency());
+  return ParseThreads;
+#else
+  return 1;
+#endif
+}
+
 bool llvm::parseAssemblyInto(MemoryBufferRef F, Module &M, SMDiagnostic &Err) {
   SourceMgr SM;
   std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::getMemBuffer(F, false);
@@ -36,6 +58,20 @@ std::unique_ptr<Module> llvm::parseAssembly(MemoryBufferRef F,
   std::unique_ptr<Module> M =
       make_unique<Module>(F.getBufferIdentifier(), Context);
 
+  // The parallel parser needs a module it can throw away: it gives up on
+  // invalid input, which is then parsed again serially for the diagnostic, and
+  // on input that uses something it leaves to the serial parser.
+  unsigned NumThreads = getParseThreadCount();
+  if (NumThreads > 1) {
+    SourceMgr SM;
+    SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(F, false), SMLoc());
+    SMDiagnostic ParallelErr;
+    if (!LLParser(F.getBuffer(), SM, ParallelErr, M.get())
+             .RunInParallel(NumThreads))
+      return M;
+    M = make_unique<Module>(F.getBufferIdentifier(), Context);
+  }
+
   if (parseAssemblyInto(F, *M, Err))
     return nullptr;
 
@@ -20,6 +20,7 @@
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/GVMaterializer.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -28,14 +29,27 @@
 #include "llvm/IR/OperandTraits.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DataStream.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <deque>
 using namespace llvm;
 
+// Parsing function bodies on several threads is opt-in.  It parses all the
+// bodies of a module the first time one of them is needed, even when the
+// module is loaded lazily.
+static cl::opt<unsigned>
+MaterializeThreads("bitcode-materialize-threads",
+                   cl::desc("Number of threads parsing the function bodies "
+                            "of a bitcode module (0 uses all the hardware "
+                            "threads)"),
+                   cl::init(1));
+
 namespace {
 enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
@@ -44,6 +58,13 @@ enum {
 class BitcodeReaderValueList {
   std::vector<WeakVH> ValuePtrs;
 
+  /// When function bodies are parsed in parallel, each worker reads the
+  /// values of the module from the list of the main reader, which does not
+  /// change meanwhile, and only stores the values local to the function.
+  /// ValuePtrs then holds the values from NumModuleValues on.
+  const BitcodeReaderValueList *ModuleValues;
+  unsigned NumModuleValues;
+
   /// ResolveConstants - As we resolve forward-referenced constants, we add
   /// information about them to this vector.  This allows us to resolve them in
   /// bulk instead of resolving each reference at a time.  See the code in
@@ -54,15 +75,29 @@ class BitcodeReaderValueList {
   typedef std::vector<std::pair<Constant*, unsigned> > ResolveConstantsTy;
   ResolveConstantsTy ResolveConstants;
   LLVMContext &Context;
+
+  WeakVH &getSlot(unsigned Idx) {
+    assert(Idx >= NumModuleValues && "Module values are read-only");
+    return ValuePtrs[Idx - NumModuleValues];
+  }
+
 public:
-  BitcodeReaderValueList(LLVMContext &C) : Context(C) {}
+  BitcodeReaderValueList(LLVMContext &C)
+      : ModuleValues(nullptr), NumModuleValues(0), Context(C) {}
+  BitcodeReaderValueList(LLVMContext &C,
+                         const BitcodeReaderValueList &ModuleValues)
+      : ModuleValues(&ModuleValues), NumModuleValues(ModuleValues.size()),
+        Context(C) {}
   ~BitcodeReaderValueList() {
     assert(ResolveConstants.empty() && "Constants not resolved?");
   }
 
   // vector compatibility methods
-  unsigned size() const { return ValuePtrs.size(); }
-  void resize(unsigned N) { ValuePtrs.resize(N); }
+  unsigned size() const { return NumModuleValues + ValuePtrs.size(); }
+  void resize(unsigned N) {
+    assert(N >= NumModuleValues && "Module values are read-only");
+    ValuePtrs.resize(N - NumModuleValues);
+  }
   void push_back(Value *V) {
     ValuePtrs.push_back(V);
   }
@@ -73,16 +108,18 @@ public:
   }
 
   Value *operator[](unsigned i) const {
-    assert(i < ValuePtrs.size());
-    return ValuePtrs[i];
+    assert(i < size());
+    if (i < NumModuleValues)
+      return (*ModuleValues)[i];
+    return ValuePtrs[i - NumModuleValues];
   }
 
-  Value *back() const { return ValuePtrs.back(); }
+  Value *back() const { return operator[](size() - 1); }
     void pop_back() { ValuePtrs.pop_back(); }
-  bool empty() const { return ValuePtrs.empty(); }
+  bool empty() const { return size() == 0; }
   void shrinkTo(unsigned N) {
     assert(N <= size() && "Invalid shrinkTo request!");
-    ValuePtrs.resize(N);
+    resize(N);
   }
 
   Constant *getConstantFwdRef(unsigned Idx, Type *Ty);
@@ -102,33 +139,77 @@ class BitcodeReaderMDValueList {
   unsigned MaxFwdRef;
   std::vector<TrackingMDRef> MDValuePtrs;
 
+  /// As in BitcodeReaderValueList, the metadata of the module when parsing a
+  /// function body in parallel with others.
+  const BitcodeReaderMDValueList *ModuleMDs;
+  unsigned NumModuleMDs;
+
+  /// When metadata is loaded lazily, forward references to the IDs below
+  /// NumLazyMDs are queued in LazyFwdRefs to be loaded on demand, rather than
+  /// resolved by reading on.  LazyLoaded holds the IDs that replaced such a
+  /// forward reference, whose cycles are still to be resolved.
+  unsigned NumLazyMDs;
+  std::vector<unsigned> LazyFwdRefs;
+  std::vector<unsigned> LazyLoaded;
+
   LLVMContext &Context;
+
+  TrackingMDRef &getSlot(unsigned Idx) {
+    assert(Idx >= NumModuleMDs && "Module metadata is read-only");
+    return MDValuePtrs[Idx - NumModuleMDs];
+  }
+
 public:
   BitcodeReaderMDValueList(LLVMContext &C)
-      : NumFwdRefs(0), AnyFwdRefs(false), Context(C) {}
+      : NumFwdRefs(0), AnyFwdRefs(false), ModuleMDs(nullptr), NumModuleMDs(0),
+        NumLazyMDs(0), Context(C) {}
+  BitcodeReaderMDValueList(LLVMContext &C,
+                           const BitcodeReaderMDValueList &ModuleMDs)
+      : NumFwdRefs(0), AnyFwdRefs(false), ModuleMDs(&ModuleMDs),
+        NumModuleMDs(ModuleMDs.size()), NumLazyMDs(0), Context(C) {}
 
   // vector compatibility methods
-  unsigned size() const       { return MDValuePtrs.size(); }
-  void resize(unsigned N)     { MDValuePtrs.resize(N); }
+  unsigned size() const       { return NumModuleMDs + MDValuePtrs.size(); }
+  void resize(unsigned N) {
+    assert(N >= NumModuleMDs && "Module metadata is read-only");
+    MDValuePtrs.resize(N - NumModuleMDs);
+  }
   void push_back(Metadata *MD) { MDValuePtrs.emplace_back(MD); }
   void clear()                { MDValuePtrs.clear();  }
-  Metadata *back() const      { return MDValuePtrs.back(); }
+  Metadata *back() const      { return operator[](size() - 1); }
   void pop_back()             { MDValuePtrs.pop_back(); }
-  bool empty() const          { return MDValuePtrs.empty(); }
+  bool empty() const          { return size() == 0; }
 
   Metadata *operator[](unsigned i) const {
-    assert(i < MDValuePtrs.size());
-    return MDValuePtrs[i];
+    assert(i < size());
+    if (i < NumModuleMDs)
+      return (*ModuleMDs)[i];
+    return MDValuePtrs[i - NumModuleMDs];
   }
 
   void shrinkTo(unsigned N) {
     assert(N <= size() && "Invalid shrinkTo request!");
-    MDValuePtrs.resize(N);
+    resize(N);
   }
 
   Metadata *getValueFwdRef(unsigned Idx);
   void AssignValue(Metadata *MD, unsigned Idx);
   void tryToResolveCycles();
+
+  void setNumLazyMDs(unsigned N) { NumLazyMDs = N; }
+  bool isLazy(unsigned Idx) const { return Idx < NumLazyMDs; }
+  bool isLoaded(unsigned Idx) const {
+    if (Idx >= size())
+      return false;
+    auto *MD = operator[](Idx);
+    return MD && !(isa<MDNode>(MD) && cast<MDNode>(MD)->isTemporary());
+  }
+  bool hasLazyFwdRefs() const { return !LazyFwdRefs.empty(); }
+  unsigned popLazyFwdRef() {
+    unsigned Idx = LazyFwdRefs.back();
+    LazyFwdRefs.pop_back();
+    return Idx;
+  }
 };
 
 class BitcodeReader : public GVMaterializer {
@@ -189,11 +270,25 @@ class BitcodeReader : public GVMaterializer {
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// The bit position of the function index block, if the module has one.
+  /// The index gives the positions of all the function bodies, which then do
+  /// not need to be walked.
+  uint64_t FunctionIndexBit = 0;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
   std::vector<uint64_t> DeferredMetadataInfo;
 
+  /// When deferred metadata is materialized, the first block that defines
+  /// nodes is only indexed: its nodes are loaded when something refers to
+  /// them.  This holds the bit position of the record of each node, by ID,
+  /// and a cursor left in the block, which holds the abbreviations the
+  /// records use.
+  std::vector<uint64_t> LazyMetadataBits;
+  BitstreamCursor LazyMetadataCursor;
+  bool ReadingLazyMetadata = false;
+
   /// These are basic blocks forward-referenced by block addresses.  They are
   /// inserted lazily into functions when they're loaded.  The basic block ID is
   /// its index into the vector.
@@ -221,6 +316,24 @@ class BitcodeReader : public GVMaterializer {
 
   bool StripDebugInfo = false;
 
+  /// True once parseFunctionBodiesInParallel has run.  It only runs once.
+  bool ParsedBodiesInParallel = false;
+
+  /// True in the readers that parse function bodies on worker threads, on
+  /// behalf of the reader of the module.
+  bool IsBodyWorker = false;
+
+  /// In a worker, the function whose body is being parsed, and whether that
+  /// body refers to the blocks of another function.  Such a body is discarded
+  /// and parsed again serially.
+  Function *WorkerFunction = nullptr;
+  bool WorkerNeedsSerialParse = false;
+
+  /// Create a reader that parses function bodies on a worker thread for
+  /// Main, sharing its stream and module level state.
+  BitcodeReader(const BitcodeReader &Main,
+                DiagnosticHandlerFunction DiagnosticHandler);
+
 public:
   std::error_code Error(BitcodeError E, const Twine &Message);
   std::error_code Error(BitcodeError E);
@@ -253,6 +366,13 @@ public:
   /// @returns true if an error occurred.
   ErrorOr<std::string> parseTriple();
 
+  /// @brief Cheap mechanism to just extract the function summaries. If
+  /// \p Index is not null, the module is registered in it under \p Path and
+  /// the summaries are added to it.
+  /// @returns whether the module contains function summaries.
+  ErrorOr<bool> parseFunctionSummaries(FunctionInfoIndex *Index,
+                                       StringRef Path);
+
   static uint64_t decodeSignRotatedValue(uint64_t V);
 
   /// Materialize any deferred Metadata block.
@@ -364,14 +484,27 @@ private:
   std::error_code ParseValueSymbolTable();
   std::error_code ParseConstants();
   std::error_code RememberAndSkipFunctionBody();
+  std::error_code parseFunctionIndex();
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   std::error_code rememberAndSkipMetadata();
   std::error_code ParseFunctionBody(Function *F);
+  std::error_code parseFunctionBodiesInParallel();
+  std::error_code parseFunctionBodyInWorker(Function *F, uint64_t BitPos);
+  void upgradeIntrinsicCalls();
   std::error_code GlobalCleanup();
   std::error_code ResolveGlobalAndAliasInits();
-  std::error_code ParseMetadata();
+  /// How ParseMetadata reads a block: all of it, only the positions of its
+  /// nodes, or the record of a single node.
+  enum class MetadataParseMode { Block, Index, Node };
+  std::error_code ParseMetadata(MetadataParseMode Mode = MetadataParseMode::Block,
+                                unsigned NodeID = 0);
+  std::error_code indexMetadata(uint64_t BitPos);
+  std::error_code loadMetadataNode(unsigned ID);
+  std::error_code loadLazyMetadata();
   std::error_code ParseMetadataAttachment(Function &F);
   ErrorOr<std::string> parseModuleTriple();
+  std::error_code parseFunctionSummaryBlock(FunctionInfoIndex *Index,
+                                            unsigned ModuleID);
   std::error_code ParseUseLists();
   std::error_code InitStream();
   std::error_code InitStreamFromBuffer();
@@ -437,6 +570,20 @@ BitcodeReader::BitcodeReader(DataStreamer *streamer, LLVMContext &C,
       MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
       WillMaterializeAllForwardRefs(false), IsMetadataMaterialized(false) {}
 
+BitcodeReader::BitcodeReader(const BitcodeReader &Main,
+                             DiagnosticHandlerFunction DiagnosticHandler)
+    : Context(Main.Context), DiagnosticHandler(DiagnosticHandler),
+      TheModule(Main.TheModule), Buffer(nullptr), LazyStreamer(nullptr),
+      NextUnreadBit(0), SeenValueSymbolTable(true), TypeList(Main.TypeList),
+      ValueList(Main.Context, Main.ValueList),
+      MDValueList(Main.Context, Main.MDValueList),
+      MAttributes(Main.MAttributes), MDKindMap(Main.MDKindMap),
+      SeenFirstFunctionBody(true), UseRelativeIDs(Main.UseRelativeIDs),
+      WillMaterializeAllForwardRefs(true), IsMetadataMaterialized(true),
+      IsBodyWorker(true) {
+  Stream.init(Main.StreamFile.get());
+}
+
 std::error_code BitcodeReader::materializeForwardReferencedFunctions() {
   if (WillMaterializeAllForwardRefs)
     return std::error_code();
@@ -753,7 +900,7 @@ void BitcodeReaderValueList::AssignValue(Value *V, unsigned Idx) {
   if (Idx >= size())
     resize(Idx+1);
 
-  WeakVH &OldV = ValuePtrs[Idx];
+  WeakVH &OldV = getSlot(Idx);
   if (!OldV) {
     OldV = V;
     return;
@@ -778,14 +925,14 @@ Constant *BitcodeReaderValueList::getConstantFwdRef(unsigned Idx,
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Value *V = ValuePtrs[Idx]) {
+  if (Value *V = operator[](Idx)) {
     assert(Ty == V->getType() && "Type mismatch in constant table!");
     return cast<Constant>(V);
   }
 
   // Create and return a placeholder, which will later be RAUW'd.
   Constant *C = new ConstantPlaceHolder(Ty, Context);
-  ValuePtrs[Idx] = C;
+  getSlot(Idx) = C;
   return C;
 }
 
@@ -797,7 +944,7 @@ Value *BitcodeReaderValueList::getValueFwdRef(unsigned Idx, Type *Ty) {
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Value *V = ValuePtrs[Idx]) {
+  if (Value *V = operator[](Idx)) {
     // If the types don't match, it's invalid.
     if (Ty && Ty != V->getType())
       return nullptr;
@@ -809,7 +956,7 @@ Value *BitcodeReaderValueList::getValueFwdRef(unsigned Idx, Type *Ty) {
 
   // Create and return a placeholder, which will later be RAUW'd.
   Value *V = new Argument(Ty);
-  ValuePtrs[Idx] = V;
+  getSlot(Idx) = V;
   return V;
 }
 
@@ -904,7 +1051,7 @@ void BitcodeReaderMDValueList::AssignValue(Metadata *MD, unsigned Idx) {
   if (Idx >= size())
     resize(Idx+1);
 
-  TrackingMDRef &OldMD = MDValuePtrs[Idx];
+  TrackingMDRef &OldMD = getSlot(Idx);
   if (!OldMD) {
     OldMD.reset(MD);
     return;
@@ -914,17 +1061,22 @@ void BitcodeReaderMDValueList::AssignValue(Metadata *MD, unsigned Idx) {
   TempMDTuple PrevMD(cast<MDTuple>(OldMD.get()));
   PrevMD->replaceAllUsesWith(MD);
   --NumFwdRefs;
+  if (Idx < NumLazyMDs)
+    LazyLoaded.push_back(Idx);
 }
 
 Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Metadata *MD = MDValuePtrs[Idx])
+  if (Metadata *MD = operator[](Idx))
     return MD;
 
-  // Track forward refs to be resolved later.
-  if (AnyFwdRefs) {
+  // Track forward refs to be resolved later.  Lazily loaded IDs are queued
+  // instead, so that resolving cycles does not scan the whole lazy range.
+  if (Idx < NumLazyMDs)
+    LazyFwdRefs.push_back(Idx);
+  else if (AnyFwdRefs) {
     MinFwdRef = std::min(MinFwdRef, Idx);
     MaxFwdRef = std::max(MaxFwdRef, Idx);
   } else {
@@ -935,12 +1087,12 @@ Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
 
   // Create and return a placeholder, which will later be RAUW'd.
   Metadata *MD = MDNode::getTemporary(Context, None).release();
-  MDValuePtrs[Idx].reset(MD);
+  getSlot(Idx).reset(MD);
   return MD;
 }
 
 void BitcodeReaderMDValueList::tryToResolveCycles() {
-  if (!AnyFwdRefs)
+  if (!AnyFwdRefs && LazyLoaded.empty())
     // Nothing to do.
     return;
 
@@ -949,18 +1101,23 @@ void BitcodeReaderMDValueList::tryToResolveCycles() {
     return;
 
   // Resolve any cycles.
-  for (unsigned I = MinFwdRef, E = MaxFwdRef + 1; I != E; ++I) {
-    auto &MD = MDValuePtrs[I];
-    auto *N = dyn_cast_or_null<MDNode>(MD);
+  auto resolveCycles = [&](unsigned I) {
+    auto *N = dyn_cast_or_null<MDNode>(operator[](I));
     if (!N)
-      continue;
+      return;
 
     assert(!N->isTemporary() && "Unexpected forward reference");
     N->resolveCycles();
-  }
+  };
+  if (AnyFwdRefs)
+    for (unsigned I = MinFwdRef, E = MaxFwdRef + 1; I != E; ++I)
+      resolveCycles(I);
+  for (unsigned I : LazyLoaded)
+    resolveCycles(I);
 
   // Make sure we return early again until there's another forward ref.
   AnyFwdRefs = false;
+  LazyLoaded.clear();
 }
 
 Type *BitcodeReader::getTypeByID(unsigned ID) {
@@ -1570,13 +1727,61 @@ std::error_code BitcodeReader::ParseValueSymbolTable() {
 
 static int64_t unrotateSign(uint64_t U) { return U & 1 ? ~(U >> 1) : U >> 1; }
 
-std::error_code BitcodeReader::ParseMetadata() {
+/// Return true if records with the given code define the next metadata ID.
+/// This must match the records ParseMetadata assigns IDs to.
+static bool definesMetadataID(unsigned Code) {
+  switch (Code) {
+  default:
+    return false;
+  case bitc::METADATA_OLD_FN_NODE:
+  case bitc::METADATA_OLD_NODE:
+  case bitc::METADATA_VALUE:
+  case bitc::METADATA_DISTINCT_NODE:
+  case bitc::METADATA_NODE:
+  case bitc::METADATA_LOCATION:
+  case bitc::METADATA_GENERIC_DEBUG:
+  case bitc::METADATA_SUBRANGE:
+  case bitc::METADATA_ENUMERATOR:
+  case bitc::METADATA_BASIC_TYPE:
+  case bitc::METADATA_DERIVED_TYPE:
+  case bitc::METADATA_COMPOSITE_TYPE:
+  case bitc::METADATA_SUBROUTINE_TYPE:
+  case bitc::METADATA_FILE:
+  case bitc::METADATA_COMPILE_UNIT:
+  case bitc::METADATA_SUBPROGRAM:
+  case bitc::METADATA_LEXICAL_BLOCK:
+  case bitc::METADATA_LEXICAL_BLOCK_FILE:
+  case bitc::METADATA_NAMESPACE:
+  case bitc::METADATA_TEMPLATE_TYPE:
+  case bitc::METADATA_TEMPLATE_VALUE:
+  case bitc::METADATA_GLOBAL_VAR:
+  case bitc::METADATA_LOCAL_VAR:
+  case bitc::METADATA_EXPRESSION:
+  case bitc::METADATA_OBJC_PROPERTY:
+  case bitc::METADATA_IMPORTED_ENTITY:
+  case bitc::METADATA_STRING:
+    return true;
+  }
+}
+
+/// ParseMetadata - Parse a metadata block.  In MetadataParseMode::Index, only
+/// record where the nodes of the block are, and leave the cursor in the block
+/// if it has any.  In MetadataParseMode::Node, parse the record of node NodeID
+/// only, at the current position of such a cursor.
+std::error_code BitcodeReader::ParseMetadata(MetadataParseMode Mode,
+                                             unsigned NodeID) {
   IsMetadataMaterialized = true;
-  unsigned NextMDValueNo = MDValueList.size();
+  unsigned NextMDValueNo =
+      Mode == MetadataParseMode::Node ? NodeID : MDValueList.size();
 
-  if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+  if (Mode != MetadataParseMode::Node &&
+      Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
     return Error("Invalid record");
 
+  // While indexing, all the references are to lazily loaded nodes.
+  if (Mode == MetadataParseMode::Index)
+    MDValueList.setNumLazyMDs(~0U);
+
   SmallVector<uint64_t, 64> Record;
 
   auto getMD =
@@ -1586,9 +1791,17 @@ std::error_code BitcodeReader::ParseMetadata() {
       return getMD(ID - 1);
     return nullptr;
   };
+  std::error_code LazyEC;
   auto getMDString = [&](unsigned ID) -> MDString *{
     // This requires that the ID is not really a forward reference.  In
-    // particular, the MDString must already have been resolved.
+    // particular, the MDString must already have been resolved, so a lazily
+    // loaded one is loaded now.
+    if (ID && MDValueList.isLazy(ID - 1) && !MDValueList.isLoaded(ID - 1)) {
+      if (!LazyEC)
+        LazyEC = loadMetadataNode(ID - 1);
+      if (LazyEC)
+        return nullptr;
+    }
     return cast_or_null<MDString>(getMDOrNull(ID));
   };
 
@@ -1597,13 +1810,25 @@ std::error_code BitcodeReader::ParseMetadata() {
 
   // Read all the records.
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks(
+        Mode == MetadataParseMode::Index ? BitstreamCursor::AF_DontPopBlockAtEnd
+                                         : 0);
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
     case BitstreamEntry::Error:
       return Error("Malformed block");
     case BitstreamEntry::EndBlock:
+      if (Mode == MetadataParseMode::Index) {
+        // Stay in a block with nodes, to be able to read them later.
+        if (LazyMetadataBits.empty() && Stream.ReadBlockEnd())
+          return Error("Malformed block");
+        if (MDValueList.size() > NextMDValueNo)
+          return Error("Invalid record");
+        MDValueList.resize(NextMDValueNo);
+        MDValueList.setNumLazyMDs(NextMDValueNo);
+        return std::error_code();
+      }
       MDValueList.tryToResolveCycles();
       return std::error_code();
     case BitstreamEntry::Record:
@@ -1613,7 +1838,13 @@ std::error_code BitcodeReader::ParseMetadata() {
 
     // Read a record.
     Record.clear();
+    uint64_t RecordBit = Stream.GetCurrentBitNo() - Stream.getAbbrevIDWidth();
     unsigned Code = Stream.readRecord(Entry.ID, Record);
+    if (Mode == MetadataParseMode::Index && definesMetadataID(Code)) {
+      LazyMetadataBits.resize(NextMDValueNo + 1);
+      LazyMetadataBits[NextMDValueNo++] = RecordBit;
+      continue;
+    }
     bool IsDistinct = false;
     switch (Code) {
     default:  // Default behavior: ignore.
@@ -2005,10 +2236,59 @@ std::error_code BitcodeReader::ParseMetadata() {
       break;
     }
     }
+
+    if (LazyEC)
+      return LazyEC;
+    if (Mode == MetadataParseMode::Node) {
+      if (NextMDValueNo != NodeID + 1)
+        return Error("Invalid record");
+      return std::error_code();
+    }
   }
 #undef GET_OR_DISTINCT
 }
 
+/// indexMetadata - Index the deferred metadata block at BitPos with a cursor
+/// of its own, which stays in the block if it defines nodes.
+std::error_code BitcodeReader::indexMetadata(uint64_t BitPos) {
+  LazyMetadataCursor.init(StreamFile.get());
+  LazyMetadataCursor.JumpToBit(BitPos);
+  std::swap(Stream, LazyMetadataCursor);
+  std::error_code EC = ParseMetadata(MetadataParseMode::Index);
+  std::swap(Stream, LazyMetadataCursor);
+  return EC;
+}
+
+/// loadMetadataNode - Parse the record of the lazily loaded node ID.
+std::error_code BitcodeReader::loadMetadataNode(unsigned ID) {
+  if (MDValueList.isLoaded(ID))
+    return std::error_code();
+
+  // Strings are loaded while another node is being read from the cursor.
+  bool SwapCursors = !ReadingLazyMetadata;
+  if (SwapCursors) {
+    std::swap(Stream, LazyMetadataCursor);
+    ReadingLazyMetadata = true;
+  }
+  Stream.JumpToBit(LazyMetadataBits[ID]);
+  std::error_code EC = ParseMetadata(MetadataParseMode::Node, ID);
+  if (SwapCursors) {
+    std::swap(Stream, LazyMetadataCursor);
+    ReadingLazyMetadata = false;
+  }
+  return EC;
+}
+
+/// loadLazyMetadata - Load the lazily loaded nodes that were referred to since
+/// the last call, and the nodes they refer to in turn.
+std::error_code BitcodeReader::loadLazyMetadata() {
+  while (MDValueList.hasLazyFwdRefs())
+    if (std::error_code EC = loadMetadataNode(MDValueList.popLazyFwdRef()))
+      return EC;
+  MDValueList.tryToResolveCycles();
+  return std::error_code();
+}
+
 /// decodeSignRotatedValue - Decode a signed value stored with the sign bit in
 /// the LSB for dense VBR encoding.
 uint64_t BitcodeReader::decodeSignRotatedValue(uint64_t V) {
@@ -2516,6 +2796,14 @@ std::error_code BitcodeReader::ParseConstants() {
       if (!Fn)
         return Error("Invalid record");
 
+      // Another worker may be creating the blocks of Fn.  Finish parsing with
+      // a stand-in value and let the body be parsed again serially.
+      if (IsBodyWorker && Fn != WorkerFunction) {
+        WorkerNeedsSerialParse = true;
+        V = UndefValue::get(Type::getInt8PtrTy(Context));
+        break;
+      }
+
       // Don't let Fn get dematerialized.
       BlockAddressesTaken.insert(Fn);
 
@@ -2599,6 +2887,9 @@ std::error_code BitcodeReader::ParseUseLists() {
         V = FunctionBBs[ID];
       } else
         V = ValueList[ID];
+      // Other workers may be adding uses to constants and globals.
+      if (IsBodyWorker && isa<Constant>(V))
+        break;
       unsigned NumUses = 0;
       SmallDenseMap<const Use *, unsigned, 16> Order;
       for (const Use &U : V->uses()) {
@@ -2635,13 +2926,23 @@ std::error_code BitcodeReader::rememberAndSkipMetadata() {
 
 std::error_code BitcodeReader::materializeMetadata() {
   for (uint64_t BitPos : DeferredMetadataInfo) {
+    // Only index the first block with nodes, and load them on demand.  The
+    // streamer cannot go back to them.
+    if (LazyMetadataBits.empty() && !LazyStreamer) {
+      if (std::error_code EC = indexMetadata(BitPos))
+        return EC;
+      continue;
+    }
+
     // Move the bit stream to the saved position.
     Stream.JumpToBit(BitPos);
     if (std::error_code EC = ParseMetadata())
       return EC;
   }
   DeferredMetadataInfo.clear();
-  return std::error_code();
+
+  // Load what named metadata refers to.
+  return loadLazyMetadata();
 }
 
 void BitcodeReader::setStripDebugInfo() { StripDebugInfo = true; }
@@ -2667,6 +2968,64 @@ std::error_code BitcodeReader::RememberAndSkipFunctionBody() {
   return std::error_code();
 }
 
+/// parseFunctionIndex - Record the positions of all the function bodies from
+/// the function index, instead of walking the bodies, and leave the stream
+/// after the index, which follows the last body.
+std::error_code BitcodeReader::parseFunctionIndex() {
+  // The index gives the position of the ENTER_SUBBLOCK of each body, while
+  // bodies are recorded past their block id, as RememberAndSkipFunctionBody
+  // does.
+  uint64_t BlockIDDelta = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+
+  Stream.JumpToBit(FunctionIndexBit);
+  BitstreamEntry Entry = Stream.advance();
+  if (Entry.Kind != BitstreamEntry::SubBlock ||
+      Entry.ID != bitc::FUNCTION_INDEX_BLOCK_ID ||
+      Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error("Malformed block");
+
+  SmallVector<uint64_t, 2> Record;
+  unsigned NumIndexed = 0;
+  uint64_t Offset = 0;
+  while (1) {
+    Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      // Every body must be indexed.
+      if (NumIndexed != FunctionsWithBodies.size())
+        return Error("Invalid function index");
+      FunctionsWithBodies.clear();
+      return std::error_code();
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: // Default behavior: ignore.
+      break;
+    case bitc::FUNCTION_INDEX_ENTRY: { // ENTRY: [valueid, offset delta]
+      if (Record.size() < 2 || Record[0] >= ValueList.size())
+        return Error("Invalid record");
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F || !F->isMaterializable())
+        return Error("Invalid record");
+      uint64_t &Position = DeferredFunctionInfo[F];
+      if (Position)
+        return Error("Invalid function index");
+      Offset += Record[1];
+      Position = Offset + BlockIDDelta;
+      ++NumIndexed;
+      break;
+    }
+    }
+  }
+}
+
 std::error_code BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -2768,6 +3127,13 @@ std::error_code BitcodeReader::ParseModule(bool Resume,
           if (std::error_code EC = GlobalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+
+          // Skip all the bodies at once when there is an index of them.
+          if (FunctionIndexBit && !LazyStreamer) {
+            if (std::error_code EC = parseFunctionIndex())
+              return EC;
+            break;
+          }
         }
 
         if (std::error_code EC = RememberAndSkipFunctionBody())
@@ -3070,6 +3436,12 @@ std::error_code BitcodeReader::ParseModule(bool Resume,
         return Error("Invalid record");
       ValueList.shrinkTo(Record[0]);
       break;
+    /// MODULE_CODE_FUNCTION_INDEX: [offset]
+    case bitc::MODULE_CODE_FUNCTION_INDEX:
+      if (Record.size() < 1)
+        return Error("Invalid record");
+      FunctionIndexBit = Record[0] * 32;
+      break;
     }
     Record.clear();
   }
@@ -3226,6 +3598,114 @@ ErrorOr<std::string> BitcodeReader::parseTriple() {
   }
 }
 
+std::error_code
+BitcodeReader::parseFunctionSummaryBlock(FunctionInfoIndex *Index,
+                                         unsigned ModuleID) {
+  if (Stream.EnterSubBlock(bitc::FUNCTION_SUMMARY_BLOCK_ID))
+    return Error("Invalid record");
+
+  SmallVector<uint64_t, 64> Record;
+  std::vector<std::string> Names;
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: // Default behavior: ignore.
+      break;
+    case bitc::FS_CODE_NAME: { // NAME: [strchr x N]
+      std::string Name;
+      if (ConvertToString(Record, 0, Name))
+        return Error("Invalid record");
+      Names.push_back(std::move(Name));
+      break;
+    }
+    case bitc::FS_CODE_ENTRY: {
+      // ENTRY: [nameid, linkage, flags, instcount, n x callee nameid]
+      if (Record.size() < 4 || Record[0] >= Names.size())
+        return Error("Invalid record");
+      for (unsigned I = 4, E = Record.size(); I != E; ++I)
+        if (Record[I] >= Names.size())
+          return Error("Invalid record");
+      if (!Index)
+        break;
+      FunctionSummary Summary(getDecodedLinkage(Record[1]), Record[3],
+                              Record[2] & 1);
+      for (unsigned I = 4, E = Record.size(); I != E; ++I)
+        Summary.addCallee(Names[Record[I]]);
+      Index->addFunctionSummary(Names[Record[0]], ModuleID,
+                                std::move(Summary));
+      break;
+    }
+    }
+  }
+}
+
+ErrorOr<bool> BitcodeReader::parseFunctionSummaries(FunctionInfoIndex *Index,
+                                                    StringRef Path) {
+  if (std::error_code EC = InitStream())
+    return EC;
+
+  // Sniff for the signature.
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return Error("Invalid bitcode signature");
+
+  unsigned ModuleID = Index ? Index->addModule(Path) : 0;
+
+  // Find the module block, then walk its sub-blocks without reading them. The
+  // summary block is emitted ahead of the function bodies.
+  while (1) {
+    BitstreamEntry Entry = Stream.advance();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return Error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return false;
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::MODULE_BLOCK_ID) {
+        if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
+          return Error("Malformed block");
+        continue;
+      }
+      if (Entry.ID == bitc::FUNCTION_SUMMARY_BLOCK_ID) {
+        if (std::error_code EC = parseFunctionSummaryBlock(Index, ModuleID))
+          return EC;
+        return true;
+      }
+      if (Entry.ID == bitc::FUNCTION_BLOCK_ID)
+        return false;
+
+      // Ignore other sub-blocks.
+      if (Stream.SkipBlock())
+        return Error("Malformed block");
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
 /// ParseMetadataAttachment - Parse metadata attachments.
 std::error_code BitcodeReader::ParseMetadataAttachment(Function &F) {
   if (Stream.EnterSubBlock(bitc::METADATA_ATTACHMENT_ID))
@@ -4399,6 +4879,15 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
   if (!F || !F->isMaterializable())
     return std::error_code();
 
+  // The first time a body is needed, parse all of them in parallel if we were
+  // asked to.
+  if (!ParsedBodiesInParallel) {
+    if (std::error_code EC = parseFunctionBodiesInParallel())
+      return EC;
+    if (!F->isMaterializable())
+      return std::error_code();
+  }
+
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
   // If its position is recorded as 0, its body is somewhere in the stream
@@ -4414,10 +4903,22 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
     return EC;
   F->setIsMaterializable(false);
 
+  // Load the metadata the body refers to.
+  if (std::error_code EC = loadLazyMetadata())
+    return EC;
+
   if (StripDebugInfo)
     stripDebugInfo(*F);
 
   // Upgrade any old intrinsic calls in the function.
+  upgradeIntrinsicCalls();
+
+  // Bring in any functions that this function forward-referenced via
+  // blockaddresses.
+  return materializeForwardReferencedFunctions();
+}
+
+void BitcodeReader::upgradeIntrinsicCalls() {
   for (UpgradedIntrinsicMap::iterator I = UpgradedIntrinsics.begin(),
        E = UpgradedIntrinsics.end(); I != E; ++I) {
     if (I->first != I->second) {
@@ -4428,10 +4929,159 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
       }
     }
   }
+}
 
-  // Bring in any functions that this function forward-referenced via
-  // blockaddresses.
-  return materializeForwardReferencedFunctions();
+/// Return the number of threads parsing function bodies.
+static unsigned getMaterializeThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (MaterializeThreads == 0)
+    return std::max(1u, std::thread::hardware_concurrency());
+  return MaterializeThreads;
+#else
+  return 1;
+#endif
+}
+
+/// Parse the bodies of all the functions that are still materializable, with
+/// one worker reader per thread.  Each worker has its own cursor over the
+/// stream and its own value and metadata lists for the function it parses,
+/// layered over the module level lists of this reader, which do not change
+/// meanwhile.  Once all the bodies are parsed, they are handed over to the
+/// module in module order, so that errors and the state of this reader do not
+/// depend on the scheduling.
+///
+/// A body that refers to the blocks of another function through a
+/// blockaddress is discarded by its worker, and so are the functions whose
+/// blocks the module refers to.  These bodies stay materializable and are
+/// parsed serially when they are needed.  Use-list orders of constants and
+/// globals recorded in function blocks are not restored, and the order in
+/// which the uses of such values are created depends on the scheduling.
+std::error_code BitcodeReader::parseFunctionBodiesInParallel() {
+  ParsedBodiesInParallel = true;
+  unsigned NumThreads = getMaterializeThreadCount();
+  // The workers need random access to the whole stream.
+  if (NumThreads < 2 || LazyStreamer)
+    return std::error_code();
+
+  std::vector<Function *> Functions;
+  std::vector<uint64_t> BitPositions;
+  for (Function &F : *TheModule) {
+    if (!F.isMaterializable() || BasicBlockFwdRefs.count(&F))
+      continue;
+    auto DFII = DeferredFunctionInfo.find(&F);
+    if (DFII == DeferredFunctionInfo.end() || !DFII->second)
+      continue;
+    Functions.push_back(&F);
+    BitPositions.push_back(DFII->second);
+  }
+  NumThreads = std::min<size_t>(NumThreads, Functions.size());
+  if (NumThreads < 2)
+    return std::error_code();
+
+  // The workers cannot resolve forward references to module level values or
+  // metadata.  There are none in well-formed bitcode.
+  for (unsigned I = 0, E = ValueList.size(); I != E; ++I)
+    if (!ValueList[I])
+      return std::error_code();
+  for (unsigned I = 0, E = MDValueList.size(); I != E; ++I) {
+    Metadata *MD = MDValueList[I];
+    if (!MD || (isa<MDNode>(MD) && cast<MDNode>(MD)->isTemporary()))
+      return std::error_code();
+  }
+
+  Context.enableMultithreading();
+
+  // Workers report their errors to this reader, which diagnoses the first one
+  // in module order.
+  std::vector<std::string> Messages(NumThreads);
+  std::vector<std::unique_ptr<BitcodeReader>> Workers;
+  for (unsigned I = 0; I != NumThreads; ++I) {
+    std::string &Message = Messages[I];
+    Workers.emplace_back(
+        new BitcodeReader(*this, [&Message](const DiagnosticInfo &DI) {
+          raw_string_ostream OS(Message);
+          DiagnosticPrinterRawOStream DP(OS);
+          DI.print(DP);
+        }));
+  }
+
+  enum BodyState : char { NotParsed, Parsed, NeedsSerialParse, Failed };
+  std::vector<BodyState> States(Functions.size(), NotParsed);
+  std::vector<std::error_code> Errors(Functions.size());
+  std::vector<std::string> ErrorMessages(Functions.size());
+  std::atomic<unsigned> NextBody(0);
+  std::atomic<bool> AnyFailed(false);
+  {
+    // Hand the bodies out one at a time, to balance the load.
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Pool.async([&, I] {
+        BitcodeReader &Worker = *Workers[I];
+        for (unsigned B = NextBody++; B < Functions.size() && !AnyFailed;
+             B = NextBody++) {
+          if (std::error_code EC =
+                  Worker.parseFunctionBodyInWorker(Functions[B],
+                                                   BitPositions[B])) {
+            States[B] = Failed;
+            Errors[B] = EC;
+            ErrorMessages[B] = std::move(Messages[I]);
+            AnyFailed = true;
+            return;
+          }
+          States[B] = Worker.WorkerNeedsSerialParse ? NeedsSerialParse : Parsed;
+        }
+      });
+    Pool.wait();
+  }
+
+  for (auto &Worker : Workers) {
+    InstsWithTBAATag.append(Worker->InstsWithTBAATag.begin(),
+                            Worker->InstsWithTBAATag.end());
+    BlockAddressesTaken.insert(Worker->BlockAddressesTaken.begin(),
+                               Worker->BlockAddressesTaken.end());
+    IdentifiedStructTypes.insert(IdentifiedStructTypes.end(),
+                                 Worker->IdentifiedStructTypes.begin(),
+                                 Worker->IdentifiedStructTypes.end());
+  }
+
+  for (unsigned B = 0, E = Functions.size(); B != E; ++B) {
+    if (States[B] != Parsed)
+      continue;
+    Function *F = Functions[B];
+    F->setIsMaterializable(false);
+    if (StripDebugInfo)
+      stripDebugInfo(*F);
+  }
+  upgradeIntrinsicCalls();
+
+  for (unsigned B = 0, E = Functions.size(); B != E; ++B)
+    if (States[B] == Failed)
+      return ::Error(DiagnosticHandler, Errors[B], ErrorMessages[B]);
+  return std::error_code();
+}
+
+/// Parse the body of F, which starts at BitPos, in a worker reader.
+std::error_code BitcodeReader::parseFunctionBodyInWorker(Function *F,
+                                                         uint64_t BitPos) {
+  assert(IsBodyWorker && "Not a worker");
+  WorkerFunction = F;
+  WorkerNeedsSerialParse = false;
+  unsigned NumTBAATags = InstsWithTBAATag.size();
+
+  Stream.JumpToBit(BitPos);
+  if (std::error_code EC = ParseFunctionBody(F))
+    return EC;
+  assert(BasicBlockFwdRefs.empty() && "Unresolved blockaddress fwd references");
+  BasicBlockFwdRefQueue.clear();
+
+  if (WorkerNeedsSerialParse) {
+    InstsWithTBAATag.resize(NumTBAATags);
+    for (BasicBlock &BB : *F)
+      BB.dropAllReferences();
+    while (!F->empty())
+      F->begin()->eraseFromParent();
+  }
+  return std::error_code();
 }
 
 bool BitcodeReader::isDematerializable(const GlobalValue *GV) const {
@@ -4675,6 +5325,30 @@ llvm::parseBitcodeFile(MemoryBufferRef Buffer, LLVMContext &Context,
   return M;
 }
 
+bool llvm::hasFunctionSummary(MemoryBufferRef Buffer, LLVMContext &Context,
+                              DiagnosticHandlerFunction DiagnosticHandler) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::getMemBuffer(Buffer, false);
+  auto R = llvm::make_unique<BitcodeReader>(Buf.release(), Context,
+                                            DiagnosticHandler);
+  ErrorOr<bool> HasSummary =
+      R->parseFunctionSummaries(nullptr, Buffer.getBufferIdentifier());
+  return HasSummary && HasSummary.get();
+}
+
+ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+llvm::getFunctionInfoIndex(MemoryBufferRef Buffer, LLVMContext &Context,
+                           DiagnosticHandlerFunction DiagnosticHandler) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::getMemBuffer(Buffer, false);
+  auto R = llvm::make_unique<BitcodeReader>(Buf.release(), Context,
+                                            DiagnosticHandler);
+  std::unique_ptr<FunctionInfoIndex> Index(new FunctionInfoIndex());
+  ErrorOr<bool> HasSummary =
+      R->parseFunctionSummaries(Index.get(), Buffer.getBufferIdentifier());
+  if (std::error_code EC = HasSummary.getError())
+    return EC;
+  return std::move(Index);
+}
+
 std::string
 llvm::getBitcodeTargetTriple(MemoryBufferRef Buffer, LLVMContext &Context,
                              DiagnosticHandlerFunction DiagnosticHandler) {
@@ -19,6 +19,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
@@ -479,8 +480,8 @@ static void WriteTypeTable(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
-static unsigned getEncodedLinkage(const GlobalValue &GV) {
-  switch (GV.getLinkage()) {
+static unsigned getEncodedLinkage(GlobalValue::LinkageTypes Linkage) {
+  switch (Linkage) {
   case GlobalValue::ExternalLinkage:
     return 0;
   case GlobalValue::WeakAnyLinkage:
@@ -507,6 +508,10 @@ static unsigned getEncodedLinkage(const GlobalValue &GV) {
   llvm_unreachable("Invalid linkage");
 }
 
+static unsigned getEncodedLinkage(const GlobalValue &GV) {
+  return getEncodedLinkage(GV.getLinkage());
+}
+
 static unsigned getEncodedVisibility(const GlobalValue &GV) {
   switch (GV.getVisibility()) {
   case GlobalValue::DefaultVisibility:   return 0;
@@ -2077,6 +2082,116 @@ static void WriteUseListBlock(const Function *F, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+/// WriteFunctionSummary - Emit the summary of every named function definition
+/// of the module, for use by thin link-time optimization.
+static void WriteFunctionSummary(const Module *M, BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_SUMMARY_BLOCK_ID, 3);
+
+  // NAME: [strchr x N]
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FS_CODE_NAME));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  unsigned NameAbbrev = Stream.EmitAbbrev(Abbv);
+
+  // ENTRY: [nameid, linkage, flags, instcount, n x callee nameid]
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FS_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 5));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 2));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  // Number the names the first time they are referenced, emitting a NAME
+  // record for each.
+  StringMap<unsigned> NameIDs;
+  SmallVector<unsigned, 64> Vals;
+  auto getNameID = [&](StringRef Name) {
+    auto Entry = NameIDs.insert(std::make_pair(Name, NameIDs.size()));
+    if (Entry.second) {
+      Vals.append(Name.begin(), Name.end());
+      Stream.EmitRecord(bitc::FS_CODE_NAME, Vals, NameAbbrev);
+      Vals.clear();
+    }
+    return Entry.first->second;
+  };
+
+  for (const Function &F : *M) {
+    if (F.isDeclaration() || !F.hasName())
+      continue;
+    FunctionSummary Summary = FunctionSummary::compute(F);
+    SmallVector<unsigned, 16> Entry;
+    Entry.push_back(getNameID(F.getName()));
+    Entry.push_back(getEncodedLinkage(Summary.getLinkage()));
+    Entry.push_back(Summary.isEligibleForImport());
+    Entry.push_back(Summary.getInstCount());
+    for (const std::string &Callee : Summary.callees())
+      Entry.push_back(getNameID(Callee));
+    Stream.EmitRecord(bitc::FS_CODE_ENTRY, Entry, EntryAbbrev);
+  }
+
+  Stream.ExitBlock();
+}
+
+/// WriteFunctionIndexOffset - Emit the record giving the position of the
+/// function index, with a placeholder value.  Return the bit position of the
+/// placeholder.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  // The position is only known once the function bodies are written, so it is
+  // a fixed-width field that can be patched.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FUNCTION_INDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned OffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FUNCTION_INDEX, Vals, OffsetAbbrev);
+  uint64_t PlaceholderBit = Stream.GetCurrentBitNo() - 32;
+  Stream.AddPlaceholderWord(PlaceholderBit);
+  return PlaceholderBit;
+}
+
+/// WriteFunctionIndex - Emit the bit offsets of the function bodies, and patch
+/// the position of the index into the record emitted by
+/// WriteFunctionIndexOffset.  Offsets are relative to BitcodeStartBit.
+static void
+WriteFunctionIndex(ArrayRef<std::pair<unsigned, uint64_t>> FunctionOffsets,
+                   uint64_t OffsetPlaceholder, uint64_t BitcodeStartBit,
+                   BitstreamWriter &Stream) {
+  // The index follows a function block, so it is word aligned.
+  uint64_t IndexBit = Stream.GetCurrentBitNo() - BitcodeStartBit;
+  assert((IndexBit & 31) == 0 && "Function index is not 32-bit aligned");
+  Stream.BackpatchWordAt(OffsetPlaceholder, IndexBit / 32);
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  // ENTRY: [valueid, offset]
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FUNCTION_INDEX_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  // The bodies are in order, so each offset is emitted relative to the
+  // previous one, which keeps the records small.
+  SmallVector<uint64_t, 2> Vals;
+  uint64_t PrevOffset = 0;
+  for (const auto &Entry : FunctionOffsets) {
+    assert(Entry.second >= PrevOffset && "Function bodies out of order");
+    Vals.push_back(Entry.first);
+    Vals.push_back(Entry.second - PrevOffset);
+    Stream.EmitRecord(bitc::FUNCTION_INDEX_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+    PrevOffset = Entry.second;
+  }
+
+  Stream.ExitBlock();
+}
+
 /// WriteFunction - Emit a function body to the module stream.
 static void WriteFunction(const Function &F, ValueEnumerator &VE,
                           BitstreamWriter &Stream) {
@@ -2327,7 +2442,9 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
 
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream,
-                        bool ShouldPreserveUseListOrder) {
+                        bool ShouldPreserveUseListOrder,
+                        bool EmitFunctionSummary, bool EmitFunctionIndex,
+                        uint64_t BitcodeStartBit) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -2335,6 +2452,11 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
   Vals.push_back(CurVersion);
   Stream.EmitRecord(bitc::MODULE_CODE_VERSION, Vals);
 
+  // Emit where to find the function index, if there is one.
+  uint64_t FunctionIndexPlaceholder = 0;
+  if (EmitFunctionIndex)
+    FunctionIndexPlaceholder = WriteFunctionIndexOffset(Stream);
+
   // Analyze the module, enumerating globals, functions, etc.
   ValueEnumerator VE(*M, ShouldPreserveUseListOrder);
 
@@ -2372,10 +2494,25 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
   if (VE.shouldPreserveUseListOrder())
     WriteUseListBlock(nullptr, VE, Stream);
 
-  // Emit function bodies.
+  // Emit the function summaries ahead of the bodies, so that readers only
+  // interested in them can stop there.
+  if (EmitFunctionSummary)
+    WriteFunctionSummary(M, Stream);
+
+  // Emit function bodies, noting where they start for the function index.
+  std::vector<std::pair<unsigned, uint64_t>> FunctionOffsets;
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
+    if (!F->isDeclaration()) {
+      if (EmitFunctionIndex)
+        FunctionOffsets.push_back(std::make_pair(
+            VE.getValueID(F), Stream.GetCurrentBitNo() - BitcodeStartBit));
       WriteFunction(*F, VE, Stream);
+    }
+
+  // Without bodies, the index offset is left as zero, meaning no index.
+  if (!FunctionOffsets.empty())
+    WriteFunctionIndex(FunctionOffsets, FunctionIndexPlaceholder,
+                       BitcodeStartBit, Stream);
 
   Stream.ExitBlock();
 }
@@ -2407,8 +2544,8 @@ static void WriteInt32ToBuffer(uint32_t Value, SmallVectorImpl<char> &Buffer,
   Position += 4;
 }
 
-static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
-                                         const Triple &TT) {
+static void EmitDarwinBCHeader(SmallVectorImpl<char> &Buffer,
+                               const Triple &TT, unsigned BCSize) {
   unsigned CPUType = ~0U;
 
   // Match x86_64-*, i[3-9]86-*, powerpc-*, powerpc64-*, arm-*, thumb-*,
@@ -2438,7 +2575,6 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
   assert(Buffer.size() >= DarwinBCHeaderSize &&
          "Expected header size to be reserved");
   unsigned BCOffset = DarwinBCHeaderSize;
-  unsigned BCSize = Buffer.size()-DarwinBCHeaderSize;
 
   // Write the magic and version.
   unsigned Position = 0;
@@ -2447,16 +2583,22 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
   WriteInt32ToBuffer(BCOffset   , Buffer, Position);
   WriteInt32ToBuffer(BCSize     , Buffer, Position);
   WriteInt32ToBuffer(CPUType    , Buffer, Position);
-
-  // If the file is not a multiple of 16 bytes, insert dummy padding.
-  while (Buffer.size() & 15)
-    Buffer.push_back(0);
 }
 
-/// WriteBitcodeToFile - Write the specified module to the specified output
-/// stream.
-void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+/// The size of the bitstream buffered before it is written out, when writing
+/// to a stream that can be patched in place.
+static cl::opt<unsigned> BitcodeFlushThreshold(
+    "bitcode-flush-threshold", cl::init(512), cl::Hidden,
+    cl::desc("The size (in MB) of bitcode buffered before it is written out "
+             "to a seekable file"));
+
+/// writeBitcode - Write the specified module to Out.  If FS is given, it is
+/// the same stream as Out and can be patched in place, so the bitstream is
+/// written out as it is produced rather than buffered whole.
+static void writeBitcode(const Module *M, raw_ostream &Out,
+                         raw_pwrite_stream *FS,
+                         bool ShouldPreserveUseListOrder,
+                         bool EmitFunctionSummary, bool EmitFunctionIndex) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2467,8 +2609,12 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
     Buffer.insert(Buffer.begin(), DarwinBCHeaderSize, 0);
 
   // Emit the module into the buffer.
+  uint64_t FSBase = FS ? FS->tell() : 0;
+  uint64_t FlushedBytes;
   {
-    BitstreamWriter Stream(Buffer);
+    BitstreamWriter Stream(Buffer, FS,
+                           uint64_t(BitcodeFlushThreshold) * 1024 * 1024);
+    uint64_t BitcodeStartBit = Stream.GetCurrentBitNo();
 
     // Emit the file header.
     Stream.Emit((unsigned)'B', 8);
@@ -2479,12 +2625,47 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream, ShouldPreserveUseListOrder);
-  }
+    WriteModule(M, Stream, ShouldPreserveUseListOrder, EmitFunctionSummary,
+                EmitFunctionIndex, BitcodeStartBit);
+    FlushedBytes = Stream.GetNumOfFlushedBytes();
+  }
+
+  // Fill in the header, which is patched in place if it has been written out,
+  // and pad the file out to a multiple of 16 bytes.
+  SmallVector<char, DarwinBCHeaderSize> Header;
+  if (TT.isOSDarwin()) {
+    uint64_t Size = FlushedBytes + Buffer.size();
+    Header.resize(DarwinBCHeaderSize);
+    EmitDarwinBCHeader(Header, TT, Size - DarwinBCHeaderSize);
+    if (!FlushedBytes)
+      std::copy(Header.begin(), Header.end(), Buffer.begin());
+    while (Size++ & 15)
+      Buffer.push_back(0);
+  }
+
+  // Write the rest of the generated bitstream to "Out".
+  Out.write(Buffer.data(), Buffer.size());
+  if (FlushedBytes && !Header.empty())
+    FS->pwrite(Header.data(), Header.size(), FSBase);
+}
 
-  if (TT.isOSDarwin())
-    EmitDarwinBCHeaderAndTrailer(Buffer, TT);
+/// WriteBitcodeToFile - Write the specified module to the specified output
+/// stream.
+void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                              bool ShouldPreserveUseListOrder,
+                              bool EmitFunctionSummary,
+                              bool EmitFunctionIndex) {
+  writeBitcode(M, Out, nullptr, ShouldPreserveUseListOrder,
+               EmitFunctionSummary, EmitFunctionIndex);
+}
 
-  // Write the generated bitstream to "Out".
-  Out.write((char*)&Buffer.front(), Buffer.size());
+void llvm::WriteBitcodeToFile(const Module *M, raw_fd_ostream &Out,
+                              bool ShouldPreserveUseListOrder,
+                              bool EmitFunctionSummary,
+                              bool EmitFunctionIndex) {
+  // Without seeking, block sizes can only be filled in before the blocks are
+  // written out, so the whole bitstream is buffered.
+  writeBitcode(M, Out, Out.supportsSeeking() ? &Out : nullptr,
+               ShouldPreserveUseListOrder, EmitFunctionSummary,
+               EmitFunctionIndex);
 }
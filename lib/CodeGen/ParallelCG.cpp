@@ -0,0 +1,80 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+
+using namespace llvm;
+
+static void
+codegen(Module *M, llvm::raw_pwrite_stream &OS,
+        const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
+        TargetMachine::CodeGenFileType FT) {
+  std::unique_ptr<TargetMachine> TM = TMFactory();
+  legacy::PassManager CodeGenPasses;
+  if (TM->addPassesToEmitFile(CodeGenPasses, OS, FT))
+    report_fatal_error("Failed to setup codegen");
+  CodeGenPasses.run(*M);
+}
+
+void llvm::splitCodeGen(
+    Module &M, ArrayRef<llvm::raw_pwrite_stream *> OSs,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
+    TargetMachine::CodeGenFileType FT, unsigned ThreadCount,
+    bool PreserveLocals) {
+  if (OSs.size() == 1) {
+    codegen(&M, *OSs[0], TMFactory, FT);
+    return;
+  }
+
+  // Partitions are cloned and serialized on this thread, since they share
+  // M's context. Each one is then read back into a private context on a
+  // worker thread, which is the only thread that touches it afterwards.
+  std::vector<SmallString<0>> BCs(OSs.size());
+  ThreadPool Pool(ThreadCount);
+  unsigned I = 0;
+  SplitModule(M, OSs.size(), [&](std::unique_ptr<Module> MPart) {
+    SmallString<0> &BC = BCs[I];
+    raw_pwrite_stream *ThreadOS = OSs[I++];
+    {
+      raw_svector_ostream BCOS(BC);
+      WriteBitcodeToFile(MPart.get(), BCOS);
+    }
+    MPart.reset();
+
+    Pool.async([&BC, ThreadOS, &TMFactory, FT] {
+      LLVMContext Ctx;
+      ErrorOr<Module *> MOrErr =
+          parseBitcodeFile(MemoryBufferRef(BC.str(), "<split-module>"), Ctx);
+      if (!MOrErr)
+        report_fatal_error("Failed to read bitcode");
+      std::unique_ptr<Module> MPartInCtx(MOrErr.get());
+
+      // The bitcode is not needed anymore once it has been parsed.
+      SmallString<0>().swap(BC);
+
+      codegen(MPartInCtx.get(), *ThreadOS, TMFactory, FT);
+    });
+  }, PreserveLocals);
+
+  Pool.wait();
+}
@@ -19,6 +19,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/CallingConv.h"
@@ -35,16 +36,27 @@
 #include "llvm/IR/TypeFinder.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
+#include <thread>
 using namespace llvm;
 
+// Printing the functions of a module on several threads is opt-in.  It
+// switches the context to multithreaded mode.
+static cl::opt<unsigned>
+PrintThreads("asm-print-threads",
+             cl::desc("Number of threads printing the functions of a module "
+                      "as assembly (0 uses all the hardware threads)"),
+             cl::init(1));
+
 // Make virtual table appear in this compilation unit.
 AssemblyAnnotationWriter::~AssemblyAnnotationWriter() {}
 
@@ -575,6 +587,10 @@ private:
   /// asMap - The slot map for attribute sets.
   DenseMap<AttributeSet, unsigned> asMap;
   unsigned asNext;
+
+  /// ModuleSlots - The tracker holding the module level slots, if this one
+  /// only numbers the values local to a function.
+  SlotTracker *ModuleSlots;
 public:
   /// Construct from a module.
   ///
@@ -590,6 +606,13 @@ public:
   /// within a function (even if no functions have been initialized).
   explicit SlotTracker(const Function *F,
                        bool ShouldInitializeAllMetadata = false);
+  /// Construct a tracker for the values local to a function, which gets the
+  /// module level slots from \p ModuleSlots.
+  ///
+  /// \p ModuleSlots must have processed the function bodies already (see
+  /// processFunctionBodies()).  It is then only read, so trackers on
+  /// different threads may share it.
+  explicit SlotTracker(SlotTracker &ModuleSlots);
 
   /// Return the slot number of the specified value in it's type
   /// plane.  If something is not in the SlotTracker, return -1.
@@ -629,6 +652,11 @@ public:
   /// This function does the actual initialization.
   inline void initialize();
 
+  /// Add the metadata and attribute sets used in the bodies of all the
+  /// functions of \p M, in the order incorporating them one after the other
+  /// would.  The module level slots do not change afterwards.
+  void processFunctionBodies(const Module &M);
+
   // Implementation Details
 private:
   /// CreateModuleSlot - Insert the specified GlobalValue* into the slot table.
@@ -656,6 +684,9 @@ private:
   /// Add all of the metadata from an instruction.
   void processInstructionMetadata(const Instruction &I);
 
+  /// Add the function attributes of a call or invoke.
+  void processInstructionAttributes(const Instruction &I);
+
   SlotTracker(const SlotTracker &) = delete;
   void operator=(const SlotTracker &) = delete;
 };
@@ -699,7 +730,7 @@ static SlotTracker *createSlotTracker(const Value *V) {
 SlotTracker::SlotTracker(const Module *M, bool ShouldInitializeAllMetadata)
     : TheModule(M), TheFunction(nullptr), FunctionProcessed(false),
       ShouldInitializeAllMetadata(ShouldInitializeAllMetadata), mNext(0),
-      fNext(0), mdnNext(0), asNext(0) {}
+      fNext(0), mdnNext(0), asNext(0), ModuleSlots(nullptr) {}
 
 // Function level constructor. Causes the contents of the Module and the one
 // function provided to be added to the slot table.
@@ -707,7 +738,14 @@ SlotTracker::SlotTracker(const Function *F, bool ShouldInitializeAllMetadata)
     : TheModule(F ? F->getParent() : nullptr), TheFunction(F),
       FunctionProcessed(false),
       ShouldInitializeAllMetadata(ShouldInitializeAllMetadata), mNext(0),
-      fNext(0), mdnNext(0), asNext(0) {}
+      fNext(0), mdnNext(0), asNext(0), ModuleSlots(nullptr) {}
+
+// Function local constructor. Only the contents of the functions incorporated
+// later are added to the slot table.
+SlotTracker::SlotTracker(SlotTracker &ModuleSlots)
+    : TheModule(nullptr), TheFunction(nullptr), FunctionProcessed(false),
+      ShouldInitializeAllMetadata(false), mNext(0), fNext(0), mdnNext(0),
+      asNext(0), ModuleSlots(&ModuleSlots) {}
 
 inline void SlotTracker::initialize() {
   if (TheModule) {
@@ -770,6 +808,10 @@ void SlotTracker::processFunction() {
     if (!AI->hasName())
       CreateFunctionSlot(AI);
 
+  // The module level slots of the body are in ModuleSlots already.
+  if (!ModuleSlots)
+    processFunctionMetadata(*TheFunction);
+
   ST_DEBUG("Inserting Instructions:\n");
 
   // Add all of the basic blocks and instructions with no names.
@@ -777,25 +819,12 @@ void SlotTracker::processFunction() {
     if (!BB.hasName())
       CreateFunctionSlot(&BB);
 
-    processFunctionMetadata(*TheFunction);
-
     for (auto &I : BB) {
       if (!I.getType()->isVoidTy() && !I.hasName())
         CreateFunctionSlot(&I);
 
-      // We allow direct calls to any llvm.foo function here, because the
-      // target may not be linked into the optimizer.
-      if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
-        // Add all the call attributes to the table.
-        AttributeSet Attrs = CI->getAttributes().getFnAttributes();
-        if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
-          CreateAttributeSetSlot(Attrs);
-      } else if (const InvokeInst *II = dyn_cast<InvokeInst>(&I)) {
-        // Add all the call attributes to the table.
-        AttributeSet Attrs = II->getAttributes().getFnAttributes();
-        if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
-          CreateAttributeSetSlot(Attrs);
-      }
+      if (!ModuleSlots)
+        processInstructionAttributes(I);
     }
   }
 
@@ -804,6 +833,19 @@ void SlotTracker::processFunction() {
   ST_DEBUG("end processFunction!\n");
 }
 
+void SlotTracker::processFunctionBodies(const Module &M) {
+  assert(!ModuleSlots && "Function bodies belong in the module tracker!");
+  initialize();
+
+  for (const Function &F : M) {
+    processFunctionMetadata(F);
+
+    for (auto &BB : F)
+      for (auto &I : BB)
+        processInstructionAttributes(I);
+  }
+}
+
 void SlotTracker::processFunctionMetadata(const Function &F) {
   SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
   for (auto &BB : F) {
@@ -833,6 +875,22 @@ void SlotTracker::processInstructionMetadata(const Instruction &I) {
     CreateMetadataSlot(MD.second);
 }
 
+void SlotTracker::processInstructionAttributes(const Instruction &I) {
+  // We allow direct calls to any llvm.foo function here, because the
+  // target may not be linked into the optimizer.
+  if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+    // Add all the call attributes to the table.
+    AttributeSet Attrs = CI->getAttributes().getFnAttributes();
+    if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
+      CreateAttributeSetSlot(Attrs);
+  } else if (const InvokeInst *II = dyn_cast<InvokeInst>(&I)) {
+    // Add all the call attributes to the table.
+    AttributeSet Attrs = II->getAttributes().getFnAttributes();
+    if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
+      CreateAttributeSetSlot(Attrs);
+  }
+}
+
 /// Clean up after incorporating a function. This is the only way to get out of
 /// the function incorporation state that affects get*Slot/Create*Slot. Function
 /// incorporation state is indicated by TheFunction != 0.
@@ -846,6 +904,9 @@ void SlotTracker::purgeFunction() {
 
 /// getGlobalSlot - Get the slot number of a global value.
 int SlotTracker::getGlobalSlot(const GlobalValue *V) {
+  if (ModuleSlots)
+    return ModuleSlots->getGlobalSlot(V);
+
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
@@ -856,6 +917,9 @@ int SlotTracker::getGlobalSlot(const GlobalValue *V) {
 
 /// getMetadataSlot - Get the slot number of a MDNode.
 int SlotTracker::getMetadataSlot(const MDNode *N) {
+  if (ModuleSlots)
+    return ModuleSlots->getMetadataSlot(N);
+
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
@@ -877,6 +941,9 @@ int SlotTracker::getLocalSlot(const Value *V) {
 }
 
 int SlotTracker::getAttributeGroupSlot(AttributeSet AS) {
+  if (ModuleSlots)
+    return ModuleSlots->getAttributeGroupSlot(AS);
+
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
@@ -1945,7 +2012,8 @@ class AssemblyWriter {
   const Module *TheModule;
   std::unique_ptr<SlotTracker> ModuleSlotTracker;
   SlotTracker &Machine;
-  TypePrinting TypePrinter;
+  std::unique_ptr<TypePrinting> ModuleTypePrinter;
+  TypePrinting &TypePrinter;
   AssemblyAnnotationWriter *AnnotationWriter;
   SetVector<const Comdat *> Comdats;
   bool ShouldPreserveUseListOrder;
@@ -1993,8 +2061,16 @@ public:
   void printUseLists(const Function *F);
 
 private:
+  /// Construct an AssemblyWriter for the functions of the module \p Parent
+  /// prints, sharing its type numbering.
+  AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
+                 AssemblyWriter &Parent);
+
   void init();
 
+  /// \brief Print out the functions of \p M on several threads.
+  void printFunctionsInParallel(const Module *M, unsigned NumThreads);
+
   /// \brief Print out metadata attachments.
   void printMetadataAttachments(
       const SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDs,
@@ -2025,7 +2101,8 @@ void AssemblyWriter::init() {
 AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
                                const Module *M, AssemblyAnnotationWriter *AAW,
                                bool ShouldPreserveUseListOrder)
-    : Out(o), TheModule(M), Machine(Mac), AnnotationWriter(AAW),
+    : Out(o), TheModule(M), Machine(Mac), ModuleTypePrinter(new TypePrinting),
+      TypePrinter(*ModuleTypePrinter), AnnotationWriter(AAW),
       ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
   init();
 }
@@ -2034,11 +2111,18 @@ AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, const Module *M,
                                AssemblyAnnotationWriter *AAW,
                                bool ShouldPreserveUseListOrder)
     : Out(o), TheModule(M), ModuleSlotTracker(createSlotTracker(M)),
-      Machine(*ModuleSlotTracker), AnnotationWriter(AAW),
+      Machine(*ModuleSlotTracker), ModuleTypePrinter(new TypePrinting),
+      TypePrinter(*ModuleTypePrinter), AnnotationWriter(AAW),
       ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
   init();
 }
 
+AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
+                               AssemblyWriter &Parent)
+    : Out(o), TheModule(Parent.TheModule), Machine(Mac),
+      TypePrinter(Parent.TypePrinter), AnnotationWriter(nullptr),
+      ShouldPreserveUseListOrder(Parent.ShouldPreserveUseListOrder) {}
+
 void AssemblyWriter::writeOperand(const Value *Operand, bool PrintType) {
   if (!Operand) {
     Out << "<null operand!>";
@@ -2120,6 +2204,17 @@ void AssemblyWriter::writeParamOperand(const Value *Operand,
   WriteAsOperandInternal(Out, Operand, &TypePrinter, &Machine, TheModule);
 }
 
+/// Return the number of threads printing the functions of a module.
+static unsigned getPrintThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (PrintThreads == 0)
+    return std::max(1u, std::thread::hardware_concurrency());
+  return PrintThreads;
+#else
+  return 1;
+#endif
+}
+
 void AssemblyWriter::printModule(const Module *M) {
   Machine.initialize();
 
@@ -2189,9 +2284,14 @@ void AssemblyWriter::printModule(const Module *M) {
   // Output global use-lists.
   printUseLists(nullptr);
 
-  // Output all of the functions.
-  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
-    printFunction(I);
+  // Output all of the functions.  Annotations are up to the client, which may
+  // not expect them to be requested from several threads.
+  unsigned NumThreads = getPrintThreadCount();
+  if (NumThreads > 1 && !AnnotationWriter)
+    printFunctionsInParallel(M, NumThreads);
+  else
+    for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+      printFunction(I);
   assert(UseListOrders.empty() && "All use-lists should have been consumed");
 
   // Output all attribute groups.
@@ -2214,6 +2314,65 @@ void AssemblyWriter::printModule(const Module *M) {
   }
 }
 
+/// Print every function of M into a buffer of its own on a pool of NumThreads
+/// threads, and write the buffers out in the order of the module.
+///
+/// The module level slots and the type numbering are complete before the
+/// workers start, and the workers only read them.  The values local to each
+/// function are numbered by a SlotTracker of its own, so the output is the
+/// same as printing the functions one after the other.
+void AssemblyWriter::printFunctionsInParallel(const Module *M,
+                                              unsigned NumThreads) {
+  // Number the metadata and attribute groups of the bodies in the order the
+  // serial printer would run into them.
+  Machine.processFunctionBodies(*M);
+  M->getContext().enableMultithreading();
+
+  struct PrintJob {
+    const Function *F;
+    UseListOrderStack UseListOrders;
+    std::string Text;
+    std::shared_future<void> Done;
+  };
+  std::vector<PrintJob> Jobs(M->size());
+  unsigned NextJob = 0;
+  for (const Function &F : *M)
+    Jobs[NextJob++].F = &F;
+
+  ThreadPool Pool(NumThreads);
+  auto Launch = [&](PrintJob &Job) {
+    // The use-list orders of the function are on top of the stack, in the
+    // order they are printed in.
+    auto I = UseListOrders.end();
+    while (I != UseListOrders.begin() && std::prev(I)->F == Job.F)
+      --I;
+    std::move(I, UseListOrders.end(), std::back_inserter(Job.UseListOrders));
+    UseListOrders.erase(I, UseListOrders.end());
+
+    Job.Done = Pool.async([this, &Job] {
+      raw_string_ostream OS(Job.Text);
+      formatted_raw_ostream FOS(OS);
+      SlotTracker FunctionSlots(Machine);
+      AssemblyWriter W(FOS, FunctionSlots, *this);
+      W.UseListOrders = std::move(Job.UseListOrders);
+      W.printFunction(Job.F);
+    });
+  };
+
+  // Keep a few functions per thread in flight, so that only a few buffers
+  // wait to be written out at any time.
+  size_t Window = 4 * NumThreads;
+  for (size_t I = 0, E = std::min(Window, Jobs.size()); I != E; ++I)
+    Launch(Jobs[I]);
+  for (size_t I = 0, E = Jobs.size(); I != E; ++I) {
+    if (I + Window < E)
+      Launch(Jobs[I + Window]);
+    Jobs[I].Done.wait();
+    Out << Jobs[I].Text;
+    std::string().swap(Jobs[I].Text);
+  }
+}
+
 void AssemblyWriter::printNamedMDNode(const NamedMDNode *NMD) {
   Out << '!';
   StringRef Name = NMD->getName();
@@ -38,6 +38,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
   ID.AddInteger(Kind);
   if (Val) ID.AddInteger(Val);
 
+  ContextLock Lock(*pImpl, pImpl->AttributesLock);
   void *InsertPoint;
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -61,6 +62,7 @@ Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   ID.AddString(Kind);
   if (!Val.empty()) ID.AddString(Val);
 
+  ContextLock Lock(*pImpl, pImpl->AttributesLock);
   void *InsertPoint;
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -465,6 +467,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
          E = SortedAttrs.end(); I != E; ++I)
     I->Profile(ID);
 
+  ContextLock Lock(*pImpl, pImpl->AttributesLock);
   void *InsertPoint;
   AttributeSetNode *PA =
     pImpl->AttrsSetNodes.FindNodeOrInsertPos(ID, InsertPoint);
@@ -599,6 +602,7 @@ AttributeSet::getImpl(LLVMContext &C,
   FoldingSetNodeID ID;
   AttributeSetImpl::Profile(ID, Attrs);
 
+  ContextLock Lock(*pImpl, pImpl->AttributesLock);
   void *InsertPoint;
   AttributeSetImpl *PA = pImpl->AttrsLists.FindNodeOrInsertPos(ID, InsertPoint);
 
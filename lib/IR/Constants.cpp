@@ -517,6 +517,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 }
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
+  // In multithreaded mode, TheTrueVal was created beforehand.
   LLVMContextImpl *pImpl = Context.pImpl;
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
@@ -524,6 +525,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 }
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
+  // In multithreaded mode, TheFalseVal was created beforehand.
   LLVMContextImpl *pImpl = Context.pImpl;
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
@@ -558,7 +560,9 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
-  ConstantInt *&Slot = pImpl->IntConstants[V];
+  unsigned Shard = LLVMContextImpl::getIntConstantShard(V);
+  ContextLock Lock(*pImpl, pImpl->IntConstantsLocks[Shard]);
+  ConstantInt *&Slot = pImpl->IntConstants[Shard][V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
     IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
@@ -697,6 +701,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
 
   ConstantFP *&Slot = pImpl->FPConstants[V];
 
@@ -852,7 +857,9 @@ ConstantArray::ConstantArray(ArrayType *T, ArrayRef<Constant *> V)
 Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(Ty, V))
     return C;
-  return Ty->getContext().pImpl->ArrayConstants.getOrCreate(Ty, V);
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  return pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 Constant *ConstantArray::getImpl(ArrayType *Ty, ArrayRef<Constant*> V) {
   // Empty arrays are canonicalized to ConstantAggregateZero.
@@ -1009,7 +1016,9 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
-  return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
+  LLVMContextImpl *pImpl = ST->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  return pImpl->StructConstants.getOrCreate(ST, V);
 }
 
 Constant *ConstantStruct::get(StructType *T, ...) {
@@ -1037,7 +1046,9 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(V))
     return C;
   VectorType *Ty = VectorType::get(V.front()->getType(), V.size());
-  return Ty->getContext().pImpl->VectorConstants.getOrCreate(Ty, V);
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  return pImpl->VectorConstants.getOrCreate(Ty, V);
 }
 Constant *ConstantVector::getImpl(ArrayRef<Constant*> V) {
   assert(!V.empty() && "Vectors can't be empty");
@@ -1357,7 +1368,9 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
-  ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  ConstantAggregateZero *&Entry = pImpl->CAZConstants[Ty];
   if (!Entry)
     Entry = new ConstantAggregateZero(Ty);
 
@@ -1367,14 +1380,22 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
-  getContext().pImpl->CAZConstants.erase(getType());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->CAZConstants.erase(getType());
+  }
   destroyConstantImpl();
 }
 
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
-  getType()->getContext().pImpl->ArrayConstants.remove(this);
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->ArrayConstants.remove(this);
+  }
   destroyConstantImpl();
 }
 
@@ -1385,14 +1406,22 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
-  getType()->getContext().pImpl->StructConstants.remove(this);
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->StructConstants.remove(this);
+  }
   destroyConstantImpl();
 }
 
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
-  getType()->getContext().pImpl->VectorConstants.remove(this);
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->VectorConstants.remove(this);
+  }
   destroyConstantImpl();
 }
 
@@ -1437,7 +1466,9 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
-  ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  ConstantPointerNull *&Entry = pImpl->CPNConstants[Ty];
   if (!Entry)
     Entry = new ConstantPointerNull(Ty);
 
@@ -1447,7 +1478,11 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
-  getContext().pImpl->CPNConstants.erase(getType());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->CPNConstants.erase(getType());
+  }
   // Free the constant and any dangling references to it.
   destroyConstantImpl();
 }
@@ -1457,7 +1492,9 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
-  UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  UndefValue *&Entry = pImpl->UVConstants[Ty];
   if (!Entry)
     Entry = new UndefValue(Ty);
 
@@ -1468,7 +1505,11 @@ UndefValue *UndefValue::get(Type *Ty) {
 //
 void UndefValue::destroyConstant() {
   // Free the constant and any dangling references to it.
-  getContext().pImpl->UVConstants.erase(getType());
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->UVConstants.erase(getType());
+  }
   destroyConstantImpl();
 }
 
@@ -1481,8 +1522,9 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
-  BlockAddress *&BA =
-    F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  BlockAddress *&BA = pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (!BA)
     BA = new BlockAddress(F, BB);
 
@@ -1504,8 +1546,9 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
-  BlockAddress *BA =
-      F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  BlockAddress *BA = pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
   return BA;
 }
@@ -1513,8 +1556,12 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
-  getFunction()->getType()->getContext().pImpl
-    ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->BlockAddresses.erase(
+        std::make_pair(getFunction(), getBasicBlock()));
+  }
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
   destroyConstantImpl();
 }
@@ -1532,8 +1579,9 @@ void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
 
   // See if the 'new' entry already exists, if not, just update this in place
   // and return early.
-  BlockAddress *&NewBA =
-    getContext().pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  BlockAddress *&NewBA = pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
   if (NewBA) {
     replaceUsesOfWithOnConstantImpl(NewBA);
     return;
@@ -1543,8 +1591,7 @@ void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
 
   // Remove the old entry, this can't cause the map to rehash (just a
   // tombstone will get added).
-  getContext().pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
-                                                          getBasicBlock()));
+  pImpl->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   NewBA = this;
   setOperand(0, NewF);
   setOperand(1, NewBB);
@@ -1571,6 +1618,7 @@ static Constant *getFoldedCast(Instruction::CastOps opc, Constant *C, Type *Ty,
   // Look up the constant in the table first to ensure uniqueness.
   ConstantExprKeyType Key(opc, C);
 
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
 
@@ -1928,6 +1976,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ConstantExprKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -2009,6 +2058,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2,
   ConstantExprKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -2054,6 +2104,7 @@ Constant *ConstantExpr::getGetElementPtr(Type *Ty, Constant *C,
                                 Ty);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2079,6 +2130,7 @@ Constant *ConstantExpr::getICmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2103,6 +2155,7 @@ Constant *ConstantExpr::getFCmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2125,6 +2178,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx,
   const ConstantExprKeyType Key(Instruction::ExtractElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2148,6 +2202,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ConstantExprKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -2171,6 +2226,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ConstantExprKeyType Key(Instruction::ShuffleVector, ArgVec);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2195,6 +2251,7 @@ Constant *ConstantExpr::getInsertValue(Constant *Agg, Constant *Val,
   const ConstantExprKeyType Key(Instruction::InsertValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2219,6 +2276,7 @@ Constant *ConstantExpr::getExtractValue(Constant *Agg, ArrayRef<unsigned> Idxs,
   const ConstantExprKeyType Key(Instruction::ExtractValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2373,7 +2431,11 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
-  getType()->getContext().pImpl->ExprConstants.remove(this);
+  {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+    pImpl->ExprConstants.remove(this);
+  }
   destroyConstantImpl();
 }
 
@@ -2471,10 +2533,10 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
   auto &Slot =
-      *Ty->getContext()
-           .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
-           .first;
+      *pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr)).first;
 
   // The bucket can point to a linked list of different CDS's that have the same
   // body but different types.  For example, 0,0,0,1 could be a 4 element array
@@ -2497,8 +2559,9 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 
 void ConstantDataSequential::destroyConstant() {
   // Remove the constant from the StringMap.
-  StringMap<ConstantDataSequential*> &CDSConstants = 
-    getType()->getContext().pImpl->CDSConstants;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  StringMap<ConstantDataSequential*> &CDSConstants = pImpl->CDSConstants;
 
   StringMap<ConstantDataSequential*>::iterator Slot =
     CDSConstants.find(getRawDataValues());
@@ -2512,7 +2575,7 @@ void ConstantDataSequential::destroyConstant() {
     // If there is only one value in the bucket (common case) it must be this
     // entry, and removing the entry should remove the bucket completely.
     assert((*Entry) == this && "Hash mismatch in ConstantDataSequential");
-    getContext().pImpl->CDSConstants.erase(Slot);
+    CDSConstants.erase(Slot);
   } else {
     // Otherwise, there are multiple entries linked off the bucket, unlink the 
     // node we care about but keep the bucket around.
@@ -2877,7 +2940,9 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
   }
 
   // Update to the new value.
-  if (Constant *C = getContext().pImpl->ArrayConstants.replaceOperandsInPlace(
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  if (Constant *C = pImpl->ArrayConstants.replaceOperandsInPlace(
           Values, this, From, ToC, NumUpdated, U - OperandList))
     replaceUsesOfWithOnConstantImpl(C);
 }
@@ -2927,7 +2992,9 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
   }
 
   // Update to the new value.
-  if (Constant *C = getContext().pImpl->StructConstants.replaceOperandsInPlace(
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  if (Constant *C = pImpl->StructConstants.replaceOperandsInPlace(
           Values, this, From, ToC))
     replaceUsesOfWithOnConstantImpl(C);
 }
@@ -2955,7 +3022,9 @@ void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
   }
 
   // Update to the new value.
-  if (Constant *C = getContext().pImpl->VectorConstants.replaceOperandsInPlace(
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  if (Constant *C = pImpl->VectorConstants.replaceOperandsInPlace(
           Values, this, From, ToC, NumUpdated, U - OperandList))
     replaceUsesOfWithOnConstantImpl(C);
 }
@@ -2983,7 +3052,9 @@ void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
   }
 
   // Update to the new value.
-  if (Constant *C = getContext().pImpl->ExprConstants.replaceOperandsInPlace(
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  if (Constant *C = pImpl->ExprConstants.replaceOperandsInPlace(
           NewOps, this, From, To, NumUpdated, U - OperandList))
     replaceUsesOfWithOnConstantImpl(C);
 }
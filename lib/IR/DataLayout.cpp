@@ -17,6 +17,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/DataLayout.h"
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
@@ -549,6 +550,10 @@ DataLayout::~DataLayout() {
 }
 
 const StructLayout *DataLayout::getStructLayout(StructType *Ty) const {
+  // Function passes running concurrently share the DataLayout of their
+  // module, the layout cache is guarded like the type tables.
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
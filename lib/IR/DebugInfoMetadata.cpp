@@ -46,6 +46,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   adjustColumn(Column);
 
   assert(Scope && "Expected scope");
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   if (Storage == Uniqued) {
     if (auto *N =
             getUniqued(Context.pImpl->DILocations,
@@ -80,7 +81,9 @@ unsigned DILocation::computeNewDiscriminator() const {
   // AddDiscriminators::runOnFunction(), where it doesn't pollute the
   // LLVMContext.
   std::pair<const char *, unsigned> Key(getFilename().data(), getLine());
-  return ++getContext().pImpl->DiscriminatorTable[Key];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  return ++pImpl->DiscriminatorTable[Key];
 }
 
 unsigned DINode::getFlag(StringRef Flag) {
@@ -172,6 +175,7 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
                                       MDString *Header,
                                       ArrayRef<Metadata *> DwarfOps,
                                       StorageType Storage, bool ShouldCreate) {
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     GenericDINodeInfo::KeyTy Key(Tag, getString(Header), DwarfOps);
@@ -199,6 +203,7 @@ void GenericDINode::recalculateHash() {
 #define UNWRAP_ARGS_IMPL(...) __VA_ARGS__
 #define UNWRAP_ARGS(ARGS) UNWRAP_ARGS_IMPL ARGS
 #define DEFINE_GETIMPL_LOOKUP(CLASS, ARGS)                                     \
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);               \
   do {                                                                         \
     if (Storage == Uniqued) {                                                  \
       if (auto *N = getUniqued(Context.pImpl->CLASS##s,                        \
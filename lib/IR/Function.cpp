@@ -259,8 +259,11 @@ Function::Function(FunctionType *Ty, LinkageTypes Linkage, const Twine &name,
   if (Ty->getNumParams())
     setValueSubclassData(1);   // Set the "has lazy arguments" bit.
 
-  if (ParentModule)
+  if (ParentModule) {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->GlobalsLock);
     ParentModule->getFunctionList().push_back(this);
+  }
 
   // Ensure intrinsics have the right parameter attributes.
   if (unsigned IID = getIntrinsicID())
@@ -279,8 +282,11 @@ Function::~Function() {
   clearGC();
 
   // Remove the intrinsicID from the Cache.
-  if (getValueName() && isIntrinsic())
-    getContext().pImpl->IntrinsicIDCache.erase(this);
+  if (getValueName() && isIntrinsic()) {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+    pImpl->IntrinsicIDCache.erase(this);
+  }
 }
 
 void Function::BuildLazyArguments() const {
@@ -443,8 +449,10 @@ unsigned Function::getIntrinsicID() const {
   if (!ValName || !isIntrinsic())
     return 0;
 
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
   LLVMContextImpl::IntrinsicIDCacheTy &IntrinsicIDCache =
-    getContext().pImpl->IntrinsicIDCache;
+    pImpl->IntrinsicIDCache;
   if (!IntrinsicIDCache.count(this)) {
     unsigned Id = lookupIntrinsicID();
     IntrinsicIDCache[this]=Id;
@@ -920,8 +928,9 @@ bool Function::callsFunctionThatReturnsTwice() const {
 
 Constant *Function::getPrefixData() const {
   assert(hasPrefixData());
-  const LLVMContextImpl::PrefixDataMapTy &PDMap =
-      getContext().pImpl->PrefixDataMap;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  const LLVMContextImpl::PrefixDataMapTy &PDMap = pImpl->PrefixDataMap;
   assert(PDMap.find(this) != PDMap.end());
   return cast<Constant>(PDMap.find(this)->second->getReturnValue());
 }
@@ -931,7 +940,9 @@ void Function::setPrefixData(Constant *PrefixData) {
     return;
 
   unsigned SCData = getSubclassDataFromValue();
-  LLVMContextImpl::PrefixDataMapTy &PDMap = getContext().pImpl->PrefixDataMap;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  LLVMContextImpl::PrefixDataMapTy &PDMap = pImpl->PrefixDataMap;
   ReturnInst *&PDHolder = PDMap[this];
   if (PrefixData) {
     if (PDHolder)
@@ -949,8 +960,9 @@ void Function::setPrefixData(Constant *PrefixData) {
 
 Constant *Function::getPrologueData() const {
   assert(hasPrologueData());
-  const LLVMContextImpl::PrologueDataMapTy &SOMap =
-      getContext().pImpl->PrologueDataMap;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  const LLVMContextImpl::PrologueDataMapTy &SOMap = pImpl->PrologueDataMap;
   assert(SOMap.find(this) != SOMap.end());
   return cast<Constant>(SOMap.find(this)->second->getReturnValue());
 }
@@ -960,7 +972,9 @@ void Function::setPrologueData(Constant *PrologueData) {
     return;
 
   unsigned PDData = getSubclassDataFromValue();
-  LLVMContextImpl::PrologueDataMapTy &PDMap = getContext().pImpl->PrologueDataMap;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  LLVMContextImpl::PrologueDataMapTy &PDMap = pImpl->PrologueDataMap;
   ReturnInst *&PDHolder = PDMap[this];
   if (PrologueData) {
     if (PDHolder)
@@ -0,0 +1,131 @@
+//===-- FunctionInfo.cpp - Function summary index -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the computation of function summaries and the function
+// summary index used by thin link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+using namespace llvm;
+
+/// Return true if a copy of a function referring to \p GV can be placed in
+/// another module.
+static bool canReferenceFromOtherModule(const GlobalValue *GV) {
+  if (GV->hasLocalLinkage())
+    return false;
+  // The defining module may drop a discardable definition that it does not
+  // use itself, leaving the copy with an unresolved reference.
+  return GV->isDeclaration() || !GV->isDiscardableIfUnused();
+}
+
+FunctionSummary FunctionSummary::compute(const Function &F) {
+  assert(!F.isDeclaration() && "Cannot summarize a declaration!");
+  unsigned InstCount = 0;
+  bool IsEligibleForImport =
+      F.hasExternalLinkage() && !F.hasFnAttribute(Attribute::NoInline);
+  SmallVector<const Function *, 8> Callees;
+  SmallPtrSet<const Function *, 8> SeenCallees;
+  SmallVector<const Constant *, 8> Worklist;
+  SmallPtrSet<const Constant *, 16> SeenConstants;
+
+  for (const Instruction &I : inst_range(&F)) {
+    if (isa<DbgInfoIntrinsic>(I))
+      continue;
+    ++InstCount;
+
+    if (ImmutableCallSite CS = ImmutableCallSite(&I))
+      if (const Function *Callee = dyn_cast<Function>(
+              CS.getCalledValue()->stripPointerCasts()))
+        if (Callee->hasName() && !Callee->isIntrinsic() &&
+            SeenCallees.insert(Callee).second)
+          Callees.push_back(Callee);
+
+    if (!IsEligibleForImport)
+      continue;
+    for (const Value *Op : I.operands())
+      if (const Constant *C = dyn_cast<Constant>(Op))
+        if (SeenConstants.insert(C).second)
+          Worklist.push_back(C);
+    while (!Worklist.empty() && IsEligibleForImport) {
+      const Constant *C = Worklist.pop_back_val();
+      if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+        IsEligibleForImport = canReferenceFromOtherModule(GV);
+        continue;
+      }
+      // Block addresses tie the body to its original function.
+      if (isa<BlockAddress>(C)) {
+        IsEligibleForImport = false;
+        continue;
+      }
+      for (const Value *Op : C->operands())
+        if (SeenConstants.insert(cast<Constant>(Op)).second)
+          Worklist.push_back(cast<Constant>(Op));
+    }
+    Worklist.clear();
+  }
+
+  FunctionSummary Summary(F.getLinkage(), InstCount, IsEligibleForImport);
+  for (const Function *Callee : Callees)
+    Summary.addCallee(Callee->getName());
+  return Summary;
+}
+
+unsigned FunctionInfoIndex::addModule(StringRef Path) {
+  ModulePaths.push_back(Path);
+  ModuleFunctions.emplace_back();
+  return ModulePaths.size() - 1;
+}
+
+void FunctionInfoIndex::addFunctionSummary(StringRef Name, unsigned ModuleID,
+                                           FunctionSummary Summary) {
+  assert(ModuleID < getNumModules() && "Unknown module!");
+  auto &Entry = *FunctionMap.insert(
+      std::make_pair(Name, std::vector<FunctionInfo>())).first;
+  Entry.getValue().emplace_back(ModuleID, std::move(Summary));
+  ModuleFunctions[ModuleID].push_back(Entry.getKey());
+}
+
+void FunctionInfoIndex::mergeFrom(const FunctionInfoIndex &Other) {
+  unsigned FirstModuleID = getNumModules();
+  for (unsigned I = 0, E = Other.getNumModules(); I != E; ++I)
+    addModule(Other.getModulePath(I));
+  for (unsigned I = 0, E = Other.getNumModules(); I != E; ++I)
+    for (StringRef Name : Other.getModuleFunctions(I))
+      for (const FunctionInfo &Info : Other.findFunctionInfoList(Name))
+        if (Info.ModuleID == I)
+          addFunctionSummary(Name, FirstModuleID + I, Info.Summary);
+}
+
+ArrayRef<FunctionInfo>
+FunctionInfoIndex::findFunctionInfoList(StringRef Name) const {
+  auto I = FunctionMap.find(Name);
+  if (I == FunctionMap.end())
+    return None;
+  return I->getValue();
+}
+
+std::unique_ptr<FunctionInfoIndex> FunctionInfoIndex::build(const Module &M,
+                                                            StringRef Path) {
+  std::unique_ptr<FunctionInfoIndex> Index(new FunctionInfoIndex());
+  unsigned ModuleID = Index->addModule(Path);
+  for (const Function &F : M)
+    if (!F.isDeclaration() && F.hasName())
+      Index->addFunctionSummary(F.getName(), ModuleID,
+                                FunctionSummary::compute(F));
+  return Index;
+}
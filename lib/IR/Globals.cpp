@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/GlobalValue.h"
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -173,6 +174,8 @@ GlobalVariable::GlobalVariable(Module &M, Type *Ty, bool constant,
     Op<0>() = InitVal;
   }
 
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->GlobalsLock);
   if (Before)
     Before->getParent()->getGlobalList().insert(Before, this);
   else
@@ -31,7 +31,9 @@ InlineAsm *InlineAsm::get(FunctionType *Ty, StringRef AsmString,
   InlineAsmKeyType Key(AsmString, Constraints, hasSideEffects, isAlignStack,
                        asmDialect);
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
-  return pImpl->InlineAsms.getOrCreate(PointerType::getUnqual(Ty), Key);
+  PointerType *PTy = PointerType::getUnqual(Ty);
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  return pImpl->InlineAsms.getOrCreate(PTy, Key);
 }
 
 InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
@@ -48,7 +50,9 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
-  getType()->getContext().pImpl->InlineAsms.remove(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->ConstantsLock);
+  pImpl->InlineAsms.remove(this);
   delete this;
 }
 
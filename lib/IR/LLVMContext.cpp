@@ -97,13 +97,28 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
 LLVMContext::~LLVMContext() { delete pImpl; }
 
 void LLVMContext::addModule(Module *M) {
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
   pImpl->OwnedModules.insert(M);
 }
 
 void LLVMContext::removeModule(Module *M) {
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
   pImpl->OwnedModules.erase(M);
 }
 
+void LLVMContext::enableMultithreading() {
+  if (pImpl->Multithreaded)
+    return;
+  // Create the constants that are otherwise created on first use, so that
+  // threads don't race to create them.
+  ConstantInt::getTrue(*this);
+  ConstantInt::getFalse(*this);
+  Value::HasMultithreadedContexts = true;
+  pImpl->Multithreaded = true;
+}
+
+bool LLVMContext::isMultithreaded() const { return pImpl->Multithreaded; }
+
 //===----------------------------------------------------------------------===//
 // Recoverable Backend Errors
 //===----------------------------------------------------------------------===//
@@ -235,6 +250,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
          "Named metadata may not start with a digit");
 
   // If this is new, assign it its ID.
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
   return pImpl->CustomMDKindNames.insert(std::make_pair(
                                              Name,
                                              pImpl->CustomMDKindNames.size()))
@@ -244,6 +260,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
@@ -20,7 +20,7 @@
 using namespace llvm;
 
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-  : TheTrueVal(nullptr), TheFalseVal(nullptr),
+  : Multithreaded(false), TheTrueVal(nullptr), TheFalseVal(nullptr),
     VoidTy(C, Type::VoidTyID),
     LabelTy(C, Type::LabelTyID),
     HalfTy(C, Type::HalfTyID),
@@ -68,6 +68,9 @@ struct DropFirst {
 }
 
 LLVMContextImpl::~LLVMContextImpl() {
+  // The context is only destroyed once no other thread uses it.
+  Multithreaded = false;
+
   // NOTE: We need to delete the contents of OwnedModules, but Module's dtor
   // will call LLVMContextImpl::removeModule, thus invalidating iterators into
   // the container. Avoid iterators during this operation:
@@ -114,7 +117,8 @@ LLVMContextImpl::~LLVMContextImpl() {
   DeleteContainerSeconds(CPNConstants);
   DeleteContainerSeconds(UVConstants);
   InlineAsms.freeConstants();
-  DeleteContainerSeconds(IntConstants);
+  for (IntMapTy &Shard : IntConstants)
+    DeleteContainerSeconds(Shard);
   DeleteContainerSeconds(FPConstants);
   
   for (StringMap<ConstantDataSequential*>::iterator I = CDSConstants.begin(),
@@ -32,6 +32,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Mutex.h"
 #include <vector>
 
 namespace llvm {
@@ -892,6 +893,60 @@ public:
 
 class LLVMContextImpl {
 public:
+  /// \name Multithreaded mode
+  ///
+  /// Once LLVMContext::enableMultithreading() has been called, the tables of
+  /// the context are guarded by the mutexes below, which are taken with a
+  /// ContextLock. A thread may hold the GlobalsLock when it takes any other
+  /// lock, the ValueHandlesLock when it takes one of the remaining locks, and
+  /// any lock when it takes a use list or value name lock, but never the
+  /// other way around.
+  /// @{
+  bool Multithreaded;
+
+  /// Number of shards of the tables that are split to reduce contention.
+  static const unsigned NumLockShards = 16;
+
+  /// Guards the shards of IntConstants.
+  sys::Mutex IntConstantsLocks[NumLockShards];
+  /// Guards the use lists of the values shared between functions, selected
+  /// by getUseListLock().
+  sys::Mutex UseListLocks[NumLockShards];
+  /// Guards the shards of ValueNames.
+  sys::Mutex ValueNamesLocks[NumLockShards];
+  /// Guards the type tables, TypeAllocator and the struct layout caches of
+  /// DataLayout.
+  sys::Mutex TypesLock;
+  /// Guards the other constant tables, FPConstants to InlineAsms.
+  sys::Mutex ConstantsLock;
+  /// Guards the attribute FoldingSets.
+  sys::Mutex AttributesLock;
+  /// Guards MDStringCache to DistinctMDNodes and CustomMDKindNames.
+  sys::Mutex MetadataLock;
+  /// Guards ValueHandles.
+  sys::Mutex ValueHandlesLock;
+  /// Guards the tables keyed by IR objects: OwnedModules,
+  /// InstructionMetadata, FunctionMetadata, DiscriminatorTable,
+  /// IntrinsicIDCache, PrefixDataMap and PrologueDataMap.
+  sys::Mutex SideTablesLock;
+  /// Guards the global lists and symbol tables of the modules, for the
+  /// function passes that run concurrently and add declarations or globals
+  /// to their module.
+  sys::Mutex GlobalsLock;
+
+  static unsigned getIntConstantShard(const APInt &V) {
+    uint64_t Key = V.getRawData()[0] ^ V.getBitWidth();
+    return ((Key * 0x9E3779B97F4A7C15ULL) >> 32) % NumLockShards;
+  }
+  sys::Mutex &getUseListLock(const Value *V) {
+    return UseListLocks[DenseMapInfo<const Value *>::getHashValue(V) %
+                        NumLockShards];
+  }
+  static unsigned getValueNamesShard(const Value *V) {
+    return DenseMapInfo<const Value *>::getHashValue(V) % NumLockShards;
+  }
+  /// @}
+
   /// OwnedModules - The set of modules instantiated in this context, and which
   /// will be automatically deleted if this context is deleted.
   SmallPtrSet<Module*, 4> OwnedModules;
@@ -907,11 +962,17 @@ public:
   void *YieldOpaqueHandle;
 
   typedef DenseMap<APInt, ConstantInt *, DenseMapAPIntKeyInfo> IntMapTy;
-  IntMapTy IntConstants;
+  /// Integer constants, split into shards selected by getIntConstantShard()
+  /// so that threads creating different constants rarely wait on each other.
+  IntMapTy IntConstants[NumLockShards];
 
   typedef DenseMap<APFloat, ConstantFP *, DenseMapAPFloatKeyInfo> FPMapTy;
   FPMapTy FPConstants;
 
+  /// The names of the values that have one (see Value::getValueName()),
+  /// split into shards selected by getValueNamesShard().
+  DenseMap<const Value *, ValueName *> ValueNames[NumLockShards];
+
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeSetImpl> AttrsLists;
   FoldingSet<AttributeSetNode> AttrsSetNodes;
@@ -1026,6 +1087,28 @@ public:
   void dropTriviallyDeadConstantArrays();
 };
 
+/// \brief Scoped lock of one of the mutexes of an LLVMContextImpl.
+///
+/// The mutex is only taken if the context is in multithreaded mode, so that
+/// single-threaded clients only pay for a well predicted branch.
+class ContextLock {
+  sys::Mutex *M;
+
+  ContextLock(const ContextLock &) = delete;
+  void operator=(const ContextLock &) = delete;
+
+public:
+  ContextLock(const LLVMContextImpl &Impl, sys::Mutex &Mutex)
+      : M(Impl.Multithreaded ? &Mutex : nullptr) {
+    if (M)
+      M->lock();
+  }
+  ~ContextLock() {
+    if (M)
+      M->unlock();
+  }
+};
+
 }
 
 #endif
@@ -12,6 +12,8 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -23,14 +25,22 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
+#include <thread>
 using namespace llvm;
 using namespace llvm::legacy;
 
+#define DEBUG_TYPE "ir"
+
+STATISTIC(NumConcurrentFunctions,
+          "Number of functions run through function passes concurrently");
+
 // See PassManagers.h for Pass Manager infrastructure overview.
 
 //===----------------------------------------------------------------------===//
@@ -58,6 +68,15 @@ PassDebugging("debug-pass", cl::Hidden,
   clEnumVal(Details   , "print pass details when it is executed"),
                              clEnumValEnd));
 
+// Running function passes on several threads is opt-in: it only happens when
+// every pass of a function pass manager supports it, see Pass::clone.
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads",
+                    cl::desc("Number of threads running function passes on "
+                             "the functions of a module (0 uses all the "
+                             "hardware threads)"),
+                    cl::init(1));
+
 namespace {
 typedef llvm::cl::list<const llvm::PassInfo *, bool, PassNameParser>
 PassOptionList;
@@ -180,6 +199,9 @@ public:
   PMDataManager *getAsPMDataManager() override { return this; }
   Pass *getAsPass() override { return this; }
 
+  /// Return an empty manager, the contained passes are copied by the caller.
+  Pass *clone() const override { return new BBPassManager(); }
+
   const char *getPassName() const override {
     return "BasicBlock Pass Manager";
   }
@@ -572,6 +594,10 @@ void PMTopLevelManager::collectLastUses(SmallVectorImpl<Pass *> &LastUses,
 
 }
 
+void PMTopLevelManager::addLastUses(Pass *P, ArrayRef<Pass *> LastUses) {
+  InversedLastUser[P].insert(LastUses.begin(), LastUses.end());
+}
+
 AnalysisUsage *PMTopLevelManager::findAnalysisUsage(Pass *P) {
   AnalysisUsage *AnUsage = nullptr;
   DenseMap<Pass *, AnalysisUsage *>::iterator DMI = AnUsageMap.find(P);
@@ -1550,9 +1576,270 @@ bool FPPassManager::runOnFunction(Function &F) {
   return Changed;
 }
 
+namespace {
+//===----------------------------------------------------------------------===//
+// FunctionPassWorker
+//
+/// FunctionPassWorker owns the copies of the passes of an FPPassManager that
+/// one thread runs, while other workers run the same pipeline on other
+/// functions of the module.  Like FunctionPassManagerImpl, it is the top level
+/// manager of the passes it owns.  It shares the thread-safe immutable passes
+/// and module level analyses of the original pass manager and copies the
+/// other immutable passes.
+class FunctionPassWorker : public Pass,
+                           public PMDataManager,
+                           public PMTopLevelManager {
+  /// The immutable passes owned by the original top level manager.
+  SmallPtrSet<ImmutablePass *, 8> SharedImmutablePasses;
+
+  /// Map from the passes of the original pass managers to their copies.
+  DenseMap<Pass *, Pass *> Copies;
+
+  /// Copy the passes of From into To, recursively.
+  bool cloneContainedPasses(PMDataManager &From, PMDataManager &To);
+
+public:
+  static char ID;
+  explicit FunctionPassWorker() :
+    Pass(PT_PassManager, ID), PMDataManager(),
+    PMTopLevelManager(new FPPassManager()) {
+    setTopLevelManager(this);
+  }
+
+  ~FunctionPassWorker() override {
+    // Keep the shared immutable passes alive.
+    SmallVectorImpl<ImmutablePass *> &IPs = getImmutablePasses();
+    IPs.erase(std::remove_if(IPs.begin(), IPs.end(),
+                             [&](ImmutablePass *IP) {
+                               return SharedImmutablePasses.count(IP);
+                             }),
+              IPs.end());
+  }
+
+  /// Copy the passes of FPM, the immutable passes of TPM that are not
+  /// thread-safe, and use the analyses of the managers in Parents.  Return
+  /// false if a pass cannot be copied.
+  bool init(FPPassManager &FPM, PMTopLevelManager &TPM,
+            ArrayRef<PMDataManager *> Parents);
+
+  /// Run the copies on F.
+  bool run(Function &F) { return getContainedManager()->runOnFunction(F); }
+
+  bool doInitialization(Module &M) override;
+  bool doFinalization(Module &M) override;
+
+  Pass *createPrinterPass(raw_ostream &O,
+                          const std::string &Banner) const override {
+    return createPrintFunctionPass(O, Banner);
+  }
+
+  PMDataManager *getAsPMDataManager() override { return this; }
+  Pass *getAsPass() override { return this; }
+  PassManagerType getTopLevelPassManagerType() override {
+    return PMT_FunctionPassManager;
+  }
+
+  FPPassManager *getContainedManager() {
+    return static_cast<FPPassManager *>(PassManagers[0]);
+  }
+};
+
+char FunctionPassWorker::ID = 0;
+} // End anonymous namespace
+
+bool FunctionPassWorker::cloneContainedPasses(PMDataManager &From,
+                                              PMDataManager &To) {
+  for (Pass *P : From.getContainedPasses()) {
+    Pass *Copy = P->clone();
+    if (!Copy)
+      return false;
+    To.add(Copy, /*ProcessAnalysis=*/false);
+    Copies[P] = Copy;
+
+    // Pass managers return an empty manager, fill it.
+    if (PMDataManager *PMD = Copy->getAsPMDataManager()) {
+      PMD->setTopLevelManager(this);
+      PMD->setDepth(To.getDepth() + 1);
+      addIndirectPassManager(PMD);
+      if (!cloneContainedPasses(*P->getAsPMDataManager(), *PMD))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool FunctionPassWorker::init(FPPassManager &FPM, PMTopLevelManager &TPM,
+                              ArrayRef<PMDataManager *> Parents) {
+  // Set the immutable passes up in their original order, so that analysis
+  // groups resolve to the same implementations.
+  SmallPtrSet<Pass *, 8> CopiedImmutablePasses;
+  for (ImmutablePass *IP : TPM.getImmutablePasses()) {
+    if (IP->isThreadSafe()) {
+      // A shared pass must not use a pass that is copied.
+      for (AnalysisID AID : TPM.findAnalysisUsage(IP)->getRequiredSet())
+        if (CopiedImmutablePasses.count(IP->getResolver()->findImplPass(AID)))
+          return false;
+      SharedImmutablePasses.insert(IP);
+      getImmutablePasses().push_back(IP);
+      recordAvailableAnalysis(IP);
+      continue;
+    }
+
+    Pass *Copy = IP->clone();
+    if (!Copy)
+      return false;
+    ImmutablePass *CopyIP = Copy->getAsImmutablePass();
+    assert(CopyIP && "Immutable pass cloned into a different kind of pass");
+    CopiedImmutablePasses.insert(IP);
+
+    // Set the copy up like PMTopLevelManager::schedulePass does.
+    CopyIP->setResolver(new AnalysisResolver(*this));
+    initializeAnalysisImpl(CopyIP);
+    addImmutablePass(CopyIP);
+    recordAvailableAnalysis(CopyIP);
+  }
+
+  if (!cloneContainedPasses(FPM, *getContainedManager()))
+    return false;
+
+  // Free the copies when the originals would be freed.  Analyses that live
+  // outside the function pass manager are shared and never freed here.
+  for (const auto &Copy : Copies) {
+    SmallVector<Pass *, 12> LastUses, CopiedLastUses;
+    TPM.collectLastUses(LastUses, Copy.first);
+    for (Pass *LastUse : LastUses) {
+      DenseMap<Pass *, Pass *>::iterator I = Copies.find(LastUse);
+      if (I != Copies.end())
+        CopiedLastUses.push_back(I->second);
+    }
+    addLastUses(Copy.second, CopiedLastUses);
+  }
+
+  for (PMDataManager *Parent : Parents)
+    addIndirectPassManager(Parent);
+  return true;
+}
+
+bool FunctionPassWorker::doInitialization(Module &M) {
+  bool Changed = false;
+
+  for (ImmutablePass *IP : getImmutablePasses())
+    if (!SharedImmutablePasses.count(IP))
+      Changed |= IP->doInitialization(M);
+
+  Changed |= getContainedManager()->doInitialization(M);
+
+  return Changed;
+}
+
+bool FunctionPassWorker::doFinalization(Module &M) {
+  bool Changed = getContainedManager()->doFinalization(M);
+
+  for (ImmutablePass *IP : getImmutablePasses())
+    if (!SharedImmutablePasses.count(IP))
+      Changed |= IP->doFinalization(M);
+
+  return Changed;
+}
+
+/// Return the number of threads FPPassManager runs function passes on.
+static unsigned getFunctionPassThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (FunctionPassThreads == 0)
+    return std::max(1u, std::thread::hardware_concurrency());
+  return FunctionPassThreads;
+#else
+  return 1;
+#endif
+}
+
+/// Apply F to P and to the passes it contains, recursively.
+template <typename FuncT>
+static void forEachPass(Pass *P, FuncT F) {
+  F(P);
+  if (PMDataManager *PMD = P->getAsPMDataManager())
+    for (Pass *Contained : PMD->getContainedPasses())
+      forEachPass(Contained, F);
+}
+
+bool FPPassManager::runOnModuleInParallel(Module &M, unsigned NumThreads,
+                                          bool &Changed) {
+  // Debugging output and timers are not meant to be used concurrently.
+  if (PassDebugging >= Executions || TimePassesIsEnabled)
+    return false;
+
+  std::vector<Function *> Functions;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+  NumThreads = std::min<size_t>(NumThreads, Functions.size());
+  if (NumThreads < 2)
+    return false;
+
+  // The analyses of the module pass manager are shared by the threads.
+  SmallVector<PMDataManager *, 2> Parents;
+  for (PMDataManager *PMD : TPM->activeStack) {
+    if (PMD->getPassManagerType() != PMT_ModulePassManager)
+      continue;
+    for (const auto &Analysis : *PMD->getAvailableAnalysis()) {
+      Pass *P = Analysis.second;
+      if (!P->getAsPMDataManager() && !P->getAsImmutablePass() &&
+          !P->isThreadSafe())
+        return false;
+    }
+    Parents.push_back(PMD);
+  }
+
+  std::vector<std::unique_ptr<FunctionPassWorker>> Workers;
+  for (unsigned I = 0; I != NumThreads; ++I) {
+    Workers.emplace_back(new FunctionPassWorker());
+    if (!Workers.back()->init(*this, *TPM, Parents))
+      return false;
+  }
+
+  M.getContext().enableMultithreading();
+  Changed = false;
+  for (auto &Worker : Workers)
+    Changed |= Worker->doInitialization(M);
+
+  // Hand the functions out one at a time, to balance the load.
+  std::atomic<unsigned> NextFunction(0);
+  std::vector<char> WorkerChanged(NumThreads, false);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Pool.async([&, I] {
+        for (unsigned F = NextFunction++; F < Functions.size();
+             F = NextFunction++)
+          if (Workers[I]->run(*Functions[F]))
+            WorkerChanged[I] = true;
+      });
+    Pool.wait();
+  }
+
+  NumConcurrentFunctions += Functions.size();
+  for (unsigned I = 0; I != NumThreads; ++I) {
+    Changed |= WorkerChanged[I];
+    Changed |= Workers[I]->doFinalization(M);
+  }
+
+  // Drop the module level analyses the passes did not preserve, as running
+  // them serially would have.
+  populateInheritedAnalysis(TPM->activeStack);
+  for (Pass *P : PassVector)
+    forEachPass(P, [&](Pass *Contained) {
+      removeNotPreservedAnalysis(Contained);
+    });
+  return true;
+}
+
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = false;
 
+  unsigned NumThreads = getFunctionPassThreadCount();
+  if (NumThreads > 1 && runOnModuleInParallel(M, NumThreads, Changed))
+    return Changed;
+
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
     Changed |= runOnFunction(*I);
 
@@ -35,7 +35,9 @@ MetadataAsValue::MetadataAsValue(Type *Ty, Metadata *MD)
 }
 
 MetadataAsValue::~MetadataAsValue() {
-  getType()->getContext().pImpl->MetadataAsValues.erase(MD);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
+  pImpl->MetadataAsValues.erase(MD);
   untrack();
 }
 
@@ -74,6 +76,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
     Entry = new MetadataAsValue(Type::getMetadataTy(Context), MD);
@@ -83,6 +86,7 @@ MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
 MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
                                               Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MetadataAsValues;
   return Store.lookup(MD);
 }
@@ -90,6 +94,7 @@ MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
 void MetadataAsValue::handleChangedMetadata(Metadata *MD) {
   LLVMContext &Context = getContext();
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MetadataAsValues;
 
   // Stop tracking the old metadata.
@@ -121,6 +126,7 @@ void MetadataAsValue::untrack() {
 }
 
 void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   bool WasInserted =
       UseMap.insert(std::make_pair(Ref, std::make_pair(Owner, NextIndex)))
           .second;
@@ -132,6 +138,7 @@ void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
 }
 
 void ReplaceableMetadataImpl::dropRef(void *Ref) {
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   bool WasErased = UseMap.erase(Ref);
   (void)WasErased;
   assert(WasErased && "Expected to drop a reference");
@@ -139,6 +146,7 @@ void ReplaceableMetadataImpl::dropRef(void *Ref) {
 
 void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
                                       const Metadata &MD) {
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto I = UseMap.find(Ref);
   assert(I != UseMap.end() && "Expected to move a reference");
   auto OwnerAndIndex = I->second;
@@ -252,13 +260,14 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
            "Expected constant or function-local value");
-    assert(!V->NameAndIsUsedByMD.getInt() &&
+    assert(!V->IsUsedByMD &&
            "Expected this to be the only metadata use");
-    V->NameAndIsUsedByMD.setInt(true);
+    V->IsUsedByMD = true;
     if (auto *C = dyn_cast<Constant>(V))
       Entry = new ConstantAsMetadata(C);
     else
@@ -270,13 +279,17 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
-  return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
+  LLVMContextImpl *pImpl = V->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
+  return pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
-  auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
+  LLVMContextImpl *pImpl = V->getType()->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
+  auto &Store = pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
     return;
@@ -299,18 +312,19 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
-    assert(!From->NameAndIsUsedByMD.getInt() &&
+    assert(!From->IsUsedByMD &&
            "Expected From not to be used by metadata");
     return;
   }
 
   // Remove old entry from the map.
-  assert(From->NameAndIsUsedByMD.getInt() &&
+  assert(From->IsUsedByMD &&
          "Expected From to be used by metadata");
-  From->NameAndIsUsedByMD.setInt(false);
+  From->IsUsedByMD = false;
   ValueAsMetadata *MD = I->second;
   assert(MD && "Expected valid metadata");
   assert(MD->getValue() == From && "Expected valid mapping");
@@ -346,9 +360,9 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   }
 
   // Update MD in place (and update the map entry).
-  assert(!To->NameAndIsUsedByMD.getInt() &&
+  assert(!To->IsUsedByMD &&
          "Expected this to be the only metadata use");
-  To->NameAndIsUsedByMD.setInt(true);
+  To->IsUsedByMD = true;
   MD->V = To;
   Entry = MD;
 }
@@ -358,6 +372,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.find(Str);
   if (I != Store.end())
@@ -652,6 +667,8 @@ template <class NodeTy> struct MDNode::HasCachedHash {
 
 MDNode *MDNode::uniquify() {
   assert(!hasSelfReference(this) && "Cannot uniquify a self-referencing node");
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
 
   // Try to insert into uniquing store.
   switch (getMetadataID()) {
@@ -663,19 +680,21 @@ MDNode *MDNode::uniquify() {
     std::integral_constant<bool, HasCachedHash<CLASS>::value>                  \
         ShouldRecalculateHash;                                                 \
     dispatchRecalculateHash(SubclassThis, ShouldRecalculateHash);              \
-    return uniquifyImpl(SubclassThis, getContext().pImpl->CLASS##s);           \
+    return uniquifyImpl(SubclassThis, pImpl->CLASS##s);                        \
   }
 #include "llvm/IR/Metadata.def"
   }
 }
 
 void MDNode::eraseFromStore() {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
   switch (getMetadataID()) {
   default:
     llvm_unreachable("Invalid subclass of MDNode");
 #define HANDLE_MDNODE_LEAF(CLASS)                                              \
   case CLASS##Kind:                                                            \
-    getContext().pImpl->CLASS##s.erase(cast<CLASS>(this));                     \
+    pImpl->CLASS##s.erase(cast<CLASS>(this));                                  \
     break;
 #include "llvm/IR/Metadata.def"
   }
@@ -683,6 +702,7 @@ void MDNode::eraseFromStore() {
 
 MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           StorageType Storage, bool ShouldCreate) {
+  ContextLock Lock(*Context.pImpl, Context.pImpl->MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
@@ -722,7 +742,9 @@ void MDNode::storeDistinctInContext() {
 #include "llvm/IR/Metadata.def"
   }
 
-  getContext().pImpl->DistinctMDNodes.insert(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->MetadataLock);
+  pImpl->DistinctMDNodes.insert(this);
 }
 
 void MDNode::replaceOperandWith(unsigned I, Metadata *New) {
@@ -1041,7 +1063,9 @@ void Instruction::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
-  auto &InstructionMetadata = getContext().pImpl->InstructionMetadata;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  auto &InstructionMetadata = pImpl->InstructionMetadata;
 
   if (KnownSet.empty()) {
     // Just drop our entry at the store.
@@ -1075,9 +1099,12 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     return;
   }
   
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
-    auto &Info = getContext().pImpl->InstructionMetadata[this];
+    auto &Info = pImpl->InstructionMetadata[this];
     assert(!Info.empty() == hasMetadataHashEntry() &&
            "HasMetadata bit is wonked");
     if (Info.empty())
@@ -1088,11 +1115,11 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
 
   // Otherwise, we're removing metadata from an instruction.
   assert((hasMetadataHashEntry() ==
-          (getContext().pImpl->InstructionMetadata.count(this) > 0)) &&
+          (pImpl->InstructionMetadata.count(this) > 0)) &&
          "HasMetadata bit out of date!");
   if (!hasMetadataHashEntry())
     return;  // Nothing to remove!
-  auto &Info = getContext().pImpl->InstructionMetadata[this];
+  auto &Info = pImpl->InstructionMetadata[this];
 
   // Handle removal of an existing value.
   Info.erase(KindID);
@@ -1100,7 +1127,7 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
   if (!Info.empty())
     return;
 
-  getContext().pImpl->InstructionMetadata.erase(this);
+  pImpl->InstructionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
 
@@ -1117,7 +1144,9 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
 
   if (!hasMetadataHashEntry())
     return nullptr;
-  auto &Info = getContext().pImpl->InstructionMetadata[this];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  auto &Info = pImpl->InstructionMetadata[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
   return Info.lookup(KindID);
@@ -1134,10 +1163,12 @@ void Instruction::getAllMetadataImpl(
     if (!hasMetadataHashEntry()) return;
   }
 
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
   assert(hasMetadataHashEntry() &&
-         getContext().pImpl->InstructionMetadata.count(this) &&
+         pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
-  const auto &Info = getContext().pImpl->InstructionMetadata.find(this)->second;
+  const auto &Info = pImpl->InstructionMetadata.find(this)->second;
   assert(!Info.empty() && "Shouldn't have called this");
   Info.getAll(Result);
 }
@@ -1145,10 +1176,12 @@ void Instruction::getAllMetadataImpl(
 void Instruction::getAllMetadataOtherThanDebugLocImpl(
     SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const {
   Result.clear();
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
   assert(hasMetadataHashEntry() &&
-         getContext().pImpl->InstructionMetadata.count(this) &&
+         pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
-  const auto &Info = getContext().pImpl->InstructionMetadata.find(this)->second;
+  const auto &Info = pImpl->InstructionMetadata.find(this)->second;
   assert(!Info.empty() && "Shouldn't have called this");
   Info.getAll(Result);
 }
@@ -1157,14 +1190,18 @@ void Instruction::getAllMetadataOtherThanDebugLocImpl(
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
-  getContext().pImpl->InstructionMetadata.erase(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  pImpl->InstructionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
 
 MDNode *Function::getMetadata(unsigned KindID) const {
   if (!hasMetadata())
     return nullptr;
-  return getContext().pImpl->FunctionMetadata[this].lookup(KindID);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  return pImpl->FunctionMetadata[this].lookup(KindID);
 }
 
 MDNode *Function::getMetadata(StringRef Kind) const {
@@ -1174,11 +1211,13 @@ MDNode *Function::getMetadata(StringRef Kind) const {
 }
 
 void Function::setMetadata(unsigned KindID, MDNode *MD) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
   if (MD) {
     if (!hasMetadata())
       setHasMetadataHashEntry(true);
 
-    getContext().pImpl->FunctionMetadata[this].set(KindID, *MD);
+    pImpl->FunctionMetadata[this].set(KindID, *MD);
     return;
   }
 
@@ -1186,7 +1225,7 @@ void Function::setMetadata(unsigned KindID, MDNode *MD) {
   if (!hasMetadata())
     return;
 
-  auto &Store = getContext().pImpl->FunctionMetadata[this];
+  auto &Store = pImpl->FunctionMetadata[this];
   Store.erase(KindID);
   if (Store.empty())
     clearMetadata();
@@ -1205,7 +1244,9 @@ void Function::getAllMetadata(
   if (!hasMetadata())
     return;
 
-  getContext().pImpl->FunctionMetadata[this].getAll(MDs);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  pImpl->FunctionMetadata[this].getAll(MDs);
 }
 
 void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
@@ -1219,7 +1260,9 @@ void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   SmallSet<unsigned, 5> KnownSet;
   KnownSet.insert(KnownIDs.begin(), KnownIDs.end());
 
-  auto &Store = getContext().pImpl->FunctionMetadata[this];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  auto &Store = pImpl->FunctionMetadata[this];
   assert(!Store.empty());
 
   Store.remove_if([&KnownSet](const std::pair<unsigned, TrackingMDNodeRef> &I) {
@@ -1233,6 +1276,8 @@ void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
 void Function::clearMetadata() {
   if (!hasMetadata())
     return;
-  getContext().pImpl->FunctionMetadata.erase(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+  pImpl->FunctionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
@@ -87,6 +87,15 @@ void Pass::verifyAnalysis() const {
   // By default, don't do anything.
 }
 
+Pass *Pass::clone() const {
+  // By default, passes cannot be copied.
+  return nullptr;
+}
+
+bool Pass::isThreadSafe() const {
+  return false;
+}
+
 void *Pass::getAdjustedAnalysisPointer(AnalysisID AID) {
   return this;
 }
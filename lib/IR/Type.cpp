@@ -316,6 +316,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
+  ContextLock Lock(*C.pImpl, C.pImpl->TypesLock);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
 
   if (!Entry)
@@ -361,6 +362,7 @@ FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
   auto I = pImpl->FunctionTypes.find_as(Key);
   FunctionType *FT;
 
@@ -404,6 +406,7 @@ StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
   auto I = pImpl->AnonStructTypes.find_as(Key);
   StructType *ST;
 
@@ -428,7 +431,9 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     setSubclassData(getSubclassData() | SCDB_Packed);
 
   unsigned NumElements = Elements.size();
-  Type **Elts = getContext().pImpl->TypeAllocator.Allocate<Type*>(NumElements);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
+  Type **Elts = pImpl->TypeAllocator.Allocate<Type*>(NumElements);
   memcpy(Elts, Elements.data(), sizeof(Elements[0]) * NumElements);
   
   ContainedTys = Elts;
@@ -436,9 +441,11 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 }
 
 void StructType::setName(StringRef Name) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
   if (Name == getName()) return;
 
-  StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
+  StringMap<StructType *> &SymbolTable = pImpl->NamedStructTypes;
   typedef StringMap<StructType *>::MapEntryTy EntryTy;
 
   // If this struct already had a name, remove its symbol table entry. Don't
@@ -457,8 +464,7 @@ void StructType::setName(StringRef Name) {
   }
   
   // Look up the entry for the name.
-  auto IterBool =
-      getContext().pImpl->NamedStructTypes.insert(std::make_pair(Name, this));
+  auto IterBool = SymbolTable.insert(std::make_pair(Name, this));
 
   // While we have a name collision, try a random rename.
   if (!IterBool.second) {
@@ -470,10 +476,9 @@ void StructType::setName(StringRef Name) {
     do {
       TempStr.resize(NameSize + 1);
       TmpStream.resync();
-      TmpStream << getContext().pImpl->NamedStructTypesUniqueID++;
+      TmpStream << pImpl->NamedStructTypesUniqueID++;
 
-      IterBool = getContext().pImpl->NamedStructTypes.insert(
-          std::make_pair(TmpStream.str(), this));
+      IterBool = SymbolTable.insert(std::make_pair(TmpStream.str(), this));
     } while (!IterBool.second);
   }
 
@@ -487,7 +492,11 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
-  StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
+  StructType *ST;
+  {
+    ContextLock Lock(*Context.pImpl, Context.pImpl->TypesLock);
+    ST = new (Context.pImpl->TypeAllocator) StructType(Context);
+  }
   if (!Name.empty())
     ST->setName(Name);
   return ST;
@@ -619,7 +628,9 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
-  return getContext().pImpl->NamedStructTypes.lookup(Name);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
+  return pImpl->NamedStructTypes.lookup(Name);
 }
 
 
@@ -684,6 +695,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
 
@@ -714,8 +726,9 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
                                             "pointer type.");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
-  VectorType *&Entry = ElementType->getContext().pImpl
-    ->VectorTypes[std::make_pair(ElementType, NumElements)];
+  ContextLock Lock(*pImpl, pImpl->TypesLock);
+  VectorType *&Entry =
+    pImpl->VectorTypes[std::make_pair(ElementType, NumElements)];
 
   if (!Entry)
     Entry = new (pImpl->TypeAllocator) VectorType(ElementType, NumElements);
@@ -736,7 +749,8 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
-  
+  ContextLock Lock(*CImpl, CImpl->TypesLock);
+
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
      : CImpl->ASPointerTypes[std::make_pair(EltTy, AddressSpace)];
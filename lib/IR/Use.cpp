@@ -19,11 +19,11 @@ void Use::swap(Use &RHS) {
     return;
 
   if (Val)
-    removeFromList();
+    Val->removeUse(*this);
 
   Value *OldVal = Val;
   if (RHS.Val) {
-    RHS.removeFromList();
+    RHS.Val->removeUse(RHS);
     Val = RHS.Val;
     Val->addUse(*this);
   } else {
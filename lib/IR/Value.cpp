@@ -40,6 +40,8 @@ using namespace llvm;
 //                                Value Class
 //===----------------------------------------------------------------------===//
 
+bool Value::HasMultithreadedContexts = false;
+
 static inline Type *checkType(Type *Ty) {
   assert(Ty && "Value defined with a null type: Error!");
   return Ty;
@@ -47,7 +49,8 @@ static inline Type *checkType(Type *Ty) {
 
 Value::Value(Type *ty, unsigned scid)
     : VTy(checkType(ty)), UseList(nullptr), SubclassID(scid), HasValueHandle(0),
-      SubclassOptionalData(0), SubclassData(0), NumOperands(0) {
+      SubclassOptionalData(0), SubclassData(0), NumOperands(0), IsUsedByMD(0),
+      HasName(0) {
   // FIXME: Why isn't this in the subclass gunk??
   // Note, we cannot call isa<CallInst> before the CallInst has been
   // constructed.
@@ -86,6 +89,32 @@ Value::~Value() {
   destroyValueName();
 }
 
+ValueName *Value::getValueName() const {
+  if (!HasName)
+    return nullptr;
+
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  unsigned Shard = LLVMContextImpl::getValueNamesShard(this);
+  ContextLock Lock(*pImpl, pImpl->ValueNamesLocks[Shard]);
+  auto I = pImpl->ValueNames[Shard].find(this);
+  assert(I != pImpl->ValueNames[Shard].end() && "No name entry found!");
+  return I->second;
+}
+
+void Value::setValueName(ValueName *VN) {
+  if (!VN && !HasName)
+    return;
+
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  unsigned Shard = LLVMContextImpl::getValueNamesShard(this);
+  ContextLock Lock(*pImpl, pImpl->ValueNamesLocks[Shard]);
+  if (VN)
+    pImpl->ValueNames[Shard][this] = VN;
+  else
+    pImpl->ValueNames[Shard].erase(this);
+  HasName = VN != nullptr;
+}
+
 void Value::destroyValueName() {
   ValueName *Name = getValueName();
   if (Name)
@@ -161,7 +190,7 @@ StringRef Value::getName() const {
   // Make sure the empty string is still a C string. For historical reasons,
   // some clients want to call .data() on the result and expect it to be null
   // terminated.
-  if (!getValueName())
+  if (!HasName)
     return StringRef("", 0);
   return getValueName()->getKey();
 }
@@ -187,8 +216,11 @@ void Value::setName(const Twine &NewName) {
   if (getSymTab(this, ST))
     return;  // Cannot set a name on this value (e.g. constant).
 
-  if (Function *F = dyn_cast<Function>(this))
-    getContext().pImpl->IntrinsicIDCache.erase(F);
+  if (Function *F = dyn_cast<Function>(this)) {
+    LLVMContextImpl *pImpl = getContext().pImpl;
+    ContextLock Lock(*pImpl, pImpl->SideTablesLock);
+    pImpl->IntrinsicIDCache.erase(F);
+  }
 
   if (!ST) { // No symbol table to update?  Just do the change.
     if (NameRef.empty()) {
@@ -506,10 +538,68 @@ void Value::reverseUseList() {
   Head->setPrev(&UseList);
 }
 
+/// The observer of the uses of shared values made by this thread.
+static LLVM_THREAD_LOCAL Value::SharedUseObserver *CurrentObserver = nullptr;
+
+Value::SharedUseObserver::~SharedUseObserver() {}
+
+void Value::setSharedUseObserver(SharedUseObserver *Observer) {
+  CurrentObserver = Observer;
+}
+
+void Value::addSharedUse(Use &U) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  {
+    ContextLock Lock(*pImpl, pImpl->getUseListLock(this));
+    U.addToList(&UseList);
+  }
+  if (SharedUseObserver *Observer = CurrentObserver)
+    Observer->addedUse(U);
+}
+
+void Value::removeSharedUse(Use &U) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  {
+    ContextLock Lock(*pImpl, pImpl->getUseListLock(this));
+    U.removeFromList();
+  }
+  if (SharedUseObserver *Observer = CurrentObserver)
+    Observer->removedUse(U);
+}
+
 //===----------------------------------------------------------------------===//
 //                             ValueHandleBase Class
 //===----------------------------------------------------------------------===//
 
+namespace {
+/// Scoped lock of the value handles of the context of a value, taken if the
+/// context is multithreaded. The handle lists of all values are linked from
+/// the ValueHandles map, which another thread may rehash at any time.
+class ValueHandlesLock {
+  sys::Mutex *M;
+
+public:
+  explicit ValueHandlesLock(const Value *V) : M(nullptr) {
+    if (LLVM_LIKELY(!Value::hasMultithreadedContexts()))
+      return;
+    LLVMContextImpl *pImpl = V->getContext().pImpl;
+    if (!pImpl->Multithreaded)
+      return;
+    M = &pImpl->ValueHandlesLock;
+    M->lock();
+  }
+  ~ValueHandlesLock() {
+    if (M)
+      M->unlock();
+  }
+};
+}
+
+void ValueHandleBase::AddToUseListOf(const ValueHandleBase &RHS) {
+  ValueHandlesLock Lock(V);
+  AddToExistingUseList(RHS.getPrevPtr());
+}
+
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
 
@@ -535,6 +625,7 @@ void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
 
 void ValueHandleBase::AddToUseList() {
   assert(V && "Null pointer doesn't have a use list!");
+  ValueHandlesLock Lock(V);
 
   LLVMContextImpl *pImpl = V->getContext().pImpl;
 
@@ -579,6 +670,7 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(V && V->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  ValueHandlesLock Lock(V);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -605,6 +697,7 @@ void ValueHandleBase::RemoveFromUseList() {
 
 void ValueHandleBase::ValueIsDeleted(Value *V) {
   assert(V->HasValueHandle && "Should only be called if ValueHandles present");
+  ValueHandlesLock Lock(V);
 
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
@@ -665,6 +758,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   assert(Old != New && "Changing value into itself!");
   assert(Old->getType() == New->getType() &&
          "replaceAllUses of value with new value of different type!");
+  ValueHandlesLock Lock(Old);
 
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
@@ -51,6 +51,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/CallingConv.h"
@@ -73,13 +74,22 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cstdarg>
+#include <thread>
 using namespace llvm;
 
 static cl::opt<bool> VerifyDebugInfo("verify-debug-info", cl::init(true));
 
+static cl::opt<unsigned>
+VerifyThreads("verify-threads",
+              cl::desc("Number of threads checking the function bodies in "
+                       "verifyModule (0 uses all the hardware threads)"),
+              cl::init(1));
+
 namespace {
 struct VerifierSupport {
   raw_ostream &OS;
@@ -280,6 +290,19 @@ public:
     return !Broken;
   }
 
+  /// \brief Take over what \p Other found while checking functions, which
+  /// the checks of the module depend on.
+  void mergeFunctionState(Verifier &Other) {
+    MDNodes.insert(Other.MDNodes.begin(), Other.MDNodes.end());
+    UnresolvedTypeRefs.insert(Other.UnresolvedTypeRefs.begin(),
+                              Other.UnresolvedTypeRefs.end());
+    for (auto &Counts : Other.FrameEscapeInfo) {
+      auto &Entry = FrameEscapeInfo[Counts.first];
+      Entry.first = std::max(Entry.first, Counts.second.first);
+      Entry.second = std::max(Entry.second, Counts.second.second);
+    }
+  }
+
 private:
   // Verification methods...
   void visitGlobalValue(const GlobalValue &GV);
@@ -3567,7 +3590,77 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
   return !V.verify(F);
 }
 
+/// Return the number of threads checking function bodies in verifyModule.
+static unsigned getVerifyThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (VerifyThreads == 0)
+    return std::max(1u, std::thread::hardware_concurrency());
+  return VerifyThreads;
+#else
+  return 1;
+#endif
+}
+
 bool llvm::verifyModule(const Module &M, raw_ostream *OS) {
+  return verifyModule(M, OS, getVerifyThreadCount());
+}
+
+/// Check the function bodies of M with one verifier per thread, then the rest
+/// of the module with a verifier that merges what they found.  Return true if
+/// the module is well formed.
+///
+/// Metadata reachable from several functions is only checked by the first
+/// verifier to get to it, so the messages about broken IR would depend on the
+/// scheduling.  This is therefore silent, and the caller checks a broken
+/// module again serially to diagnose it deterministically.
+static bool verifyModuleInParallel(const Module &M, unsigned NumThreads) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    if (!F.isDeclaration() && !F.isMaterializable())
+      Functions.push_back(&F);
+  NumThreads = std::max<size_t>(1, std::min<size_t>(NumThreads,
+                                                    Functions.size()));
+
+  M.getContext().enableMultithreading();
+
+  raw_null_ostream NullStr;
+  std::vector<std::unique_ptr<Verifier>> Workers;
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Workers.emplace_back(new Verifier(NullStr));
+
+  // Hand the functions out one at a time, to balance the load, and stop at the
+  // first broken one.
+  std::atomic<unsigned> NextFunction(0);
+  std::atomic<bool> AnyBroken(false);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Pool.async([&, I] {
+        Verifier &Worker = *Workers[I];
+        for (unsigned F = NextFunction++; F < Functions.size() && !AnyBroken;
+             F = NextFunction++)
+          if (!Worker.verify(*Functions[F]))
+            AnyBroken = true;
+      });
+    Pool.wait();
+  }
+  if (AnyBroken)
+    return false;
+
+  Verifier V(NullStr);
+  for (auto &Worker : Workers)
+    V.mergeFunctionState(*Worker);
+  return V.verify(M);
+}
+
+bool llvm::verifyModule(const Module &M, raw_ostream *OS,
+                        unsigned NumThreads) {
+  if (NumThreads > 1) {
+    bool Valid = verifyModuleInParallel(M, NumThreads);
+    if (Valid || !OS)
+      return !Valid;
+  }
+
   raw_null_ostream NullStr;
   Verifier V(OS ? *OS : NullStr);
 
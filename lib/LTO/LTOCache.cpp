@@ -0,0 +1,203 @@
+//===-LTOCache.cpp - LLVM Link Time Optimizer object cache ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the on-disk cache of link-time optimized objects.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/LTOCache.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+LTOCacheKey::LTOCacheKey() {}
+
+void LTOCacheKey::add(StringRef Data) {
+  add(Data.size());
+  Hasher.update(Data);
+}
+
+void LTOCacheKey::add(uint64_t Value) {
+  uint8_t Bytes[8];
+  support::endian::write64le(Bytes, Value);
+  Hasher.update(Bytes);
+}
+
+std::string LTOCacheKey::final() {
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+LTOCache::LTOCache(StringRef Dir) : Dir(Dir) {
+  // Failing to create the directory simply makes every lookup miss.
+  sys::fs::create_directories(Dir);
+}
+
+void LTOCache::getEntryPath(StringRef Key, SmallVectorImpl<char> &Path) const {
+  Path.append(Dir.begin(), Dir.end());
+  sys::path::append(Path, "llvmcache-" + Key);
+}
+
+std::unique_ptr<MemoryBuffer> LTOCache::lookup(StringRef Key) {
+  SmallString<128> Path;
+  getEntryPath(Key, Path);
+  int FD;
+  if (sys::fs::openFileForRead(Path, FD))
+    return nullptr;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getOpenFile(FD, Path, /*FileSize=*/-1,
+                                /*RequiresNullTerminator=*/false);
+  // Record the use of the entry, pruning removes the least recently used
+  // entries first.
+  if (BufferOrErr)
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (!BufferOrErr)
+    return nullptr;
+  return std::move(BufferOrErr.get());
+}
+
+void LTOCache::insert(StringRef Key, StringRef Data) {
+  SmallString<128> Path;
+  getEntryPath(Key, Path);
+
+  // Write the entry to a temporary file first, so that readers never see a
+  // partial entry.
+  SmallString<128> TempModel(Dir);
+  sys::path::append(TempModel, "llvmcache-%%%%%%%%.tmp");
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(TempModel, FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, Path))
+    sys::fs::remove(TempPath);
+}
+
+std::unique_ptr<MemoryBuffer> LTOCache::getOrCompute(
+    StringRef Key, function_ref<std::unique_ptr<MemoryBuffer>()> Compute) {
+  if (std::unique_ptr<MemoryBuffer> Hit = lookup(Key))
+    return Hit;
+
+  SmallString<128> Path;
+  getEntryPath(Key, Path);
+  while (true) {
+    LockFileManager Lock(Path);
+    switch (Lock) {
+    case LockFileManager::LFS_Error:
+      // Unable to lock the entry: compute it without coordinating with other
+      // processes.
+    case LockFileManager::LFS_Owned: {
+      std::unique_ptr<MemoryBuffer> Buffer = Compute();
+      if (Buffer)
+        insert(Key, Buffer->getBuffer());
+      return Buffer;
+    }
+    case LockFileManager::LFS_Shared:
+      break;
+    }
+
+    // Another process is computing the entry. Wait for it and use its result.
+    switch (Lock.waitForUnlock()) {
+    case LockFileManager::Res_Success:
+    case LockFileManager::Res_OwnerDied:
+      if (std::unique_ptr<MemoryBuffer> Hit = lookup(Key))
+        return Hit;
+      // The owner failed to produce the entry; try to compute it ourselves.
+      continue;
+    case LockFileManager::Res_Timeout:
+      // The owner is likely stuck. Remove its lock and start over.
+      Lock.unsafeRemoveLockFile();
+      continue;
+    }
+  }
+}
+
+bool LTOCache::prune(const LTOCachePruningPolicy &Policy) {
+  if (!Policy.Expiration && !Policy.MaxSize)
+    return false;
+
+  // The modification time of the timestamp file records the last pruning.
+  uint64_t Now = sys::TimeValue::now().toEpochTime();
+  SmallString<128> TimestampFile(Dir);
+  sys::path::append(TimestampFile, "llvmcache.timestamp");
+  sys::fs::file_status Status;
+  if (Policy.Interval && !sys::fs::status(TimestampFile, Status) &&
+      Status.getLastModificationTime().toEpochTime() + Policy.Interval > Now)
+    return false;
+  {
+    std::error_code EC;
+    raw_fd_ostream Timestamp(TimestampFile, EC, sys::fs::F_None);
+    if (EC)
+      return false;
+  }
+
+  struct CacheEntry {
+    std::string Path;
+    uint64_t LastUse;
+    uint64_t Size;
+  };
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    // Skip the timestamp, lock files and entries being written.
+    StringRef Name = sys::path::filename(I->path());
+    if (!Name.startswith("llvmcache-") || Name.find('.') != StringRef::npos)
+      continue;
+    if (I->status(Status))
+      continue;
+    uint64_t LastUse = Status.getLastModificationTime().toEpochTime();
+    if (Policy.Expiration && LastUse + Policy.Expiration < Now) {
+      sys::fs::remove(I->path());
+      continue;
+    }
+    CacheEntry Entry = {I->path(), LastUse, Status.getSize()};
+    Entries.push_back(Entry);
+    TotalSize += Entry.Size;
+  }
+
+  if (Policy.MaxSize && TotalSize > Policy.MaxSize) {
+    std::sort(Entries.begin(), Entries.end(),
+              [](const CacheEntry &A, const CacheEntry &B) {
+                if (A.LastUse != B.LastUse)
+                  return A.LastUse < B.LastUse;
+                return A.Path < B.Path;
+              });
+    for (const CacheEntry &Entry : Entries) {
+      if (TotalSize <= Policy.MaxSize)
+        break;
+      sys::fs::remove(Entry.Path);
+      TotalSize -= Entry.Size;
+    }
+  }
+  return true;
+}
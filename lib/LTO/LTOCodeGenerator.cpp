@@ -13,11 +13,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOCodeGenerator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -305,19 +307,19 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   if (TargetMach)
     return true;
 
-  std::string TripleStr = IRLinker.getModule()->getTargetTriple();
+  TripleStr = IRLinker.getModule()->getTargetTriple();
   if (TripleStr.empty())
     TripleStr = sys::getDefaultTargetTriple();
   llvm::Triple Triple(TripleStr);
 
   // create target machine from info for merged modules
-  const Target *march = TargetRegistry::lookupTarget(TripleStr, errMsg);
-  if (!march)
+  MArch = TargetRegistry::lookupTarget(TripleStr, errMsg);
+  if (!MArch)
     return false;
 
   // The relocation model is actually a static member of TargetMachine and
   // needs to be set before the TargetMachine is instantiated.
-  Reloc::Model RelocModel = Reloc::Default;
+  RelocModel = Reloc::Default;
   switch (CodeModel) {
   case LTO_CODEGEN_PIC_MODEL_STATIC:
     RelocModel = Reloc::Static;
@@ -337,7 +339,7 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   // the default set of features.
   SubtargetFeatures Features(MAttr);
   Features.getDefaultSubtargetFeatures(Triple);
-  std::string FeatureStr = Features.getString();
+  FeatureStr = Features.getString();
   // Set a default CPU for Darwin triples.
   if (MCpu.empty() && Triple.isOSDarwin()) {
     if (Triple.getArch() == llvm::Triple::x86_64)
@@ -348,7 +350,6 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
       MCpu = "cyclone";
   }
 
-  CodeGenOpt::Level CGOptLevel;
   switch (OptLevel) {
   case 0:
     CGOptLevel = CodeGenOpt::None;
@@ -364,12 +365,16 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
     break;
   }
 
-  TargetMach = march->createTargetMachine(TripleStr, MCpu, FeatureStr, Options,
-                                          RelocModel, CodeModel::Default,
-                                          CGOptLevel);
+  TargetMach = createTargetMachine().release();
   return true;
 }
 
+std::unique_ptr<TargetMachine> LTOCodeGenerator::createTargetMachine() {
+  return std::unique_ptr<TargetMachine>(
+      MArch->createTargetMachine(TripleStr, MCpu, FeatureStr, Options,
+                                 RelocModel, CodeModel::Default, CGOptLevel));
+}
+
 void LTOCodeGenerator::
 applyRestriction(GlobalValue &GV,
                  ArrayRef<StringRef> Libcalls,
@@ -578,6 +583,77 @@ bool LTOCodeGenerator::compileOptimized(raw_pwrite_stream &out,
   return true;
 }
 
+bool LTOCodeGenerator::compileOptimized(ArrayRef<raw_pwrite_stream *> Out,
+                                        std::string &errMsg) {
+  if (Out.size() == 1)
+    return compileOptimized(*Out[0], errMsg);
+
+  if (!this->determineTarget(errMsg))
+    return false;
+
+  Module *mergedModule = IRLinker.getModule();
+
+  // If the bitcode files contain ARC code and were compiled with optimization,
+  // the ObjCARCContractPass must be run, so do it unconditionally here.
+  legacy::PassManager preCodeGenPasses;
+  preCodeGenPasses.add(createObjCARCContractPass());
+  preCodeGenPasses.run(*mergedModule);
+
+  // Every partition is compiled by its own TargetMachine. Locals referenced
+  // across partitions are turned into hidden symbols by the split, which keeps
+  // them out of the interface of the linked output.
+  splitCodeGen(*mergedModule, Out, [this]() { return createTargetMachine(); },
+               TargetMachine::CGFT_ObjectFile, CodeGenThreads);
+
+  return true;
+}
+
+bool LTOCodeGenerator::compileOptimizedToFiles(const char ***names,
+                                               unsigned *count,
+                                               std::string &errMsg) {
+  NativeObjectPaths.clear();
+  NativeObjectPathRefs.clear();
+
+  // make unique temp .o files to put generated object files; they are removed
+  // again when ObjFiles goes out of scope, unless the compilation succeeded.
+  std::vector<std::unique_ptr<tool_output_file>> ObjFiles;
+  std::vector<raw_pwrite_stream *> OSs;
+  for (unsigned I = 0; I != CodeGenPartitions; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    std::error_code EC =
+        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+    ObjFiles.push_back(make_unique<tool_output_file>(Filename.c_str(), FD));
+    OSs.push_back(&ObjFiles.back()->os());
+    NativeObjectPaths.push_back(Filename.str());
+  }
+
+  // generate object files
+  bool genResult = compileOptimized(OSs, errMsg);
+  for (auto &ObjFile : ObjFiles) {
+    ObjFile->os().close();
+    if (ObjFile->os().has_error()) {
+      ObjFile->os().clear_error();
+      errMsg = "could not write object file";
+      genResult = false;
+    }
+  }
+  if (!genResult)
+    return false;
+
+  for (auto &ObjFile : ObjFiles)
+    ObjFile->keep();
+  for (const std::string &Path : NativeObjectPaths)
+    NativeObjectPathRefs.push_back(Path.c_str());
+  *names = NativeObjectPathRefs.data();
+  *count = NativeObjectPathRefs.size();
+  return true;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
@@ -0,0 +1,392 @@
+//===-ThinLTOCodeGenerator.cpp - LLVM Thin Link Time Optimizer ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Thin Link Time Optimization driver.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "thinlto"
+
+STATISTIC(NumBackends, "Number of modules optimized and compiled");
+STATISTIC(NumCacheHits, "Number of object files reused from the cache");
+
+ThinLTOCodeGenerator::ThinLTOCodeGenerator()
+    : RelocModel(Reloc::Default), OptLevel(2), ThreadCount(0),
+      ImportInstrLimit(100) {}
+
+ThinLTOCodeGenerator::~ThinLTOCodeGenerator() {}
+
+void ThinLTOCodeGenerator::addModule(StringRef Identifier, StringRef Data) {
+  ModuleInput Input;
+  Input.Identifier = Identifier;
+  Input.Data = Data;
+  Modules.push_back(Input);
+}
+
+std::unique_ptr<FunctionInfoIndex>
+ThinLTOCodeGenerator::linkSummaries(std::string &ErrMsg) {
+  std::unique_ptr<FunctionInfoIndex> Index(new FunctionInfoIndex());
+  LLVMContext Context;
+  for (const ModuleInput &Input : Modules) {
+    MemoryBufferRef Buffer(Input.Data, Input.Identifier);
+    std::unique_ptr<FunctionInfoIndex> ModuleIndex;
+    if (hasFunctionSummary(Buffer, Context)) {
+      ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+          getFunctionInfoIndex(Buffer, Context);
+      if (std::error_code EC = IndexOrErr.getError()) {
+        ErrMsg = "error reading summaries of '" + Input.Identifier +
+                 "': " + EC.message();
+        return nullptr;
+      }
+      ModuleIndex = std::move(IndexOrErr.get());
+    } else {
+      // Fall back to summarizing the module ourselves.
+      ErrorOr<Module *> ModuleOrErr = parseBitcodeFile(Buffer, Context);
+      if (std::error_code EC = ModuleOrErr.getError()) {
+        ErrMsg = "error loading '" + Input.Identifier + "': " + EC.message();
+        return nullptr;
+      }
+      std::unique_ptr<Module> M(ModuleOrErr.get());
+      ModuleIndex = FunctionInfoIndex::build(*M, Input.Identifier);
+    }
+    Index->mergeFrom(*ModuleIndex);
+  }
+  return Index;
+}
+
+ThinLTOCodeGenerator::ImportListTy
+ThinLTOCodeGenerator::computeImportList(const FunctionInfoIndex &Index,
+                                        unsigned ModuleID,
+                                        unsigned InstrLimit) {
+  ImportListTy ImportList;
+  StringSet<> Visited;
+  std::vector<StringRef> Worklist;
+  for (StringRef Name : Index.getModuleFunctions(ModuleID)) {
+    Visited.insert(Name);
+    for (const FunctionInfo &Info : Index.findFunctionInfoList(Name))
+      if (Info.ModuleID == ModuleID)
+        Worklist.insert(Worklist.end(), Info.Summary.callees().begin(),
+                        Info.Summary.callees().end());
+  }
+
+  for (unsigned I = 0; I != Worklist.size(); ++I) {
+    StringRef Callee = Worklist[I];
+    if (!Visited.insert(Callee).second)
+      continue;
+
+    // Take the first definition worth importing.
+    for (const FunctionInfo &Info : Index.findFunctionInfoList(Callee)) {
+      const FunctionSummary &Summary = Info.Summary;
+      if (Info.ModuleID == ModuleID || !Summary.isEligibleForImport() ||
+          Summary.getInstCount() > InstrLimit)
+        continue;
+      ImportList[Info.ModuleID].push_back(Callee);
+      // The callees of an imported function become candidates in turn.
+      Worklist.insert(Worklist.end(), Summary.callees().begin(),
+                      Summary.callees().end());
+      break;
+    }
+  }
+  return ImportList;
+}
+
+bool ThinLTOCodeGenerator::importFunctions(Module &M,
+                                           const ImportListTy &Imports,
+                                           std::string &ErrMsg) {
+  for (const auto &Import : Imports) {
+    const ModuleInput &Input = Modules[Import.first];
+    ErrorOr<Module *> SrcOrErr = getLazyBitcodeModule(
+        MemoryBuffer::getMemBuffer(Input.Data, Input.Identifier, false),
+        M.getContext());
+    if (std::error_code EC = SrcOrErr.getError()) {
+      ErrMsg = "error loading '" + Input.Identifier + "': " + EC.message();
+      return false;
+    }
+    std::unique_ptr<Module> Src(SrcOrErr.get());
+
+    SmallPtrSet<const GlobalValue *, 8> Selected;
+    for (const std::string &Name : Import.second) {
+      Function *F = Src->getFunction(Name);
+      if (!F || F->isDeclaration())
+        continue;
+      // Another definition may already have been linked in.
+      if (Function *Existing = M.getFunction(Name))
+        if (!Existing->isDeclaration())
+          continue;
+      if (std::error_code EC = F->materialize()) {
+        ErrMsg = "error importing '" + Name + "' from '" + Input.Identifier +
+                 "': " + EC.message();
+        return false;
+      }
+      Selected.insert(F);
+    }
+    if (Selected.empty())
+      continue;
+
+    // Copy the selected functions into a module of their own, referring to
+    // everything else through declarations, and link that module in.
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> ImportM(CloneModule(
+        Src.get(), VMap,
+        [&](const GlobalValue *GV) { return Selected.count(GV) != 0; }));
+    ImportM->setModuleInlineAsm("");
+    while (!ImportM->named_metadata_empty())
+      ImportM->eraseNamedMetadata(ImportM->named_metadata_begin());
+    for (const GlobalValue *GV : Selected) {
+      Function *F = cast<Function>(VMap[GV]);
+      stripDebugInfo(*F);
+      F->setComdat(nullptr);
+    }
+    if (Linker::LinkModules(&M, ImportM.get())) {
+      ErrMsg = "error linking functions imported from '" + Input.Identifier +
+               "'";
+      return false;
+    }
+
+    // The linker only replaces a declaration with a real definition. Once
+    // linked in, the copies must not be emitted again by this module.
+    for (const GlobalValue *GV : Selected)
+      M.getFunction(GV->getName())
+          ->setLinkage(GlobalValue::AvailableExternallyLinkage);
+  }
+  return true;
+}
+
+/// Mix the target options that affect code generation into \p Key.
+static void addTargetOptions(LTOCacheKey &Key, const TargetOptions &Options) {
+  Key.add(Options.UnsafeFPMath);
+  Key.add(Options.NoInfsFPMath);
+  Key.add(Options.NoNaNsFPMath);
+  Key.add(Options.HonorSignDependentRoundingFPMathOption);
+  Key.add(Options.UseSoftFloat);
+  Key.add(Options.NoZerosInBSS);
+  Key.add(Options.GuaranteedTailCallOpt);
+  Key.add(Options.DisableTailCalls);
+  Key.add(Options.StackAlignmentOverride);
+  Key.add(Options.EnableFastISel);
+  Key.add(Options.PositionIndependentExecutable);
+  Key.add(Options.UseInitArray);
+  Key.add(Options.FunctionSections);
+  Key.add(Options.DataSections);
+  Key.add(Options.UniqueSectionNames);
+  Key.add(Options.TrapUnreachable);
+  Key.add(Options.TrapFuncName);
+  Key.add(Options.FloatABIType);
+  Key.add(Options.AllowFPOpFusion);
+  Key.add(Options.JTType);
+  Key.add(Options.ThreadModel);
+  const MCTargetOptions &MCOptions = Options.MCOptions;
+  Key.add(MCOptions.SanitizeAddress);
+  Key.add(MCOptions.MCRelaxAll);
+  Key.add(MCOptions.MCNoExecStack);
+  Key.add(MCOptions.MCSaveTempLabels);
+  Key.add(MCOptions.MCUseDwarfDirectory);
+  Key.add(MCOptions.DwarfVersion);
+  Key.add(MCOptions.ABIName);
+}
+
+std::string
+ThinLTOCodeGenerator::computeCacheKey(unsigned ModuleID,
+                                      const ImportListTy &Imports,
+                                      ArrayRef<std::string> ModuleHashes) const {
+  LTOCacheKey Key;
+  Key.add(LLVM_VERSION_STRING);
+  Key.add(ModuleHashes[ModuleID]);
+  // The imported functions are identified by the contents of the modules
+  // they come from.
+  Key.add(Imports.size());
+  for (const auto &Import : Imports) {
+    Key.add(ModuleHashes[Import.first]);
+    Key.add(Import.second.size());
+    for (const std::string &Name : Import.second)
+      Key.add(Name);
+  }
+  Key.add(MCpu);
+  Key.add(MAttr);
+  Key.add(RelocModel);
+  Key.add(OptLevel);
+  addTargetOptions(Key, Options);
+  return Key.final();
+}
+
+bool ThinLTOCodeGenerator::runBackend(unsigned ModuleID,
+                                      const ImportListTy &Imports,
+                                      std::unique_ptr<MemoryBuffer> &Binary,
+                                      std::string &ErrMsg) {
+  ++NumBackends;
+  const ModuleInput &Input = Modules[ModuleID];
+  LLVMContext Context;
+  ErrorOr<Module *> ModuleOrErr =
+      parseBitcodeFile(MemoryBufferRef(Input.Data, Input.Identifier), Context);
+  if (std::error_code EC = ModuleOrErr.getError()) {
+    ErrMsg = "error loading '" + Input.Identifier + "': " + EC.message();
+    return false;
+  }
+  std::unique_ptr<Module> M(ModuleOrErr.get());
+
+  if (!importFunctions(*M, Imports, ErrMsg))
+    return false;
+
+  std::string TripleStr = M->getTargetTriple();
+  if (TripleStr.empty())
+    TripleStr = sys::getDefaultTargetTriple();
+  Triple TheTriple(TripleStr);
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    return false;
+
+  SubtargetFeatures Features(MAttr);
+  Features.getDefaultSubtargetFeatures(TheTriple);
+  CodeGenOpt::Level CGOptLevel;
+  switch (OptLevel) {
+  case 0:
+    CGOptLevel = CodeGenOpt::None;
+    break;
+  case 1:
+    CGOptLevel = CodeGenOpt::Less;
+    break;
+  case 3:
+    CGOptLevel = CodeGenOpt::Aggressive;
+    break;
+  default:
+    CGOptLevel = CodeGenOpt::Default;
+    break;
+  }
+  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+      TripleStr, MCpu, Features.getString(), Options, RelocModel,
+      CodeModel::Default, CGOptLevel));
+  M->setDataLayout(*TM->getDataLayout());
+
+  // Optimize the module with the regular per-module pipeline. Unlike full
+  // LTO, nothing can be internalized since other modules see the symbols.
+  legacy::PassManager Passes;
+  Passes.add(createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+  Passes.add(createVerifierPass());
+  PassManagerBuilder PMB;
+  PMB.OptLevel = OptLevel;
+  if (OptLevel > 1)
+    PMB.Inliner = createFunctionInliningPass();
+  else
+    PMB.Inliner = createAlwaysInlinerPass();
+  PMB.LoopVectorize = OptLevel > 1;
+  PMB.SLPVectorize = OptLevel > 1;
+  PMB.LibraryInfo = new TargetLibraryInfoImpl(TheTriple);
+  PMB.populateModulePassManager(Passes);
+  Passes.run(*M);
+
+  SmallString<0> Object;
+  {
+    raw_svector_ostream OS(Object);
+    legacy::PassManager CodeGenPasses;
+    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
+                                TargetMachine::CGFT_ObjectFile)) {
+      ErrMsg = "target file type not supported";
+      return false;
+    }
+    CodeGenPasses.run(*M);
+  }
+  Binary = MemoryBuffer::getMemBufferCopy(Object, Input.Identifier + ".o");
+  return true;
+}
+
+bool ThinLTOCodeGenerator::run(std::string &ErrMsg) {
+  std::unique_ptr<FunctionInfoIndex> Index = linkSummaries(ErrMsg);
+  if (!Index)
+    return false;
+
+  unsigned NumModules = Modules.size();
+  std::vector<ImportListTy> ImportLists;
+  for (unsigned I = 0; I != NumModules; ++I)
+    ImportLists.push_back(computeImportList(*Index, I, ImportInstrLimit));
+
+  std::unique_ptr<LTOCache> Cache;
+  std::vector<std::string> CacheKeys;
+  if (!CacheDir.empty()) {
+    Cache.reset(new LTOCache(CacheDir));
+    std::vector<std::string> ModuleHashes;
+    for (const ModuleInput &Input : Modules) {
+      LTOCacheKey Hash;
+      Hash.add(Input.Data);
+      ModuleHashes.push_back(Hash.final());
+    }
+    for (unsigned I = 0; I != NumModules; ++I)
+      CacheKeys.push_back(computeCacheKey(I, ImportLists[I], ModuleHashes));
+  }
+
+  ProducedBinaries.clear();
+  ProducedBinaries.resize(NumModules);
+  std::vector<std::string> Errors(NumModules);
+  std::vector<char> Succeeded(NumModules, false);
+  {
+    ThreadPool Pool(ThreadCount);
+    for (unsigned I = 0; I != NumModules; ++I)
+      Pool.async([&, I] {
+        if (!Cache) {
+          Succeeded[I] = runBackend(I, ImportLists[I], ProducedBinaries[I],
+                                    Errors[I]);
+          return;
+        }
+        bool Computed = false;
+        ProducedBinaries[I] = Cache->getOrCompute(
+            CacheKeys[I], [&]() -> std::unique_ptr<MemoryBuffer> {
+              Computed = true;
+              std::unique_ptr<MemoryBuffer> Binary;
+              if (!runBackend(I, ImportLists[I], Binary, Errors[I]))
+                return nullptr;
+              return Binary;
+            });
+        if (!Computed)
+          ++NumCacheHits;
+        Succeeded[I] = ProducedBinaries[I] != nullptr;
+      });
+    Pool.wait();
+  }
+
+  if (Cache)
+    Cache->prune(CachePruningPolicy);
+
+  for (unsigned I = 0; I != NumModules; ++I)
+    if (!Succeeded[I]) {
+      ErrMsg = Errors[I];
+      ProducedBinaries.clear();
+      return false;
+    }
+  return true;
+}
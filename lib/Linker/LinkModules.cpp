@@ -59,9 +59,18 @@ class TypeMapTy : public ValueMapTypeRemapper {
   /// getting a body from the source module.
   SmallPtrSet<StructType*, 16> DstResolvedOpaqueTypes;
 
+  /// Pairs of destination and source types that can never be isomorphic, so
+  /// that a mismatch deep in a large struct graph is only found once rather
+  /// than once per global whose type reaches it.
+  DenseSet<std::pair<Type *, Type *>> NonIsomorphicTypes;
+
+  /// Set when the current isomorphism check failed on a mapping that another
+  /// check could make differently, which must not go in NonIsomorphicTypes.
+  bool FailedOnMapping;
+
 public:
   TypeMapTy(Linker::IdentifiedStructTypeSet &DstStructTypesSet)
-      : DstStructTypesSet(DstStructTypesSet) {}
+      : FailedOnMapping(false), DstStructTypesSet(DstStructTypesSet) {}
 
   Linker::IdentifiedStructTypeSet &DstStructTypesSet;
   /// Indicate that the specified type in the destination module is conceptually
@@ -107,6 +116,7 @@ void TypeMapTy::addTypeMapping(Type *DstTy, Type *SrcTy) {
 
   // Check to see if these types are recursively isomorphic and establish a
   // mapping between them if so.
+  FailedOnMapping = false;
   if (!areTypesIsomorphic(DstTy, SrcTy)) {
     // Oops, they aren't isomorphic.  Just discard this request by rolling out
     // any speculative mappings we've established.
@@ -134,10 +144,18 @@ bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
   if (DstTy->getTypeID() != SrcTy->getTypeID())
     return false;
 
+  // So are two types whose structures were found to differ before.
+  if (NonIsomorphicTypes.count(std::make_pair(DstTy, SrcTy)))
+    return false;
+
   // If we have an entry in the MappedTypes table, then we have our answer.
   Type *&Entry = MappedTypes[SrcTy];
-  if (Entry)
-    return Entry == DstTy;
+  if (Entry) {
+    if (Entry == DstTy)
+      return true;
+    FailedOnMapping = true;
+    return false;
+  }
 
   // Two identical types are clearly isomorphic.  Remember this
   // non-speculatively.
@@ -163,8 +181,10 @@ bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
     // that we're trying to map onto the same opaque type then we fail.
     if (cast<StructType>(DstTy)->isOpaque()) {
       // We can only map one source type onto the opaque destination type.
-      if (!DstResolvedOpaqueTypes.insert(cast<StructType>(DstTy)).second)
+      if (!DstResolvedOpaqueTypes.insert(cast<StructType>(DstTy)).second) {
+        FailedOnMapping = true;
         return false;
+      }
       SrcDefinitionsToResolve.push_back(SSTy);
       SpeculativeTypes.push_back(SrcTy);
       SpeculativeDstOpaqueTypes.push_back(cast<StructType>(DstTy));
@@ -173,31 +193,37 @@ bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
     }
   }
 
+  // From here on, a failure only depends on the structure of the two types.
+  auto Mismatch = [&]() {
+    NonIsomorphicTypes.insert(std::make_pair(DstTy, SrcTy));
+    return false;
+  };
+
   // If the number of subtypes disagree between the two types, then we fail.
   if (SrcTy->getNumContainedTypes() != DstTy->getNumContainedTypes())
-    return false;
+    return Mismatch();
 
   // Fail if any of the extra properties (e.g. array size) of the type disagree.
   if (isa<IntegerType>(DstTy))
-    return false;  // bitwidth disagrees.
+    return Mismatch();  // bitwidth disagrees.
   if (PointerType *PT = dyn_cast<PointerType>(DstTy)) {
     if (PT->getAddressSpace() != cast<PointerType>(SrcTy)->getAddressSpace())
-      return false;
+      return Mismatch();
 
   } else if (FunctionType *FT = dyn_cast<FunctionType>(DstTy)) {
     if (FT->isVarArg() != cast<FunctionType>(SrcTy)->isVarArg())
-      return false;
+      return Mismatch();
   } else if (StructType *DSTy = dyn_cast<StructType>(DstTy)) {
     StructType *SSTy = cast<StructType>(SrcTy);
     if (DSTy->isLiteral() != SSTy->isLiteral() ||
         DSTy->isPacked() != SSTy->isPacked())
-      return false;
+      return Mismatch();
   } else if (ArrayType *DATy = dyn_cast<ArrayType>(DstTy)) {
     if (DATy->getNumElements() != cast<ArrayType>(SrcTy)->getNumElements())
-      return false;
+      return Mismatch();
   } else if (VectorType *DVTy = dyn_cast<VectorType>(DstTy)) {
     if (DVTy->getNumElements() != cast<VectorType>(SrcTy)->getNumElements())
-      return false;
+      return Mismatch();
   }
 
   // Otherwise, we speculate that these two types will line up and recursively
@@ -208,7 +234,7 @@ bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
   for (unsigned I = 0, E = SrcTy->getNumContainedTypes(); I != E; ++I)
     if (!areTypesIsomorphic(DstTy->getContainedType(I),
                             SrcTy->getContainedType(I)))
-      return false;
+      return FailedOnMapping ? false : Mismatch();
 
   // If everything seems to have lined up, then everything is great.
   return true;
@@ -260,7 +286,9 @@ Type *TypeMapTy::get(Type *Ty, SmallPtrSet<StructType *, 8> &Visited) {
   // These are types that LLVM itself will unique.
   bool IsUniqued = !isa<StructType>(Ty) || cast<StructType>(Ty)->isLiteral();
 
-#ifndef NDEBUG
+#ifdef XDEBUG
+  // This walks the whole map for every struct type, so it is an expensive
+  // check.
   if (!IsUniqued) {
     for (auto &Pair : MappedTypes) {
       assert(!(Pair.first != Ty && Pair.second == Ty) &&
@@ -427,14 +455,17 @@ class ModuleLinker {
   /// For symbol clashes, prefer those from Src.
   bool OverrideFromSrc;
 
+  /// Link the globals of Src lazily unless DstM declares them.
+  bool LinkOnlyNeeded;
+
 public:
   ModuleLinker(Module *dstM, Linker::IdentifiedStructTypeSet &Set, Module *srcM,
                DiagnosticHandlerFunction DiagnosticHandler,
-               bool OverrideFromSrc)
+               bool OverrideFromSrc, bool LinkOnlyNeeded)
       : DstM(dstM), SrcM(srcM), TypeMap(Set),
         ValMaterializer(TypeMap, DstM, LazilyLinkGlobalValues),
-        DiagnosticHandler(DiagnosticHandler), OverrideFromSrc(OverrideFromSrc) {
-  }
+        DiagnosticHandler(DiagnosticHandler), OverrideFromSrc(OverrideFromSrc),
+        LinkOnlyNeeded(LinkOnlyNeeded) {}
 
   bool run();
 
@@ -612,7 +643,9 @@ Value *ValueMaterializerTy::materializeValueFor(Value *V) {
     }
   }
 
-  LazilyLinkGlobalValues.push_back(SGV);
+  // A declaration has no body to link.
+  if (!SGV->isDeclaration())
+    LazilyLinkGlobalValues.push_back(SGV);
   return DGV;
 }
 
@@ -1081,9 +1114,12 @@ bool ModuleLinker::linkGlobalValueProto(GlobalValue *SGV) {
   } else {
     // If the GV is to be lazily linked, don't create it just yet.
     // The ValueMaterializerTy will deal with creating it if it's used.
+    // Appending variables such as llvm.used are always linked, they are what
+    // keeps the globals they list alive.
     if (!DGV && !OverrideFromSrc &&
         (SGV->hasLocalLinkage() || SGV->hasLinkOnceLinkage() ||
-         SGV->hasAvailableExternallyLinkage())) {
+         SGV->hasAvailableExternallyLinkage() ||
+         (LinkOnlyNeeded && !SGV->hasAppendingLinkage()))) {
       DoNotLinkFromSource.insert(SGV);
       return false;
     }
@@ -1259,10 +1295,17 @@ void ModuleLinker::linkNamedMDNodes() {
     // Don't link module flags here. Do them separately.
     if (&*I == SrcModFlags) continue;
     NamedMDNode *DestNMD = DstM->getOrInsertNamedMetadata(I->getName());
-    // Add Src elements into Dest node.
-    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
-      DestNMD->addOperand(MapMetadata(I->getOperand(i), ValueMap, RF_None,
-                                      &TypeMap, &ValMaterializer));
+    // Add Src elements into Dest node.  Globals that were not needed are
+    // left out rather than materialized.
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
+      if (LinkOnlyNeeded)
+        DestNMD->addOperand(MapMetadata(I->getOperand(i), ValueMap,
+                                        RF_NullMapMissingGlobalValues,
+                                        &TypeMap));
+      else
+        DestNMD->addOperand(MapMetadata(I->getOperand(i), ValueMap, RF_None,
+                                        &TypeMap, &ValMaterializer));
+    }
   }
 }
 
@@ -1605,8 +1648,10 @@ bool ModuleLinker::run() {
 
   // Remap all of the named MDNodes in Src into the DstM module. We do this
   // after linking GlobalValues so that MDNodes that reference GlobalValues
-  // are properly remapped.
-  linkNamedMDNodes();
+  // are properly remapped.  When only linking what is needed, named metadata
+  // must not pull in more globals, so wait until they are all linked.
+  if (!LinkOnlyNeeded)
+    linkNamedMDNodes();
 
   // Merge the module flags into the DstM module.
   if (linkModuleFlagsMetadata())
@@ -1631,6 +1676,9 @@ bool ModuleLinker::run() {
       return true;
   }
 
+  if (LinkOnlyNeeded)
+    linkNamedMDNodes();
+
   return false;
 }
 
@@ -1756,9 +1804,10 @@ void Linker::deleteModule() {
   Composite = nullptr;
 }
 
-bool Linker::linkInModule(Module *Src, bool OverrideSymbols) {
+bool Linker::linkInModule(Module *Src, bool OverrideSymbols,
+                          bool LinkOnlyNeeded) {
   ModuleLinker TheLinker(Composite, IdentifiedStructTypes, Src,
-                         DiagnosticHandler, OverrideSymbols);
+                         DiagnosticHandler, OverrideSymbols, LinkOnlyNeeded);
   bool RetCode = TheLinker.run();
   Composite->dropTriviallyDeadConstantArrays();
   return RetCode;
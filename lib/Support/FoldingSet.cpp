@@ -169,16 +169,6 @@ bool FoldingSetNodeID::operator<(FoldingSetNodeIDRef RHS) const {
   return FoldingSetNodeIDRef(Bits.data(), Bits.size()) < RHS;
 }
 
-/// Intern - Copy this node's data to a memory region allocated from the
-/// given allocator and return a FoldingSetNodeIDRef describing the
-/// interned data.
-FoldingSetNodeIDRef
-FoldingSetNodeID::Intern(BumpPtrAllocator &Allocator) const {
-  unsigned *New = Allocator.Allocate<unsigned>(Bits.size());
-  std::uninitialized_copy(Bits.begin(), Bits.end(), New);
-  return FoldingSetNodeIDRef(New, Bits.size());
-}
-
 //===----------------------------------------------------------------------===//
 /// Helper functions for FoldingSetImpl.
 
@@ -0,0 +1,39 @@
+//===- llvm/Support/Parallel.cpp - Parallel algorithms --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/ManagedStatic.h"
+
+using namespace llvm;
+
+static ManagedStatic<ThreadPool> DefaultThreadPool;
+
+ThreadPool &llvm::getDefaultThreadPool() { return *DefaultThreadPool; }
+
+void TaskGroup::spawn(std::function<void()> F) {
+  auto Future = Pool.async(std::move(F));
+  std::lock_guard<std::mutex> LockGuard(Lock);
+  Futures.push_back(std::move(Future));
+}
+
+void TaskGroup::sync() {
+  // Tasks may spawn more tasks into this group while we wait, so keep
+  // draining until no future is left.
+  while (true) {
+    std::vector<std::shared_future<void>> Pending;
+    {
+      std::lock_guard<std::mutex> LockGuard(Lock);
+      Pending.swap(Futures);
+    }
+    if (Pending.empty())
+      return;
+    for (auto &Future : Pending)
+      Pool.waitFor(Future);
+  }
+}
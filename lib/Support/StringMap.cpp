@@ -12,11 +12,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Compiler.h"
 #include <cassert>
 using namespace llvm;
 
+/// hashKey - Compute the full hash value of a key.  This uses the hashing
+/// library, which consumes the string a word at a time, rather than the
+/// byte-at-a-time HashString: long mangled names are common keys, and the
+/// hash is recomputed on every lookup.  The value is truncated to the width
+/// of the full hash values stored in the table.
+static inline unsigned hashKey(StringRef Key) {
+  return (unsigned)hash_combine_range(Key.begin(), Key.end());
+}
+
 StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
   ItemSize = itemSize;
   
@@ -61,7 +70,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
     init(16);
     HTSize = NumBuckets;
   }
-  unsigned FullHashValue = HashString(Name);
+  unsigned FullHashValue = hashKey(Name);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
@@ -116,7 +125,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 int StringMapImpl::FindKey(StringRef Key) const {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
+  unsigned FullHashValue = hashKey(Key);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
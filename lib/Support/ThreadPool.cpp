@@ -0,0 +1,201 @@
+//==-- llvm/Support/ThreadPool.cpp - A work-stealing ThreadPool --*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a work-stealing pool of worker threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+#include <cassert>
+
+using namespace llvm;
+
+#if LLVM_ENABLE_THREADS
+
+// The pool and queue index of the worker running on the current thread, if
+// any. Used to route tasks spawned from a task onto the spawner's own queue.
+static LLVM_THREAD_LOCAL ThreadPool *CurrentPool = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentIndex = 0;
+
+static unsigned getDefaultThreadCount() {
+  unsigned Count = std::thread::hardware_concurrency();
+  return Count ? Count : 1;
+}
+
+ThreadPool::ThreadPool() : ThreadPool(getDefaultThreadCount()) {}
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : PendingTasks(0), NextQueue(0), EnableFlag(true) {
+  if (ThreadCount == 0)
+    ThreadCount = getDefaultThreadCount();
+  Queues.reserve(ThreadCount);
+  for (unsigned I = 0; I < ThreadCount; ++I)
+    Queues.emplace_back(new WorkQueue());
+  // Create ThreadCount threads that will loop forever, wait on
+  // WorkAvailableCondition for tasks to be queued, and run them.
+  Threads.reserve(ThreadCount);
+  for (unsigned I = 0; I < ThreadCount; ++I)
+    Threads.emplace_back([this, I] { workerLoop(I); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    EnableFlag = false;
+  }
+  WorkAvailableCondition.notify_all();
+  for (auto &Worker : Threads)
+    Worker.join();
+}
+
+bool ThreadPool::isWorkerThread() const { return CurrentPool == this; }
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  PackagedTaskTy PackagedTask(std::move(Task));
+  auto Future = PackagedTask.get_future().share();
+
+  // Tasks spawned by one of our workers go to the back of that worker's own
+  // queue; everything else is spread round-robin over all queues.
+  unsigned Index = isWorkerThread()
+                       ? CurrentIndex
+                       : NextQueue.fetch_add(1) % Queues.size();
+  ++PendingTasks;
+  {
+    std::unique_lock<std::mutex> LockGuard(Queues[Index]->Lock);
+    Queues[Index]->Tasks.push_back(std::move(PackagedTask));
+  }
+
+  // Take the state lock so that a worker that just found every queue empty
+  // cannot miss this notification.
+  { std::unique_lock<std::mutex> LockGuard(StateLock); }
+  WorkAvailableCondition.notify_one();
+  CompletionCondition.notify_all();
+  return Future;
+}
+
+bool ThreadPool::tryPopTask(unsigned Self, PackagedTaskTy &Task) {
+  // Newest task first from our own queue.
+  {
+    WorkQueue &Own = *Queues[Self];
+    std::unique_lock<std::mutex> LockGuard(Own.Lock);
+    if (!Own.Tasks.empty()) {
+      Task = std::move(Own.Tasks.back());
+      Own.Tasks.pop_back();
+      return true;
+    }
+  }
+  // Otherwise steal the oldest task of another worker.
+  unsigned NumQueues = Queues.size();
+  for (unsigned I = 1; I < NumQueues; ++I) {
+    WorkQueue &Victim = *Queues[(Self + I) % NumQueues];
+    std::unique_lock<std::mutex> LockGuard(Victim.Lock);
+    if (!Victim.Tasks.empty()) {
+      Task = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::hasQueuedTasks() const {
+  for (const auto &Queue : Queues) {
+    std::unique_lock<std::mutex> LockGuard(Queue->Lock);
+    if (!Queue->Tasks.empty())
+      return true;
+  }
+  return false;
+}
+
+bool ThreadPool::runPendingTask(unsigned Self) {
+  PackagedTaskTy Task;
+  if (!tryPopTask(Self, Task))
+    return false;
+  Task();
+  finishTask();
+  return true;
+}
+
+void ThreadPool::finishTask() {
+  --PendingTasks;
+  { std::unique_lock<std::mutex> LockGuard(StateLock); }
+  CompletionCondition.notify_all();
+}
+
+void ThreadPool::workerLoop(unsigned Index) {
+  CurrentPool = this;
+  CurrentIndex = Index;
+  while (true) {
+    if (runPendingTask(Index))
+      continue;
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    // Wait for tasks to be pushed in the queues, or for the pool to shut
+    // down.
+    WorkAvailableCondition.wait(
+        LockGuard, [&] { return !EnableFlag || hasQueuedTasks(); });
+    // Exit only once all the queues have been drained.
+    if (!EnableFlag && !hasQueuedTasks())
+      return;
+  }
+}
+
+void ThreadPool::wait() {
+  assert(!isWorkerThread() &&
+         "ThreadPool::wait() would deadlock when called from a worker; "
+         "use waitFor() on the futures instead");
+  std::unique_lock<std::mutex> LockGuard(StateLock);
+  CompletionCondition.wait(LockGuard, [&] { return PendingTasks == 0; });
+}
+
+void ThreadPool::waitFor(const std::shared_future<void> &Future) {
+  auto IsReady = [&] {
+    return Future.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  };
+  if (!isWorkerThread()) {
+    Future.wait();
+    return;
+  }
+  // Keep this worker busy with other tasks until the future is satisfied.
+  while (!IsReady()) {
+    if (runPendingTask(CurrentIndex))
+      continue;
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    CompletionCondition.wait(LockGuard,
+                             [&] { return IsReady() || hasQueuedTasks(); });
+  }
+}
+
+#else // LLVM_ENABLE_THREADS
+
+// No threads are available: every task is run synchronously on submission.
+
+ThreadPool::ThreadPool() {}
+
+ThreadPool::ThreadPool(unsigned ThreadCount) {}
+
+ThreadPool::~ThreadPool() {}
+
+bool ThreadPool::isWorkerThread() const { return false; }
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  PackagedTaskTy PackagedTask(std::move(Task));
+  auto Future = PackagedTask.get_future().share();
+  PackagedTask();
+  return Future;
+}
+
+void ThreadPool::wait() {}
+
+void ThreadPool::waitFor(const std::shared_future<void> &Future) {
+  Future.wait();
+}
+
+#endif // LLVM_ENABLE_THREADS
@@ -532,6 +532,15 @@ raw_fd_ostream::raw_fd_ostream(int fd, bool shouldClose, bool unbuffered)
   SupportsSeeking = !EC && Status.type() == sys::fs::file_type::regular_file;
 #else
   SupportsSeeking = loc != (off_t)-1;
+#endif
+#if defined(HAVE_FCNTL_H) && defined(O_APPEND)
+  // Writes to a file opened for appending all go to its end, so it can't be
+  // written at an offset.
+  if (SupportsSeeking) {
+    int Flags = ::fcntl(FD, F_GETFL);
+    if (Flags != -1 && (Flags & O_APPEND))
+      SupportsSeeking = false;
+  }
 #endif
   if (!SupportsSeeking)
     pos = 0;
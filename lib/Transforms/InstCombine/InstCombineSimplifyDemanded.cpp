@@ -74,6 +74,9 @@ bool InstCombiner::SimplifyDemandedBits(Use &U, APInt DemandedMask,
   Value *NewVal = SimplifyDemandedUseBits(U.get(), DemandedMask, KnownZero,
                                           KnownOne, Depth, UserI);
   if (!NewVal) return false;
+  // The old value may have been changed in place, and the user is.
+  if (KBC)
+    KBC->invalidate(U.get());
   U = NewVal;
   return true;
 }
@@ -75,6 +75,11 @@ STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
 
+static cl::opt<bool>
+UseKnownBitsCache("instcombine-known-bits-cache", cl::Hidden, cl::init(false),
+                  cl::desc("Cache the known bits of the instructions across "
+                           "the combines of a function"));
+
 Value *InstCombiner::EmitGEPOffset(User *GEP) {
   return llvm::EmitGEPOffset(Builder, DL, GEP);
 }
@@ -317,7 +322,10 @@ bool InstCombiner::SimplifyAssociativeOrCommutative(BinaryOperator &I) {
       }
     }
 
-    // No further simplifications.
+    // No further simplifications.  The users of I may have cached known bits
+    // computed from its old form.
+    if (Changed && KBC)
+      KBC->invalidate(&I);
     return Changed;
   } while (1);
 }
@@ -2957,6 +2965,13 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
   // by instcombiner.
   bool DbgDeclaresChanged = LowerDbgDeclare(F);
 
+  // The known bits stay valid across the iterations: the instructions changed
+  // in place are invalidated when they are added to the worklist again, and
+  // the cache forgets what is replaced or erased.
+  KnownBitsCache KBC;
+  if (UseKnownBitsCache)
+    Worklist.setKnownBitsCache(&KBC);
+
   // Iterate while there is work to do.
   int Iteration = 0;
   for (;;) {
@@ -2968,7 +2983,8 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
     if (prepareICWorklistFromFunction(F, DL, &TLI, Worklist))
       Changed = true;
 
-    InstCombiner IC(Worklist, &Builder, MinimizeSize, &AC, &TLI, &DT, DL, LI);
+    InstCombiner IC(Worklist, &Builder, MinimizeSize, &AC, &TLI, &DT, DL, LI,
+                    UseKnownBitsCache ? &KBC : nullptr);
     if (IC.run())
       Changed = true;
 
@@ -2976,6 +2992,7 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
       break;
   }
 
+  Worklist.setKnownBitsCache(nullptr);
   return DbgDeclaresChanged || Iteration > 1;
 }
 
@@ -3015,6 +3032,7 @@ public:
 
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   bool runOnFunction(Function &F) override;
+  Pass *clone() const override { return new InstructionCombiningPass(); }
 };
 }
 
@@ -52,6 +52,8 @@ struct AlignmentFromAssumptions : public FunctionPass {
 
   bool runOnFunction(Function &F) override;
 
+  Pass *clone() const override { return new AlignmentFromAssumptions(); }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<AssumptionCacheTracker>();
     AU.addRequired<ScalarEvolution>();
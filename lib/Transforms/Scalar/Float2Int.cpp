@@ -58,6 +58,7 @@ namespace {
     }
 
     bool runOnFunction(Function &F) override;
+    Pass *clone() const override { return new Float2Int(); }
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.setPreservesCFG();
     }
@@ -101,6 +101,8 @@ namespace {
 
     bool runOnLoop(Loop *L, LPPassManager &LPM) override;
 
+    Pass *clone() const override { return new LICM(); }
+
     /// This transformation requires natural loop information & requires that
     /// loop preheaders be inserted into the CFG...
     ///
@@ -69,6 +69,7 @@ namespace {
     }
 
     bool runOnLoop(Loop *L, LPPassManager &LPM) override;
+    Pass *clone() const override { return new LoopRotate(MaxHeaderSize); }
     bool simplifyLoopLatch(Loop *L);
     bool rotateLoop(Loop *L, bool SimplifiedLatch);
 
@@ -130,6 +130,23 @@ namespace {
 
     bool runOnLoop(Loop *L, LPPassManager &LPM) override;
 
+    Pass *clone() const override {
+      LoopUnroll *Copy = new LoopUnroll();
+      Copy->CurrentCount = CurrentCount;
+      Copy->CurrentThreshold = CurrentThreshold;
+      Copy->CurrentAbsoluteThreshold = CurrentAbsoluteThreshold;
+      Copy->CurrentMinPercentOfOptimized = CurrentMinPercentOfOptimized;
+      Copy->CurrentAllowPartial = CurrentAllowPartial;
+      Copy->CurrentRuntime = CurrentRuntime;
+      Copy->UserCount = UserCount;
+      Copy->UserThreshold = UserThreshold;
+      Copy->UserAbsoluteThreshold = UserAbsoluteThreshold;
+      Copy->UserPercentOfOptimized = UserPercentOfOptimized;
+      Copy->UserAllowPartial = UserAllowPartial;
+      Copy->UserRuntime = UserRuntime;
+      return Copy;
+    }
+
     /// This transformation requires natural loop information & requires that
     /// loop preheaders be inserted into the CFG...
     ///
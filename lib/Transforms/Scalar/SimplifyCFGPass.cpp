@@ -208,6 +208,10 @@ struct CFGSimplifyPass : public FunctionPass {
     return simplifyFunctionCFG(F, TTI, AC, BonusInstThreshold);
   }
 
+  Pass *clone() const override {
+    return new CFGSimplifyPass(BonusInstThreshold);
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<AssumptionCacheTracker>();
     AU.addRequired<TargetTransformInfoWrapperPass>();
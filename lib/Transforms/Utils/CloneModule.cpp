@@ -33,6 +33,23 @@ Module *llvm::CloneModule(const Module *M) {
 }
 
 Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
+  return CloneModule(M, VMap, [](const GlobalValue *GV) { return true; });
+}
+
+/// Give the definition NewGV the comdat of OrigGV, creating it in the new
+/// module if needed.
+static void copyComdat(GlobalObject *NewGV, const GlobalObject *OrigGV) {
+  const Comdat *SC = OrigGV->getComdat();
+  if (!SC)
+    return;
+  Comdat *DC = NewGV->getParent()->getOrInsertComdat(SC->getName());
+  DC->setSelectionKind(SC->getSelectionKind());
+  NewGV->setComdat(DC);
+}
+
+Module *llvm::CloneModule(
+    const Module *M, ValueToValueMapTy &VMap,
+    std::function<bool(const GlobalValue *)> ShouldCloneDefinition) {
   // First off, we need to create the new module.
   Module *New = new Module(M->getModuleIdentifier(), M->getContext());
   New->setDataLayout(M->getDataLayout());
@@ -45,6 +62,11 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
   //
   for (Module::const_global_iterator I = M->global_begin(), E = M->global_end();
        I != E; ++I) {
+    // Appending globals such as llvm.global_ctors cannot be declared, and
+    // nothing but the IR-level intrinsics refers to them, so skip them
+    // entirely when their definition is not wanted.
+    if (I->hasAppendingLinkage() && !ShouldCloneDefinition(I))
+      continue;
     GlobalVariable *GV = new GlobalVariable(*New, 
                                             I->getType()->getElementType(),
                                             I->isConstant(), I->getLinkage(),
@@ -69,9 +91,29 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
   for (Module::const_alias_iterator I = M->alias_begin(), E = M->alias_end();
        I != E; ++I) {
     auto *PTy = cast<PointerType>(I->getType());
-    auto *GA = GlobalAlias::create(PTy, I->getLinkage(), I->getName(), New);
-    GA->copyAttributesFrom(I);
-    VMap[I] = GA;
+    if (ShouldCloneDefinition(I)) {
+      auto *GA = GlobalAlias::create(PTy, I->getLinkage(), I->getName(), New);
+      GA->copyAttributesFrom(I);
+      VMap[I] = GA;
+      continue;
+    }
+
+    // An alias cannot act as an external reference, so we need to create
+    // either a function or a global variable depending on the value type.
+    GlobalValue *GV;
+    if (auto *FTy = dyn_cast<FunctionType>(PTy->getElementType()))
+      GV = Function::Create(FTy, GlobalValue::ExternalLinkage, I->getName(),
+                            New);
+    else
+      GV = new GlobalVariable(*New, PTy->getElementType(), false,
+                              GlobalValue::ExternalLinkage, nullptr,
+                              I->getName(), nullptr,
+                              I->getThreadLocalMode(),
+                              PTy->getAddressSpace());
+    VMap[I] = GV;
+    // We do not copy attributes (mainly because copying between different
+    // kinds of globals is forbidden), but this is generally not required for
+    // correctness.
   }
   
   // Now that all of the things that global variable initializer can refer to
@@ -80,15 +122,28 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
   //
   for (Module::const_global_iterator I = M->global_begin(), E = M->global_end();
        I != E; ++I) {
+    if (!VMap.count(I))
+      continue;
     GlobalVariable *GV = cast<GlobalVariable>(VMap[I]);
+    if (!ShouldCloneDefinition(I)) {
+      // Skip after setting the correct linkage for an external reference.
+      GV->setLinkage(GlobalValue::ExternalLinkage);
+      continue;
+    }
     if (I->hasInitializer())
       GV->setInitializer(MapValue(I->getInitializer(), VMap));
+    copyComdat(GV, I);
   }
 
   // Similarly, copy over function bodies now...
   //
   for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I) {
     Function *F = cast<Function>(VMap[I]);
+    if (!ShouldCloneDefinition(I)) {
+      // Skip after setting the correct linkage for an external reference.
+      F->setLinkage(GlobalValue::ExternalLinkage);
+      continue;
+    }
     if (!I->isDeclaration()) {
       Function::arg_iterator DestI = F->arg_begin();
       for (Function::const_arg_iterator J = I->arg_begin(); J != I->arg_end();
@@ -100,11 +155,15 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
       SmallVector<ReturnInst*, 8> Returns;  // Ignore returns cloned.
       CloneFunctionInto(F, I, VMap, /*ModuleLevelChanges=*/true, Returns);
     }
+    copyComdat(F, I);
   }
 
   // And aliases
   for (Module::const_alias_iterator I = M->alias_begin(), E = M->alias_end();
        I != E; ++I) {
+    // We already dealt with undefined aliases above.
+    if (!ShouldCloneDefinition(I))
+      continue;
     GlobalAlias *GA = cast<GlobalAlias>(VMap[I]);
     if (const Constant *C = I->getAliasee())
       GA->setAliasee(MapValue(C, VMap));
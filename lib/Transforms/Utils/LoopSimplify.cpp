@@ -759,6 +759,8 @@ namespace {
 
     bool runOnFunction(Function &F) override;
 
+    Pass *clone() const override { return new LoopSimplify(); }
+
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<AssumptionCacheTracker>();
 
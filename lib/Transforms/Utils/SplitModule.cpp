@@ -0,0 +1,232 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalObject.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "split-module"
+
+typedef EquivalenceClasses<const GlobalValue *> ClusterMapType;
+typedef DenseMap<const GlobalValue *, unsigned> ClusterIDMapType;
+
+/// Call UserFn for every global value that refers to GV, looking through
+/// constant expressions and constant aggregates. Instructions are attributed to
+/// the function containing them.
+static void
+forEachGlobalValueUser(const GlobalValue *GV,
+                       function_ref<void(const GlobalValue *)> UserFn) {
+  SmallVector<const User *, 8> Worklist(GV->user_begin(), GV->user_end());
+  SmallPtrSet<const User *, 8> Visited;
+  while (!Worklist.empty()) {
+    const User *U = Worklist.pop_back_val();
+    if (!Visited.insert(U).second)
+      continue;
+    if (const Instruction *I = dyn_cast<Instruction>(U)) {
+      UserFn(I->getParent()->getParent());
+    } else if (const GlobalValue *UGV = dyn_cast<GlobalValue>(U)) {
+      UserFn(UGV);
+    } else if (isa<Constant>(U)) {
+      Worklist.append(U->user_begin(), U->user_end());
+    } else {
+      llvm_unreachable("Underimplemented use case");
+    }
+  }
+}
+
+/// Return a rough measure of the amount of code generation work for GV.
+static unsigned getGlobalValueSize(const GlobalValue *GV) {
+  if (const Function *F = dyn_cast<Function>(GV)) {
+    unsigned Size = 1;
+    for (const BasicBlock &BB : *F)
+      Size += BB.size();
+    return Size;
+  }
+  return isa<GlobalVariable>(GV) ? 1 : 0;
+}
+
+/// Group the global values of M that must stay together and assign every group
+/// to one of N partitions, balancing the amount of code per partition.
+static void findPartitions(Module &M, ClusterIDMapType &ClusterIDMap,
+                           unsigned N, bool PreserveLocals) {
+  ClusterMapType GVtoClusterMap;
+  DenseMap<const Comdat *, const GlobalValue *> ComdatMembers;
+
+  SmallVector<const GlobalValue *, 64> Globals;
+  auto RecordGlobal = [&](const GlobalValue &GV) {
+    Globals.push_back(&GV);
+    GVtoClusterMap.insert(&GV);
+
+    // Members of a comdat are discarded or kept together by the linker.
+    if (const Comdat *C = GV.getComdat()) {
+      auto Member = ComdatMembers.insert(std::make_pair(C, &GV));
+      if (!Member.second)
+        GVtoClusterMap.unionSets(Member.first->second, &GV);
+    }
+
+    // An alias has to be defined next to the object it aliases.
+    if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(&GV))
+      if (const GlobalObject *Base = GA->getBaseObject())
+        GVtoClusterMap.unionSets(&GV, Base);
+  };
+  for (const GlobalVariable &GV : M.globals())
+    RecordGlobal(GV);
+  for (const Function &F : M)
+    RecordGlobal(F);
+  for (const GlobalAlias &GA : M.aliases())
+    RecordGlobal(GA);
+
+  // Local symbols cannot be referenced from another partition, so they must
+  // share a partition with all of their users.
+  if (PreserveLocals)
+    for (const GlobalValue *GV : Globals)
+      if (GV->hasLocalLinkage())
+        forEachGlobalValueUser(GV, [&](const GlobalValue *User) {
+          GVtoClusterMap.unionSets(GV, User);
+        });
+
+  // Number the clusters in module order and measure them. The leader of a
+  // cluster depends on the order of the unions above, which is deterministic.
+  DenseMap<const GlobalValue *, unsigned> LeaderToCluster;
+  SmallVector<unsigned, 64> ClusterOf;
+  SmallVector<uint64_t, 64> ClusterSize;
+  for (const GlobalValue *GV : Globals) {
+    const GlobalValue *Leader = GVtoClusterMap.getLeaderValue(GV);
+    auto Cluster =
+        LeaderToCluster.insert(std::make_pair(Leader, ClusterSize.size()));
+    if (Cluster.second)
+      ClusterSize.push_back(0);
+    ClusterOf.push_back(Cluster.first->second);
+    ClusterSize[Cluster.first->second] += getGlobalValueSize(GV);
+  }
+
+  // Hand the biggest clusters out first, each to the least loaded partition.
+  SmallVector<unsigned, 64> Order;
+  for (unsigned I = 0, E = ClusterSize.size(); I != E; ++I)
+    Order.push_back(I);
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return ClusterSize[A] > ClusterSize[B];
+  });
+  SmallVector<uint64_t, 16> PartitionSize(N, 0);
+  SmallVector<unsigned, 64> ClusterPartition(ClusterSize.size(), 0);
+  for (unsigned Cluster : Order) {
+    unsigned Partition =
+        std::min_element(PartitionSize.begin(), PartitionSize.end()) -
+        PartitionSize.begin();
+    ClusterPartition[Cluster] = Partition;
+    PartitionSize[Partition] += ClusterSize[Cluster];
+  }
+
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I)
+    ClusterIDMap[Globals[I]] = ClusterPartition[ClusterOf[I]];
+
+  DEBUG({
+    for (unsigned I = 0; I != N; ++I)
+      dbgs() << "split-module: partition " << I << " size "
+             << PartitionSize[I] << '\n';
+  });
+}
+
+/// Give GV a name if it has none. Unnamed entities must be named consistently
+/// between modules; setName will give a distinct name to each such entity.
+static void nameUnnamed(GlobalValue &GV) {
+  if (!GV.hasName())
+    GV.setName("__llvmsplit_unnamed");
+}
+
+/// Make the local symbol GV visible to the other partitions, but not outside
+/// of the linked output.
+static void externalize(GlobalValue &GV) {
+  GV.setLinkage(GlobalValue::ExternalLinkage);
+  GV.setVisibility(GlobalValue::HiddenVisibility);
+  // Keep the name of comdat members, which may be the comdat's key.
+  if (GV.hasName() && !GV.getComdat())
+    GV.setName(GV.getName() + ".llvm.split");
+  nameUnnamed(GV);
+}
+
+/// Externalize every local symbol of M that is referenced from a partition
+/// other than its own.
+static void externalizeCrossPartitionLocals(Module &M,
+                                            ClusterIDMapType &ClusterIDMap) {
+  auto Visit = [&](GlobalValue &GV) {
+    if (!GV.hasLocalLinkage())
+      return;
+    unsigned Home = ClusterIDMap.lookup(&GV);
+    bool IsReferencedElsewhere = false;
+    forEachGlobalValueUser(&GV, [&](const GlobalValue *User) {
+      if (ClusterIDMap.lookup(User) != Home)
+        IsReferencedElsewhere = true;
+    });
+    if (IsReferencedElsewhere)
+      externalize(GV);
+  };
+  for (Function &F : M)
+    Visit(F);
+  for (GlobalVariable &GV : M.globals())
+    Visit(GV);
+  for (GlobalAlias &GA : M.aliases())
+    Visit(GA);
+}
+
+void llvm::SplitModule(
+    Module &M, unsigned N,
+    std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback,
+    bool PreserveLocals) {
+  // Every symbol that can be referenced across partitions needs a name.
+  for (Function &F : M)
+    if (!F.hasLocalLinkage())
+      nameUnnamed(F);
+  for (GlobalVariable &GV : M.globals())
+    if (!GV.hasLocalLinkage())
+      nameUnnamed(GV);
+  for (GlobalAlias &GA : M.aliases())
+    if (!GA.hasLocalLinkage())
+      nameUnnamed(GA);
+
+  ClusterIDMapType ClusterIDMap;
+  findPartitions(M, ClusterIDMap, N, PreserveLocals);
+  if (!PreserveLocals)
+    externalizeCrossPartitionLocals(M, ClusterIDMap);
+
+  for (unsigned I = 0; I < N; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(
+        CloneModule(&M, VMap, [&](const GlobalValue *GV) {
+          // Declarations are cloned as they are, in every partition.
+          return GV->isDeclaration() || ClusterIDMap.lookup(GV) == I;
+        }));
+    // Module-level inline asm must be emitted exactly once.
+    if (I != 0)
+      MPart->setModuleInlineAsm("");
+    ModuleCallback(std::move(MPart));
+  }
+}
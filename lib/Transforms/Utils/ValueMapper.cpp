@@ -41,8 +41,11 @@ Value *llvm::MapValue(const Value *V, ValueToValueMapTy &VM, RemapFlags Flags,
 
   // Global values do not need to be seeded into the VM if they
   // are using the identity mapping.
-  if (isa<GlobalValue>(V))
+  if (isa<GlobalValue>(V)) {
+    if (Flags & RF_NullMapMissingGlobalValues)
+      return nullptr;
     return VM[V] = const_cast<Value*>(V);
+  }
   
   if (const InlineAsm *IA = dyn_cast<InlineAsm>(V)) {
     // Inline asm may need *type* remapping.
@@ -84,8 +87,10 @@ Value *llvm::MapValue(const Value *V, ValueToValueMapTy &VM, RemapFlags Flags,
     return nullptr;
   
   if (BlockAddress *BA = dyn_cast<BlockAddress>(C)) {
-    Function *F = 
-      cast<Function>(MapValue(BA->getFunction(), VM, Flags, TypeMapper, Materializer));
+    Function *F = cast_or_null<Function>(
+        MapValue(BA->getFunction(), VM, Flags, TypeMapper, Materializer));
+    if (!F)
+      return nullptr;
     BasicBlock *BB = cast_or_null<BasicBlock>(MapValue(BA->getBasicBlock(), VM,
                                                        Flags, TypeMapper, Materializer));
     return VM[V] = BlockAddress::get(F, BB ? BB : BA->getBasicBlock());
@@ -120,12 +125,19 @@ Value *llvm::MapValue(const Value *V, ValueToValueMapTy &VM, RemapFlags Flags,
   
   // If one of the operands mismatch, push it and the other mapped operands.
   if (OpNo != NumOperands) {
+    // Operands only map to null with RF_NullMapMissingGlobalValues.
+    if (!Mapped)
+      return nullptr;
     Ops.push_back(cast<Constant>(Mapped));
   
     // Map the rest of the operands that aren't processed yet.
-    for (++OpNo; OpNo != NumOperands; ++OpNo)
-      Ops.push_back(MapValue(cast<Constant>(C->getOperand(OpNo)), VM,
-                             Flags, TypeMapper, Materializer));
+    for (++OpNo; OpNo != NumOperands; ++OpNo) {
+      Mapped = MapValue(C->getOperand(OpNo), VM, Flags, TypeMapper,
+                        Materializer);
+      if (!Mapped)
+        return nullptr;
+      Ops.push_back(cast<Constant>(Mapped));
+    }
   }
   
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(C))
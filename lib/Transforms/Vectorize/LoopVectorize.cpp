@@ -1193,6 +1193,10 @@ struct LoopVectorize : public FunctionPass {
 
   BlockFrequency ColdEntryFreq;
 
+  Pass *clone() const override {
+    return new LoopVectorize(DisableUnrolling, AlwaysVectorize);
+  }
+
   bool runOnFunction(Function &F) override {
     SE = &getAnalysis<ScalarEvolution>();
     LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
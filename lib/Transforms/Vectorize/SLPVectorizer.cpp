@@ -3066,6 +3066,8 @@ struct SLPVectorizer : public FunctionPass {
   DominatorTree *DT;
   AssumptionCache *AC;
 
+  Pass *clone() const override { return new SLPVectorizer(); }
+
   bool runOnFunction(Function &F) override {
     if (skipOptnoneFunction(F))
       return false;
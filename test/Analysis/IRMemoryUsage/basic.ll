@@ -0,0 +1,43 @@
+; RUN: opt < %s -analyze -ir-memory | FileCheck %s
+
+; The byte counts depend on the host, so only the counts of the objects are
+; checked.
+
+; CHECK: IR memory usage:
+; CHECK-DAG: {{^ *}}4 {{.*}}  BinaryOperator{{$}}
+; CHECK-DAG: {{^ *}}2 {{.*}}  Function{{$}}
+; CHECK-DAG: {{^ *}}3 {{.*}}  Argument{{$}}
+; CHECK-DAG: {{^ *}}2 {{.*}}  BasicBlock{{$}}
+; CHECK-DAG: {{^ *}}1 {{.*}}  CallInst{{$}}
+; CHECK-DAG: {{^ *}}2 {{.*}}  ReturnInst{{$}}
+; CHECK-DAG: {{^ *}}1 {{.*}}  GlobalVariable{{$}}
+; CHECK-DAG: {{^ *}}1 {{.*}}  ConstantDataArray{{$}}
+; CHECK-DAG: {{^ *}}2 {{.*}}  ConstantInt{{$}}
+; CHECK-DAG: {{^ *}}1 {{.*}}  NamedMDNode{{$}}
+; CHECK-DAG: {{^ *}}2 {{.*}}  MDTuple{{$}}
+; CHECK-DAG: {{^ *}}1 {{.*}}  MDString{{$}}
+; CHECK-DAG: {{^ *}}1 {{.*}}  Metadata attachment{{$}}
+; CHECK-DAG: {{^ *}}9 {{.*}}  Value name{{$}}
+; CHECK-DAG: {{^ *}}14 {{.*}}  Use{{$}}
+; CHECK: {{^ *[0-9]+ +[0-9]+ 100.00}}  Total{{$}}
+
+@str = global [4 x i8] c"abc\00"
+
+define i32 @f(i32 %a, i32 %b) {
+entry:
+  %x = add i32 %a, 1
+  %y = mul i32 %x, %b, !custom !0
+  %z = sub i32 %y, 2
+  ret i32 %z
+}
+
+define i32 @g(i32) {
+  %2 = call i32 @f(i32 %0, i32 %0)
+  %3 = xor i32 %2, %0
+  ret i32 %3
+}
+
+!named = !{!1}
+
+!0 = !{!"custom"}
+!1 = !{!0}
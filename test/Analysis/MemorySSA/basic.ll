@@ -0,0 +1,96 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa -memoryssa-print-clobbers < %s | FileCheck %s
+
+; The load in the loop is given the phi of the loop as its version of memory,
+; but only the store before the loop writes what it reads.
+
+; CHECK-LABEL: define void @foo()
+define void @foo() {
+entry:
+  %p1 = alloca i8
+  %p2 = alloca i8
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+; CHECK-NEXT: store i8 0, i8* %p1
+  store i8 0, i8* %p1
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+; CHECK-NEXT: store i8 0, i8* %p2
+  store i8 0, i8* %p2
+  br label %loop
+
+loop:
+; CHECK: loop:
+; CHECK-NEXT: ; 4 = MemoryPhi({entry,2},{loop,3})
+; CHECK-NEXT: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %v = load i8, i8* %p1
+  %v = load i8, i8* %p1
+; CHECK-NEXT: ; 3 = MemoryDef(4)
+; CHECK-NEXT: ; Clobber: 4
+; CHECK-NEXT: store i8 %v, i8* %p2
+  store i8 %v, i8* %p2
+  br label %loop
+}
+
+; A load after a store to the same location is clobbered by the store, even
+; with unrelated stores in between.
+
+; CHECK-LABEL: define i32 @straight(
+define i32 @straight(i32* noalias %a, i32* noalias %b) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+  store i32 1, i32* %a
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+  store i32 2, i32* %b
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %v = load i32, i32* %a
+  %v = load i32, i32* %a
+; CHECK: ; 3 = MemoryDef(2)
+; CHECK-NEXT: ; Clobber: 2
+  store i32 3, i32* %b
+; CHECK: ; MemoryUse(3)
+; CHECK-NEXT: ; Clobber: 3
+; CHECK-NEXT: %w = load i32, i32* %b
+  %w = load i32, i32* %b
+  %x = add i32 %v, %w
+  ret i32 %x
+}
+
+; Stores on both sides of a diamond meet in a phi.  A load of memory that
+; only the sides write is clobbered by the phi; a load of memory that neither
+; side writes is not.
+
+; CHECK-LABEL: define i32 @diamond(
+define i32 @diamond(i1 %c, i32* noalias %a, i32* noalias %b) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %b
+  br i1 %c, label %left, label %right
+
+left:
+; CHECK: ; 2 = MemoryDef(1)
+  store i32 1, i32* %a
+  br label %join
+
+right:
+; CHECK: ; 3 = MemoryDef(1)
+  store i32 2, i32* %a
+  br label %join
+
+join:
+; CHECK: join:
+; CHECK-NEXT: ; 4 = MemoryPhi({left,2},{right,3})
+; CHECK-NEXT: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 4
+; CHECK-NEXT: %v = load i32, i32* %a
+  %v = load i32, i32* %a
+; CHECK-NEXT: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %w = load i32, i32* %b
+  %w = load i32, i32* %b
+  %x = add i32 %v, %w
+  ret i32 %x
+}
@@ -0,0 +1,67 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa -memoryssa-print-clobbers < %s | FileCheck %s
+
+declare void @readnone() readnone
+declare i32 @reads(i32*) readonly
+declare void @writes(i32*)
+
+; A readnone call touches no memory, a readonly call is a use, and any other
+; call is a def.
+
+; CHECK-LABEL: define i32 @kinds(
+define i32 @kinds(i32* %a) {
+entry:
+; CHECK-NOT: Memory
+; CHECK: call void @readnone()
+  call void @readnone()
+; CHECK-NEXT: ; MemoryUse(liveOnEntry)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+; CHECK-NEXT: %v = call i32 @reads(i32* %a)
+  %v = call i32 @reads(i32* %a)
+; CHECK-NEXT: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+; CHECK-NEXT: call void @writes(i32* %a)
+  call void @writes(i32* %a)
+; CHECK-NEXT: ; MemoryUse(1)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %w = call i32 @reads(i32* %a)
+  %w = call i32 @reads(i32* %a)
+  %x = add i32 %v, %w
+  ret i32 %x
+}
+
+; A readonly call is clobbered by a store to what it may read, but not by a
+; store to memory it cannot see.
+
+; CHECK-LABEL: define i32 @store_before_call(
+define i32 @store_before_call(i32* %a) {
+entry:
+  %local = alloca i32
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+; CHECK: ; 2 = MemoryDef(1)
+  store i32 0, i32* %local
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %v = call i32 @reads(i32* %a)
+  %v = call i32 @reads(i32* %a)
+  ret i32 %v
+}
+
+; A load of a local that does not escape is not clobbered by a call.
+
+; CHECK-LABEL: define i32 @call_before_load(
+define i32 @call_before_load(i32* %a) {
+entry:
+  %local = alloca i32
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 1, i32* %local
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+; CHECK-NEXT: call void @writes(i32* %a)
+  call void @writes(i32* %a)
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %v = load i32, i32* %local
+  %v = load i32, i32* %local
+  ret i32 %v
+}
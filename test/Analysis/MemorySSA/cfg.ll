@@ -0,0 +1,34 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa -memoryssa-print-clobbers < %s | FileCheck %s
+
+; A phi has an incoming value for each edge into its block, and the edges
+; from unreachable blocks bring in the live on entry def.  The accesses of
+; unreachable blocks are given the live on entry def too.
+
+; CHECK-LABEL: define i32 @edges(
+define i32 @edges(i32 %c, i32* %a) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+  switch i32 %c, label %join [ i32 0, label %join
+                               i32 1, label %side ]
+
+side:
+; CHECK: ; 2 = MemoryDef(1)
+  store i32 1, i32* %a
+  br label %join
+
+dead:
+; CHECK: dead:
+; CHECK-NEXT: ; 3 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: ; Clobber: liveOnEntry
+  store i32 2, i32* %a
+  br label %join
+
+join:
+; CHECK: join:
+; CHECK-NEXT: ; 4 = MemoryPhi({entry,1},{entry,1},{side,2},{dead,liveOnEntry})
+; CHECK-NEXT: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 4
+  %v = load i32, i32* %a
+  ret i32 %v
+}
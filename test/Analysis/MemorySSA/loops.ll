@@ -0,0 +1,109 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa -memoryssa-print-clobbers < %s | FileCheck %s
+
+; Nested loops that only write %b do not clobber loads of %a: the walker goes
+; around both loops and finds the store before them.
+
+; CHECK-LABEL: define i32 @nested(
+define i32 @nested(i32* noalias %a, i32* noalias %b, i32 %n) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+  br label %outer
+
+outer:
+; CHECK: outer:
+; CHECK-NEXT: ; 3 = MemoryPhi({entry,1},{outer.latch,2})
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+; CHECK: inner:
+; CHECK-NEXT: ; 4 = MemoryPhi({outer,3},{inner,2})
+; CHECK: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %v = load i32, i32* %a
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %v = load i32, i32* %a
+; CHECK: ; 2 = MemoryDef(4)
+; CHECK-NEXT: ; Clobber: 4
+  store i32 %v, i32* %b
+  %j.next = add i32 %j, 1
+  %inner.cond = icmp slt i32 %j.next, %n
+  br i1 %inner.cond, label %inner, label %outer.latch
+
+outer.latch:
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %w = load i32, i32* %a
+  %w = load i32, i32* %a
+  %i.next = add i32 %i, %w
+  %outer.cond = icmp slt i32 %i.next, %n
+  br i1 %outer.cond, label %outer, label %exit
+
+exit:
+; CHECK: exit:
+; CHECK-NEXT: ; MemoryUse(2)
+; CHECK-NEXT: ; Clobber: 1
+  %x = load i32, i32* %a
+  ret i32 %x
+}
+
+; A store in the loop to the location the load reads makes the phi of the
+; loop its clobber, and a store after the load in the same iteration too.
+
+; CHECK-LABEL: define i32 @clobbered_in_loop(
+define i32 @clobbered_in_loop(i32* noalias %a, i32* noalias %b, i32 %n) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+  br label %loop
+
+loop:
+; CHECK: loop:
+; CHECK-NEXT: ; 4 = MemoryPhi({entry,1},{loop,3})
+; CHECK: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 4
+; CHECK-NEXT: %v = load i32, i32* %a
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* %a
+; CHECK: ; 2 = MemoryDef(4)
+; CHECK-NEXT: ; Clobber: 4
+  store i32 %v, i32* %b
+; CHECK: ; 3 = MemoryDef(2)
+; CHECK-NEXT: ; Clobber: 4
+  store i32 %i, i32* %a
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+; CHECK: exit:
+; CHECK-NEXT: ; MemoryUse(3)
+; CHECK-NEXT: ; Clobber: 3
+  %x = load i32, i32* %a
+  ret i32 %x
+}
+
+; A loop without defs gets no phi.
+
+; CHECK-LABEL: define i32 @no_defs_in_loop(
+define i32 @no_defs_in_loop(i32* %a, i32 %n) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+  br label %loop
+
+loop:
+; CHECK: loop:
+; CHECK-NOT: MemoryPhi
+; CHECK: ; MemoryUse(1)
+; CHECK-NEXT: ; Clobber: 1
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* %a
+  %i.next = add i32 %i, %v
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i32 %i.next
+}
@@ -0,0 +1,32 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa -memoryssa-print-clobbers < %s | FileCheck %s
+
+; Volatile and atomic loads are defs, and the walker does not move them, nor
+; fences, across the access above them.
+
+; CHECK-LABEL: define i32 @ordered(
+define i32 @ordered(i32* noalias %a, i32* noalias %b) {
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: ; Clobber: 1
+; CHECK-NEXT: %v = load volatile i32, i32* %b
+  %v = load volatile i32, i32* %b
+; CHECK: ; 3 = MemoryDef(2)
+; CHECK-NEXT: ; Clobber: 2
+; CHECK-NEXT: fence seq_cst
+  fence seq_cst
+; CHECK: ; 4 = MemoryDef(3)
+; CHECK-NEXT: ; Clobber: 3
+; CHECK-NEXT: %w = load atomic i32, i32* %b seq_cst, align 4
+  %w = load atomic i32, i32* %b seq_cst, align 4
+; An unordered load is a plain use, but the ordered load above it may write
+; any memory.
+; CHECK: ; MemoryUse(4)
+; CHECK-NEXT: ; Clobber: 4
+; CHECK-NEXT: %x = load atomic i32, i32* %a unordered, align 4
+  %x = load atomic i32, i32* %a unordered, align 4
+  %y = add i32 %v, %w
+  %z = add i32 %x, %y
+  ret i32 %z
+}
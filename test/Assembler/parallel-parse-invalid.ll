@@ -0,0 +1,12 @@
+; RUN: not llvm-as -asm-parse-threads=4 < %s -o /dev/null 2>&1 | FileCheck %s
+
+; Invalid input is parsed again serially, for the diagnostic.
+
+define i32 @f() {
+  ret i32 0
+}
+
+define i32 @g() {
+; CHECK: :[[@LINE+1]]:11: error: use of undefined value '%x'
+  ret i32 %x
+}
@@ -0,0 +1,51 @@
+; RUN: llvm-as < %s > %t.serial.bc
+; RUN: llvm-as -asm-parse-threads=4 < %s > %t.parallel.bc
+; RUN: cmp %t.serial.bc %t.parallel.bc
+; RUN: llvm-as -asm-parse-threads=4 < %s | llvm-dis | FileCheck %s
+
+; Function bodies parsed on several threads must come out as they do when
+; parsed serially, including the order of the use lists that llvm-as keeps.
+
+%pair = type { i32, %pair* }
+
+@g = global i32 0
+@ptrs = global [2 x i8*] [i8* bitcast (i32* @g to i8*), i8* bitcast (i32 (i32)* @0 to i8*)]
+
+; CHECK-LABEL: define i32 @first(
+; CHECK-NEXT: %v = load i32, i32* @g, !tbaa !0, !custom !3
+; CHECK-NEXT: %w = call i32 @0(i32 %v) #0
+; CHECK-NEXT: %p = getelementptr %pair, %pair* @h, i32 0, i32 0
+define i32 @first() {
+  %v = load i32, i32* @g, !tbaa !0, !custom !3
+  %w = call i32 @0(i32 %v) #0
+  %p = getelementptr %pair, %pair* @h, i32 0, i32 0
+  store i32 %w, i32* %p
+  %q = call i8* @second(i8* bitcast (i32* @g to i8*), i8* bitcast (%pair* @h to i8*))
+  ret i32 ptrtoint (i32* @g to i32)
+}
+
+; CHECK-LABEL: define i8* @second(
+; CHECK-NEXT: store i32 ptrtoint (i32* @g to i32), i32* @g
+define i8* @second(i8* %a, i8* %b) {
+  store i32 ptrtoint (i32* @g to i32), i32* @g
+  %c = icmp eq i8* %a, bitcast (i32* @g to i8*)
+  %r = select i1 %c, i8* %a, i8* bitcast (%pair* @h to i8*)
+  ret i8* %r
+}
+
+; CHECK-LABEL: define internal i32 @0(
+; CHECK-NEXT: %r = add i32 %x, ptrtoint (%pair* @h to i32)
+define internal i32 @0(i32 %x) {
+  %r = add i32 %x, ptrtoint (%pair* @h to i32)
+  ret i32 %r
+}
+
+@h = global %pair { i32 ptrtoint (i32* @g to i32), %pair* @h }
+
+; CHECK: attributes #0 = { nounwind }
+attributes #0 = { nounwind }
+
+!0 = !{!1, !1, i64 0}
+!1 = !{!"int", !2}
+!2 = !{!"tbaa root"}
+!3 = !{i8* bitcast (%pair* @h to i8*)}
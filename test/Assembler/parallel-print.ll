@@ -0,0 +1,63 @@
+; RUN: llvm-as < %s | llvm-dis > %t.serial.ll
+; RUN: llvm-as < %s | llvm-dis -asm-print-threads=4 > %t.parallel.ll
+; RUN: cmp %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+; RUN: llvm-as < %s | llvm-dis -preserve-ll-uselistorder > %t.serial.ll
+; RUN: llvm-as < %s | llvm-dis -preserve-ll-uselistorder -asm-print-threads=4 > %t.parallel.ll
+; RUN: cmp %t.serial.ll %t.parallel.ll
+
+; Functions printed on several threads must come out as they do when printed
+; one after the other, including the metadata and attribute groups numbered
+; while printing the bodies.
+
+%0 = type { i32, %0* }
+
+@g = global i32 0
+
+; CHECK-LABEL: define i32 @first(i32)
+; CHECK-NEXT: %v = load i32, i32* @g, !tbaa !0
+; CHECK-NEXT: %w = call i32 @second(i32 %v) #1
+; CHECK-NEXT: %x = add i32 %0, %w
+; CHECK-NEXT: ret i32 %x, !custom !3
+define i32 @first(i32) {
+  %v = load i32, i32* @g, !tbaa !0
+  %w = call i32 @second(i32 %v) #1
+  %x = add i32 %0, %w
+  ret i32 %x, !custom !3
+}
+
+; CHECK-LABEL: define i32 @second(i32 %a)
+; CHECK-NEXT: %1 = getelementptr %0, %0* null, i32 0, i32 0
+; CHECK-NEXT: %2 = load i32, i32* %1, !range !4
+; CHECK: call void @third() #2
+; CHECK-NEXT: br label %5
+define i32 @second(i32 %a) {
+  %1 = getelementptr %0, %0* null, i32 0, i32 0
+  %2 = load i32, i32* %1, !range !4
+  %3 = add i32 %a, %2
+  %4 = add i32 %3, %a
+  call void @third() #2
+  br label %5
+
+; <label>:5
+  ret i32 %4
+}
+
+; CHECK-LABEL: declare void @third() #0
+declare void @third() #0
+
+; CHECK: attributes #0 = { nounwind }
+; CHECK: attributes #1 = { readonly }
+; CHECK: attributes #2 = { cold }
+attributes #0 = { nounwind }
+attributes #1 = { readonly }
+attributes #2 = { cold }
+
+; CHECK: !0 = !{!1, !1, i64 0}
+; CHECK: !3 = !{!"custom"}
+; CHECK: !4 = !{i32 0, i32 10}
+!0 = !{!1, !1, i64 0}
+!1 = !{!"int", !2}
+!2 = !{!"tbaa root"}
+!3 = !{!"custom"}
+!4 = !{i32 0, i32 10}
@@ -0,0 +1,36 @@
+; RUN: llvm-as < %s | cat > %t.buffered.bc
+; RUN: llvm-as -bitcode-flush-threshold=0 %s -o %t.streamed.bc
+; RUN: cmp %t.buffered.bc %t.streamed.bc
+; RUN: llvm-as -function-index < %s | cat > %t.buffered-index.bc
+; RUN: llvm-as -function-index -bitcode-flush-threshold=0 %s -o %t.streamed-index.bc
+; RUN: cmp %t.buffered-index.bc %t.streamed-index.bc
+; RUN: llvm-link -bitcode-flush-threshold=0 %t.streamed-index.bc -o %t.linked.bc
+; RUN: llvm-dis < %t.linked.bc | FileCheck %s
+
+; Bitcode written out block by block to a seekable file, with the block sizes,
+; the function index offset and the wrapper header patched in place, is the
+; same as bitcode buffered whole and written to a pipe.
+
+target triple = "x86_64-apple-macosx10.10.0"
+
+; CHECK: @g = global i32 1
+@g = global i32 1
+
+; CHECK-LABEL: define i32 @f(
+; CHECK-NEXT: load i32, i32* @g, !tbaa !0
+define i32 @f() {
+  %v = load i32, i32* @g, !tbaa !0
+  ret i32 %v
+}
+
+; CHECK-LABEL: define i32 @h(
+; CHECK-NEXT: call i32 @f()
+define i32 @h() {
+  %v = call i32 @f()
+  ret i32 %v
+}
+
+; CHECK: !0 = !{!1, !1, i64 0}
+!0 = !{!1, !1, i64 0}
+!1 = !{!"int", !2}
+!2 = !{!"tbaa root"}
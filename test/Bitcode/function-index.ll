@@ -0,0 +1,51 @@
+; RUN: llvm-as -function-index < %s | llvm-bcanalyzer -dump | FileCheck %s
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s --check-prefix=NOINDEX
+; RUN: llvm-as -function-index < %s > %t.bc
+; RUN: llvm-dis < %t.bc | FileCheck %s --check-prefix=IR
+; RUN: opt -S %t.bc | FileCheck %s --check-prefix=IR
+; RUN: llvm-extract -func=baz %t.bc -S | FileCheck %s --check-prefix=EXTRACT
+
+; The module records where the index is, and the index follows the bodies,
+; with one entry per body.
+
+; CHECK: <MODULE_BLOCK
+; CHECK: <FUNCTION_INDEX abbrevid={{[0-9]+}} op0={{[1-9][0-9]*}}/>
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_INDEX_BLOCK
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: </FUNCTION_INDEX_BLOCK>
+
+; NOINDEX-NOT: FUNCTION_INDEX
+
+@table = global i8* blockaddress(@baz, %l)
+
+declare void @ext()
+
+; IR-LABEL: define void @foo(
+; IR-NEXT: call void @ext()
+define void @foo() {
+  call void @ext()
+  ret void
+}
+
+; IR-LABEL: define i32 @bar(
+; IR-NEXT: add i32 %x, 1
+define i32 @bar(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; IR-LABEL: define i8* @baz(
+; IR: ret i8* blockaddress(@baz, %l)
+; EXTRACT-NOT: define void @foo(
+; EXTRACT-LABEL: define i8* @baz(
+; EXTRACT: ret i8* blockaddress(@baz, %l)
+define i8* @baz() {
+  br label %l
+l:
+  ret i8* blockaddress(@baz, %l)
+}
@@ -0,0 +1,34 @@
+; RUN: llvm-as -function-summary < %s | llvm-bcanalyzer -dump | FileCheck %s
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s --check-prefix=NOSUMMARY
+; RUN: llvm-as -function-summary < %s | llvm-dis | FileCheck %s --check-prefix=IR
+
+; The summary block comes before the function bodies. Names are numbered in
+; order of first reference: foo is 0, bar is 1 and baz is 2.
+
+; CHECK: <FUNCTION_SUMMARY_BLOCK
+; CHECK-NEXT: <NAME abbrevid=4 op0=102 op1=111 op2=111/>
+; CHECK-NEXT: <NAME abbrevid=4 op0=98 op1=97 op2=114/>
+; CHECK-NEXT: <NAME abbrevid=4 op0=98 op1=97 op2=122/>
+; foo: external linkage, 3 instructions, calls bar and baz. It refers to the
+; internal bar, so it cannot be imported.
+; CHECK-NEXT: <ENTRY abbrevid=5 op0=0 op1=0 op2=0 op3=3 op4=1 op5=2/>
+; bar: internal linkage, 1 instruction.
+; CHECK-NEXT: <ENTRY abbrevid=5 op0=1 op1=3 op2=0 op3=1/>
+; CHECK-NEXT: </FUNCTION_SUMMARY_BLOCK>
+; CHECK: <FUNCTION_BLOCK
+
+; NOSUMMARY-NOT: FUNCTION_SUMMARY_BLOCK
+
+; IR: define void @foo()
+
+define void @foo() {
+  call void @bar()
+  call void @baz()
+  ret void
+}
+
+define internal void @bar() {
+  ret void
+}
+
+declare void @baz()
@@ -0,0 +1,79 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -S %t.bc -o %t.serial.ll
+; RUN: opt -S -bitcode-materialize-threads=4 %t.bc -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+; RUN: llvm-link -S -bitcode-materialize-threads=4 %t.bc | FileCheck %s
+
+; Function bodies parsed on several threads must come out as they do when
+; parsed serially, including the ones that blockaddresses refer to, which are
+; left to the serial parser.
+
+; CHECK: @table = global [2 x i8*] [i8* blockaddress(@target, %a), i8* blockaddress(@target, %b)]
+@table = global [2 x i8*] [i8* blockaddress(@target, %a), i8* blockaddress(@target, %b)]
+@g = global i32 0
+
+; CHECK-LABEL: define i32 @target(
+; CHECK: br i1 %c, label %a, label %b
+define i32 @target(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %a, label %b
+a:
+  ret i32 1
+b:
+  ret i32 2
+}
+
+; CHECK-LABEL: define i8* @other(
+; CHECK-NEXT: ret i8* blockaddress(@self, %l)
+define i8* @other() {
+  ret i8* blockaddress(@self, %l)
+}
+
+; CHECK-LABEL: define void @self(
+; CHECK: indirectbr i8* blockaddress(@self, %l), [label %l]
+define void @self(i8* %p) {
+entry:
+  indirectbr i8* blockaddress(@self, %l), [label %l]
+l:
+  ret void
+}
+
+; CHECK-LABEL: define i32 @load(
+; CHECK-NEXT: load i32, i32* %p, !tbaa !{{[0-9]+}}
+; CHECK-NEXT: add i32 %v, ptrtoint (i32* @g to i32)
+; CHECK-NEXT: call void @llvm.dbg.value(metadata i32 %w, i64 0, metadata !{{[0-9]+}}, metadata !{{[0-9]+}}), !dbg !{{[0-9]+}}
+define i32 @load(i32* %p) {
+  %v = load i32, i32* %p, !tbaa !0
+  %w = add i32 %v, ptrtoint (i32* @g to i32)
+  call void @llvm.dbg.value(metadata i32 %w, i64 0, metadata !7, metadata !8), !dbg !9
+  ret i32 %w, !dbg !9
+}
+
+; CHECK-LABEL: define i32 @calls(
+; CHECK-NEXT: call i32 @load(i32* @g)
+; CHECK-NEXT: call i32 @target(i32 %a)
+define i32 @calls() {
+  %a = call i32 @load(i32* @g)
+  %b = call i32 @target(i32 %a)
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+!llvm.dbg.cu = !{!3}
+!llvm.module.flags = !{!10}
+!0 = !{!1, !1, i64 0}
+!1 = !{!"int", !2}
+!2 = !{!"tbaa root"}
+!3 = !DICompileUnit(language: DW_LANG_C99, file: !4, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: 1, subprograms: !5)
+!4 = !DIFile(filename: "t.c", directory: "/")
+!5 = !{!6}
+!6 = !DISubprogram(name: "load", scope: !4, file: !4, line: 1, isLocal: false, isDefinition: true, function: i32 (i32*)* @load)
+!7 = !DILocalVariable(tag: DW_TAG_auto_variable, name: "w", scope: !6, file: !4, line: 2, type: !11)
+!8 = !DIExpression()
+!9 = !DILocation(line: 2, scope: !6)
+!10 = !{i32 2, !"Debug Info Version", i32 3}
+!11 = !DIBasicType(name: "int", size: 32, align: 32, encoding: DW_ATE_signed)
@@ -0,0 +1,41 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -codegen-partitions=2 \
+; RUN:   -codegen-threads=2 %s -o %t
+; RUN: FileCheck --check-prefix=P0 %s < %t
+; RUN: FileCheck --check-prefix=P1 %s < %t.1
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -codegen-partitions=2 \
+; RUN:   -codegen-threads=1 %s -o %t.serial
+; RUN: cmp %t %t.serial
+; RUN: cmp %t.1 %t.serial.1
+
+; The largest function is placed on its own in the first partition.
+; P0: .globl big
+; P0-NOT: .globl small
+; P0-NOT: helper
+
+; The internal helper stays local and next to its only user.
+; P1-NOT: .globl big
+; P1: .globl small
+; P1: small:
+; P1: callq helper
+; P1-NOT: .globl helper
+; P1: helper:
+
+define i32 @big(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  %2 = mul i32 %1, %a
+  %3 = sub i32 %2, %b
+  %4 = xor i32 %3, %1
+  %5 = add i32 %4, %2
+  %6 = mul i32 %5, %3
+  ret i32 %6
+}
+
+define i32 @small(i32 %a) {
+  %1 = call i32 @helper(i32 %a)
+  ret i32 %1
+}
+
+define internal i32 @helper(i32 %a) noinline {
+  %1 = add i32 %a, 1
+  ret i32 %1
+}
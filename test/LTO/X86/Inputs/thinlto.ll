@@ -0,0 +1,21 @@
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = internal global i32 0
+
+define i32 @leaf(i32 %a) {
+  %1 = mul i32 %a, 3
+  ret i32 %1
+}
+
+define i32 @small(i32 %a) {
+  %1 = call i32 @leaf(i32 %a)
+  %2 = add i32 %1, 1
+  ret i32 %2
+}
+
+define i32 @uses_local(i32 %a) {
+  %1 = load i32, i32* @counter
+  %2 = add i32 %1, %a
+  store i32 %2, i32* @counter
+  ret i32 %2
+}
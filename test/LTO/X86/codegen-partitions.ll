@@ -0,0 +1,45 @@
+; RUN: llvm-as < %s > %t1
+; RUN: llvm-lto -exported-symbol=big -exported-symbol=small \
+; RUN:     -codegen-partitions=2 -o %t2 %t1
+; RUN: llvm-nm %t2 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t2.1 | FileCheck --check-prefix=CHECK1 %s
+; RUN: llvm-objdump -t %t2.1 | FileCheck --check-prefix=VIS %s
+
+; RUN: llvm-lto -exported-symbol=big -exported-symbol=small \
+; RUN:     -codegen-partitions=2 -codegen-threads=1 -o %t3 %t1
+; RUN: cmp %t2 %t3
+; RUN: cmp %t2.1 %t3.1
+
+; The internal helper is placed with its smaller caller and referenced across
+; partitions, so it is promoted to a hidden symbol under a unique name.
+
+; CHECK0: T big
+; CHECK0: U helper.llvm.split
+; CHECK0-NOT: small
+
+; CHECK1-NOT: big
+; CHECK1: T helper.llvm.split
+; CHECK1: T small
+
+; VIS: .hidden helper.llvm.split
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @big(i32 %a, i32 %b) {
+  %1 = mul i32 %a, %b
+  %2 = add i32 %1, %a
+  %3 = xor i32 %2, %b
+  %4 = sub i32 %3, %a
+  %5 = call i32 @helper(i32 %4)
+  ret i32 %5
+}
+
+define i32 @small(i32 %a) {
+  %1 = call i32 @helper(i32 %a)
+  ret i32 %1
+}
+
+define internal i32 @helper(i32 %a) noinline {
+  %1 = mul i32 %a, %a
+  ret i32 %1
+}
@@ -0,0 +1,46 @@
+; REQUIRES: asserts
+; RUN: llvm-as -function-summary < %s > %t1.bc
+; RUN: llvm-as -function-summary < %p/Inputs/thinlto.ll > %t2.bc
+; RUN: rm -rf %t.cache
+
+; The first link compiles both modules and fills the cache.
+; RUN: llvm-lto -thinlto -thinlto-cache-dir=%t.cache -o %t3 %t1.bc %t2.bc \
+; RUN:     -stats 2>&1 | FileCheck %s --check-prefix=COLD
+; RUN: ls %t.cache/llvmcache-* | count 2
+
+; The second one reuses the cached objects.
+; RUN: llvm-lto -thinlto -thinlto-cache-dir=%t.cache -o %t4 %t1.bc %t2.bc \
+; RUN:     -stats 2>&1 | FileCheck %s --check-prefix=WARM
+; RUN: cmp %t3 %t4
+; RUN: cmp %t3.1 %t4.1
+
+; Changing what the first module imports only recompiles the first module.
+; RUN: llvm-lto -thinlto -thinlto-cache-dir=%t.cache -import-instr-limit=0 \
+; RUN:     -o %t5 %t1.bc %t2.bc -stats 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=IMPORTS
+; RUN: cmp %t3.1 %t5.1
+
+; Pruning to a tiny size removes every entry.
+; RUN: llvm-lto -thinlto -thinlto-cache-dir=%t.cache \
+; RUN:     -thinlto-cache-max-size=1 -thinlto-cache-pruning-interval=0 \
+; RUN:     -o %t6 %t1.bc %t2.bc
+; RUN: ls %t.cache | count 1
+
+; COLD: 2 thinlto - Number of modules optimized and compiled
+; COLD-NOT: reused from the cache
+; WARM-NOT: optimized and compiled
+; WARM: 2 thinlto - Number of object files reused from the cache
+; IMPORTS: 1 thinlto - Number of modules optimized and compiled
+; IMPORTS: 1 thinlto - Number of object files reused from the cache
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @small(i32)
+declare i32 @uses_local(i32)
+
+define i32 @main(i32 %a) {
+  %1 = call i32 @small(i32 %a)
+  %2 = call i32 @uses_local(i32 %1)
+  ret i32 %2
+}
@@ -0,0 +1,43 @@
+; RUN: llvm-as -function-summary < %s > %t1.bc
+; RUN: llvm-as -function-summary < %p/Inputs/thinlto.ll > %t2.bc
+; RUN: llvm-lto -thinlto -o %t3 %t1.bc %t2.bc
+; RUN: llvm-nm %t3 | FileCheck %s --check-prefix=NM0
+; RUN: llvm-nm %t3.1 | FileCheck %s --check-prefix=NM1
+
+; Inputs without summaries are summarized on the fly.
+; RUN: llvm-as < %s > %t4.bc
+; RUN: llvm-lto -thinlto -thinlto-threads=2 -o %t5 %t4.bc %t2.bc
+; RUN: llvm-nm %t5 | FileCheck %s --check-prefix=NM0
+
+; With a zero import limit, nothing is imported.
+; RUN: llvm-lto -thinlto -import-instr-limit=0 -o %t6 %t1.bc %t2.bc
+; RUN: llvm-nm %t6 | FileCheck %s --check-prefix=NOIMPORT
+
+; @small is imported and inlined, along with @leaf which it calls. @uses_local
+; refers to an internal global of its module, so it cannot be imported.
+; NM0-NOT: U leaf
+; NM0: T main
+; NM0-NOT: U small
+; NM0: U uses_local
+; NM0-NOT: U small
+
+; The imported copies are not emitted again: every function keeps its single
+; definition in its own module.
+; NM1: T leaf
+; NM1: T small
+; NM1: T uses_local
+
+; NOIMPORT: T main
+; NOIMPORT: U small
+; NOIMPORT: U uses_local
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @small(i32)
+declare i32 @uses_local(i32)
+
+define i32 @main(i32 %a) {
+  %1 = call i32 @small(i32 %a)
+  %2 = call i32 @uses_local(i32 %1)
+  ret i32 %2
+}
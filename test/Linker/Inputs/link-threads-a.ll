@@ -0,0 +1,18 @@
+%struct.S = type { i32, i32 }
+
+@X = appending global [1 x i32] [i32 1]
+
+define linkonce_odr i32 @common() {
+  ret i32 1
+}
+
+define i32 @a(%struct.S* %p) {
+  %f = getelementptr %struct.S, %struct.S* %p, i32 0, i32 1
+  %v = load i32, i32* %f
+  %w = call i32 @common()
+  %r = add i32 %v, %w
+  ret i32 %r
+}
+
+!named = !{!0}
+!0 = !{!"a"}
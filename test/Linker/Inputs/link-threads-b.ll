@@ -0,0 +1,14 @@
+@b.count = internal global i32 0
+
+define internal i32 @b.helper() {
+  %v = load i32, i32* @b.count
+  ret i32 %v
+}
+
+define i32 @b() {
+  %v = call i32 @b.helper()
+  ret i32 %v
+}
+
+!other = !{!0}
+!0 = !{!"b"}
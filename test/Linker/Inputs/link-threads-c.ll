@@ -0,0 +1,20 @@
+%struct.S = type { i32, i32 }
+
+@gc = global i32 2
+@X = appending global [1 x i32] [i32 3]
+
+declare i32 @a(%struct.S*)
+
+define linkonce_odr i32 @common() {
+  ret i32 1
+}
+
+define i32 @c() {
+  %v = load i32, i32* @gc
+  %w = call i32 @common()
+  %r = add i32 %v, %w
+  ret i32 %r
+}
+
+!named = !{!0}
+!0 = !{!"c"}
@@ -0,0 +1,25 @@
+@used_global = global i32 1
+@unused_global = global i32 2
+
+define void @foo() {
+  call void @bar()
+  ret void
+}
+
+define internal void @bar() {
+  %v = load i32, i32* @used_global
+  ret void
+}
+
+define void @unused() {
+  call void @unused_internal()
+  ret void
+}
+
+define internal void @unused_internal() {
+  ret void
+}
+
+!named = !{!0, !1}
+!0 = !{void ()* @foo}
+!1 = !{void ()* @unused, i32* @unused_global}
@@ -0,0 +1,12 @@
+; RUN: not llvm-link %s %p/Inputs/link-threads-flags-b.ll \
+; RUN:   %p/Inputs/link-threads-flags-c.ll -S -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llvm-link -link-threads=2 %s %p/Inputs/link-threads-flags-b.ll \
+; RUN:   %p/Inputs/link-threads-flags-c.ll -S -o /dev/null 2>&1 | FileCheck %s
+
+; The override of the last file comes too late for the conflict between the
+; first two, even when the last two files could be linked together first.
+
+; CHECK: linking module flags 'foo': IDs have conflicting values
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"foo", i32 37}
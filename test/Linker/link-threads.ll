@@ -0,0 +1,48 @@
+; RUN: llvm-link %s %p/Inputs/link-threads-a.ll %p/Inputs/link-threads-b.ll \
+; RUN:   %p/Inputs/link-threads-c.ll -S -o %t.serial.ll
+; RUN: llvm-link -link-threads=2 %s %p/Inputs/link-threads-a.ll \
+; RUN:   %p/Inputs/link-threads-b.ll %p/Inputs/link-threads-c.ll -S -o %t.2.ll
+; RUN: cmp %t.serial.ll %t.2.ll
+; RUN: llvm-link -link-threads=4 %s %p/Inputs/link-threads-a.ll \
+; RUN:   %p/Inputs/link-threads-b.ll %p/Inputs/link-threads-c.ll -S -o %t.4.ll
+; RUN: cmp %t.serial.ll %t.4.ll
+; RUN: FileCheck %s < %t.4.ll
+
+; Linking the files in a tree gives the module they give linked one by one,
+; with the internal globals of a file next to the other globals of the file.
+
+; CHECK: @gs = global %struct.S zeroinitializer
+; CHECK-NEXT: @X = appending global [3 x i32] [i32 0, i32 1, i32 3]
+; CHECK-NEXT: @b.count = internal global i32 0
+; CHECK-NEXT: @gc = global i32 2
+
+; CHECK: define i32 @main()
+; CHECK: define i32 @a(
+; CHECK: define linkonce_odr i32 @common()
+; CHECK: define i32 @b()
+; CHECK: define internal i32 @b.helper()
+; CHECK: define i32 @c()
+
+; CHECK: !named = !{![[A:[0-9]+]], ![[C:[0-9]+]]}
+; CHECK-NEXT: !other = !{![[B:[0-9]+]]}
+; CHECK: ![[A]] = !{!"a"}
+; CHECK: ![[C]] = !{!"c"}
+; CHECK: ![[B]] = !{!"b"}
+
+%struct.S = type { i32, i32 }
+
+@gs = global %struct.S zeroinitializer
+@X = appending global [1 x i32] [i32 0]
+
+declare i32 @a(%struct.S*)
+declare i32 @b()
+declare i32 @c()
+
+define i32 @main() {
+  %x = call i32 @a(%struct.S* @gs)
+  %y = call i32 @b()
+  %z = call i32 @c()
+  %s = add i32 %x, %y
+  %t = add i32 %s, %z
+  ret i32 %t
+}
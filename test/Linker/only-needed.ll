@@ -0,0 +1,27 @@
+; RUN: llvm-link -only-needed %s %p/Inputs/only-needed.ll -S | FileCheck %s
+; RUN: llvm-link %s %p/Inputs/only-needed.ll -S | FileCheck %s -check-prefix=ALL
+
+; With -only-needed, the second file only provides what the first one needs,
+; and its named metadata does not keep the rest alive.
+
+; CHECK: @used_global = global i32 1
+; CHECK-NOT: @unused_global
+; ALL: @unused_global = global i32 2
+
+define void @main() {
+  call void @foo()
+  ret void
+}
+
+declare void @foo()
+
+; CHECK-LABEL: define void @foo()
+; CHECK-LABEL: define internal void @bar()
+; CHECK-NOT: @unused
+
+; ALL-LABEL: define void @unused()
+; ALL-LABEL: define internal void @unused_internal()
+
+; CHECK: !named = !{!0, !1}
+; CHECK: !0 = !{void ()* @foo}
+; CHECK: !1 = !{null, null}
@@ -0,0 +1,77 @@
+; REQUIRES: asserts
+; RUN: opt -S -O2 < %s > %t.serial
+; RUN: opt -S -O2 -function-pass-threads=4 -stats < %s > %t.parallel \
+; RUN:     2> %t.stats
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.stats
+
+; A pass that cannot be copied makes the pass manager run serially.
+; RUN: opt -instcombine -reassociate -function-pass-threads=4 -stats \
+; RUN:     -o /dev/null < %s 2>&1 | FileCheck %s --check-prefix=SERIAL
+
+; CHECK: ir - Number of functions run through function passes concurrently
+; SERIAL: instcombine
+; SERIAL-NOT: ir - Number of functions
+
+@g = global i32 0
+
+define i32 @sum(i32* %p, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %addr = getelementptr inbounds i32, i32* %p, i32 %i
+  %v = load i32, i32* %addr
+  %acc.next = add i32 %acc, %v
+  %i.next = add i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = add i32 %acc.next, 0
+  ret i32 %r
+}
+
+define void @scale(float* %p, float %s) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %addr = getelementptr inbounds float, float* %p, i64 %i
+  %v = load float, float* %addr
+  %m = fmul float %v, %s
+  store float %m, float* %addr
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i32 @select(i32 %a, i32 %b) {
+  %c = icmp slt i32 %a, %b
+  %x = select i1 %c, i32 %a, i32 %b
+  %y = mul i32 %x, 1
+  store i32 %y, i32* @g
+  ret i32 %y
+}
+
+define i32 @unrolled() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = xor i32 %acc, %i
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 4
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %acc.next
+}
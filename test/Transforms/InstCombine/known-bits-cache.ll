@@ -0,0 +1,61 @@
+; RUN: opt < %s -instcombine -S | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-known-bits-cache -S | FileCheck %s
+
+; The cache of known bits must not change what instcombine does when it
+; changes instructions in place.
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64"
+
+; The add is reassociated in place into %iv + 2, after which the phi is known
+; to be even.
+; CHECK-LABEL: @reassociate(
+; CHECK: %iv.next.1 = add nsw i64 %iv, 2
+; CHECK: ret i64 0
+define i64 @reassociate(i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next.1, %loop ]
+  %iv.next = add nuw nsw i64 %iv, 1
+  %iv.next.1 = add nuw nsw i64 %iv.next, 1
+  %low = and i64 %iv, 1
+  %done = icmp eq i64 %iv.next.1, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i64 %low
+}
+
+; The constant of the and is shrunk in place to the demanded bits, so the or
+; does not know its low bits anymore.
+; CHECK-LABEL: @shrink(
+; CHECK-NEXT: %c = lshr i32 %x, 4
+; CHECK-NEXT: %d = and i32 %c, 15
+; CHECK-NEXT: %e = and i32 %x, 3
+; CHECK-NEXT: %f = add nuw nsw i32 %d, %e
+; CHECK-NEXT: ret i32 %f
+define i32 @shrink(i32 %x) {
+  %a = and i32 %x, 255
+  %b = or i32 %a, 256
+  %c = lshr i32 %b, 4
+  %d = and i32 %c, 15
+  %e = and i32 %b, 3
+  %f = add i32 %d, %e
+  ret i32 %f
+}
+
+%s = type { i32, i32, i32 }
+
+; The multiplication is descaled in place.
+; CHECK-LABEL: @descale(
+; CHECK-NEXT: %o = mul nsw i64 %i, 3
+; CHECK-NEXT: getelementptr inbounds %s, %s* %p, i64 %o
+define %s @descale(%s* %p, i64 %i) {
+  %o = mul nsw i64 %i, 36
+  %q = bitcast %s* %p to i8*
+  %pp = getelementptr inbounds i8, i8* %q, i64 %o
+  %r = bitcast i8* %pp to %s*
+  %l = load %s, %s* %r
+  ret %s %l
+}
@@ -0,0 +1,43 @@
+; RUN: not llvm-as -verify-threads=4 %s -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llvm-as -verify-threads=1 %s -o /dev/null 2>&1 | FileCheck %s
+
+; Checking the functions on several threads diagnoses a broken module like
+; checking them serially: in module order, and metadata that several
+; functions share only once.
+
+; CHECK: Instruction does not dominate all uses!
+; CHECK-NEXT: %x = add i32 %a, 1
+; CHECK-NEXT: %y = add i32 %x, 1
+define i32 @f(i32 %a) {
+  %y = add i32 %x, 1
+  %x = add i32 %a, 1
+  ret i32 %y
+}
+
+; CHECK-NEXT: location requires a valid scope
+; CHECK-NEXT: !{{[0-9]+}} = !DILocation(line: 1, scope: !{{[0-9]+}})
+; CHECK-NEXT: !{{[0-9]+}} = !{}
+define void @g() {
+  ret void, !dbg !0
+}
+
+define void @h() {
+  ret void, !dbg !0
+}
+
+; CHECK-NEXT: Instruction does not dominate all uses!
+; CHECK-NEXT: %b = add i32 %a, 1
+; CHECK-NEXT: %c = add i32 %b, 1
+define i32 @k(i32 %a) {
+  %c = add i32 %b, 1
+  %b = add i32 %a, 1
+  ret i32 %c
+}
+
+; CHECK-NOT: requires a valid scope
+
+!0 = !DILocation(line: 1, scope: !1)
+!1 = !{}
+
+!llvm.module.flags = !{!2}
+!2 = !{i32 2, !"Debug Info Version", i32 3}
@@ -14,12 +14,15 @@
 
 #include "llvm/Config/config.h" // plugin-api.h requires HAVE_STDINT_H
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -28,6 +31,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Object/IRObjectFile.h"
@@ -92,6 +96,14 @@ namespace options {
   static bool generate_api_file = false;
   static OutputType TheOutputType = OT_NORMAL;
   static unsigned OptLevel = 2;
+  // Number of parallel code generation jobs. The optimized module is split
+  // into this many partitions, each of which becomes its own object file.
+  static unsigned Parallelism = 1;
+  // Optimize and compile every module separately, importing the functions
+  // worth inlining from the other modules, instead of merging them.
+  static bool thinlto = false;
+  // Directory where thin LTO caches the object files of unchanged modules.
+  static std::string cache_dir;
   static std::string obj_path;
   static std::string extra_library_path;
   static std::string triple;
@@ -119,12 +131,21 @@ namespace options {
       triple = opt.substr(strlen("mtriple="));
     } else if (opt.startswith("obj-path=")) {
       obj_path = opt.substr(strlen("obj-path="));
+    } else if (opt == "thinlto") {
+      thinlto = true;
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
     } else if (opt == "emit-llvm") {
       TheOutputType = OT_BC_ONLY;
     } else if (opt == "save-temps") {
       TheOutputType = OT_SAVE_TEMPS;
     } else if (opt == "disable-output") {
       TheOutputType = OT_DISABLE;
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, Parallelism) ||
+          Parallelism == 0)
+        report_fatal_error("Invalid parallelism level: " +
+                           opt.substr(strlen("jobs=")));
     } else if (opt.size() == 2 && opt[0] == 'O') {
       if (opt[1] < '0' || opt[1] > '3')
         report_fatal_error("Optimization level must be between 0 and 3");
@@ -742,6 +763,48 @@ static void saveBCFile(StringRef Path, Module &M) {
   WriteBitcodeToFile(&M, OS, /* ShouldPreserveUseListOrder */ true);
 }
 
+/// Open \p Count object files for writing. With obj-path, the first one is
+/// obj_path and the I-th one, for I > 0, is obj_path.I.
+static void openObjectFiles(unsigned Count,
+                            std::vector<SmallString<128>> &Filenames,
+                            std::vector<std::unique_ptr<raw_fd_ostream>> &Files) {
+  Filenames.resize(Count);
+  for (unsigned I = 0; I != Count; ++I) {
+    SmallString<128> &Filename = Filenames[I];
+    int FD;
+    if (options::obj_path.empty()) {
+      std::error_code EC =
+          sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+      if (EC)
+        message(LDPL_FATAL, "Could not create temporary file: %s",
+                EC.message().c_str());
+    } else {
+      Filename = options::obj_path;
+      if (I != 0)
+        Filename += "." + utostr(I);
+      std::error_code EC =
+          sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
+      if (EC)
+        message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+    }
+    Files.push_back(make_unique<raw_fd_ostream>(FD, true));
+  }
+}
+
+/// Add the object files \p Filenames to the link, and schedule temporary
+/// files for removal.
+static void addObjectFiles(ArrayRef<SmallString<128>> Filenames) {
+  for (const SmallString<128> &Filename : Filenames) {
+    if (add_input_file(Filename.c_str()) != LDPS_OK)
+      message(LDPL_FATAL,
+              "Unable to add .o file to the link. File left behind in: %s",
+              Filename.c_str());
+
+    if (options::obj_path.empty())
+      Cleanup.push_back(Filename.c_str());
+  }
+}
+
 static void codegen(Module &M) {
   const std::string &TripleStr = M.getTargetTriple();
   Triple TheTriple(TripleStr);
@@ -775,49 +838,72 @@ static void codegen(Module &M) {
     CGOptLevel = CodeGenOpt::Aggressive;
     break;
   }
-  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
-      TripleStr, options::mcpu, Features.getString(), Options, RelocationModel,
-      CodeModel::Default, CGOptLevel));
+  auto CreateTargetMachine = [&]() {
+    return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+        TripleStr, options::mcpu, Features.getString(), Options,
+        RelocationModel, CodeModel::Default, CGOptLevel));
+  };
+  std::unique_ptr<TargetMachine> TM = CreateTargetMachine();
 
   runLTOPasses(M, *TM);
 
   if (options::TheOutputType == options::OT_SAVE_TEMPS)
     saveBCFile(output_name + ".opt.bc", M);
 
-  legacy::PassManager CodeGenPasses;
+  std::vector<SmallString<128>> Filenames;
+  std::vector<std::unique_ptr<raw_fd_ostream>> Files;
+  openObjectFiles(options::Parallelism, Filenames, Files);
+  std::vector<raw_pwrite_stream *> OSs;
+  for (auto &File : Files)
+    OSs.push_back(File.get());
 
-  SmallString<128> Filename;
-  int FD;
-  if (options::obj_path.empty()) {
-    std::error_code EC =
-        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
-    if (EC)
-      message(LDPL_FATAL, "Could not create temporary file: %s",
-              EC.message().c_str());
-  } else {
-    Filename = options::obj_path;
-    std::error_code EC =
-        sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
-    if (EC)
-      message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
-  }
-
-  {
-    raw_fd_ostream OS(FD, true);
-
-    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
+  if (OSs.size() == 1) {
+    legacy::PassManager CodeGenPasses;
+    if (TM->addPassesToEmitFile(CodeGenPasses, *OSs[0],
                                 TargetMachine::CGFT_ObjectFile))
       message(LDPL_FATAL, "Failed to setup codegen");
     CodeGenPasses.run(M);
+  } else {
+    splitCodeGen(M, OSs, CreateTargetMachine, TargetMachine::CGFT_ObjectFile,
+                 options::Parallelism);
   }
+  Files.clear();
 
-  if (add_input_file(Filename.c_str()) != LDPS_OK)
-    message(LDPL_FATAL,
-            "Unable to add .o file to the link. File left behind in: %s",
-            Filename.c_str());
+  addObjectFiles(Filenames);
+}
+
+/// Optimize and compile every module of \p Buffers separately with thin LTO,
+/// and add the resulting object files to the link.
+static void thinLTOCodegen(ArrayRef<SmallString<0>> Buffers,
+                           ArrayRef<std::string> Identifiers) {
+  if (unsigned NumOpts = options::extra.size())
+    cl::ParseCommandLineOptions(NumOpts, &options::extra[0]);
+
+  ThinLTOCodeGenerator CodeGen;
+  CodeGen.setTargetOptions(InitTargetOptionsFromCodeGenFlags());
+  CodeGen.setCpu(options::mcpu);
+  CodeGen.setAttr(join(MAttrs.begin(), MAttrs.end(), ","));
+  CodeGen.setCodePICModel(RelocationModel);
+  CodeGen.setOptLevel(options::OptLevel);
+  CodeGen.setThreadCount(options::Parallelism);
+  CodeGen.setCacheDir(options::cache_dir);
+  for (unsigned I = 0, E = Buffers.size(); I != E; ++I)
+    CodeGen.addModule(Identifiers[I], Buffers[I]);
 
-  if (options::obj_path.empty())
-    Cleanup.push_back(Filename.c_str());
+  std::string ErrMsg;
+  if (!CodeGen.run(ErrMsg))
+    message(LDPL_FATAL, "Thin LTO failed: %s", ErrMsg.c_str());
+
+  ArrayRef<std::unique_ptr<MemoryBuffer>> Binaries =
+      CodeGen.getProducedBinaries();
+  std::vector<SmallString<128>> Filenames;
+  std::vector<std::unique_ptr<raw_fd_ostream>> Files;
+  openObjectFiles(Binaries.size(), Filenames, Files);
+  for (unsigned I = 0, E = Binaries.size(); I != E; ++I)
+    *Files[I] << Binaries[I]->getBuffer();
+  Files.clear();
+
+  addObjectFiles(Filenames);
 }
 
 /// gold informs us that all symbols have been read. At this point, we use
@@ -830,11 +916,50 @@ static ld_plugin_status allSymbolsReadHook(raw_fd_ostream *ApiFile) {
   LLVMContext Context;
   Context.setDiagnosticHandler(diagnosticHandler, nullptr, true);
 
+  std::string DefaultTriple = sys::getDefaultTargetTriple();
+
+  if (options::thinlto) {
+    // Resolve the symbols of every module on its own and hand the modules
+    // over to the thin LTO backends, without merging them. Nothing can be
+    // internalized, since the modules keep referring to each other.
+    std::vector<SmallString<0>> Buffers;
+    std::vector<std::string> Identifiers;
+    for (claimed_file &F : Modules) {
+      ld_plugin_input_file File;
+      if (get_input_file(F.handle, &File) != LDPS_OK)
+        message(LDPL_FATAL, "Failed to get file information");
+      StringSet<> Internalize;
+      StringSet<> Maybe;
+      std::unique_ptr<Module> M =
+          getModuleForFile(Context, F, File, ApiFile, Internalize, Maybe);
+      if (!options::triple.empty())
+        M->setTargetTriple(options::triple.c_str());
+      else if (M->getTargetTriple().empty())
+        M->setTargetTriple(DefaultTriple);
+
+      Buffers.emplace_back();
+      raw_svector_ostream OS(Buffers.back());
+      WriteBitcodeToFile(M.get(), OS, /* ShouldPreserveUseListOrder */ false,
+                         /* EmitFunctionSummary */ true);
+      OS.flush();
+      Identifiers.push_back(File.name);
+      if (release_input_file(F.handle) != LDPS_OK)
+        message(LDPL_FATAL, "Failed to release file information");
+    }
+
+    if (options::TheOutputType == options::OT_DISABLE)
+      return LDPS_OK;
+    thinLTOCodegen(Buffers, Identifiers);
+
+    if (!options::extra_library_path.empty() &&
+        set_extra_library_path(options::extra_library_path.c_str()) != LDPS_OK)
+      message(LDPL_FATAL, "Unable to set the extra library path.");
+    return LDPS_OK;
+  }
+
   std::unique_ptr<Module> Combined(new Module("ld-temp.o", Context));
   Linker L(Combined.get());
 
-  std::string DefaultTriple = sys::getDefaultTargetTriple();
-
   StringSet<> Internalize;
   StringSet<> Maybe;
   for (claimed_file &F : Modules) {
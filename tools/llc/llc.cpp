@@ -20,6 +20,7 @@
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
@@ -95,7 +96,25 @@ static cl::opt<bool> AsmVerbose("asm-verbose",
                                 cl::desc("Add comments to directives."),
                                 cl::init(true));
 
+static cl::opt<unsigned>
+CodeGenPartitions("codegen-partitions", cl::init(1u), cl::value_desc("N"),
+                  cl::desc("Split the module into N partitions and generate "
+                           "code for them in parallel. Partition I > 0 is "
+                           "written to <output>.I"));
+
+static cl::opt<unsigned>
+CodeGenThreads("codegen-threads", cl::init(0u), cl::value_desc("N"),
+               cl::desc("Number of threads used with -codegen-partitions "
+                        "(default = number of hardware threads)"));
+
 static int compileModule(char **, LLVMContext &);
+static int compileModuleInPartitions(char **, std::unique_ptr<Module> M,
+                                     const Target *TheTarget,
+                                     const Triple &TheTriple,
+                                     const std::string &CPUStr,
+                                     const std::string &FeaturesStr,
+                                     const TargetOptions &Options,
+                                     CodeGenOpt::Level OLvl);
 
 static std::unique_ptr<tool_output_file>
 GetOutputStream(const char *TargetName, Triple::OSType OS,
@@ -285,6 +304,19 @@ static int compileModule(char **argv, LLVMContext &Context) {
   if (GenerateSoftFloatCalls)
     FloatABIForCalls = FloatABI::Soft;
 
+  if (CodeGenPartitions > 1) {
+    // Add the target data from the target machine, if it exists, or the
+    // module.
+    if (const DataLayout *DL = Target->getDataLayout())
+      M->setDataLayout(*DL);
+
+    // Override function attributes.
+    overrideFunctionAttributes(CPUStr, FeaturesStr, *M);
+
+    return compileModuleInPartitions(argv, std::move(M), TheTarget, TheTriple,
+                                     CPUStr, FeaturesStr, Options, OLvl);
+  }
+
   // Figure out where we are going to send the output.
   std::unique_ptr<tool_output_file> Out =
       GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
@@ -361,3 +393,70 @@ static int compileModule(char **argv, LLVMContext &Context) {
 
   return 0;
 }
+
+/// Generate code for M in CodeGenPartitions partitions, in parallel. Every
+/// partition is compiled with its own LLVMContext and TargetMachine and is
+/// written to its own output file, next to the main output file.
+static int compileModuleInPartitions(char **argv, std::unique_ptr<Module> M,
+                                     const Target *TheTarget,
+                                     const Triple &TheTriple,
+                                     const std::string &CPUStr,
+                                     const std::string &FeaturesStr,
+                                     const TargetOptions &Options,
+                                     CodeGenOpt::Level OLvl) {
+  if (!StartAfter.empty() || !StopAfter.empty()) {
+    errs() << argv[0] << ": -start-after and -stop-after cannot be used with "
+           << "-codegen-partitions\n";
+    return 1;
+  }
+  if (DisableSimplifyLibCalls) {
+    errs() << argv[0] << ": -disable-simplify-libcalls cannot be used with "
+           << "-codegen-partitions\n";
+    return 1;
+  }
+
+  std::unique_ptr<tool_output_file> Out =
+      GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
+  if (!Out) return 1;
+  if (OutputFilename == "-") {
+    errs() << argv[0] << ": -codegen-partitions requires an output file\n";
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<tool_output_file>> Outs;
+  std::vector<raw_pwrite_stream *> OSs;
+  Outs.push_back(std::move(Out));
+  OSs.push_back(&Outs.back()->os());
+  sys::fs::OpenFlags OpenFlags = FileType == TargetMachine::CGFT_AssemblyFile
+                                     ? sys::fs::F_Text
+                                     : sys::fs::F_None;
+  for (unsigned I = 1; I != CodeGenPartitions; ++I) {
+    std::error_code EC;
+    Outs.push_back(llvm::make_unique<tool_output_file>(
+        (OutputFilename + "." + Twine(I)).str(), EC, OpenFlags));
+    if (EC) {
+      errs() << EC.message() << '\n';
+      return 1;
+    }
+    OSs.push_back(&Outs.back()->os());
+  }
+
+  // Before executing passes, print the final values of the LLVM options.
+  cl::PrintOptionValues();
+
+  auto TMFactory = [&]() {
+    return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+        TheTriple.getTriple(), CPUStr, FeaturesStr, Options, RelocModel,
+        CMModel, OLvl));
+  };
+  // Locals are kept next to their users so that the partitions taken
+  // together define exactly the symbols the module would have.
+  splitCodeGen(*M, OSs, TMFactory, FileType, CodeGenThreads,
+               /*PreserveLocals=*/true);
+
+  // Declare success.
+  for (auto &O : Outs)
+    O->keep();
+
+  return 0;
+}
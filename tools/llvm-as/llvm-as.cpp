@@ -56,6 +56,14 @@ static cl::opt<bool> PreserveBitcodeUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM bitcode."),
     cl::init(true), cl::Hidden);
 
+static cl::opt<bool> EmitFunctionSummary(
+    "function-summary",
+    cl::desc("Emit function summaries for thin link-time optimization"));
+
+static cl::opt<bool> EmitFunctionIndex(
+    "function-index",
+    cl::desc("Emit the offsets of the function bodies for lazy loading"));
+
 static void WriteOutputFile(const Module *M) {
   // Infer the output filename if needed.
   if (OutputFilename.empty()) {
@@ -83,7 +91,8 @@ static void WriteOutputFile(const Module *M) {
   }
 
   if (Force || !CheckBitcodeOutputToConsole(Out->os(), true))
-    WriteBitcodeToFile(M, Out->os(), PreserveBitcodeUseListOrder);
+    WriteBitcodeToFile(M, Out->os(), PreserveBitcodeUseListOrder,
+                       EmitFunctionSummary, EmitFunctionIndex);
 
   // Declare success.
   Out->keep();
@@ -110,6 +110,9 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::METADATA_BLOCK_ID:        return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID:   return "METADATA_ATTACHMENT_BLOCK";
   case bitc::USELIST_BLOCK_ID:         return "USELIST_BLOCK_ID";
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID:
+                                       return "FUNCTION_SUMMARY_BLOCK";
+  case bitc::FUNCTION_INDEX_BLOCK_ID:  return "FUNCTION_INDEX_BLOCK";
   }
 }
 
@@ -158,6 +161,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::MODULE_CODE_ALIAS:       return "ALIAS";
     case bitc::MODULE_CODE_PURGEVALS:   return "PURGEVALS";
     case bitc::MODULE_CODE_GCNAME:      return "GCNAME";
+    case bitc::MODULE_CODE_FUNCTION_INDEX: return "FUNCTION_INDEX";
     }
   case bitc::PARAMATTR_BLOCK_ID:
     switch (CodeID) {
@@ -282,6 +286,17 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::USELIST_CODE_DEFAULT: return "USELIST_CODE_DEFAULT";
     case bitc::USELIST_CODE_BB:      return "USELIST_CODE_BB";
     }
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID:
+    switch(CodeID) {
+    default:return nullptr;
+    case bitc::FS_CODE_NAME:  return "NAME";
+    case bitc::FS_CODE_ENTRY: return "ENTRY";
+    }
+  case bitc::FUNCTION_INDEX_BLOCK_ID:
+    switch(CodeID) {
+    default:return nullptr;
+    case bitc::FUNCTION_INDEX_ENTRY: return "ENTRY";
+    }
   }
 }
 
@@ -14,24 +14,35 @@
 
 #include "llvm/Linker/Linker.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 using namespace llvm;
 
 static cl::list<std::string>
@@ -43,6 +54,17 @@ static cl::list<std::string> OverridingInputs(
     cl::desc(
         "input bitcode file which can override previously defined symbol(s)"));
 
+static cl::opt<bool>
+OnlyNeeded("only-needed",
+           cl::desc("Link in only the definitions the first input file needs, "
+                    "directly or through other linked definitions"));
+
+static cl::opt<unsigned>
+LinkThreads("link-threads",
+            cl::desc("Number of threads loading and linking the input files "
+                     "in a balanced tree (0 uses all the hardware threads)"),
+            cl::init(1));
+
 static cl::opt<std::string>
 OutputFilename("o", cl::desc("Override output filename"), cl::init("-"),
                cl::value_desc("filename"));
@@ -69,6 +91,10 @@ static cl::opt<bool> PreserveBitcodeUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM bitcode."),
     cl::init(true), cl::Hidden);
 
+static cl::opt<bool> EmitFunctionIndex(
+    "function-index",
+    cl::desc("Emit the offsets of the function bodies for lazy loading"));
+
 static cl::opt<bool> PreserveAssemblyUseListOrder(
     "preserve-ll-uselistorder",
     cl::desc("Preserve use-list order when writing LLVM assembly."),
@@ -92,6 +118,10 @@ loadFile(const char *argv0, const std::string &FN, LLVMContext &Context) {
 }
 
 static void diagnosticHandler(const DiagnosticInfo &DI) {
+  // Several partial links may report a diagnostic at the same time.
+  static std::mutex DiagnosticLock;
+  std::lock_guard<std::mutex> Lock(DiagnosticLock);
+
   unsigned Severity = DI.getSeverity();
   switch (Severity) {
   case DS_Error:
@@ -112,10 +142,30 @@ static void diagnosticHandler(const DiagnosticInfo &DI) {
   errs() << '\n';
 }
 
+/// Set when the input files are linked in a tree and one of them has module
+/// flags that have to be linked in the order of the files.
+static std::atomic<bool> FoundOrderDependentFlags(false);
+
+/// Return true if \p M has module flags that override or require the value of
+/// a flag.  Such flags may not add up to the same flags, or to the same
+/// errors, when the files are not linked one by one.
+static bool hasOrderDependentModuleFlags(const Module &M) {
+  SmallVector<Module::ModuleFlagEntry, 8> Flags;
+  M.getModuleFlagsMetadata(Flags);
+  for (const Module::ModuleFlagEntry &Flag : Flags)
+    if (Flag.Behavior == Module::Override || Flag.Behavior == Module::Require)
+      return true;
+  return false;
+}
+
 static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
-                      const cl::list<std::string> &Files,
-                      bool OverrideDuplicateSymbols) {
+                      ArrayRef<std::string> Files,
+                      bool OverrideDuplicateSymbols, bool LinkWholeFirst,
+                      bool InTree = false) {
   for (const auto &File : Files) {
+    if (InTree && FoundOrderDependentFlags)
+      return false;
+
     std::unique_ptr<Module> M = loadFile(argv0, File, Context);
     if (!M.get()) {
       errs() << argv0 << ": error loading file '" << File << "'\n";
@@ -127,16 +177,178 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
       return false;
     }
 
+    if (InTree && hasOrderDependentModuleFlags(*M)) {
+      FoundOrderDependentFlags = true;
+      return false;
+    }
+
     if (Verbose)
       errs() << "Linking in '" << File << "'\n";
 
-    if (L.linkInModule(M.get(), OverrideDuplicateSymbols))
+    // The first input file is linked in whole, it is what the definitions of
+    // the other files are needed for.
+    bool LinkOnlyNeeded =
+        OnlyNeeded && !(LinkWholeFirst && &File == &Files.front());
+    if (L.linkInModule(M.get(), OverrideDuplicateSymbols, LinkOnlyNeeded))
       return false;
   }
 
   return true;
 }
 
+/// Return the number of threads linking the input files.
+static unsigned getLinkThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (LinkThreads == 0)
+    return std::max(1u, std::thread::hardware_concurrency());
+  return LinkThreads;
+#else
+  return 1;
+#endif
+}
+
+namespace {
+/// A module linked from consecutive input files, in a context of its own when
+/// the inputs are linked in a tree.
+struct PartialLink {
+  std::unique_ptr<LLVMContext> Context;
+  std::unique_ptr<Module> Composite;
+  std::unique_ptr<Linker> L;
+};
+}
+
+/// Move the elements of \p List that are not in \p Old to the end of the list,
+/// in the order \p SourceOrder gives for their names.
+template <typename ListTy, typename SetTy>
+static void restoreSourceOrder(ListTy &List, const SetTy &Old,
+                               const StringMap<unsigned> &SourceOrder) {
+  typedef typename ListTy::value_type ElementTy;
+  std::vector<std::pair<unsigned, ElementTy *>> New;
+  for (ElementTy &E : List) {
+    if (Old.count(&E))
+      continue;
+    auto I = SourceOrder.find(E.getName());
+    New.push_back(std::make_pair(I == SourceOrder.end() ? ~0U : I->second, &E));
+  }
+  std::stable_sort(New.begin(), New.end(),
+                   [](const std::pair<unsigned, ElementTy *> &LHS,
+                      const std::pair<unsigned, ElementTy *> &RHS) {
+    return LHS.first < RHS.first;
+  });
+  for (auto &P : New)
+    List.splice(List.end(), List, P.second);
+}
+
+/// Link \p Src into \p L, which holds the files before those \p Src was
+/// linked from.
+///
+/// The globals \p Src adds come after the globals of the files before it, as
+/// they do when the files are linked one by one.  But the globals that are
+/// linked lazily, such as the internal ones, come after the others, while they
+/// come along the globals of their own file in \p Src.  They are put back in
+/// the order of \p Src, and so is the named metadata \p Src adds, so that the
+/// partial links add up to the sequential one unless some local names clash.
+static bool linkPartialLink(Linker &L, Module &Src) {
+  Module &Dst = *L.getModule();
+  std::vector<std::pair<GlobalValue *, WeakVH>> Old;
+  for (GlobalValue &GV : Dst.globals())
+    Old.push_back(std::make_pair(&GV, WeakVH(&GV)));
+  for (GlobalValue &GV : Dst.functions())
+    Old.push_back(std::make_pair(&GV, WeakVH(&GV)));
+  for (GlobalValue &GV : Dst.aliases())
+    Old.push_back(std::make_pair(&GV, WeakVH(&GV)));
+
+  SmallPtrSet<NamedMDNode *, 8> OldNamedMD;
+  for (NamedMDNode &NMD : Dst.named_metadata())
+    OldNamedMD.insert(&NMD);
+
+  StringMap<unsigned> SourceOrder, NamedMDOrder;
+  unsigned Index = 0;
+  for (GlobalValue &GV : Src.globals())
+    SourceOrder[GV.getName()] = Index++;
+  for (GlobalValue &GV : Src.functions())
+    SourceOrder[GV.getName()] = Index++;
+  for (GlobalValue &GV : Src.aliases())
+    SourceOrder[GV.getName()] = Index++;
+  Index = 0;
+  for (NamedMDNode &NMD : Src.named_metadata())
+    NamedMDOrder[NMD.getName()] = Index++;
+
+  if (L.linkInModule(&Src))
+    return false;
+
+  // A global of Dst is replaced and erased when Src defines it, and the new
+  // global is added with the others.  Only appending globals are replaced in
+  // place, by the concatenation of both arrays.
+  SmallPtrSet<GlobalValue *, 64> Remaining;
+  for (auto &P : Old) {
+    if (P.second == P.first) {
+      Remaining.insert(P.first);
+      continue;
+    }
+    if (!P.second)
+      continue;
+    auto *GV = dyn_cast<GlobalVariable>(P.second->stripPointerCasts());
+    if (GV && GV->hasAppendingLinkage())
+      Remaining.insert(GV);
+  }
+  restoreSourceOrder(Dst.getGlobalList(), Remaining, SourceOrder);
+  restoreSourceOrder(Dst.getFunctionList(), Remaining, SourceOrder);
+  restoreSourceOrder(Dst.getAliasList(), Remaining, SourceOrder);
+  restoreSourceOrder(Dst.getNamedMDList(), OldNamedMD, NamedMDOrder);
+  return true;
+}
+
+/// Link \p Files in order into a new module in a new context, which is left in
+/// \p Result.  Up to \p LeafSize files are linked one after the other.  More
+/// files are split in two halves that are linked concurrently, and the right
+/// half is then written to bitcode and read back lazily into the context of the
+/// left half to be linked into it, so that the files are still linked in order.
+static bool linkTree(const char *argv0, ArrayRef<std::string> Files,
+                     size_t LeafSize, ThreadPool &Pool, PartialLink &Result) {
+  if (Files.size() <= LeafSize) {
+    Result.Context = make_unique<LLVMContext>();
+    Result.Composite = make_unique<Module>("llvm-link", *Result.Context);
+    Result.L = make_unique<Linker>(Result.Composite.get(), diagnosticHandler);
+    return linkFiles(argv0, *Result.Context, *Result.L, Files, false, false,
+                     true);
+  }
+
+  ArrayRef<std::string> RightFiles = Files.slice(Files.size() / 2);
+  SmallString<0> RightBitcode;
+  bool RightLinked = false;
+  auto Right = Pool.async([&] {
+    PartialLink RightResult;
+    if (!linkTree(argv0, RightFiles, LeafSize, Pool, RightResult))
+      return;
+    raw_svector_ostream OS(RightBitcode);
+    WriteBitcodeToFile(RightResult.Composite.get(), OS,
+                       PreserveBitcodeUseListOrder);
+    RightLinked = true;
+  });
+
+  bool LeftLinked = linkTree(argv0, Files.drop_back(RightFiles.size()),
+                             LeafSize, Pool, Result);
+  Pool.waitFor(Right);
+  if (!LeftLinked || !RightLinked)
+    return false;
+
+  if (Verbose)
+    errs() << "Linking in the files from '" << RightFiles.front() << "' to '"
+           << RightFiles.back() << "'\n";
+  ErrorOr<Module *> MOrErr = getLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(RightBitcode, "<partial link>", false),
+      *Result.Context);
+  if (std::error_code EC = MOrErr.getError()) {
+    errs() << argv0 << ": error reading a partial link: " << EC.message()
+           << '\n';
+    return false;
+  }
+  std::unique_ptr<Module> M(MOrErr.get());
+  M->materializeMetadata();
+  return linkPartialLink(*Result.L, *M);
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -146,15 +358,40 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm linker\n");
 
-  auto Composite = make_unique<Module>("llvm-link", Context);
-  Linker L(Composite.get(), diagnosticHandler);
-
-  // First add all the regular input files
-  if (!linkFiles(argv[0], Context, L, InputFilenames, false))
-    return 1;
+  // First add all the regular input files, in a tree of partial links when
+  // several threads are asked for.  Only the needed definitions of a file
+  // depend on all the files before it, so -only-needed links them in order.
+  PartialLink Link;
+  unsigned NumThreads = getLinkThreadCount();
+  if (NumThreads > 1 && InputFilenames.size() > 1 && !OnlyNeeded) {
+    size_t LeafSize = (InputFilenames.size() + NumThreads - 1) / NumThreads;
+    ThreadPool Pool(NumThreads);
+    bool Linked = false;
+    Pool.async([&] {
+      Linked = linkTree(argv[0], InputFilenames, LeafSize, Pool, Link);
+    });
+    Pool.wait();
+    if (!Linked && !FoundOrderDependentFlags)
+      return 1;
+    if (FoundOrderDependentFlags) {
+      if (Verbose)
+        errs() << "Module flags to override or require, linking in order\n";
+      Link.L.reset();
+      Link.Composite.reset();
+      Link.Context.reset();
+    }
+  }
+  if (!Link.Composite) {
+    Link.Composite = make_unique<Module>("llvm-link", Context);
+    Link.L = make_unique<Linker>(Link.Composite.get(), diagnosticHandler);
+    if (!linkFiles(argv[0], Context, *Link.L, InputFilenames, false, true))
+      return 1;
+  }
+  Module *Composite = Link.Composite.get();
 
   // Next the -override ones.
-  if (!linkFiles(argv[0], Context, L, OverridingInputs, true))
+  if (!linkFiles(argv[0], Composite->getContext(), *Link.L, OverridingInputs,
+                 true, false))
     return 1;
 
   if (DumpAsm) errs() << "Here's the assembly:\n" << *Composite;
@@ -175,7 +412,8 @@ int main(int argc, char **argv) {
   if (OutputAssembly) {
     Composite->print(Out.os(), nullptr, PreserveAssemblyUseListOrder);
   } else if (Force || !CheckBitcodeOutputToConsole(Out.os(), true))
-    WriteBitcodeToFile(Composite.get(), Out.os(), PreserveBitcodeUseListOrder);
+    WriteBitcodeToFile(Composite, Out.os(), PreserveBitcodeUseListOrder,
+                       /* EmitFunctionSummary */ false, EmitFunctionIndex);
 
   // Declare success.
   Out.keep();
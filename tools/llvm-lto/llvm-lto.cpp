@@ -12,10 +12,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -73,6 +76,51 @@ static cl::opt<bool> ListSymbolsOnly(
     "list-symbols-only", cl::init(false),
     cl::desc("Instead of running LTO, list the symbols in each IR file"));
 
+static cl::opt<unsigned> CodeGenPartitions(
+    "codegen-partitions", cl::init(1u), cl::value_desc("N"),
+    cl::desc("Split the optimized module into N partitions and generate code "
+             "for them in parallel. With -o, partition I > 0 is written to "
+             "<output>.I"));
+
+static cl::opt<unsigned> CodeGenThreads(
+    "codegen-threads", cl::init(0u), cl::value_desc("N"),
+    cl::desc("Number of threads used with -codegen-partitions "
+             "(default = number of hardware threads)"));
+
+static cl::opt<bool> ThinLTO(
+    "thinlto", cl::init(false),
+    cl::desc("Optimize and compile every input separately, importing the "
+             "functions worth inlining from the other inputs. The object "
+             "file of input I > 0 is written to <output>.I"));
+
+static cl::opt<unsigned> ThinLTOThreads(
+    "thinlto-threads", cl::init(0u), cl::value_desc("N"),
+    cl::desc("Number of threads used with -thinlto "
+             "(default = number of hardware threads)"));
+
+static cl::opt<unsigned> ImportInstrLimit(
+    "import-instr-limit", cl::init(100u), cl::value_desc("N"),
+    cl::desc("Only import functions with at most N instructions with "
+             "-thinlto"));
+
+static cl::opt<std::string> ThinLTOCacheDir(
+    "thinlto-cache-dir", cl::value_desc("directory"),
+    cl::desc("Reuse the object files of unchanged inputs from this "
+             "directory with -thinlto"));
+
+static cl::opt<unsigned> ThinLTOCachePruningInterval(
+    "thinlto-cache-pruning-interval", cl::init(1200u), cl::value_desc("s"),
+    cl::desc("Minimum number of seconds between two prunings of the cache"));
+
+static cl::opt<unsigned> ThinLTOCacheExpiration(
+    "thinlto-cache-expiration", cl::init(7 * 24 * 3600u), cl::value_desc("s"),
+    cl::desc("Remove cache entries unused for this many seconds "
+             "(0 = never)"));
+
+static cl::opt<unsigned long long> ThinLTOCacheMaxSize(
+    "thinlto-cache-max-size", cl::init(0ull), cl::value_desc("bytes"),
+    cl::desc("Maximum total size of the cache entries (0 = unlimited)"));
+
 static cl::opt<bool> SetMergedModule(
     "set-merged-module", cl::init(false),
     cl::desc("Use the first input module as the merged module"));
@@ -116,6 +164,115 @@ getLocalLTOModule(StringRef Path, std::unique_ptr<MemoryBuffer> &Buffer,
       Buffer->getBufferStart(), Buffer->getBufferSize(), Options, Error, Path));
 }
 
+/// Optimize the merged module and generate code for it in CodeGenPartitions
+/// partitions, either to the -o file and its numbered siblings or to
+/// temporary files.
+static int compileInPartitions(LTOCodeGenerator &CodeGen, const char *Argv0) {
+  std::string ErrorInfo;
+  if (!CodeGen.optimize(DisableInline, DisableGVNLoadPRE,
+                        DisableLTOVectorization, ErrorInfo)) {
+    errs() << Argv0 << ": error optimizing the code: " << ErrorInfo << "\n";
+    return 1;
+  }
+
+  if (OutputFilename.empty()) {
+    const char **OutputNames = nullptr;
+    unsigned NumOutputs = 0;
+    if (!CodeGen.compileOptimizedToFiles(&OutputNames, &NumOutputs,
+                                         ErrorInfo)) {
+      errs() << Argv0 << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+    for (unsigned I = 0; I != NumOutputs; ++I)
+      outs() << "Wrote native object file '" << OutputNames[I] << "'\n";
+    return 0;
+  }
+
+  std::vector<std::unique_ptr<raw_fd_ostream>> Files;
+  std::vector<raw_pwrite_stream *> OSs;
+  for (unsigned I = 0; I != CodeGenPartitions; ++I) {
+    std::string PartFilename = OutputFilename;
+    if (I != 0)
+      PartFilename += "." + utostr(I);
+    std::error_code EC;
+    Files.push_back(
+        make_unique<raw_fd_ostream>(PartFilename, EC, sys::fs::F_None));
+    if (EC) {
+      errs() << Argv0 << ": error opening the file '" << PartFilename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    OSs.push_back(Files.back().get());
+  }
+
+  if (!CodeGen.compileOptimized(OSs, ErrorInfo)) {
+    errs() << Argv0 << ": error compiling the code: " << ErrorInfo << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+/// Run thin LTO on the inputs, writing one object file per input.
+static int thinLTO(const char *Argv0, const TargetOptions &Options) {
+  if (OutputFilename.empty()) {
+    errs() << Argv0 << ": -thinlto requires an output file\n";
+    return 1;
+  }
+
+  ThinLTOCodeGenerator CodeGen;
+  CodeGen.setTargetOptions(Options);
+  CodeGen.setCpu(MCPU);
+  CodeGen.setAttr(join(MAttrs.begin(), MAttrs.end(), ","));
+  CodeGen.setCodePICModel(RelocModel);
+  CodeGen.setOptLevel(OptLevel - '0');
+  CodeGen.setThreadCount(ThinLTOThreads);
+  CodeGen.setImportInstrLimit(ImportInstrLimit);
+  if (!ThinLTOCacheDir.empty()) {
+    CodeGen.setCacheDir(ThinLTOCacheDir);
+    LTOCachePruningPolicy Policy;
+    Policy.Interval = ThinLTOCachePruningInterval;
+    Policy.Expiration = ThinLTOCacheExpiration;
+    Policy.MaxSize = ThinLTOCacheMaxSize;
+    CodeGen.setCachePruningPolicy(Policy);
+  }
+
+  std::vector<std::unique_ptr<MemoryBuffer>> InputBuffers;
+  for (const std::string &Filename : InputFilenames) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << Argv0 << ": error loading file '" << Filename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    InputBuffers.push_back(std::move(BufferOrErr.get()));
+    CodeGen.addModule(Filename, InputBuffers.back()->getBuffer());
+  }
+
+  std::string ErrorInfo;
+  if (!CodeGen.run(ErrorInfo)) {
+    errs() << Argv0 << ": error compiling the code: " << ErrorInfo << "\n";
+    return 1;
+  }
+
+  ArrayRef<std::unique_ptr<MemoryBuffer>> Binaries =
+      CodeGen.getProducedBinaries();
+  for (unsigned I = 0, E = Binaries.size(); I != E; ++I) {
+    std::string Filename = OutputFilename;
+    if (I != 0)
+      Filename += "." + utostr(I);
+    std::error_code EC;
+    raw_fd_ostream FileStream(Filename, EC, sys::fs::F_None);
+    if (EC) {
+      errs() << Argv0 << ": error opening the file '" << Filename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    FileStream << Binaries[I]->getBuffer();
+  }
+  return 0;
+}
+
 /// \brief List symbols in each IR file.
 ///
 /// The main point here is to provide lit-testable coverage for the LTOModule
@@ -167,6 +324,9 @@ int main(int argc, char **argv) {
   if (ListSymbolsOnly)
     return listSymbols(argv[0], Options);
 
+  if (ThinLTO)
+    return thinLTO(argv[0], Options);
+
   unsigned BaseArg = 0;
 
   LTOCodeGenerator CodeGen;
@@ -252,6 +412,11 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
+  CodeGen.setParallelism(CodeGenPartitions, CodeGenThreads);
+
+  if (CodeGenPartitions > 1)
+    return compileInPartitions(CodeGen, argv[0]);
+
   if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
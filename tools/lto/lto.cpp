@@ -321,6 +321,18 @@ const void *lto_codegen_compile_optimized(lto_code_gen_t cg, size_t *length) {
   return unwrap(cg)->compileOptimized(length, sLastErrorString);
 }
 
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int partitions,
+                                 unsigned int threads) {
+  unwrap(cg)->setParallelism(partitions, threads);
+}
+
+bool lto_codegen_compile_optimized_to_files(lto_code_gen_t cg,
+                                            const char ***names,
+                                            unsigned int *count) {
+  maybeParseOptions(cg);
+  return !unwrap(cg)->compileOptimizedToFiles(names, count, sLastErrorString);
+}
+
 bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
   maybeParseOptions(cg);
   return !unwrap(cg)->compile_to_file(
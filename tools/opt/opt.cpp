@@ -185,6 +185,14 @@ static cl::opt<bool> PreserveBitcodeUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM bitcode."),
     cl::init(true), cl::Hidden);
 
+static cl::opt<bool> EmitFunctionSummary(
+    "function-summary",
+    cl::desc("Emit function summaries for thin link-time optimization"));
+
+static cl::opt<bool> EmitFunctionIndex(
+    "function-index",
+    cl::desc("Emit the offsets of the function bodies for lazy loading"));
+
 static cl::opt<bool> PreserveAssemblyUseListOrder(
     "preserve-ll-uselistorder",
     cl::desc("Preserve use-list order when writing LLVM assembly."),
@@ -585,8 +593,9 @@ int main(int argc, char **argv) {
       Passes.add(
           createPrintModulePass(Out->os(), "", PreserveAssemblyUseListOrder));
     else
-      Passes.add(
-          createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder));
+      Passes.add(createBitcodeWriterPass(
+          Out->os(), PreserveBitcodeUseListOrder, EmitFunctionSummary,
+          EmitFunctionIndex));
   }
 
   // Before executing passes, print the final values of the LLVM options.
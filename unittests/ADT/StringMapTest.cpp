@@ -229,7 +229,8 @@ TEST_F(StringMapTest, InsertPairTest) {
 TEST_F(StringMapTest, InsertRehashingPairTest) {
   // Check that the correct iterator is returned when the inserted element is
   // moved to a different bucket during internal rehashing. This depends on
-  // the particular key, and the implementation of StringMap and HashString.
+  // the particular key, and the implementation of StringMap and its hash
+  // function.
   // Changes to those might result in this test not actually checking that.
   StringMap<uint32_t> t(1);
   EXPECT_EQ(1u, t.getNumBuckets());
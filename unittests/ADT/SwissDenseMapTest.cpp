@@ -0,0 +1,203 @@
+//===- llvm/unittest/ADT/SwissDenseMapTest.cpp - SwissDenseMap tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SwissDenseMap.h"
+#include <map>
+#include <memory>
+#include <set>
+
+using namespace llvm;
+
+namespace {
+
+/// A value that counts the live instances, to check that the map constructs
+/// and destroys its values correctly.
+struct Counted {
+  static int Live;
+  int Value;
+
+  Counted(int Value = 0) : Value(Value) { ++Live; }
+  Counted(const Counted &Other) : Value(Other.Value) { ++Live; }
+  Counted &operator=(const Counted &) = default;
+  ~Counted() { --Live; }
+};
+
+int Counted::Live = 0;
+
+TEST(SwissDenseMapTest, EmptyMap) {
+  SwissDenseMap<int, int> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(0u, Map.count(1));
+  EXPECT_TRUE(Map.find(1) == Map.end());
+  EXPECT_EQ(0, Map.lookup(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_EQ(0u, Map.getMemorySize());
+}
+
+TEST(SwissDenseMapTest, InsertFindErase) {
+  SwissDenseMap<int, int> Map;
+  EXPECT_TRUE(Map.insert(std::make_pair(1, 10)).second);
+  EXPECT_FALSE(Map.insert(std::make_pair(1, 20)).second);
+  EXPECT_EQ(1u, Map.size());
+  EXPECT_EQ(10, Map.lookup(1));
+  EXPECT_EQ(10, Map.find(1)->second);
+
+  Map[2] = 20;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(20, Map[2]);
+
+  EXPECT_TRUE(Map.erase(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_EQ(0u, Map.count(1));
+  Map.erase(Map.find(2));
+  EXPECT_TRUE(Map.empty());
+}
+
+// DenseMapInfo reserves some keys for empty and tombstone buckets; this map
+// does not.
+TEST(SwissDenseMapTest, ReservedDenseMapKeys) {
+  SwissDenseMap<int, int> Map;
+  int EmptyKey = DenseMapInfo<int>::getEmptyKey();
+  int TombstoneKey = DenseMapInfo<int>::getTombstoneKey();
+  Map[EmptyKey] = 1;
+  Map[TombstoneKey] = 2;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(1, Map.lookup(EmptyKey));
+  EXPECT_EQ(2, Map.lookup(TombstoneKey));
+}
+
+// Compare against std::map through inserts, erases and growth.
+TEST(SwissDenseMapTest, MatchesStdMap) {
+  SwissDenseMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Ref;
+  unsigned Seed = 1;
+  for (unsigned I = 0; I != 20000; ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    unsigned Key = (Seed >> 16) % 3000;
+    if (Seed & 0x100) {
+      Map[Key] = I;
+      Ref[Key] = I;
+    } else {
+      EXPECT_EQ(Ref.erase(Key) != 0, Map.erase(Key));
+    }
+    ASSERT_EQ(Ref.size(), Map.size());
+  }
+  for (auto &KV : Ref)
+    EXPECT_EQ(KV.second, Map.lookup(KV.first));
+  unsigned Seen = 0;
+  for (auto &KV : Map) {
+    EXPECT_EQ(Ref[KV.first], KV.second);
+    ++Seen;
+  }
+  EXPECT_EQ(Ref.size(), Seen);
+}
+
+// A map that is filled and drained repeatedly must not grow.
+TEST(SwissDenseMapTest, ChurnDoesNotGrow) {
+  SwissDenseMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I;
+  size_t Size = Map.getMemorySize();
+  for (unsigned Round = 1; Round != 100; ++Round) {
+    for (unsigned I = 0; I != 100; ++I)
+      Map.erase(Round * 100 - 100 + I);
+    for (unsigned I = 0; I != 100; ++I)
+      Map[Round * 100 + I] = I;
+  }
+  EXPECT_EQ(100u, Map.size());
+  EXPECT_EQ(Size, Map.getMemorySize());
+}
+
+TEST(SwissDenseMapTest, ReserveAvoidsRehash) {
+  SwissDenseMap<unsigned, unsigned> Map;
+  Map.reserve(1000);
+  const void *Buckets = Map.getPointerIntoBucketsArray();
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[I] = I;
+  EXPECT_EQ(Buckets, Map.getPointerIntoBucketsArray());
+}
+
+TEST(SwissDenseMapTest, ValueLifetimes) {
+  {
+    SwissDenseMap<int, Counted> Map;
+    for (int I = 0; I != 100; ++I)
+      Map[I] = Counted(I);
+    EXPECT_EQ(100, Counted::Live);
+    for (int I = 0; I != 50; ++I)
+      Map.erase(I);
+    EXPECT_EQ(50, Counted::Live);
+
+    SwissDenseMap<int, Counted> Copy(Map);
+    EXPECT_EQ(100, Counted::Live);
+    EXPECT_EQ(75, Copy.lookup(75).Value);
+    Copy.clear();
+    EXPECT_EQ(50, Counted::Live);
+  }
+  EXPECT_EQ(0, Counted::Live);
+}
+
+TEST(SwissDenseMapTest, MoveOnlyValues) {
+  SwissDenseMap<int, std::unique_ptr<int>> Map;
+  for (int I = 0; I != 100; ++I)
+    Map.insert(std::make_pair(I, std::unique_ptr<int>(new int(I))));
+  EXPECT_EQ(42, *Map[42]);
+
+  SwissDenseMap<int, std::unique_ptr<int>> Moved(std::move(Map));
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(100u, Moved.size());
+  Map = std::move(Moved);
+  EXPECT_EQ(99, *Map[99]);
+}
+
+TEST(SwissDenseMapTest, CopyAndSwap) {
+  SwissDenseMap<int, int> A, B;
+  A[1] = 1;
+  B[2] = 2;
+  B[3] = 3;
+  A.swap(B);
+  EXPECT_EQ(2u, A.size());
+  EXPECT_EQ(1u, B.size());
+  B = A;
+  EXPECT_EQ(3, B.lookup(3));
+  EXPECT_EQ(2u, B.size());
+}
+
+TEST(SwissDenseMapTest, ConstIteration) {
+  SwissDenseMap<int, int> Map;
+  for (int I = 0; I != 40; ++I)
+    Map[I] = I;
+  const SwissDenseMap<int, int> &CMap = Map;
+  std::set<int> Keys;
+  for (SwissDenseMap<int, int>::const_iterator I = CMap.begin(),
+                                               E = CMap.end();
+       I != E; ++I)
+    Keys.insert(I->first);
+  EXPECT_EQ(40u, Keys.size());
+  SwissDenseMap<int, int>::const_iterator CI = Map.find(7);
+  EXPECT_EQ(7, CI->second);
+}
+
+struct LookupKeyInfo {
+  static unsigned getHashValue(int Key) { return Key; }
+  static unsigned getHashValue(long Key) { return unsigned(Key); }
+  static bool isEqual(int LHS, int RHS) { return LHS == RHS; }
+  static bool isEqual(long LHS, int RHS) { return LHS == RHS; }
+};
+
+TEST(SwissDenseMapTest, FindAs) {
+  SwissDenseMap<int, int, LookupKeyInfo> Map;
+  Map[5] = 50;
+  EXPECT_EQ(50, Map.find_as(5L)->second);
+  EXPECT_TRUE(Map.find_as(6L) == Map.end());
+}
+
+} // end anonymous namespace
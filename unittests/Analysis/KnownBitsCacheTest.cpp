@@ -0,0 +1,148 @@
+//===- KnownBitsCacheTest.cpp - Unit tests for the known bits cache -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/KnownBitsCache.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+namespace llvm {
+namespace {
+
+class KnownBitsCacheTest : public testing::Test {
+protected:
+  void parseAssembly(const char *Assembly) {
+    SMDiagnostic Error;
+    M = parseAssemblyString(Assembly, Error, Context);
+
+    std::string ErrMsg;
+    raw_string_ostream OS(ErrMsg);
+    Error.print("", OS);
+
+    // A failure here means that the test itself is buggy.
+    if (!M)
+      report_fatal_error(OS.str().c_str());
+
+    F = M->getFunction("test");
+    if (!F)
+      report_fatal_error("Test must have a function named @test");
+  }
+
+  Instruction *findInst(StringRef Name) {
+    for (BasicBlock &BB : *F)
+      for (Instruction &I : BB)
+        if (I.getName() == Name)
+          return &I;
+    report_fatal_error("No instruction of this name in the test function");
+  }
+
+  // Compute the known bits of V through the cache, and return the known
+  // zeros.
+  APInt knownZero(Value *V) {
+    APInt KnownZero(32, 0), KnownOne(32, 0);
+    computeKnownBits(V, KnownZero, KnownOne, M->getDataLayout(), 0, nullptr,
+                     nullptr, nullptr, &KBC);
+    return KnownZero;
+  }
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  Function *F;
+  KnownBitsCache KBC;
+};
+
+TEST_F(KnownBitsCacheTest, Lookup) {
+  parseAssembly("define i32 @test(i32 %x) {\n"
+                "  %a = shl i32 %x, 4\n"
+                "  %b = or i32 %a, 3\n"
+                "  ret i32 %b\n"
+                "}\n");
+  Instruction *A = findInst("a");
+  Instruction *B = findInst("b");
+  EXPECT_EQ(APInt(32, 0xc), knownZero(B));
+
+  // The query computed the bits of both instructions.
+  APInt KnownZero(32, 0), KnownOne(32, 0);
+  EXPECT_TRUE(KBC.lookupKnownBits(B, 0, KnownZero, KnownOne));
+  EXPECT_EQ(APInt(32, 0xc), KnownZero);
+  EXPECT_EQ(APInt(32, 3), KnownOne);
+  EXPECT_TRUE(KBC.lookupKnownBits(A, 1, KnownZero, KnownOne));
+  EXPECT_EQ(APInt(32, 0xf), KnownZero);
+  EXPECT_FALSE(KBC.lookupKnownBits(A, 0, KnownZero, KnownOne));
+  EXPECT_EQ(2u, KBC.size());
+
+  EXPECT_EQ(0u, KBC.lookupNumSignBits(B, 0));
+  KBC.cacheNumSignBits(B, 0, 2);
+  EXPECT_EQ(2u, KBC.lookupNumSignBits(B, 0));
+
+  KBC.clear();
+  EXPECT_EQ(0u, KBC.size());
+}
+
+TEST_F(KnownBitsCacheTest, Invalidate) {
+  parseAssembly("define i32 @test(i32 %x, i32 %y) {\n"
+                "  %a = shl i32 %x, 4\n"
+                "  %b = or i32 %a, 3\n"
+                "  %c = add i32 %y, 1\n"
+                "  %d = and i32 %b, %c\n"
+                "  ret i32 %d\n"
+                "}\n");
+  Instruction *A = findInst("a");
+  Instruction *B = findInst("b");
+  Instruction *C = findInst("c");
+  Instruction *D = findInst("d");
+  knownZero(D);
+  EXPECT_EQ(4u, KBC.size());
+
+  // Changing %a in place forgets it and the values computed from it, but
+  // not %c.
+  KBC.invalidate(A);
+  APInt KnownZero(32, 0), KnownOne(32, 0);
+  EXPECT_FALSE(KBC.lookupKnownBits(A, 2, KnownZero, KnownOne));
+  EXPECT_FALSE(KBC.lookupKnownBits(B, 1, KnownZero, KnownOne));
+  EXPECT_FALSE(KBC.lookupKnownBits(D, 0, KnownZero, KnownOne));
+  EXPECT_TRUE(KBC.lookupKnownBits(C, 1, KnownZero, KnownOne));
+  EXPECT_EQ(1u, KBC.size());
+}
+
+TEST_F(KnownBitsCacheTest, ReplaceAndErase) {
+  parseAssembly("define i32 @test(i32 %x, i32 %y) {\n"
+                "  %a = shl i32 %x, 4\n"
+                "  %b = or i32 %a, 3\n"
+                "  %c = shl i32 %y, 8\n"
+                "  ret i32 %b\n"
+                "}\n");
+  Instruction *A = findInst("a");
+  Instruction *B = findInst("b");
+  Instruction *C = findInst("c");
+  EXPECT_EQ(APInt(32, 0xc), knownZero(B));
+  EXPECT_EQ(APInt(32, 0xff), knownZero(C));
+
+  // Replacing %a forgets the bits of %b, which were computed from it.
+  A->replaceAllUsesWith(C);
+  A->eraseFromParent();
+  APInt KnownZero(32, 0), KnownOne(32, 0);
+  EXPECT_FALSE(KBC.lookupKnownBits(B, 0, KnownZero, KnownOne));
+  EXPECT_EQ(APInt(32, 0xfc), knownZero(B));
+
+  // Erasing an instruction forgets its bits.
+  unsigned Size = KBC.size();
+  B->replaceAllUsesWith(UndefValue::get(B->getType()));
+  B->eraseFromParent();
+  EXPECT_GT(Size, KBC.size());
+  EXPECT_TRUE(KBC.lookupKnownBits(C, 0, KnownZero, KnownOne));
+}
+
+} // end anonymous namespace
+} // end namespace llvm
@@ -0,0 +1,229 @@
+//===- MemorySSATest.cpp - Unit tests for MemorySSA -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+#include <functional>
+
+namespace llvm {
+namespace {
+
+typedef std::function<void(Function &, MemorySSA &)> MemorySSACallback;
+
+class MemorySSATestPass : public FunctionPass {
+public:
+  static char ID;
+  MemorySSATestPass(MemorySSACallback Callback)
+      : FunctionPass(ID), Callback(Callback) {}
+
+  static int initialize() {
+    PassInfo *PI = new PassInfo("MemorySSA testing pass", "", &ID, nullptr,
+                                false, false);
+    PassRegistry &Registry = *PassRegistry::getPassRegistry();
+    Registry.registerPass(*PI, false);
+    initializeAliasAnalysisAnalysisGroup(Registry);
+    initializeBasicAliasAnalysisPass(Registry);
+    initializeDominatorTreeWrapperPassPass(Registry);
+    initializeMemorySSAWrapperPassPass(Registry);
+    return 0;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<MemorySSAWrapperPass>();
+  }
+
+  bool runOnFunction(Function &F) override {
+    Callback(F, getAnalysis<MemorySSAWrapperPass>().getMSSA());
+    return false;
+  }
+
+private:
+  MemorySSACallback Callback;
+};
+
+char MemorySSATestPass::ID = 0;
+
+class MemorySSATest : public testing::Test {
+protected:
+  void parseAssembly(const char *Assembly) {
+    SMDiagnostic Error;
+    M = parseAssemblyString(Assembly, Error, Context);
+
+    std::string ErrMsg;
+    raw_string_ostream OS(ErrMsg);
+    Error.print("", OS);
+
+    // A failure here means that the test itself is buggy.
+    if (!M)
+      report_fatal_error(OS.str().c_str());
+  }
+
+  void runWithMemorySSA(MemorySSACallback Callback) {
+    static int Initialize = MemorySSATestPass::initialize();
+    (void)Initialize;
+    legacy::PassManager PM;
+    PM.add(createBasicAliasAnalysisPass());
+    PM.add(new MemorySSATestPass(Callback));
+    PM.run(*M);
+  }
+
+  static Instruction *findInst(Function &F, StringRef Name) {
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB)
+        if (I.getName() == Name)
+          return &I;
+    report_fatal_error("No instruction of this name in the test function");
+  }
+
+  static BasicBlock *findBlock(Function &F, StringRef Name) {
+    for (BasicBlock &BB : F)
+      if (BB.getName() == Name)
+        return &BB;
+    report_fatal_error("No block of this name in the test function");
+  }
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+};
+
+TEST_F(MemorySSATest, RemoveStore) {
+  parseAssembly("define i32 @f(i32* %p) {\n"
+                "entry:\n"
+                "  store i32 0, i32* %p\n"
+                "  store i32 1, i32* %p\n"
+                "  %v = load i32, i32* %p\n"
+                "  ret i32 %v\n"
+                "}\n");
+  runWithMemorySSA([&](Function &F, MemorySSA &MSSA) {
+    BasicBlock &Entry = F.getEntryBlock();
+    auto I = Entry.begin();
+    Instruction *First = I++;
+    Instruction *Second = I++;
+    Instruction *Load = I;
+
+    MemoryUseOrDef *FirstAccess = MSSA.getMemoryAccess(First);
+    MemoryUseOrDef *SecondAccess = MSSA.getMemoryAccess(Second);
+    MemoryUseOrDef *LoadAccess = MSSA.getMemoryAccess(Load);
+    ASSERT_TRUE(isa<MemoryDef>(SecondAccess));
+    ASSERT_TRUE(isa<MemoryUse>(LoadAccess));
+    EXPECT_EQ(SecondAccess,
+              MSSA.getWalker()->getClobberingMemoryAccess(Load));
+
+    MSSA.removeMemoryAccess(SecondAccess);
+    Second->eraseFromParent();
+    MSSA.verifyMemorySSA();
+
+    EXPECT_EQ(FirstAccess, LoadAccess->getDefiningAccess());
+    EXPECT_EQ(FirstAccess, MSSA.getWalker()->getClobberingMemoryAccess(Load));
+    EXPECT_EQ(2u, MSSA.getBlockAccesses(&Entry)->size());
+  });
+}
+
+TEST_F(MemorySSATest, CreateStoreInBlock) {
+  parseAssembly("define i32 @f(i32* %p, i32* %q) {\n"
+                "entry:\n"
+                "  store i32 0, i32* %p\n"
+                "  %v = load i32, i32* %q\n"
+                "  %w = load i32, i32* %p\n"
+                "  %s = add i32 %v, %w\n"
+                "  ret i32 %s\n"
+                "}\n");
+  runWithMemorySSA([&](Function &F, MemorySSA &MSSA) {
+    BasicBlock &Entry = F.getEntryBlock();
+    Instruction *V = findInst(F, "v");
+    Instruction *W = findInst(F, "w");
+    Argument *P = F.arg_begin();
+    MemoryUseOrDef *VAccess = MSSA.getMemoryAccess(V);
+    MemoryUseOrDef *WAccess = MSSA.getMemoryAccess(W);
+    MemoryAccess *OldDef = WAccess->getDefiningAccess();
+
+    // Store to %p between the two loads.
+    auto *NewStore = new StoreInst(ConstantInt::get(V->getType(), 1), P, W);
+    MemoryUseOrDef *NewAccess = MSSA.createMemoryAccessAfter(NewStore, VAccess);
+    MSSA.verifyMemorySSA();
+
+    ASSERT_TRUE(isa<MemoryDef>(NewAccess));
+    EXPECT_EQ(OldDef, NewAccess->getDefiningAccess());
+    EXPECT_EQ(OldDef, VAccess->getDefiningAccess());
+    EXPECT_EQ(NewAccess, WAccess->getDefiningAccess());
+    EXPECT_EQ(NewAccess, MSSA.getWalker()->getClobberingMemoryAccess(W));
+    EXPECT_EQ(4u, MSSA.getBlockAccesses(&Entry)->size());
+
+    // A load of %q at the beginning of the block sees the live-on-entry
+    // version.
+    auto *NewLoad = new LoadInst(std::next(F.arg_begin()), "", Entry.begin());
+    MemoryUseOrDef *LoadAccess =
+        MSSA.createMemoryAccessInBB(NewLoad, &Entry, MemorySSA::Beginning);
+    MSSA.verifyMemorySSA();
+    ASSERT_TRUE(isa<MemoryUse>(LoadAccess));
+    EXPECT_TRUE(MSSA.isLiveOnEntryDef(LoadAccess->getDefiningAccess()));
+  });
+}
+
+TEST_F(MemorySSATest, CreateStoreInBranch) {
+  parseAssembly("define i32 @f(i32* %p, i1 %c) {\n"
+                "entry:\n"
+                "  store i32 0, i32* %p\n"
+                "  br i1 %c, label %left, label %right\n"
+                "left:\n"
+                "  br label %merge\n"
+                "right:\n"
+                "  br label %merge\n"
+                "merge:\n"
+                "  %v = load i32, i32* %p\n"
+                "  ret i32 %v\n"
+                "}\n");
+  runWithMemorySSA([&](Function &F, MemorySSA &MSSA) {
+    BasicBlock *Left = findBlock(F, "left");
+    BasicBlock *Merge = findBlock(F, "merge");
+    Instruction *V = findInst(F, "v");
+    MemoryUseOrDef *EntryStore =
+        MSSA.getMemoryAccess(F.getEntryBlock().begin());
+    MemoryUseOrDef *VAccess = MSSA.getMemoryAccess(V);
+    EXPECT_EQ(EntryStore, VAccess->getDefiningAccess());
+    EXPECT_EQ(nullptr, MSSA.getMemoryAccess(Merge));
+
+    // A store on one side of the diamond needs a phi where the sides meet.
+    auto *NewStore = new StoreInst(ConstantInt::get(V->getType(), 1),
+                                   F.arg_begin(), Left->getTerminator());
+    MemoryUseOrDef *NewAccess =
+        MSSA.createMemoryAccessInBB(NewStore, Left, MemorySSA::End);
+    MSSA.verifyMemorySSA();
+
+    MemoryPhi *Phi = MSSA.getMemoryAccess(Merge);
+    ASSERT_NE(nullptr, Phi);
+    EXPECT_EQ(Phi, VAccess->getDefiningAccess());
+    EXPECT_EQ(NewAccess, Phi->getIncomingValueForBlock(Left));
+    EXPECT_EQ(EntryStore,
+              Phi->getIncomingValueForBlock(findBlock(F, "right")));
+    EXPECT_EQ(Phi, MSSA.getWalker()->getClobberingMemoryAccess(V));
+
+    // Removing it again leaves a phi of two equal values, which can go too.
+    MSSA.removeMemoryAccess(NewAccess);
+    NewStore->eraseFromParent();
+    EXPECT_EQ(EntryStore, Phi->getIncomingValueForBlock(Left));
+    MSSA.removeMemoryAccess(Phi);
+    MSSA.verifyMemorySSA();
+    EXPECT_EQ(EntryStore, VAccess->getDefiningAccess());
+    EXPECT_EQ(EntryStore, MSSA.getWalker()->getClobberingMemoryAccess(V));
+  });
+}
+
+} // end anonymous namespace
+} // end namespace llvm
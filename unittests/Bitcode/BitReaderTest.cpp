@@ -12,6 +12,7 @@
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -146,6 +147,97 @@ TEST(BitReaderTest, MaterializeFunctionsOutOfOrder) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// Tests that lazily loaded metadata is loaded on demand, and comes out the same
+// as when it is loaded eagerly.
+TEST(BitReaderTest, MaterializeMetadataOnDemand) {
+  const char *Assembly =
+      "@g = global i32 0\n"
+      "define i32 @f(i32* %p) {\n"
+      "  %v = load i32, i32* %p, !tbaa !0\n"
+      "  ret i32 %v, !dbg !9\n"
+      "}\n"
+      "define void @h() {\n"
+      "  store i32 0, i32* @g, !nontemporal !12\n"
+      "  ret void\n"
+      "}\n"
+      "!llvm.dbg.cu = !{!3}\n"
+      "!llvm.module.flags = !{!10}\n"
+      "!named = !{!11}\n"
+      "!0 = !{!1, !1, i64 0}\n"
+      "!1 = !{!\"int\", !2}\n"
+      "!2 = !{!\"tbaa root\"}\n"
+      "!3 = !DICompileUnit(language: DW_LANG_C99, file: !4, producer: "
+      "\"clang\", isOptimized: true, runtimeVersion: 0, emissionKind: 1, "
+      "subprograms: !5)\n"
+      "!4 = !DIFile(filename: \"t.c\", directory: \"/\")\n"
+      "!5 = !{!6}\n"
+      "!6 = !DISubprogram(name: \"f\", scope: !4, file: !4, line: 1, "
+      "isLocal: false, isDefinition: true, function: i32 (i32*)* @f)\n"
+      "!7 = distinct !{!7, !8}\n"
+      "!8 = !{!7}\n"
+      "!9 = !DILocation(line: 2, scope: !13, inlinedAt: !14)\n"
+      "!10 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+      "!11 = !{!\"named\"}\n"
+      "!12 = !{i32 1, !7}\n"
+      "!13 = distinct !DILexicalBlock(scope: !6, file: !4, line: 2)\n"
+      "!14 = !DILocation(line: 3, scope: !6)\n";
+
+  SmallString<1024> Mem;
+  writeModuleToBuffer(parseAssembly(Assembly), Mem);
+
+  std::string Expected;
+  {
+    LLVMContext Context;
+    ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(
+        MemoryBuffer::getMemBuffer(Mem.str(), "test", false), Context);
+    std::unique_ptr<Module> M(ModuleOrErr.get());
+    EXPECT_FALSE(M->materializeAllPermanently());
+    raw_string_ostream OS(Expected);
+    M->print(OS, nullptr);
+  }
+
+  LLVMContext Context;
+  ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(Mem.str(), "test", false), Context,
+      /*DiagnosticHandler=*/nullptr, /*ShouldLazyLoadMetadata=*/true);
+  std::unique_ptr<Module> M(ModuleOrErr.get());
+
+  // Named metadata and the nodes it refers to are there once asked for.
+  EXPECT_FALSE(M->materializeMetadata());
+  NamedMDNode *Named = M->getNamedMetadata("named");
+  ASSERT_EQ(1u, Named->getNumOperands());
+  EXPECT_EQ("named",
+            cast<MDString>(Named->getOperand(0)->getOperand(0))->getString());
+
+  // So is what a function body refers to, cycles and all.
+  Function *H = M->getFunction("h");
+  EXPECT_FALSE(H->materialize());
+  MDNode *NT = H->getEntryBlock().front().getMetadata("nontemporal");
+  ASSERT_TRUE(NT);
+  EXPECT_TRUE(NT->isResolved());
+  MDNode *Cycle = cast<MDNode>(NT->getOperand(1));
+  EXPECT_TRUE(Cycle->isResolved());
+  EXPECT_EQ(Cycle, Cycle->getOperand(0));
+
+  Function *F = M->getFunction("f");
+  EXPECT_FALSE(F->materialize());
+  const Instruction &Load = F->getEntryBlock().front();
+  MDNode *TBAA = Load.getMetadata(LLVMContext::MD_tbaa);
+  ASSERT_TRUE(TBAA);
+  EXPECT_FALSE(TBAA->isTemporary());
+  DILocation *Loc = F->getEntryBlock().getTerminator()->getDebugLoc();
+  ASSERT_TRUE(Loc);
+  EXPECT_TRUE(isa<DILexicalBlock>(Loc->getScope()));
+  EXPECT_EQ(3u, Loc->getInlinedAt()->getLine());
+
+  EXPECT_FALSE(M->materializeAllPermanently());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+  std::string Actual;
+  raw_string_ostream OS(Actual);
+  M->print(OS, nullptr);
+  EXPECT_EQ(Expected, OS.str());
+}
+
 TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   SmallString<1024> Mem;
 
@@ -0,0 +1,118 @@
+//===- llvm/unittest/IR/ConcurrentContextTest.cpp - Multithreaded context -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+#if LLVM_ENABLE_THREADS
+
+const unsigned NumThreads = 4;
+const unsigned NumIterations = 500;
+
+struct ThreadResult {
+  std::vector<Constant *> Ints;
+  std::vector<Type *> Types;
+  std::vector<MDNode *> Nodes;
+};
+
+// Create the same uniqued objects on every thread, in a different order, and
+// build a function using them in a module of its own.
+void buildModule(LLVMContext &C, Module &M, unsigned Thread,
+                 ThreadResult &Result) {
+  Type *I32 = Type::getInt32Ty(C);
+  Function *F =
+      Function::Create(FunctionType::get(I32, {I32}, false),
+                       GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *BB = BasicBlock::Create(C, "entry", F);
+  IRBuilder<> Builder(BB);
+  Value *Acc = F->arg_begin();
+  for (unsigned I = 0; I != NumIterations; ++I) {
+    unsigned N = Thread % 2 ? NumIterations - 1 - I : I;
+    Type *Ty = IntegerType::get(C, 1 + N % 100);
+    Constant *Int = ConstantInt::get(Ty, N);
+    Type *STy = StructType::get(Ty, PointerType::getUnqual(Ty), nullptr);
+    MDNode *Node = MDNode::get(
+        C, {MDString::get(C, "node"), ConstantAsMetadata::get(Int)});
+    Result.Ints.push_back(Int);
+    Result.Types.push_back(STy);
+    Result.Nodes.push_back(Node);
+
+    // Every add uses the same shared constant, which contends on its use
+    // list.
+    Acc = Builder.CreateAdd(Acc, ConstantInt::get(I32, 42));
+    cast<Instruction>(Acc)->setMetadata("node", Node);
+    WeakVH Handle(ConstantInt::get(I32, N));
+    (void)Handle;
+  }
+  Builder.CreateRet(Acc);
+
+  // Reverse the iterations of the odd threads, so that the results compare
+  // element-wise.
+  if (Thread % 2) {
+    std::reverse(Result.Ints.begin(), Result.Ints.end());
+    std::reverse(Result.Types.begin(), Result.Types.end());
+    std::reverse(Result.Nodes.begin(), Result.Nodes.end());
+  }
+}
+
+TEST(ConcurrentContextTest, UniquingAcrossThreads) {
+  LLVMContext C;
+  C.enableMultithreading();
+  EXPECT_TRUE(C.isMultithreaded());
+
+  std::vector<std::unique_ptr<Module>> Modules;
+  std::vector<ThreadResult> Results(NumThreads);
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Modules.emplace_back(new Module("m", C));
+
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Threads.emplace_back(buildModule, std::ref(C), std::ref(*Modules[I]), I,
+                         std::ref(Results[I]));
+  for (std::thread &T : Threads)
+    T.join();
+
+  // Every thread got the same uniqued objects.
+  for (unsigned I = 1; I != NumThreads; ++I) {
+    EXPECT_EQ(Results[0].Ints, Results[I].Ints);
+    EXPECT_EQ(Results[0].Types, Results[I].Types);
+    EXPECT_EQ(Results[0].Nodes, Results[I].Nodes);
+  }
+
+  // No use of the shared constant was lost.
+  Constant *FortyTwo = ConstantInt::get(Type::getInt32Ty(C), 42);
+  EXPECT_EQ(NumThreads * NumIterations, FortyTwo->getNumUses());
+
+  Modules.clear();
+  EXPECT_TRUE(FortyTwo->use_empty());
+}
+
+#endif
+
+TEST(ConcurrentContextTest, SingleThreadedByDefault) {
+  LLVMContext C;
+  EXPECT_FALSE(C.isMultithreaded());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,73 @@
+//===- llvm/unittest/Support/ParallelTest.cpp - Parallel algorithm tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "gtest/gtest.h"
+#include <random>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ParallelTest, ParallelFor) {
+  ThreadPool Pool(4);
+  std::vector<unsigned> Visits(10000, 0);
+  parallel_for(0, 10000, [&](int I) { ++Visits[I]; }, Pool);
+  for (unsigned V : Visits)
+    ASSERT_EQ(1u, V);
+}
+
+TEST(ParallelTest, ParallelForEach) {
+  ThreadPool Pool(4);
+  std::vector<uint64_t> Values(5000);
+  for (unsigned I = 0; I < Values.size(); ++I)
+    Values[I] = I;
+  parallel_for_each(Values.begin(), Values.end(), [](uint64_t &V) { V *= 2; },
+                    Pool);
+  for (unsigned I = 0; I < Values.size(); ++I)
+    ASSERT_EQ(2u * I, Values[I]);
+}
+
+TEST(ParallelTest, ParallelSort) {
+  std::mt19937 Generator(42);
+  std::vector<uint32_t> Values(100000);
+  for (auto &V : Values)
+    V = Generator() % 1000;
+  std::vector<uint32_t> Expected = Values;
+  std::sort(Expected.begin(), Expected.end());
+
+  ThreadPool Pool(4);
+  parallel_sort(Values.begin(), Values.end(), std::less<uint32_t>(), Pool);
+  ASSERT_EQ(Expected, Values);
+
+  // Sort in reverse with the default pool.
+  parallel_sort(Values.begin(), Values.end(), std::greater<uint32_t>());
+  std::reverse(Expected.begin(), Expected.end());
+  ASSERT_EQ(Expected, Values);
+}
+
+TEST(ParallelTest, TaskGroup) {
+  ThreadPool Pool(3);
+  std::atomic_int Count{0};
+  {
+    TaskGroup TG(Pool);
+    for (unsigned I = 0; I < 10; ++I)
+      TG.spawn([&] {
+        ++Count;
+        // Spawn more work into the same group from within a task.
+        TG.spawn([&] { ++Count; });
+      });
+    TG.sync();
+    ASSERT_EQ(20, Count);
+    TG.spawn([&] { ++Count; });
+  }
+  ASSERT_EQ(21, Count);
+}
+
+} // end anonymous namespace
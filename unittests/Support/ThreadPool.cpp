@@ -0,0 +1,89 @@
+//========- unittests/Support/ThreadPool.cpp - ThreadPool.h tests ---========//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, AsyncBarrier) {
+  std::atomic_int checked_in{0};
+
+  ThreadPool Pool;
+  for (size_t i = 0; i < 5; ++i) {
+    Pool.async([&checked_in, i] {
+      (void)i;
+      ++checked_in;
+    });
+  }
+  Pool.wait();
+  ASSERT_EQ(5, checked_in);
+}
+
+static void TestFunc(std::atomic_int &checked_in, int i) { checked_in += i; }
+
+TEST(ThreadPoolTest, AsyncBarrierArgs) {
+  std::atomic_int checked_in{0};
+
+  ThreadPool Pool;
+  for (size_t i = 0; i < 5; ++i) {
+    Pool.async(TestFunc, std::ref(checked_in), i);
+  }
+  Pool.wait();
+  ASSERT_EQ(10, checked_in);
+}
+
+TEST(ThreadPoolTest, Async) {
+  ThreadPool Pool(2);
+  std::atomic_int i{0};
+  auto F1 = Pool.async([&i] { ++i; });
+  auto F2 = Pool.async([&i] { ++i; });
+  F1.wait();
+  F2.wait();
+  ASSERT_EQ(2, i.load());
+}
+
+TEST(ThreadPoolTest, PoolDestruction) {
+  // Destroying the pool runs every task that was already queued.
+  std::atomic_int checked_in{0};
+  {
+    ThreadPool Pool(2);
+    for (size_t i = 0; i < 100; ++i)
+      Pool.async([&checked_in] { ++checked_in; });
+  }
+  ASSERT_EQ(100, checked_in);
+}
+
+TEST(ThreadPoolTest, NestedWaitFor) {
+  // A task that spawns and waits for sub-tasks must not deadlock, even when
+  // every worker is busy doing the same.
+  ThreadPool Pool(2);
+  std::atomic_int checked_in{0};
+  std::vector<std::shared_future<void>> Outer;
+  for (size_t i = 0; i < 8; ++i) {
+    Outer.push_back(Pool.async([&Pool, &checked_in] {
+      std::vector<std::shared_future<void>> Inner;
+      for (size_t j = 0; j < 8; ++j)
+        Inner.push_back(Pool.async([&checked_in] { ++checked_in; }));
+      for (auto &F : Inner)
+        Pool.waitFor(F);
+      ASSERT_TRUE(Pool.isWorkerThread() || !llvm_is_multithreaded());
+    }));
+  }
+  for (auto &F : Outer)
+    Pool.waitFor(F);
+  ASSERT_FALSE(Pool.isWorkerThread());
+  ASSERT_EQ(64, checked_in);
+}
+
+} // end anonymous namespace